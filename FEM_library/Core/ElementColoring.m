@@ -0,0 +1,26 @@
+function [ COLORING ] = ElementColoring( elements, numElemDof, numNodes )
+%ELEMENTCOLORING greedy coloring of the mesh elements
+%
+%   COLORING = ELEMENTCOLORING(ELEMENTS, NUMELEMDOF, NUMNODES) assigns a
+%   color to each element so that elements sharing a node have different
+%   colors. The elements of a color can then be scattered in parallel into
+%   the global matrix or vector without atomic updates, see
+%   SparseScatterMap and GlobalAssembleColored. COLORING is a struct with
+%   fields
+%       ptr       - (numColors+1) x 1 int32, 0-based offsets in elements
+%       elements  - numElem x 1 int32, 0-based element indices grouped by
+%                   color (in their original order inside each color)
+%       numColors - number of colors
+%
+%   The coloring depends only on the connectivity and is computed once per
+%   mesh.
+
+%   This file is part of redbKIT.
+%   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+%   Author: Federico Negri <federico.negri at epfl.ch>
+
+[COLORING.ptr, COLORING.elements] = SparseScatter_C('color', elements, numElemDof, numNodes);
+
+COLORING.numColors = length(COLORING.ptr) - 1;
+
+end
@@ -0,0 +1,140 @@
+%GeometryCache physical gradients of the basis functions on each element
+% GeometryCache methods:
+%    GeometryCache      - constructor
+%    GetData            - return the struct to be passed to the C assemblers
+%    IsAvailable        - true if the gradients have been precomputed
+%    GetMemory          - memory (MB) used by the cached gradients
+%
+% GeometryCache properties:
+%    M_precision        - 'double' or 'single'
+%    M_numQuadPoints    - number of stored quadrature points per element
+%                         (1 if the gradients are constant on each element)
+%    M_gradphi          - array dim x numElemDof x M_numQuadPoints x numElem
+%    M_dphi_ref         - reference gradients (FE_SPACE.dphi_ref)
+%
+%   CACHE = GEOMETRYCACHE(MESH, FE_SPACE, PRECISION, BUDGET) computes
+%   gradphi = invjac' * dphi_ref on each element and quadrature node, as
+%   done inside the element loops of the C assemblers. PRECISION is
+%   'double' (default) or 'single'. BUDGET is the max memory in MB that
+%   can be used by the cache (default Inf): if the cached gradients do not
+%   fit into BUDGET, the cache is not built and the assemblers recompute
+%   the gradients on the fly.
+%
+%   For affine elements with constant reference gradients (P1) only one
+%   value per element is stored.
+%
+%   The struct returned by CACHE.GetData() can be passed to the C
+%   assemblers in place of FE_SPACE.dphi_ref.
+
+%   This file is part of redbKIT.
+%   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+%   Author: Federico Negri <federico.negri at epfl.ch>
+
+classdef GeometryCache < handle
+
+    properties (GetAccess = public, SetAccess = protected)
+        M_precision;
+        M_numQuadPoints;
+        M_gradphi;
+        M_dphi_ref;
+    end
+
+    methods
+
+        %==========================================================================
+        %% Constructor
+        function obj = GeometryCache( MESH, FE_SPACE, precision, budget )
+
+            if nargin < 3 || isempty(precision)
+                precision = 'double';
+            end
+
+            if nargin < 4 || isempty(budget)
+                budget = Inf;
+            end
+
+            obj.M_precision = precision;
+            obj.M_dphi_ref  = FE_SPACE.dphi_ref;
+            obj.M_gradphi   = [];
+
+            dim           = MESH.dim;
+            nln           = FE_SPACE.numElemDof;
+            numQuadPoints = FE_SPACE.numQuadNodes;
+            noe           = MESH.numElem;
+
+            dphi_ref      = reshape(FE_SPACE.dphi_ref, nln, numQuadPoints, dim);
+
+            % affine elements with constant reference gradients: store
+            % only one value per element
+            dphi_var = bsxfun(@minus, dphi_ref, dphi_ref(:,1,:));
+            if max(abs(dphi_var(:))) <= 1e-14 * max(1, max(abs(dphi_ref(:))))
+                obj.M_numQuadPoints = 1;
+                dphi_ref            = dphi_ref(:,1,:);
+            else
+                obj.M_numQuadPoints = numQuadPoints;
+            end
+
+            switch precision
+                case 'double'
+                    bytes = 8;
+                case 'single'
+                    bytes = 4;
+                otherwise
+                    error('GeometryCache: precision %s not available, use double or single', precision);
+            end
+
+            memory = bytes * dim * nln * obj.M_numQuadPoints * noe / 1024^2;
+            if memory > budget
+                fprintf('\n GeometryCache: %2.1f MB required, budget is %2.1f MB. Gradients will be recomputed.', memory, budget);
+                return;
+            end
+
+            invjac = MESH.invjac;
+            if ismatrix(invjac) && size(invjac,1) == dim*dim && dim > 1
+                % element-contiguous layout (geotrasf with 'AoS')
+                invjac = reshape(invjac', noe, dim, dim);
+            end
+
+            gradphi = zeros(dim, nln, obj.M_numQuadPoints, noe, precision);
+            for d1 = 1 : dim
+                for d2 = 1 : dim
+                    gradphi(d1,:,:,:) = gradphi(d1,:,:,:) + ...
+                        cast( bsxfun(@times, reshape(dphi_ref(:,:,d2), [1 nln obj.M_numQuadPoints 1]), ...
+                                             reshape(invjac(:,d1,d2), [1 1 1 noe])), precision);
+                end
+            end
+            obj.M_gradphi = gradphi;
+
+        end
+
+        %==========================================================================
+        %% GetData
+        function data = GetData( obj )
+
+            data.dphi_ref      = obj.M_dphi_ref;
+            data.gradphi       = obj.M_gradphi;
+            data.numQuadPoints = obj.M_numQuadPoints;
+
+        end
+
+        %==========================================================================
+        %% IsAvailable
+        function flag = IsAvailable( obj )
+
+            flag = ~isempty( obj.M_gradphi );
+
+        end
+
+        %==========================================================================
+        %% GetMemory
+        function memory = GetMemory( obj )
+
+            tmp    = obj.M_gradphi; %#ok<NASGU>
+            info   = whos('tmp');
+            memory = info.bytes / 1024^2;
+
+        end
+
+    end
+
+end
@@ -11,6 +11,11 @@ function A = GlobalAssemble( i, j, s, m, n )
 %
 %   If the FAST package is available, then GLOBALASSEMBLE calls fsparse,
 %   otherwise it calls Matlab built-in sparse function.
+%
+%   Vectors i and j can be double or integer (int32, int64) arrays, as
+%   returned by the C assemblers when the connectivity is passed as int32.
+%   Vector s can be single (C assemblers called with the _single suffix):
+%   the coefficients are summed and the matrix is stored in double.
 % 
 %   The sintax of GLOBALASSEMBLE is the same as that of sparse and fsparse;
 %   please type help sparse or help sparse. For instance
@@ -28,12 +33,31 @@ function A = GlobalAssemble( i, j, s, m, n )
 %   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
 %   Author: Federico Negri <federico.negri at epfl.ch> 
 
+if isa(s, 'single')
+    s = double(s);
+end
+
 if exist('fsparse', 'file') == 3
     
+    % fsparse handles int32 indices natively
+    if isinteger(i) && ~isa(i, 'int32')
+        i = double(i);
+    end
+    if isinteger(j) && ~isa(j, 'int32')
+        j = double(j);
+    end
+    
     A = fsparse( i, j, s, [m, n] );
     
 else
     
+    if isinteger(i)
+        i = double(i);
+    end
+    if isinteger(j)
+        j = double(j);
+    end
+    
     A = sparse( i, j, s, m, n );
     
 end
@@ -0,0 +1,26 @@
+function F = GlobalAssembleColored( rows, coef, n, COLORING )
+%GLOBALASSEMBLECOLORED build a vector from elemental contributions
+%
+%   F = GLOBALASSEMBLECOLORED(ROWS, COEF, N, COLORING) returns the full
+%   N x 1 vector with F(ROWS(k)) summing the COEF(k). The contributions are
+%   assumed to be stored element by element (length(COEF)/numElem
+%   consecutive entries per element, as returned by the C assemblers) and
+%   are scattered color by color in parallel, COLORING being the struct
+%   returned by ElementColoring; an error is raised if two elements of a
+%   color write the same entry. If COLORING is empty, GlobalAssemble is
+%   called instead.
+%
+%   See also ElementColoring, GlobalAssemble.
+
+%   This file is part of redbKIT.
+%   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+%   Author: Federico Negri <federico.negri at epfl.ch>
+
+if isempty(COLORING)
+    F = GlobalAssemble(rows, 1, coef, n, 1);
+    return;
+end
+
+F = SparseScatter_C('assemble_vector', rows, coef, n, COLORING.ptr, COLORING.elements);
+
+end
@@ -0,0 +1,19 @@
+function A = GlobalAssembleSymmetric( i, j, s, n )
+%GLOBALASSEMBLESYMMETRIC Create symmetric sparse matrix from its upper triangle
+% 
+%   A = GLOBALASSEMBLESYMMETRIC(i,j,s,n) builds the n-by-n symmetric sparse
+%   matrix whose upper triangle is GLOBALASSEMBLE(i,j,s,n,n), i.e. i(k) <=
+%   j(k) for all k. This is the format returned by the C assemblers in
+%   symmetric mode, where only the upper triangle of each local matrix is
+%   computed.
+%
+%   See also GlobalAssemble.
+
+%   This file is part of redbKIT.
+%   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+%   Author: Federico Negri <federico.negri at epfl.ch> 
+
+A = GlobalAssemble( i, j, s, n, n );
+A = A + triu(A, 1).';
+
+end
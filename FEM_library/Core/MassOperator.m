@@ -0,0 +1,163 @@
+%MassOperator compact representation of the FE mass matrix on affine elements
+% MassOperator methods:
+%    MassOperator       - constructor
+%    Apply              - compute M*V without assembling M
+%    GetDiagonal        - diagonal of the lumped mass matrix
+%    GetMatrix          - sparse mass matrix (diagonal if lumped)
+%    IsLumped           - true for the lumped mass types
+%
+% MassOperator properties:
+%    M_type             - 'consistent', 'rowsum' or 'HRZ'
+%    M_scaling          - multiplicative coefficient (e.g. density)
+%    M_diagonal         - lumped mass, numDof x 1 (only for lumped types)
+%    M_Coloring         - element coloring used by Apply (see ElementColoring),
+%                         empty if the elemental products are scattered
+%                         with atomic updates
+%
+%   On affine elements the element mass matrices are detjac * M_ref, so
+%   the operator is fully described by the reference mass matrix and by
+%   MESH.jac: M*V is computed element by element (MassOperator_C_omp)
+%   instead of storing numElemDof^2 * numElem triplets. The lumped types
+%   return the row-sum and the HRZ (scaled diagonal) lumped matrices;
+%   note that for P2 elements the row-sum lumping yields zero vertex
+%   masses, HRZ should be used instead.
+%
+%   See also Mass_assembler_C_omp, MassOperator_C_omp.
+
+%   This file is part of redbKIT.
+%   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+%   Author: Federico Negri <federico.negri at epfl.ch>
+
+classdef MassOperator < handle
+
+    properties (GetAccess = public, SetAccess = protected)
+        M_type;
+        M_scaling;
+        M_diagonal;
+        M_Coloring;
+    end
+
+    properties (Access = protected)
+        M_dim;
+        M_elements;
+        M_jac;
+        M_FE_SPACE;
+    end
+
+    methods
+
+        %==========================================================================
+        %% Constructor
+        function obj = MassOperator( MESH, FE_SPACE, type, scaling, coloring )
+            % if COLORING is true (e.g. DATA.Assembly.coloring), Apply
+            % scatters the elemental products color by color
+
+            if nargin < 3 || isempty(type)
+                type = 'consistent';
+            end
+
+            if nargin < 4 || isempty(scaling)
+                scaling = 1;
+            end
+
+            if nargin < 5 || isempty(coloring)
+                coloring = false;
+            end
+
+            obj.M_type     = type;
+            obj.M_scaling  = scaling;
+            obj.M_dim      = MESH.dim;
+            % int32 connectivity, half the memory of the double one
+            obj.M_elements = int32( MESH.elements );
+            obj.M_jac      = MESH.jac;
+            obj.M_FE_SPACE = FE_SPACE;
+
+            obj.M_Coloring = [];
+            if coloring && ~IsLumped( obj )
+                obj.M_Coloring = ElementColoring(obj.M_elements, FE_SPACE.numElemDof, FE_SPACE.numDofScalar);
+            end
+
+            switch type
+
+                case 'consistent'
+                    obj.M_diagonal = [];
+
+                case {'rowsum', 'HRZ'}
+                    d = MassOperator_C_omp(['lumped_',type], MESH.dim, obj.M_elements, FE_SPACE.numElemDof, ...
+                        FE_SPACE.numDofScalar, FE_SPACE.quad_weights, MESH.jac, FE_SPACE.phi);
+                    obj.M_diagonal = scaling * repmat(d, FE_SPACE.numComponents, 1);
+
+                otherwise
+                    error('MassOperator: unknown mass type %s', type);
+            end
+
+        end
+
+        %==========================================================================
+        %% Apply
+        function Y = Apply( obj, V )
+
+            if IsLumped( obj )
+                Y = obj.M_diagonal .* V;
+                return;
+            end
+
+            V = reshape(full(V), obj.M_FE_SPACE.numDofScalar, obj.M_FE_SPACE.numComponents);
+
+            input_args = {obj.M_dim, obj.M_elements, obj.M_FE_SPACE.numElemDof, ...
+                obj.M_FE_SPACE.numDofScalar, obj.M_FE_SPACE.quad_weights, obj.M_jac, obj.M_FE_SPACE.phi, V};
+
+            if ~isempty(obj.M_Coloring)
+                input_args = [input_args, {obj.M_Coloring.ptr, obj.M_Coloring.elements}];
+            end
+
+            Y = MassOperator_C_omp('apply', input_args{:});
+
+            Y = obj.M_scaling * Y(:);
+
+        end
+
+        %==========================================================================
+        %% GetDiagonal
+        function d = GetDiagonal( obj )
+
+            if ~IsLumped( obj )
+                error('MassOperator: GetDiagonal is available only for lumped mass types');
+            end
+            d = obj.M_diagonal;
+
+        end
+
+        %==========================================================================
+        %% GetMatrix
+        function M = GetMatrix( obj )
+
+            if IsLumped( obj )
+                n = length(obj.M_diagonal);
+                M = spdiags(obj.M_diagonal, 0, n, n);
+                return;
+            end
+
+            [rowM, colM, coefM] = Mass_assembler_C_omp(obj.M_dim, obj.M_elements, obj.M_FE_SPACE.numElemDof, ...
+                obj.M_FE_SPACE.quad_weights, obj.M_jac, obj.M_FE_SPACE.phi);
+
+            M_scalar = GlobalAssemble(rowM, colM, obj.M_scaling * coefM, ...
+                obj.M_FE_SPACE.numDofScalar, obj.M_FE_SPACE.numDofScalar);
+            M        = [];
+            for k = 1 : obj.M_FE_SPACE.numComponents
+                M = blkdiag(M, M_scalar);
+            end
+
+        end
+
+        %==========================================================================
+        %% IsLumped
+        function flag = IsLumped( obj )
+
+            flag = ~strcmp(obj.M_type, 'consistent');
+
+        end
+
+    end
+
+end
@@ -0,0 +1,44 @@
+function SetOmpSettings(num_threads, schedule, chunk)
+%SETOMPSETTINGS set number of threads and schedule of the C assemblers
+%
+%   SETOMPSETTINGS(NUM_THREADS, SCHEDULE, CHUNK) sets the number of OpenMP
+%   threads and the schedule ('static', 'dynamic' or 'guided', with chunk
+%   size CHUNK) used by the following calls to the compiled assemblers,
+%   which read them at each call (see SetOmpRuntime in Tools.c). Empty
+%   arguments keep the default values.
+%
+%   SETOMPSETTINGS() restores the defaults: static schedule, and
+%   OMP_NUM_THREADS or all the cores.
+%
+%   With the static schedule the output arrays of each element are first
+%   touched by the thread which assembles it; with a dynamic or guided
+%   schedule the NUMA placement of the outputs is not preserved.
+
+%   This file is part of redbKIT.
+%   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+%   Author: Federico Negri <federico.negri at epfl.ch>
+
+global redbKIT_OMP_SETTINGS
+
+if nargin == 0
+    redbKIT_OMP_SETTINGS = [];
+    return;
+end
+
+if nargin < 2
+    schedule = [];
+end
+
+if nargin < 3
+    chunk = [];
+end
+
+if ~isempty(schedule) && ~any(strcmp(schedule, {'static', 'dynamic', 'guided'}))
+    error('SetOmpSettings: unknown schedule %s', schedule);
+end
+
+redbKIT_OMP_SETTINGS.num_threads = num_threads;
+redbKIT_OMP_SETTINGS.schedule    = schedule;
+redbKIT_OMP_SETTINGS.chunk       = chunk;
+
+end
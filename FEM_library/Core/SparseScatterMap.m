@@ -0,0 +1,194 @@
+%SparseScatterMap sparsity pattern and triplet-to-slot map of a FE matrix
+% SparseScatterMap methods:
+%    SparseScatterMap   - constructor
+%    Assemble           - assemble sparse matrix from elemental coefficients
+%    Matrix             - sparse matrix from the value array of the pattern
+%    IsCompatible       - check whether a set of triplets can be assembled
+%    GetNnz             - number of nonzeros of the pattern
+%    CreateCache        - cache of maps and element coloring of an assembler
+%    ScatterInputs      - extra inputs of the C assemblers for a direct
+%                         scatter into the cached pattern
+%    AssembleCached     - assemble a matrix reusing the cached map
+%
+% SparseScatterMap properties:
+%    M_numRows          - number of rows of the assembled matrix
+%    M_numCols          - number of columns of the assembled matrix
+%    M_numEntries       - number of (row, col, coef) triplets
+%    M_ir, M_jc         - compressed column pattern (0-based, int32)
+%    M_map              - position of each triplet in the value array
+%    M_Coloring         - element coloring (see ElementColoring), optional
+%
+%   The pattern depends only on the mesh connectivity and on the local
+%   ordering of the assembler, hence it can be computed once and reused
+%   at each Newton iteration or time step: the sort and merge of the
+%   triplets performed by sparse/fsparse is replaced by a scatter of the
+%   coefficients into the value array of the compressed matrix.
+%
+%   The maps of an assembler are cached by name (CreateCache) for the
+%   lifetime of the assembler, hence for its mesh and FE spaces: each name
+%   must identify one operation of the C assemblers, i.e. one layout of
+%   the triplets. Once the map of an operation is known, the C assembler
+%   is called with the suffix _scatter and the inputs of ScatterInputs:
+%   the local matrices are then summed, with atomic updates, directly into
+%   the value array of the compressed matrix and the triplets are not even
+%   allocated (see CoefFormat in Tools.h).
+%
+%   If an element coloring is given, the triplets are assumed to be stored
+%   element by element and they are scattered color by color, without
+%   atomic updates; Assemble checks that no two elements of a color write
+%   the same entry.
+%
+%   See also GlobalAssemble, SparseScatter_C.
+
+%   This file is part of redbKIT.
+%   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+%   Author: Federico Negri <federico.negri at epfl.ch>
+
+classdef SparseScatterMap < handle
+
+    properties (GetAccess = public, SetAccess = protected)
+        M_numRows;
+        M_numCols;
+        M_numEntries;
+        M_ir;
+        M_jc;
+        M_map;
+        M_Coloring;
+    end
+
+    methods
+
+        %==========================================================================
+        %% Constructor
+        function obj = SparseScatterMap( rows, cols, m, n, Coloring )
+
+            if nargin < 5
+                Coloring = [];
+            end
+
+            obj.M_numRows    = m;
+            obj.M_numCols    = n;
+            obj.M_numEntries = length(rows);
+            obj.M_Coloring   = Coloring;
+
+            [obj.M_ir, obj.M_jc, obj.M_map] = SparseScatter_C('pattern', rows, cols, m, n);
+
+        end
+
+        %==========================================================================
+        %% Assemble
+        function A = Assemble( obj, coef )
+
+            if isempty(obj.M_Coloring)
+                A = SparseScatter_C('assemble', obj.M_ir, obj.M_jc, obj.M_map, coef, obj.M_numRows, obj.M_numCols);
+            else
+                A = SparseScatter_C('assemble', obj.M_ir, obj.M_jc, obj.M_map, coef, obj.M_numRows, obj.M_numCols, ...
+                    obj.M_Coloring.ptr, obj.M_Coloring.elements);
+            end
+
+        end
+
+        %==========================================================================
+        %% Matrix
+        function A = Matrix( obj, nzval )
+
+            A = SparseScatter_C('matrix', obj.M_ir, obj.M_jc, nzval, obj.M_numRows, obj.M_numCols);
+
+        end
+
+        %==========================================================================
+        %% IsCompatible
+        function flag = IsCompatible( obj, rows, cols, m, n )
+
+            flag = obj.M_numEntries == length(rows) && length(cols) == length(rows) ...
+                && obj.M_numRows == m && obj.M_numCols == n;
+
+        end
+
+        %==========================================================================
+        %% GetNnz
+        function nnz = GetNnz( obj )
+
+            nnz = double( obj.M_jc(end) );
+
+        end
+
+    end
+
+    methods (Static)
+
+        %==========================================================================
+        %% CreateCache
+        function [ScatterMaps, Coloring] = CreateCache( DATA, elements, numElemDof, numNodes )
+            % ScatterMaps is an empty containers.Map if
+            % DATA.Assembly.cache_pattern is true, [] otherwise; Coloring
+            % is the element coloring if DATA.Assembly.coloring is true,
+            % computed once per mesh, [] otherwise
+
+            ScatterMaps = [];
+            Coloring    = [];
+            if ~isfield(DATA, 'Assembly')
+                return;
+            end
+
+            if isfield(DATA.Assembly, 'cache_pattern') && DATA.Assembly.cache_pattern
+                ScatterMaps = containers.Map();
+            end
+
+            if isfield(DATA.Assembly, 'coloring') && DATA.Assembly.coloring
+                Coloring = ElementColoring(elements, numElemDof, numNodes);
+            end
+
+        end
+
+        %==========================================================================
+        %% ScatterInputs
+        function [suffix, inputs] = ScatterInputs( ScatterMaps, name )
+            % if the map associated with NAME has been computed, SUFFIX =
+            % '_scatter' has to be appended to the name of the operation of
+            % the C assembler and INPUTS = {map, nnz} to its inputs; the
+            % first matrix it returns is then the value array of the
+            % compressed matrix, to be passed to AssembleCached with empty
+            % rows and cols
+
+            suffix = '';
+            inputs = {};
+            if ~isempty(ScatterMaps) && isKey(ScatterMaps, name)
+                Map    = ScatterMaps(name);
+                suffix = '_scatter';
+                inputs = {Map.M_map, GetNnz(Map)};
+            end
+
+        end
+
+        %==========================================================================
+        %% AssembleCached
+        function A = AssembleCached( ScatterMaps, name, rows, cols, coef, m, n, Coloring )
+            % the map associated with NAME is computed the first time from
+            % ROWS and COLS; later on, COEF is the value array returned by
+            % the C assembler called with the ScatterInputs (ROWS and COLS
+            % are empty), or the triplet coefficients, which are scattered
+            % through the map; without a cache (ScatterMaps = []) the
+            % matrix is built by GlobalAssemble
+
+            if isempty(ScatterMaps)
+                A = GlobalAssemble(rows, cols, coef, m, n);
+                return;
+            end
+
+            if isKey(ScatterMaps, name) && isempty(rows)
+                A = Matrix(ScatterMaps(name), coef);
+                return;
+            end
+
+            if ~isKey(ScatterMaps, name) || ~IsCompatible(ScatterMaps(name), rows, cols, m, n)
+                ScatterMaps(name) = SparseScatterMap(rows, cols, m, n, Coloring);
+            end
+
+            A = Assemble(ScatterMaps(name), coef);
+
+        end
+
+    end
+
+end
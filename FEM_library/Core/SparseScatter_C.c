@@ -0,0 +1,626 @@
+/*   This file is part of redbKIT.
+ *   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+ *   Author: Federico Negri <federico.negri@epfl.ch>
+ */
+
+#include "mex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include "Tools.h"
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#warning "OpenMP not enabled. Compile with mex SparseScatter_C.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp""
+#endif
+
+/*************************************************************************/
+static int compareInt(const void * a, const void * b)
+{
+    return ( *(const int*)a - *(const int*)b );
+}
+
+/*************************************************************************/
+/* Compute the compressed column pattern of the matrix defined by the
+ * triplets (rows, cols) and the map between each triplet and its slot in
+ * the value array of the compressed matrix */
+void ComputePattern(mxArray* plhs[], const mxArray* prhs[])
+{
+    long long* rows = GetIndexData(prhs[1]);
+    long long* cols = GetIndexData(prhs[2]);
+    if ( mxGetScalar(prhs[3]) > 2147483647.0 || mxGetScalar(prhs[4]) > 2147483647.0 )
+    {
+        mexErrMsgTxt("The number of rows and columns of the pattern must not exceed the maximum int32 value.");
+    }
+
+    int numRows  = (int) mxGetScalar(prhs[3]);
+    int numCols  = (int) mxGetScalar(prhs[4]);
+
+    mwSize numEntries = mxGetM(prhs[1]) * mxGetN(prhs[1]);
+
+    if ( mxGetM(prhs[2]) * mxGetN(prhs[2]) != numEntries )
+    {
+        mexErrMsgTxt("rows and cols must have the same number of entries.");
+    }
+
+    mwIndex k;
+    int j;
+
+    /* Bucket the triplets by column (counting sort) */
+    mwIndex* colStart = (mwIndex*) mxCalloc(numCols+1, sizeof(mwIndex));
+    mwIndex* colPos   = (mwIndex*) mxCalloc(numCols, sizeof(mwIndex));
+    mwIndex* order    = (mwIndex*) mxMalloc(numEntries * sizeof(mwIndex));
+    int* uniqueRows   = (int*) mxMalloc(numEntries * sizeof(int));
+    int* colNnz       = (int*) mxCalloc(numCols, sizeof(int));
+
+    for (k = 0; k < numEntries; k = k + 1 )
+    {
+        if ( cols[k] < 1 || cols[k] > numCols || rows[k] < 1 || rows[k] > numRows )
+        {
+            mexErrMsgTxt("Index exceeds matrix dimensions.");
+        }
+        j = cols[k] - 1;
+        colStart[j+1] = colStart[j+1] + 1;
+    }
+
+    for (j = 0; j < numCols; j = j + 1 )
+    {
+        colStart[j+1] = colStart[j+1] + colStart[j];
+        colPos[j]     = colStart[j];
+    }
+
+    for (k = 0; k < numEntries; k = k + 1 )
+    {
+        j = cols[k] - 1;
+        order[colPos[j]] = k;
+        colPos[j] = colPos[j] + 1;
+    }
+
+    /* Extract the sorted unique rows of each column */
+    #pragma omp parallel firstprivate(numRows, numCols) private(j, k)
+    {
+        int* marker = (int*) malloc(numRows * sizeof(int));
+        int r;
+        for (r = 0; r < numRows; r = r + 1 )
+        {
+            marker[r] = -1;
+        }
+
+        #pragma omp for schedule(dynamic, 256)
+        for (j = 0; j < numCols; j = j + 1 )
+        {
+            int cnt = 0;
+            for (k = colStart[j]; k < colStart[j+1]; k = k + 1 )
+            {
+                r = rows[order[k]] - 1;
+                if ( marker[r] != j )
+                {
+                    marker[r] = j;
+                    uniqueRows[colStart[j] + cnt] = r;
+                    cnt = cnt + 1;
+                }
+            }
+            qsort(uniqueRows + colStart[j], cnt, sizeof(int), compareInt);
+            colNnz[j] = cnt;
+        }
+        free(marker);
+    }
+
+    /* Column pointers */
+    long long nnz = 0;
+    for (j = 0; j < numCols; j = j + 1 )
+    {
+        nnz = nnz + colNnz[j];
+    }
+    if ( nnz > 2147483647 )
+    {
+        mexErrMsgTxt("Number of nonzeros exceeds the maximum int32 value.");
+    }
+
+    plhs[0] = mxCreateNumericMatrix((int)nnz, 1, mxINT32_CLASS, mxREAL);
+    plhs[1] = mxCreateNumericMatrix(numCols+1, 1, mxINT32_CLASS, mxREAL);
+    plhs[2] = mxCreateNumericMatrix(numEntries, 1, mxINT32_CLASS, mxREAL);
+
+    int* ir  = (int*) mxGetData(plhs[0]);
+    int* jc  = (int*) mxGetData(plhs[1]);
+    int* map = (int*) mxGetData(plhs[2]);
+
+    jc[0] = 0;
+    for (j = 0; j < numCols; j = j + 1 )
+    {
+        jc[j+1] = jc[j] + colNnz[j];
+    }
+
+    /* Row indices and triplet-to-slot map */
+    #pragma omp parallel firstprivate(numRows, numCols) private(j, k)
+    {
+        int* slot = (int*) malloc(numRows * sizeof(int));
+        int r, q;
+
+        #pragma omp for schedule(dynamic, 256)
+        for (j = 0; j < numCols; j = j + 1 )
+        {
+            for (q = 0; q < colNnz[j]; q = q + 1 )
+            {
+                r = uniqueRows[colStart[j] + q];
+                ir[jc[j] + q] = r;
+                slot[r] = jc[j] + q;
+            }
+            for (k = colStart[j]; k < colStart[j+1]; k = k + 1 )
+            {
+                r = rows[order[k]] - 1;
+                map[order[k]] = slot[r];
+            }
+        }
+        free(slot);
+    }
+
+    mxFree(colStart);
+    mxFree(colPos);
+    mxFree(order);
+    mxFree(uniqueRows);
+    mxFree(colNnz);
+    
+    ReleaseIndexData(rows, prhs[1]);
+    ReleaseIndexData(cols, prhs[2]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Greedy coloring of the elements: elements sharing a node get different
+ * colors, hence the elements of one color can be assembled in parallel
+ * into the global matrix or vector without atomics. The elements are
+ * returned grouped by color, in their original order inside each color
+ * (0-based colorPtr and colorElements). */
+void ColorElements(mxArray* plhs[], const mxArray* prhs[])
+{
+    long long* elements    = GetIndexData(prhs[1]);
+    int nln                = (int) mxGetScalar(prhs[2]);
+    int numNodes           = (int) mxGetScalar(prhs[3]);
+    mwSize numRowsElements = mxGetM(prhs[1]);
+    int noe                = mxGetN(prhs[1]);
+
+    if ( nln > numRowsElements )
+    {
+        mexErrMsgTxt("nln exceeds the number of rows of elements.");
+    }
+
+    int ie, a, n;
+    mwIndex k;
+
+    /* Elements of each node (compressed storage) */
+    mwIndex* nodeStart = (mwIndex*) mxCalloc(numNodes+1, sizeof(mwIndex));
+    mwIndex* nodePos   = (mwIndex*) mxMalloc(numNodes * sizeof(mwIndex));
+    int* nodeElements = (int*) mxMalloc((mwSize) nln * noe * sizeof(int));
+
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            if ( elements[a+ie*numRowsElements] < 1 || elements[a+ie*numRowsElements] > numNodes )
+            {
+                mexErrMsgTxt("Index exceeds the number of nodes.");
+            }
+            n = elements[a+ie*numRowsElements] - 1;
+            nodeStart[n+1] = nodeStart[n+1] + 1;
+        }
+    }
+
+    for (n = 0; n < numNodes; n = n + 1 )
+    {
+        nodeStart[n+1] = nodeStart[n+1] + nodeStart[n];
+        nodePos[n]     = nodeStart[n];
+    }
+
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            n = elements[a+ie*numRowsElements] - 1;
+            nodeElements[nodePos[n]] = ie;
+            nodePos[n] = nodePos[n] + 1;
+        }
+    }
+
+    /* First-fit coloring in the element order: forbidden[c] == ie if
+     * color c is used by an already colored neighbour of ie */
+    int* color     = (int*) mxMalloc(noe * sizeof(int));
+    int* forbidden = (int*) mxMalloc((noe+1) * sizeof(int));
+    int numColors  = 0;
+
+    int c;
+    for (c = 0; c <= noe; c = c + 1 )
+    {
+        forbidden[c] = -1;
+    }
+
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            n = elements[a+ie*numRowsElements] - 1;
+            for (k = nodeStart[n]; k < nodeStart[n+1]; k = k + 1 )
+            {
+                if ( nodeElements[k] < ie )
+                {
+                    forbidden[color[nodeElements[k]]] = ie;
+                }
+            }
+        }
+
+        c = 0;
+        while ( forbidden[c] == ie )
+        {
+            c = c + 1;
+        }
+        color[ie] = c;
+
+        if ( c + 1 > numColors )
+        {
+            numColors = c + 1;
+        }
+    }
+
+    /* Group the elements by color */
+    plhs[0] = mxCreateNumericMatrix(numColors+1, 1, mxINT32_CLASS, mxREAL);
+    plhs[1] = mxCreateNumericMatrix(noe, 1, mxINT32_CLASS, mxREAL);
+
+    int* colorPtr      = (int*) mxGetData(plhs[0]);
+    int* colorElements = (int*) mxGetData(plhs[1]);
+    int* colorPos      = (int*) mxMalloc((numColors+1) * sizeof(int));
+
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        colorPtr[color[ie]+1] = colorPtr[color[ie]+1] + 1;
+    }
+
+    for (c = 0; c < numColors; c = c + 1 )
+    {
+        colorPtr[c+1] = colorPtr[c+1] + colorPtr[c];
+        colorPos[c]   = colorPtr[c];
+    }
+
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        colorElements[colorPos[color[ie]]] = ie;
+        colorPos[color[ie]] = colorPos[color[ie]] + 1;
+    }
+
+    mxFree(nodeStart);
+    mxFree(nodePos);
+    mxFree(nodeElements);
+    mxFree(color);
+    mxFree(forbidden);
+    mxFree(colorPos);
+
+    ReleaseIndexData(elements, prhs[1]);
+}
+/*************************************************************************/
+/* Check the coloring against the triplets and return the number of
+ * triplets of each element. Each of the noe colored elements owns
+ * localSize consecutive triplets, triplet l writing the position map[l]
+ * if map is given (matrix slots), rows[l] - 1 otherwise (vector rows),
+ * in [0, numSlots): the entries of every element
+ * are checked explicitly, so that two elements of the same color never
+ * write the same position. A coloring computed for another mesh or a
+ * wrong number of triplets per element is then reported instead of
+ * producing a race in the colored scatter. */
+mwSize CheckColoring(const mxArray* colorPtr, const mxArray* colorElements, const int* map, const long long* rows,
+        mwSize numSlots, mwSize numEntries)
+{
+    if (!mxIsInt32(colorPtr) || !mxIsInt32(colorElements)) {
+        mexErrMsgTxt("colorPtr and colorElements must be int32.");
+    }
+
+    int* ptr      = (int*) mxGetData(colorPtr);
+    int* elements = (int*) mxGetData(colorElements);
+    int numColors = mxGetM(colorPtr) * mxGetN(colorPtr) - 1;
+    mwSize noe    = mxGetM(colorElements) * mxGetN(colorElements);
+    int c, e, ie;
+
+    if ( noe == 0 || numEntries % noe != 0 )
+    {
+        mexErrMsgTxt("The number of entries must be a multiple of the number of colored elements.");
+    }
+    mwSize localSize = numEntries / noe;
+
+    if ( numColors < 0 || ptr[0] != 0 || (mwSize) ptr[numColors] != noe )
+    {
+        mexErrMsgTxt("colorPtr does not match colorElements.");
+    }
+
+    for (c = 0; c < numColors; c = c + 1 )
+    {
+        if ( ptr[c+1] < ptr[c] )
+        {
+            mexErrMsgTxt("colorPtr does not match colorElements.");
+        }
+    }
+
+    /* owner[s] is the last element writing position s, ownerColor[s] its color */
+    int* owner      = (int*) mxMalloc(numSlots * sizeof(int));
+    int* ownerColor = (int*) mxMalloc(numSlots * sizeof(int));
+    mwIndex s, l;
+    long long slot;
+
+    for (s = 0; s < numSlots; s = s + 1 )
+    {
+        ownerColor[s] = -1;
+    }
+
+    for (c = 0; c < numColors; c = c + 1 )
+    {
+        for (e = ptr[c]; e < ptr[c+1]; e = e + 1 )
+        {
+            ie = elements[e];
+            if ( ie < 0 || (mwSize) ie >= noe )
+            {
+                mexErrMsgTxt("Element index exceeds the number of colored elements.");
+            }
+
+            for (l = (mwIndex) ie * localSize; l < ((mwIndex) ie + 1) * localSize; l = l + 1 )
+            {
+                slot = map ? map[l] : rows[l] - 1;
+                if ( slot < 0 || (mwSize) slot >= numSlots )
+                {
+                    mexErrMsgTxt("Index exceeds the number of positions.");
+                }
+
+                s = slot;
+                if ( ownerColor[s] == c && owner[s] != ie )
+                {
+                    mexErrMsgTxt("Elements of the same color write the same position: the coloring does not match the triplets.");
+                }
+                owner[s]      = ie;
+                ownerColor[s] = c;
+            }
+        }
+    }
+
+    mxFree(owner);
+    mxFree(ownerColor);
+    return localSize;
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Sparse matrix with the compressed column pattern (ir, jc) and values
+ * nzval, or zero values if nzval is NULL */
+static mxArray* CreateCompressedMatrix(const int* ir, const int* jc, mwSize numRows, mwSize numCols, const double* nzval)
+{
+    mwSize nnz = jc[numCols];
+
+    mxArray* A = mxCreateSparse(numRows, numCols, (nnz > 0 ? nnz : 1), mxREAL);
+
+    mwIndex* Ir = mxGetIr(A);
+    mwIndex* Jc = mxGetJc(A);
+    double*  Pr = mxGetPr(A);
+
+    mwIndex k, j;
+
+    #pragma omp parallel for schedule(runtime) shared(Ir, Pr, ir, nzval) private(k) firstprivate(nnz)
+    for (k = 0; k < nnz; k = k + 1 )
+    {
+        Ir[k] = ir[k];
+        Pr[k] = nzval ? nzval[k] : 0.0;
+    }
+
+    for (j = 0; j <= numCols; j = j + 1 )
+    {
+        Jc[j] = jc[j];
+    }
+    return A;
+}
+/*************************************************************************/
+/* Build the sparse matrix from the value array nzval of the compressed
+ * column pattern (ir, jc), as returned by the C assemblers called with
+ * the suffix _scatter (see CoefFormat in Tools.h) */
+void BuildMatrix(mxArray* plhs[], const mxArray* prhs[])
+{
+    int* ir      = (int*) mxGetData(prhs[1]);
+    int* jc      = (int*) mxGetData(prhs[2]);
+    mwSize numRows  = (mwSize) mxGetScalar(prhs[4]);
+    mwSize numCols  = (mwSize) mxGetScalar(prhs[5]);
+
+    if ( mxGetM(prhs[2]) * mxGetN(prhs[2]) != numCols + 1
+            || mxGetM(prhs[3]) * mxGetN(prhs[3]) != (mwSize) jc[numCols] )
+    {
+        mexErrMsgTxt("nzval does not match the pattern.");
+    }
+
+    plhs[0] = CreateCompressedMatrix(ir, jc, numRows, numCols, mxGetPr(prhs[3]));
+}
+/*************************************************************************/
+/* Build the sparse matrix by scattering the coefficients directly into the
+ * value array of the precomputed compressed column pattern; single
+ * precision coefficients are summed in double */
+void Assemble(mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+    int* ir      = (int*) mxGetData(prhs[1]);
+    int* jc      = (int*) mxGetData(prhs[2]);
+    int* map     = (int*) mxGetData(prhs[3]);
+    CoefArray coef = GetCoefArray(prhs[4]);
+    mwSize numRows  = (mwSize) mxGetScalar(prhs[5]);
+    mwSize numCols  = (mwSize) mxGetScalar(prhs[6]);
+
+    mwSize numEntries = mxGetM(prhs[3]) * mxGetN(prhs[3]);
+    int colored       = (nrhs == 9);
+
+    if ( mxGetM(prhs[4]) * mxGetN(prhs[4]) != numEntries )
+    {
+        mexErrMsgTxt("coef and map must have the same number of entries.");
+    }
+
+    if ( mxGetM(prhs[2]) * mxGetN(prhs[2]) != numCols + 1 )
+    {
+        mexErrMsgTxt("jc does not match the number of columns.");
+    }
+
+    mwIndex k;
+
+    /* with a coloring, the triplets of each element (localSize
+     * consecutive entries) are scattered color by color: the elements of
+     * a color do not share any slot (checked by CheckColoring), so no
+     * atomic update is needed */
+    if (colored)
+    {
+        int* colorPtr      = (int*) mxGetData(prhs[7]);
+        int* colorElements = (int*) mxGetData(prhs[8]);
+        int numColors      = mxGetM(prhs[7]) * mxGetN(prhs[7]) - 1;
+        mwSize localSize   = CheckColoring(prhs[7], prhs[8], map, NULL, jc[numCols], numEntries);
+        int c, e;
+
+        plhs[0] = CreateCompressedMatrix(ir, jc, numRows, numCols, NULL);
+        double* Pr = mxGetPr(plhs[0]);
+
+        for (c = 0; c < numColors; c = c + 1 )
+        {
+            #pragma omp parallel for schedule(runtime) shared(Pr, map, coef, colorElements) private(e) firstprivate(localSize)
+            for (e = colorPtr[c]; e < colorPtr[c+1]; e = e + 1 )
+            {
+                mwSize first = (mwSize) colorElements[e] * localSize;
+                mwSize l;
+                for (l = first; l < first + localSize; l = l + 1 )
+                {
+                    Pr[map[l]] += GetCoef(coef, l);
+                }
+            }
+        }
+        return;
+    }
+
+    plhs[0] = CreateCompressedMatrix(ir, jc, numRows, numCols, NULL);
+    double* Pr = mxGetPr(plhs[0]);
+
+    #pragma omp parallel for schedule(runtime) shared(Pr, map, coef) private(k) firstprivate(numEntries)
+    for (k = 0; k < numEntries; k = k + 1 )
+    {
+        #pragma omp atomic
+        Pr[map[k]] += GetCoef(coef, k);
+    }
+}
+/*************************************************************************/
+/* Build a full vector from elemental contributions, color by color */
+void AssembleVector(mxArray* plhs[], const mxArray* prhs[])
+{
+    if (!mxIsDouble(prhs[2])) {
+        mexErrMsgTxt("coef must be double.");
+    }
+
+    long long* rows = GetIndexData(prhs[1]);
+    double* coef  = mxGetPr(prhs[2]);
+    mwSize numRows = (mwSize) mxGetScalar(prhs[3]);
+
+    mwSize numEntries = mxGetM(prhs[1]) * mxGetN(prhs[1]);
+
+    if ( mxGetM(prhs[2]) * mxGetN(prhs[2]) != numEntries )
+    {
+        mexErrMsgTxt("rows and coef must have the same number of entries.");
+    }
+
+    int* colorPtr      = (int*) mxGetData(prhs[4]);
+    int* colorElements = (int*) mxGetData(prhs[5]);
+    int numColors      = mxGetM(prhs[4]) * mxGetN(prhs[4]) - 1;
+    mwSize localSize   = CheckColoring(prhs[4], prhs[5], NULL, rows, numRows, numEntries);
+
+    int c, e;
+
+    plhs[0] = mxCreateDoubleMatrix(numRows, 1, mxREAL);
+    double* F = mxGetPr(plhs[0]);
+
+    for (c = 0; c < numColors; c = c + 1 )
+    {
+        #pragma omp parallel for schedule(runtime) shared(F, rows, coef, colorElements) private(e) firstprivate(localSize)
+        for (e = colorPtr[c]; e < colorPtr[c+1]; e = e + 1 )
+        {
+            mwSize first = (mwSize) colorElements[e] * localSize;
+            mwSize l;
+            for (l = first; l < first + localSize; l = l + 1 )
+            {
+                F[rows[l]-1] += coef[l];
+            }
+        }
+    }
+
+    ReleaseIndexData(rows, prhs[1]);
+}
+/*************************************************************************/
+
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+    SetOmpRuntime();
+
+    char *Operation_name = mxArrayToString(prhs[0]);
+
+    if (strcmp(Operation_name, "pattern")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=5) {
+            mexErrMsgTxt("5 inputs are required.");
+        } else if(nlhs>3) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+
+        ComputePattern(plhs, prhs);
+    }
+    else if (strcmp(Operation_name, "assemble")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=7 && nrhs!=9) {
+            mexErrMsgTxt("7 or 9 inputs are required.");
+        } else if(nlhs>1) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+
+        if (!mxIsInt32(prhs[1]) || !mxIsInt32(prhs[2]) || !mxIsInt32(prhs[3])) {
+            mexErrMsgTxt("ir, jc and map must be int32.");
+        }
+
+        Assemble(plhs, nrhs, prhs);
+    }
+    else if (strcmp(Operation_name, "assemble_vector")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=6) {
+            mexErrMsgTxt("6 inputs are required.");
+        } else if(nlhs>1) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+
+        AssembleVector(plhs, prhs);
+    }
+    else if (strcmp(Operation_name, "color")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=4) {
+            mexErrMsgTxt("4 inputs are required.");
+        } else if(nlhs>2) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+
+        ColorElements(plhs, prhs);
+    }
+    else if (strcmp(Operation_name, "matrix")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=6) {
+            mexErrMsgTxt("6 inputs are required.");
+        } else if(nlhs>1) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+
+        if (!mxIsInt32(prhs[1]) || !mxIsInt32(prhs[2]) || !mxIsDouble(prhs[3])) {
+            mexErrMsgTxt("ir and jc must be int32, nzval must be double.");
+        }
+
+        BuildMatrix(plhs, prhs);
+    }
+    else
+    {
+        mexErrMsgTxt("Unknown operation. Valid operations are 'pattern', 'assemble', 'matrix', 'assemble_vector' and 'color'.");
+    }
+
+    mxFree(Operation_name);
+}
+/*************************************************************************/
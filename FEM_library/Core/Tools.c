@@ -4,338 +4,474 @@
  */
 
 #include "Tools.h"
+#include <stdlib.h>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
 
 /*************************************************************************/
-
-double Mdot(int dim, double X[dim][dim], double Y[dim][dim])
+long long* GetIndexData(const mxArray* A)
 {
-    int d1, d2;
-    double Z = 0;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    /* int64 data are used directly, any other class is converted once */
+    if (mxIsInt64(A))
+    {
+        return (long long*) mxGetData(A);
+    }
+    
+    mwSize n = mxGetM(A) * mxGetN(A);
+    long long* data = (long long*) mxMalloc(n * sizeof(long long));
+    mwSize k;
+    
+    if (mxIsDouble(A))
     {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        double* values = mxGetPr(A);
+#pragma omp parallel for schedule(runtime) shared(data,values) private(k) firstprivate(n)
+        for (k = 0; k < n; k = k + 1 )
         {
-            Z = Z + X[d1][d2] * Y[d1][d2];
+            data[k] = (long long) values[k];
         }
     }
-    return Z;
+    else if (mxIsInt32(A))
+    {
+        int* values = (int*) mxGetData(A);
+#pragma omp parallel for schedule(runtime) shared(data,values) private(k) firstprivate(n)
+        for (k = 0; k < n; k = k + 1 )
+        {
+            data[k] = values[k];
+        }
+    }
+    else
+    {
+        mexErrMsgTxt("Index arrays must be double, int32 or int64.");
+    }
+    return data;
 }
 /*************************************************************************/
-double ScalarProduct(int dim, double x[dim], double y[dim])
+void ReleaseIndexData(long long* data, const mxArray* A)
 {
-    double result = 0;
-    int d1;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    if (!mxIsInt64(A))
     {
-        result += x[d1] * y[d1];
+        mxFree(data);
     }
-    return result;
 }
 /*************************************************************************/
-void MatrixVector(int dim1, int dim2, double A[dim1][dim2], double x[dim2], double y[dim1])
+mxArray* CreateIndexMatrix(mwSize m, mwSize n, const mxArray* elements, double maxIndex)
 {
-    int d1, d2;
-    for (d1 = 0; d1 < dim1; d1 = d1 + 1 )
+    mxArray* A;
+    
+    if (mxIsDouble(elements))
     {
-        y[d1] = 0;
-        for (d2 = 0; d2 < dim2; d2 = d2 + 1 )
-        {
-            y[d1] += A[d1][d2] * x[d2];
-        }
-    }    
+        A = mxCreateUninitNumericMatrix(m, n, mxDOUBLE_CLASS, mxREAL);
+    }
+    else if (maxIndex > 2147483647.0)
+    {
+        A = mxCreateUninitNumericMatrix(m, n, mxINT64_CLASS, mxREAL);
+    }
+    else
+    {
+        A = mxCreateUninitNumericMatrix(m, n, mxINT32_CLASS, mxREAL);
+    }
+    
+    FirstTouch(mxGetData(A), m * n * mxGetElementSize(A), mxGetN(elements));
+    return A;
 }
-
 /*************************************************************************/
-void MatrixSum(int dim, double X[dim][dim], double Y[dim][dim] )
+double GetNumNodes(const mxArray* elements, int nln)
 {
-    int d1, d2;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    /* with double connectivity the outputs are double and maxIndex is
+     * not used by CreateIndexMatrix */
+    if (mxIsDouble(elements))
+    {
+        return 0;
+    }
+    
+    long long* data = GetIndexData(elements);
+    mwSize numRowsElements = mxGetM(elements);
+    int noe = mxGetN(elements);
+    long long numNodes = 0;
+    int ie, a;
+    
+    for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        for (a = 0; a < nln; a = a + 1 )
         {
-            X[d1][d2] = X[d1][d2] + Y[d1][d2];
+            if (data[a+ie*numRowsElements] > numNodes)
+            {
+                numNodes = data[a+ie*numRowsElements];
+            }
         }
     }
+    
+    ReleaseIndexData(data, elements);
+    return numNodes;
+}
+/*************************************************************************/
+IndexArray GetIndexArray(const mxArray* A)
+{
+    IndexArray I;
+    I.dbl = NULL;
+    I.i32 = NULL;
+    I.i64 = NULL;
+    
+    if (mxIsEmpty(A)) {
+        return I;
+    } else if (mxIsInt32(A)) {
+        I.i32 = (int*) mxGetData(A);
+    } else if (mxIsInt64(A)) {
+        I.i64 = (long long*) mxGetData(A);
+    } else {
+        I.dbl = mxGetPr(A);
+    }
+    return I;
 }
 /*************************************************************************/
-void MatrixSumAlpha(int dim, double alpha, double X[dim][dim], double beta, double Y[dim][dim], double result[dim][dim] )
+static void PhysicalGradientsFromReference(const GeometryCache* cache, int ie, int q, double* out, int strideD, int strideK)
 {
-    int d1, d2;
+    const int dim = cache->dim;
+    const int nln = cache->nln;
+    const double* invjac = cache->invjac + ie*cache->invjacStrideE;
+    int d1, d2, k;
+    
     for (d1 = 0; d1 < dim; d1 = d1 + 1 )
     {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        for (k = 0; k < nln; k = k + 1 )
         {
-            result[d1][d2] = alpha * X[d1][d2] + beta * Y[d1][d2];
+            double gradphi = 0;
+            for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+            {
+                gradphi = gradphi + invjac[(d1+d2*dim)*cache->invjacStrideC] * cache->gradrefphi[k+(q+d2*cache->NumQuadPoints)*nln];
+            }
+            out[d1*strideD + k*strideK] = gradphi;
         }
     }
 }
 /*************************************************************************/
-double MatrixDeterminant2(int dim, double A[dim][dim])
+static void PhysicalGradientsFromCache(const GeometryCache* cache, int ie, int q, double* out, int strideD, int strideK)
 {
-    return A[0][0]*A[1][1]-A[0][1]*A[1][0];
-}
-/*************************************************************************/
-double MatrixDeterminant3(int dim, double A[dim][dim])
-{
-    return A[0][0]*(A[1][1]*A[2][2]-A[2][1]*A[1][2]) -A[0][1]*(A[1][0]*A[2][2]-A[1][2]*A[2][0])  +A[0][2]*(A[1][0]*A[2][1]-A[1][1]*A[2][0]);
+    const int dim = cache->dim;
+    const int nln = cache->nln;
+    const int qc  = (cache->numCachedQuadPoints == 1) ? 0 : q;
+    const double* gradphi = cache->gradphi + (mwSize) dim * nln * ( qc + cache->numCachedQuadPoints * (mwSize) ie );
+    int d1, k;
+    
+    for (k = 0; k < nln; k = k + 1 )
+    {
+        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+        {
+            out[d1*strideD + k*strideK] = gradphi[d1 + k*dim];
+        }
+    }
 }
 /*************************************************************************/
-double MatrixDeterminant(int dim, double A[dim][dim])
+static void PhysicalGradientsFromSingleCache(const GeometryCache* cache, int ie, int q, double* out, int strideD, int strideK)
 {
-    double determinant = 0;
-    if ( dim == 2 )
-    {
-        determinant = MatrixDeterminant2(2, A);
-    }
+    const int dim = cache->dim;
+    const int nln = cache->nln;
+    const int qc  = (cache->numCachedQuadPoints == 1) ? 0 : q;
+    const float* gradphi = cache->gradphi_single + (mwSize) dim * nln * ( qc + cache->numCachedQuadPoints * (mwSize) ie );
+    int d1, k;
     
-    if ( dim == 3 )
+    for (k = 0; k < nln; k = k + 1 )
     {
-        determinant = MatrixDeterminant3(3, A);
+        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+        {
+            out[d1*strideD + k*strideK] = (double) gradphi[d1 + k*dim];
+        }
     }
-        
-    return determinant;
 }
 /*************************************************************************/
-void MatrixInvT(int dim, double A[dim][dim], double invAT[dim][dim] )
+GeometryCache GetGeometryCache(const mxArray* A, const mxArray* invjac, int dim, int nln, int NumQuadPoints, int noe)
 {
-    if ( dim == 2 )
+    GeometryCache cache;
+    cache.gradphi        = NULL;
+    cache.gradphi_single = NULL;
+    cache.numCachedQuadPoints = 0;
+    cache.invjac         = mxGetPr(invjac);
+    cache.dim            = dim;
+    cache.nln            = nln;
+    cache.NumQuadPoints  = NumQuadPoints;
+    cache.PhysicalGradients = PhysicalGradientsFromReference;
+    GetInvJacStrides(invjac, dim, noe, &cache.invjacStrideE, &cache.invjacStrideC);
+    
+    if (!mxIsStruct(A))
     {
-        double det = MatrixDeterminant2(2, A);
-        
-        double invdet = 1/det;
-        
-        invAT[0][0] =   A[1][1]*invdet;
-        invAT[1][0] =  -A[0][1]*invdet;
-        invAT[0][1] =  -A[1][0]*invdet;
-        invAT[1][1] =   A[0][0]*invdet;
+        cache.gradrefphi = mxGetPr(A);
+        return cache;
+    }
+    
+    mxArray* dphi_ref = mxGetField(A, 0, "dphi_ref");
+    mxArray* gradphi  = mxGetField(A, 0, "gradphi");
+    mxArray* numQuad  = mxGetField(A, 0, "numQuadPoints");
+    
+    if (dphi_ref == NULL)
+    {
+        mexErrMsgTxt("Geometry cache must contain the field dphi_ref.");
     }
+    cache.gradrefphi = mxGetPr(dphi_ref);
     
-    if ( dim == 3 )
+    if (gradphi != NULL && !mxIsEmpty(gradphi) && numQuad != NULL)
     {
-        double det = MatrixDeterminant3(3, A);
+        cache.numCachedQuadPoints = (int) mxGetScalar(numQuad);
         
-        double invdet = 1/det;
+        if (cache.numCachedQuadPoints != 1 && cache.numCachedQuadPoints != NumQuadPoints)
+        {
+            mexErrMsgTxt("Geometry cache: numQuadPoints must be 1 or the number of quadrature nodes.");
+        }
+        if (mxGetNumberOfElements(gradphi) != (mwSize) dim * nln * cache.numCachedQuadPoints * noe)
+        {
+            mexErrMsgTxt("Geometry cache: gradphi must have dim*nln*numQuadPoints*noe entries.");
+        }
         
-        invAT[0][0] =  (A[1][1]*A[2][2]-A[2][1]*A[1][2])*invdet;
-        invAT[1][0] = -(A[0][1]*A[2][2]-A[0][2]*A[2][1])*invdet;
-        invAT[2][0] =  (A[0][1]*A[1][2]-A[0][2]*A[1][1])*invdet;
-        invAT[0][1] = -(A[1][0]*A[2][2]-A[1][2]*A[2][0])*invdet;
-        invAT[1][1] =  (A[0][0]*A[2][2]-A[0][2]*A[2][0])*invdet;
-        invAT[2][1] = -(A[0][0]*A[1][2]-A[1][0]*A[0][2])*invdet;
-        invAT[0][2] =  (A[1][0]*A[2][1]-A[2][0]*A[1][1])*invdet;
-        invAT[1][2] = -(A[0][0]*A[2][1]-A[2][0]*A[0][1])*invdet;
-        invAT[2][2] =  (A[0][0]*A[1][1]-A[1][0]*A[0][1])*invdet;
+        if (mxIsSingle(gradphi))
+        {
+            cache.gradphi_single    = (const float*) mxGetData(gradphi);
+            cache.PhysicalGradients = PhysicalGradientsFromSingleCache;
+        }
+        else if (mxIsDouble(gradphi))
+        {
+            cache.gradphi           = mxGetPr(gradphi);
+            cache.PhysicalGradients = PhysicalGradientsFromCache;
+        }
+        else
+        {
+            mexErrMsgTxt("Geometry cache: gradphi must be a double or single array.");
+        }
     }
-    
+    return cache;
 }
 /*************************************************************************/
-void MatrixInvT3(int dim, double A[dim][dim], double invAT[dim][dim] )
+QuadData GetQuadData(const mxArray* A, int noe, int NumQuadPoints, int numComponents)
 {
-   
-    double det = MatrixDeterminant3(3, A);
-    
-    double invdet = 1/det;
-    
-    invAT[0][0] =  (A[1][1]*A[2][2]-A[2][1]*A[1][2])*invdet;
-    invAT[1][0] = -(A[0][1]*A[2][2]-A[0][2]*A[2][1])*invdet;
-    invAT[2][0] =  (A[0][1]*A[1][2]-A[0][2]*A[1][1])*invdet;
-    invAT[0][1] = -(A[1][0]*A[2][2]-A[1][2]*A[2][0])*invdet;
-    invAT[1][1] =  (A[0][0]*A[2][2]-A[0][2]*A[2][0])*invdet;
-    invAT[2][1] = -(A[0][0]*A[1][2]-A[1][0]*A[0][2])*invdet;
-    invAT[0][2] =  (A[1][0]*A[2][1]-A[2][0]*A[1][1])*invdet;
-    invAT[1][2] = -(A[0][0]*A[2][1]-A[2][0]*A[0][1])*invdet;
-    invAT[2][2] =  (A[0][0]*A[1][1]-A[1][0]*A[0][1])*invdet;
-
+    QuadData D;
+    D.data = mxGetPr(A);
+    
+    mwSize m = mxGetM(A);
+    mwSize n = mxGetN(A);
+    
+    if (m == noe && n == NumQuadPoints*numComponents)
+    {
+        D.strideE = 1;
+        D.strideQ = noe;
+        D.strideC = noe*NumQuadPoints;
+    }
+    else if (m == noe && n == numComponents)
+    {
+        D.strideE = 1;
+        D.strideQ = 0;
+        D.strideC = noe;
+    }
+    else if (m * n == numComponents)
+    {
+        D.strideE = 0;
+        D.strideQ = 0;
+        D.strideC = 1;
+    }
+    else
+    {
+        mexErrMsgTxt("Coefficients must be given at the quadrature nodes, per element or as constants.");
+    }
+    return D;
 }
 /*************************************************************************/
-void MatrixInv3(int dim, double A[dim][dim], double invA[dim][dim] )
+void GetInvJacStrides(const mxArray* invjac, int dim, int noe, int* strideE, int* strideC)
 {
-   
-    double det = MatrixDeterminant3(3, A);
-    
-    double invdet = 1/det;
-    
-    invA[0][0] =  (A[1][1]*A[2][2]-A[2][1]*A[1][2])*invdet;
-    invA[0][1] = -(A[0][1]*A[2][2]-A[0][2]*A[2][1])*invdet;
-    invA[0][2] =  (A[0][1]*A[1][2]-A[0][2]*A[1][1])*invdet;
-    invA[1][0] = -(A[1][0]*A[2][2]-A[1][2]*A[2][0])*invdet;
-    invA[1][1] =  (A[0][0]*A[2][2]-A[0][2]*A[2][0])*invdet;
-    invA[1][2] = -(A[0][0]*A[1][2]-A[1][0]*A[0][2])*invdet;
-    invA[2][0] =  (A[1][0]*A[2][1]-A[2][0]*A[1][1])*invdet;
-    invA[2][1] = -(A[0][0]*A[2][1]-A[2][0]*A[0][1])*invdet;
-    invA[2][2] =  (A[0][0]*A[1][1]-A[1][0]*A[0][1])*invdet;
-
+    if (mxGetNumberOfDimensions(invjac) == 2 && mxGetM(invjac) == dim*dim && mxGetN(invjac) == noe)
+    {
+        *strideE = dim*dim;
+        *strideC = 1;
+    }
+    else if (mxGetM(invjac) == noe && mxGetM(invjac) * mxGetN(invjac) == noe*dim*dim)
+    {
+        *strideE = 1;
+        *strideC = noe;
+    }
+    else
+    {
+        mexErrMsgTxt("invjac must be a noe x dim x dim or a (dim*dim) x noe array.");
+    }
 }
 /*************************************************************************/
-void MatrixProduct(int dim, double X[dim][dim], double Y[dim][dim], double result[dim][dim] )
+void SetOmpRuntime(void)
 {
-    int d1, d2, d3;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+#ifdef _OPENMP
+    int numThreads = 0;
+    int chunk      = 0;
+    omp_sched_t kind = omp_sched_static;
+    
+    const mxArray* settings = mexGetVariablePtr("global", "redbKIT_OMP_SETTINGS");
+    
+    if (settings != NULL && mxIsStruct(settings))
     {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        mxArray* field;
+        
+        field = mxGetField(settings, 0, "num_threads");
+        if (field != NULL && !mxIsEmpty(field))
         {
-            result[d1][d2] = 0;
-            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
-            {
-                result[d1][d2] = result[d1][d2] + X[d1][d3]*Y[d3][d2];
+            numThreads = (int) mxGetScalar(field);
+        }
+        
+        field = mxGetField(settings, 0, "chunk");
+        if (field != NULL && !mxIsEmpty(field))
+        {
+            chunk = (int) mxGetScalar(field);
+        }
+        
+        field = mxGetField(settings, 0, "schedule");
+        if (field != NULL && mxIsChar(field))
+        {
+            char* name = mxArrayToString(field);
+            if (strcmp(name, "dynamic")==0) {
+                kind = omp_sched_dynamic;
+            } else if (strcmp(name, "guided")==0) {
+                kind = omp_sched_guided;
+            } else if (strcmp(name, "static")!=0) {
+                mxFree(name);
+                mexErrMsgTxt("Unknown OpenMP schedule, use static, dynamic or guided.");
             }
+            mxFree(name);
         }
     }
-}
-/*************************************************************************/
-void MatrixScalar(int dim, double alpha, double X[dim][dim], double result[dim][dim] )
-{
-    int d1, d2, d3;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    
+    /* the settings of the OpenMP runtime are shared by all the MEX files,
+     * hence the defaults are restored explicitly */
+    if (numThreads <= 0)
     {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        const char* env = getenv("OMP_NUM_THREADS");
+        numThreads = (env != NULL) ? atoi(env) : 0;
+        if (numThreads <= 0)
         {
-            result[d1][d2] = alpha * X[d1][d2];
+            numThreads = omp_get_num_procs();
         }
     }
+    
+    omp_set_num_threads(numThreads);
+    omp_set_schedule(kind, chunk);
+#endif
 }
 /*************************************************************************/
-void MatrixProductAlpha(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] )
+void FirstTouch(void* data, size_t bytes, int noe)
 {
-    int d1, d2, d3;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    char* ptr = (char*) data;
+    
+    if (noe < 1)
     {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-        {
-            result[d1][d2] = 0;
-            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
-            {
-                result[d1][d2] = result[d1][d2] + X[d1][d3]*Y[d3][d2];
-            }
-            result[d1][d2] = alpha * result[d1][d2];
-        }
+        noe = 1;
+    }
+    
+    /* element blocks; a remainder (arrays which are not a multiple of
+     * the number of elements) is zeroed by the calling thread */
+    size_t blockSize = bytes / noe;
+    int ie;
+    
+#pragma omp parallel for schedule(runtime) shared(ptr) private(ie) firstprivate(blockSize, noe)
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        memset(ptr + ie*blockSize, 0, blockSize);
     }
+    
+    memset(ptr + noe*blockSize, 0, bytes - noe*blockSize);
 }
 /*************************************************************************/
-void MatrixProductAlphaT1(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] )
+mxArray* CreateElementMatrix(mwSize m, mwSize n, int noe)
 {
-    int d1, d2, d3;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-    {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-        {
-            result[d1][d2] = 0;
-            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
-            {
-                result[d1][d2] = result[d1][d2] + X[d3][d1]*Y[d3][d2];
-            }
-            result[d1][d2] = alpha * result[d1][d2];
-        }
-    }
+    mxArray* A = mxCreateUninitNumericMatrix(m, n, mxDOUBLE_CLASS, mxREAL);
+    FirstTouch(mxGetData(A), m * n * sizeof(double), noe);
+    return A;
 }
 /*************************************************************************/
-void MatrixProductAlphaT2(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] )
+static int StripSuffix(char* Operation, const char* suffix)
 {
-    int d1, d2, d3;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    size_t n = strlen(Operation);
+    size_t ns = strlen(suffix);
+    
+    int found = n > ns && strcmp(Operation + n - ns, suffix) == 0;
+    if (found)
     {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-        {
-            result[d1][d2] = 0;
-            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
-            {
-                result[d1][d2] = result[d1][d2] + X[d1][d3]*Y[d2][d3];
-            }
-            result[d1][d2] = alpha * result[d1][d2];
-        }
+        Operation[n - ns] = '\0';
     }
+    return found;
 }
 /*************************************************************************/
-void MatrixProductAlphaT3(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] )
+int ParsePrecision(char* Operation)
 {
-    int d1, d2, d3;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-    {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-        {
-            result[d1][d2] = 0;
-            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
-            {
-                result[d1][d2] = result[d1][d2] + X[d3][d1]*Y[d2][d3];
-            }
-            result[d1][d2] = alpha * result[d1][d2];
-        }
-    }
+    return StripSuffix(Operation, "_single");
 }
 /*************************************************************************/
-void MatrixProductQ1(int dim, int numQuadPoints, double X[dim][dim][numQuadPoints], double Y[dim][dim], double result[dim][dim], int q )
+CoefFormat ParseCoefFormat(char* Operation, int* nrhs, const mxArray* prhs[])
 {
-    int d1, d2, d3;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    CoefFormat format = {0, NULL, 0, 0};
+    
+    if (StripSuffix(Operation, "_scatter"))
     {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        if (*nrhs < 3 || !mxIsInt32(prhs[*nrhs-2]))
         {
-            result[d1][d2] = 0;
-            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
-            {
-                result[d1][d2] = result[d1][d2] + X[d1][d3][q]*Y[d3][d2];
-            }
+            mexErrMsgTxt("_scatter requires the int32 map and the number of nonzeros as last inputs.");
         }
+        format.map        = (const int*) mxGetData(prhs[*nrhs-2]);
+        format.numEntries = mxGetNumberOfElements(prhs[*nrhs-2]);
+        format.nnz        = (mwSize) mxGetScalar(prhs[*nrhs-1]);
+        *nrhs = *nrhs - 2;
     }
+    
+    format.single = ParsePrecision(Operation);
+    return format;
 }
 /*************************************************************************/
-double Trace(int dim, double X[dim][dim])
+mxArray* CreateCoefMatrix(mwSize m, mwSize n, int noe, int single)
 {
-    double T = 0;
-    int d1;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    if (!single)
     {
-        T = T + X[d1][d1];
+        return CreateElementMatrix(m, n, noe);
     }
-    return T;
+    
+    mxArray* A = mxCreateUninitNumericMatrix(m, n, mxSINGLE_CLASS, mxREAL);
+    FirstTouch(mxGetData(A), m * n * sizeof(float), noe);
+    return A;
 }
 /*************************************************************************/
-double TraceQ(int dim, int numQuadPoints, double X[dim][dim][numQuadPoints], int q)
+CoefArray GetCoefArray(const mxArray* A)
 {
-    double T = 0;
-    int d1;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    CoefArray C = {NULL, NULL, NULL};
+    
+    if (mxIsSingle(A))
+    {
+        C.sgl = (float*) mxGetData(A);
+    }
+    else
     {
-        T = T + X[d1][d1][q];
+        C.dbl = mxGetPr(A);
     }
-    return T;
+    return C;
 }
 /*************************************************************************/
-void compute_GreenStrainTensor(int dim, int numQuadPoints, double F[dim][dim][numQuadPoints], double Id[dim][dim], double E[dim][dim][numQuadPoints], int q )
+void CreateMatrixOutputs(mxArray* plhs[], mwSize numEntries, const mxArray* elements, double maxIndex, int noe, CoefFormat format)
 {
+    if (!format.map)
+    {
+        plhs[0] = CreateIndexMatrix(numEntries, 1, elements, maxIndex);
+        plhs[1] = CreateIndexMatrix(numEntries, 1, elements, maxIndex);
+        plhs[2] = CreateCoefMatrix(numEntries, 1, noe, format.single);
+        return;
+    }
     
-    int d1, d2, d3;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    if (format.numEntries != numEntries)
     {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-        {
-            double tmp = 0;
-            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
-            {
-                tmp = tmp + F[d3][d1][q] * F[d3][d2][q];
-            }
-            E[d1][d2][q] = 0.5 * ( tmp - Id[d1][d2] );
-        }
+        mexErrMsgTxt("The scatter map does not match the local matrices of the assembler.");
     }
+    
+    plhs[0] = mxCreateDoubleMatrix(0, 1, mxREAL);
+    plhs[1] = mxCreateDoubleMatrix(0, 1, mxREAL);
+    plhs[2] = mxCreateDoubleMatrix(format.nnz, 1, mxREAL);
 }
 /*************************************************************************/
-void compute_DerGreenStrainTensor(int dim, int numQuadPoints, double F[dim][dim][numQuadPoints], double dF[dim][dim], double dE[dim][dim], int q )
+CoefArray GetMatrixCoefArray(const mxArray* coef, CoefFormat format)
 {
-    
-    int d1, d2, d3;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    if (!format.map)
     {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-        {
-            double tmp1 = 0;
-            double tmp2 = 0;
-            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
-            {
-                tmp1 = tmp1 + dF[d3][d1] * F[d3][d2][q];
-                tmp2 = tmp2 + F[d3][d1][q]  * dF[d3][d2];
-            }
-            dE[d1][d2] = 0.5 * ( tmp1 + tmp2 );
-        }
+        return GetCoefArray(coef);
     }
+    
+    CoefArray C = {mxGetPr(coef), NULL, format.map};
+    return C;
 }
 /*************************************************************************/
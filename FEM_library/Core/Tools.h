@@ -12,72 +12,1094 @@
 #ifndef TOOLS_H_INCLUDED
 #define TOOLS_H_INCLUDED
 
+/* Element kernels called with a constant dim must be inlined at the call
+ * site to be specialized */
+#if defined(__GNUC__)
+#define FORCE_INLINE static inline __attribute__((always_inline))
+#else
+#define FORCE_INLINE static inline
+#endif
+
+/*************************************************************************/
+/* Small dense tensor kernels. They are defined here as static inline
+ * functions so that they can be inlined in the assembly loops: when the
+ * caller passes a compile-time constant dim (see the _element kernels of
+ * the material models) the loops over d1, d2, d3 are fully unrolled and
+ * the 2D/3D branches are resolved at compile time. */
+
+static inline double Mdot(int dim, double X[dim][dim], double Y[dim][dim])
+{
+    int d1, d2;
+    double Z = 0;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            Z = Z + X[d1][d2] * Y[d1][d2];
+        }
+    }
+    return Z;
+}
+/*************************************************************************/
+static inline double ScalarProduct(int dim, double x[dim], double y[dim])
+{
+    double result = 0;
+    int d1;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        result += x[d1] * y[d1];
+    }
+    return result;
+}
+/*************************************************************************/
+static inline void MatrixVector(int dim1, int dim2, double A[dim1][dim2], double x[dim2], double y[dim1])
+{
+    int d1, d2;
+    for (d1 = 0; d1 < dim1; d1 = d1 + 1 )
+    {
+        y[d1] = 0;
+        for (d2 = 0; d2 < dim2; d2 = d2 + 1 )
+        {
+            y[d1] += A[d1][d2] * x[d2];
+        }
+    }    
+}
+
+/*************************************************************************/
+static inline void MatrixSum(int dim, double X[dim][dim], double Y[dim][dim] )
+{
+    int d1, d2;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            X[d1][d2] = X[d1][d2] + Y[d1][d2];
+        }
+    }
+}
+/*************************************************************************/
+static inline void MatrixSumAlpha(int dim, double alpha, double X[dim][dim], double beta, double Y[dim][dim], double result[dim][dim] )
+{
+    int d1, d2;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            result[d1][d2] = alpha * X[d1][d2] + beta * Y[d1][d2];
+        }
+    }
+}
+/*************************************************************************/
+static inline double MatrixDeterminant2(int dim, double A[dim][dim])
+{
+    return A[0][0]*A[1][1]-A[0][1]*A[1][0];
+}
+/*************************************************************************/
+static inline double MatrixDeterminant3(int dim, double A[dim][dim])
+{
+    return A[0][0]*(A[1][1]*A[2][2]-A[2][1]*A[1][2]) -A[0][1]*(A[1][0]*A[2][2]-A[1][2]*A[2][0])  +A[0][2]*(A[1][0]*A[2][1]-A[1][1]*A[2][0]);
+}
+/*************************************************************************/
+static inline double MatrixDeterminant(int dim, double A[dim][dim])
+{
+    double determinant = 0;
+    if ( dim == 2 )
+    {
+        determinant = MatrixDeterminant2(2, A);
+    }
+    
+    if ( dim == 3 )
+    {
+        determinant = MatrixDeterminant3(3, A);
+    }
+        
+    return determinant;
+}
+/*************************************************************************/
+static inline void MatrixInvT(int dim, double A[dim][dim], double invAT[dim][dim] )
+{
+    if ( dim == 2 )
+    {
+        double det = MatrixDeterminant2(2, A);
+        
+        double invdet = 1/det;
+        
+        invAT[0][0] =   A[1][1]*invdet;
+        invAT[1][0] =  -A[0][1]*invdet;
+        invAT[0][1] =  -A[1][0]*invdet;
+        invAT[1][1] =   A[0][0]*invdet;
+    }
+    
+    if ( dim == 3 )
+    {
+        double det = MatrixDeterminant3(3, A);
+        
+        double invdet = 1/det;
+        
+        invAT[0][0] =  (A[1][1]*A[2][2]-A[2][1]*A[1][2])*invdet;
+        invAT[1][0] = -(A[0][1]*A[2][2]-A[0][2]*A[2][1])*invdet;
+        invAT[2][0] =  (A[0][1]*A[1][2]-A[0][2]*A[1][1])*invdet;
+        invAT[0][1] = -(A[1][0]*A[2][2]-A[1][2]*A[2][0])*invdet;
+        invAT[1][1] =  (A[0][0]*A[2][2]-A[0][2]*A[2][0])*invdet;
+        invAT[2][1] = -(A[0][0]*A[1][2]-A[1][0]*A[0][2])*invdet;
+        invAT[0][2] =  (A[1][0]*A[2][1]-A[2][0]*A[1][1])*invdet;
+        invAT[1][2] = -(A[0][0]*A[2][1]-A[2][0]*A[0][1])*invdet;
+        invAT[2][2] =  (A[0][0]*A[1][1]-A[1][0]*A[0][1])*invdet;
+    }
+    
+}
+/*************************************************************************/
+static inline void MatrixInvT3(int dim, double A[dim][dim], double invAT[dim][dim] )
+{
+   
+    double det = MatrixDeterminant3(3, A);
+    
+    double invdet = 1/det;
+    
+    invAT[0][0] =  (A[1][1]*A[2][2]-A[2][1]*A[1][2])*invdet;
+    invAT[1][0] = -(A[0][1]*A[2][2]-A[0][2]*A[2][1])*invdet;
+    invAT[2][0] =  (A[0][1]*A[1][2]-A[0][2]*A[1][1])*invdet;
+    invAT[0][1] = -(A[1][0]*A[2][2]-A[1][2]*A[2][0])*invdet;
+    invAT[1][1] =  (A[0][0]*A[2][2]-A[0][2]*A[2][0])*invdet;
+    invAT[2][1] = -(A[0][0]*A[1][2]-A[1][0]*A[0][2])*invdet;
+    invAT[0][2] =  (A[1][0]*A[2][1]-A[2][0]*A[1][1])*invdet;
+    invAT[1][2] = -(A[0][0]*A[2][1]-A[2][0]*A[0][1])*invdet;
+    invAT[2][2] =  (A[0][0]*A[1][1]-A[1][0]*A[0][1])*invdet;
+
+}
+/*************************************************************************/
+static inline void MatrixInv3(int dim, double A[dim][dim], double invA[dim][dim] )
+{
+   
+    double det = MatrixDeterminant3(3, A);
+    
+    double invdet = 1/det;
+    
+    invA[0][0] =  (A[1][1]*A[2][2]-A[2][1]*A[1][2])*invdet;
+    invA[0][1] = -(A[0][1]*A[2][2]-A[0][2]*A[2][1])*invdet;
+    invA[0][2] =  (A[0][1]*A[1][2]-A[0][2]*A[1][1])*invdet;
+    invA[1][0] = -(A[1][0]*A[2][2]-A[1][2]*A[2][0])*invdet;
+    invA[1][1] =  (A[0][0]*A[2][2]-A[0][2]*A[2][0])*invdet;
+    invA[1][2] = -(A[0][0]*A[1][2]-A[1][0]*A[0][2])*invdet;
+    invA[2][0] =  (A[1][0]*A[2][1]-A[2][0]*A[1][1])*invdet;
+    invA[2][1] = -(A[0][0]*A[2][1]-A[2][0]*A[0][1])*invdet;
+    invA[2][2] =  (A[0][0]*A[1][1]-A[1][0]*A[0][1])*invdet;
+
+}
+/*************************************************************************/
+static inline void MatrixProduct(int dim, double X[dim][dim], double Y[dim][dim], double result[dim][dim] )
+{
+    int d1, d2, d3;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            result[d1][d2] = 0;
+            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+            {
+                result[d1][d2] = result[d1][d2] + X[d1][d3]*Y[d3][d2];
+            }
+        }
+    }
+}
+/*************************************************************************/
+static inline void MatrixScalar(int dim, double alpha, double X[dim][dim], double result[dim][dim] )
+{
+    int d1, d2;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            result[d1][d2] = alpha * X[d1][d2];
+        }
+    }
+}
+/*************************************************************************/
+static inline void MatrixProductAlpha(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] )
+{
+    int d1, d2, d3;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            result[d1][d2] = 0;
+            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+            {
+                result[d1][d2] = result[d1][d2] + X[d1][d3]*Y[d3][d2];
+            }
+            result[d1][d2] = alpha * result[d1][d2];
+        }
+    }
+}
+/*************************************************************************/
+static inline void MatrixProductAlphaT1(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] )
+{
+    int d1, d2, d3;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            result[d1][d2] = 0;
+            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+            {
+                result[d1][d2] = result[d1][d2] + X[d3][d1]*Y[d3][d2];
+            }
+            result[d1][d2] = alpha * result[d1][d2];
+        }
+    }
+}
+/*************************************************************************/
+static inline void MatrixProductAlphaT2(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] )
+{
+    int d1, d2, d3;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            result[d1][d2] = 0;
+            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+            {
+                result[d1][d2] = result[d1][d2] + X[d1][d3]*Y[d2][d3];
+            }
+            result[d1][d2] = alpha * result[d1][d2];
+        }
+    }
+}
+/*************************************************************************/
+static inline void MatrixProductAlphaT3(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] )
+{
+    int d1, d2, d3;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            result[d1][d2] = 0;
+            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+            {
+                result[d1][d2] = result[d1][d2] + X[d3][d1]*Y[d2][d3];
+            }
+            result[d1][d2] = alpha * result[d1][d2];
+        }
+    }
+}
+/*************************************************************************/
+static inline void MatrixProductQ1(int dim, int numQuadPoints, double X[dim][dim][numQuadPoints], double Y[dim][dim], double result[dim][dim], int q )
+{
+    int d1, d2, d3;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            result[d1][d2] = 0;
+            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+            {
+                result[d1][d2] = result[d1][d2] + X[d1][d3][q]*Y[d3][d2];
+            }
+        }
+    }
+}
+/*************************************************************************/
+static inline double Trace(int dim, double X[dim][dim])
+{
+    double T = 0;
+    int d1;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        T = T + X[d1][d1];
+    }
+    return T;
+}
+/*************************************************************************/
+static inline double TraceQ(int dim, int numQuadPoints, double X[dim][dim][numQuadPoints], int q)
+{
+    double T = 0;
+    int d1;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        T = T + X[d1][d1][q];
+    }
+    return T;
+}
+/*************************************************************************/
+static inline void compute_GreenStrainTensor(int dim, int numQuadPoints, double F[dim][dim][numQuadPoints], double Id[dim][dim], double E[dim][dim][numQuadPoints], int q )
+{
+    
+    int d1, d2, d3;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            double tmp = 0;
+            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+            {
+                tmp = tmp + F[d3][d1][q] * F[d3][d2][q];
+            }
+            E[d1][d2][q] = 0.5 * ( tmp - Id[d1][d2] );
+        }
+    }
+}
+/*************************************************************************/
+static inline void compute_DerGreenStrainTensor(int dim, int numQuadPoints, double F[dim][dim][numQuadPoints], double dF[dim][dim], double dE[dim][dim], int q )
+{
+    
+    int d1, d2, d3;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            double tmp1 = 0;
+            double tmp2 = 0;
+            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+            {
+                tmp1 = tmp1 + dF[d3][d1] * F[d3][d2][q];
+                tmp2 = tmp2 + F[d3][d1][q]  * dF[d3][d2];
+            }
+            dE[d1][d2] = 0.5 * ( tmp1 + tmp2 );
+        }
+    }
+}
+/*************************************************************************/
+/* Index arrays: connectivity can be passed as double, int32 or int64,
+ * row/column outputs are created with the same class of the connectivity
+ * (int64 if the largest global index does not fit into an int32). The
+ * assemblers read the connectivity with GetIndexData and compute the
+ * global indices in 64 bit integers. */
+
+typedef struct
+{
+    double*    dbl;
+    int*       i32;
+    long long* i64;
+} IndexArray;
+
+
+long long* GetIndexData(const mxArray* A);
+
+
+void ReleaseIndexData(long long* data, const mxArray* A);
+
+
+mxArray* CreateIndexMatrix(mwSize m, mwSize n, const mxArray* elements, double maxIndex);
+
+
+/* Largest node index in the first nln rows of an integer connectivity, to
+ * be used as maxIndex of CreateIndexMatrix in scalar problems */
+double GetNumNodes(const mxArray* elements, int nln);
+
+
+IndexArray GetIndexArray(const mxArray* A);
+
+
+/* The assemblers collect the n indices of an element in a local buffer and
+ * copy them into A from position k with SetIndexBlock, so that the class
+ * of A is tested once per element and not at each entry. Nothing is
+ * written if A is empty (see CreateMatrixOutputs) */
+static inline void SetIndexBlock(IndexArray A, mwSize k, const long long* values, int n)
+{
+    int i;
+    if (A.i32) {
+        int* dest = A.i32 + k;
+        for (i = 0; i < n; i = i + 1 )
+        {
+            dest[i] = (int) values[i];
+        }
+    } else if (A.i64) {
+        long long* dest = A.i64 + k;
+        for (i = 0; i < n; i = i + 1 )
+        {
+            dest[i] = values[i];
+        }
+    } else if (A.dbl) {
+        double* dest = A.dbl + k;
+        for (i = 0; i < n; i = i + 1 )
+        {
+            dest[i] = (double) values[i];
+        }
+    }
+}
+
+/* Symmetric assembly: only the entries a <= b of each local matrix are
+ * computed and they are stored in the upper triangle (row <= col) of the
+ * global matrix, which is then completed by GlobalAssembleSymmetric. The
+ * dofs of an element are distinct, so local entries with a < b never fall
+ * on the global diagonal. rows and cols are the local index buffers of the
+ * element (see SetIndexBlock). */
+static inline void SetSymmetricIndex(long long* rows, long long* cols, int k, long long row, long long col)
+{
+    if (row <= col) {
+        rows[k] = row;
+        cols[k] = col;
+    } else {
+        rows[k] = col;
+        cols[k] = row;
+    }
+}
+
+/*************************************************************************/
+/* OpenMP runtime settings and NUMA first touch. The element loops use
+ * schedule(runtime): SetOmpRuntime, called at the beginning of each
+ * mexFunction, sets the schedule and the number of threads from the
+ * MATLAB global variable written by SetOmpSettings (default: static
+ * schedule, OMP_NUM_THREADS or all the cores).
+ * The outputs are allocated uninitialized and zeroed by element blocks
+ * with the same schedule of the assembly loops, so that with a static
+ * schedule the pages of the triplets of each element are first touched,
+ * and hence placed, on the NUMA node of the thread assembling it. */
+
+void SetOmpRuntime(void);
+
+
+void FirstTouch(void* data, size_t bytes, int noe);
+
+
+mxArray* CreateElementMatrix(mwSize m, mwSize n, int noe);
+
 /*************************************************************************/
+/* Coefficient arrays: the local matrices are always computed, and summed
+ * over the quadrature nodes, in double precision. The coefficients of the
+ * local matrices are rounded to single precision when stored if the
+ * operation name has the suffix _single (ParsePrecision strips it and
+ * returns the flag, which each call passes down to CreateCoefMatrix),
+ * halving the size of the triplets; the vectors (residuals, right-hand
+ * sides) are always returned in double. */
+
+/* If map is set, dbl is the value array of a cached compressed matrix and
+ * the coefficient of triplet k is summed into dbl[map[k]] with an atomic
+ * update (see CoefFormat); GetCoef is not available in this case. */
 
-double Mdot(int dim, double X[dim][dim], double Y[dim][dim]);
+typedef struct
+{
+    double*    dbl;
+    float*     sgl;
+    const int* map;
+} CoefArray;
 
 
-double ScalarProduct(int dim, double x[dim], double y[dim]);
+int ParsePrecision(char* Operation);
 
 
-void MatrixVector(int dim1, int dim2, double A[dim1][dim2], double x[dim2], double y[dim1]);
+mxArray* CreateCoefMatrix(mwSize m, mwSize n, int noe, int single);
 
 
-void MatrixSum(int dim, double X[dim][dim], double Y[dim][dim] );
+CoefArray GetCoefArray(const mxArray* A);
 
 
-void MatrixSumAlpha(int dim, double alpha, double X[dim][dim], double beta, double Y[dim][dim], double result[dim][dim] );
+static inline void SetCoef(CoefArray A, mwSize k, double value)
+{
+    if (A.map) {
+        #pragma omp atomic
+        A.dbl[A.map[k]] += value;
+    } else if (A.sgl) {
+        A.sgl[k] = (float) value;
+    } else {
+        A.dbl[k] = value;
+    }
+}
 
+static inline double GetCoef(CoefArray A, mwSize k)
+{
+    return A.sgl ? (double) A.sgl[k] : A.dbl[k];
+}
 
-double MatrixDeterminant2(int dim, double A[dim][dim]);
+static inline void AddCoef(CoefArray A, mwSize k, double value)
+{
+    if (A.map) {
+        #pragma omp atomic
+        A.dbl[A.map[k]] += value;
+    } else if (A.sgl) {
+        A.sgl[k] = (float) ( A.sgl[k] + value );
+    } else {
+        A.dbl[k] = A.dbl[k] + value;
+    }
+}
 
+/*************************************************************************/
+/* Format of the matrix outputs of a call, set by the suffixes of the
+ * operation name (ParseCoefFormat):
+ *  _single  - the coefficients are rounded to single precision
+ *  _scatter - the last two inputs are the map and the number of nonzeros
+ *             of the SparseScatterMap computed from the triplets of a
+ *             previous call with the same operation. The first matrix
+ *             output (plhs[0..2], see CreateMatrixOutputs) is returned as
+ *             the value array of the compressed matrix, with empty rows
+ *             and columns: the local matrices are summed directly into
+ *             it and the triplets are never stored. */
 
-double MatrixDeterminant3(int dim, double A[dim][dim]);
+typedef struct
+{
+    int        single;
+    const int* map;
+    mwSize     numEntries;
+    mwSize     nnz;
+} CoefFormat;
 
 
-double MatrixDeterminant(int dim, double A[dim][dim]);
+CoefFormat ParseCoefFormat(char* Operation, int* nrhs, const mxArray* prhs[]);
 
 
-void MatrixInvT(int dim, double A[dim][dim], double invAT[dim][dim] );
+void CreateMatrixOutputs(mxArray* plhs[], mwSize numEntries, const mxArray* elements, double maxIndex, int noe, CoefFormat format);
 
 
-void MatrixInvT3(int dim, double A[dim][dim], double invAT[dim][dim] );
+CoefArray GetMatrixCoefArray(const mxArray* coef, CoefFormat format);
 
+/*************************************************************************/
+/* Layout of invjac: noe x dim x dim (as returned by geotrasf) or
+ * element-contiguous (dim*dim) x noe (geotrasf with 'AoS' layout).
+ * INVJAC(ie,d1,d2) = invjac[ie*strideE + (d1+d2*dim)*strideC] */
 
-void MatrixInv3(int dim, double A[dim][dim], double invA[dim][dim] );
+void GetInvJacStrides(const mxArray* invjac, int dim, int noe, int* strideE, int* strideC);
+
+/*************************************************************************/
+/* Geometry cache: physical gradients of the basis functions precomputed
+ * for each element (see GeometryCache.m). The reference gradients argument
+ * of the assemblers can be either the array of reference gradients or the
+ * struct returned by GeometryCache.GetData; in the latter case the
+ * gradients are read from the cache instead of being recomputed.
+ *
+ * GetGeometryCache validates the cache and selects, once per call, the
+ * routine filling the gradients of all the basis functions at node q of
+ * element ie:
+ *     cache.PhysicalGradients(&cache, ie, q, out, strideD, strideK)
+ * stores d(phi_k)/d(x_d1) in out[d1*strideD + k*strideK]. */
+
+typedef struct GeometryCache GeometryCache;
+
+typedef void (*PhysicalGradientsFunction)(const GeometryCache* cache, int ie, int q, double* out, int strideD, int strideK);
+
+struct GeometryCache
+{
+    const double* gradrefphi;
+    const double* gradphi;
+    const float*  gradphi_single;
+    int           numCachedQuadPoints;
+    const double* invjac;
+    int           invjacStrideE;
+    int           invjacStrideC;
+    int           dim;
+    int           nln;
+    int           NumQuadPoints;
+    PhysicalGradientsFunction PhysicalGradients;
+};
+
+
+GeometryCache GetGeometryCache(const mxArray* A, const mxArray* invjac, int dim, int nln, int NumQuadPoints, int noe);
+
+/*************************************************************************/
+/* Coefficients evaluated at the quadrature nodes: either a noe x
+ * (NumQuadPoints*numComponents) array, a noe x numComponents array
+ * (constant in each element) or a 1 x numComponents array (constant).
+ * The value of component c at node q of element ie is read through the
+ * strides, which are zero along the constant directions. */
+
+typedef struct
+{
+    double* data;
+    mwSize  strideE;
+    mwSize  strideQ;
+    mwSize  strideC;
+} QuadData;
+
+
+QuadData GetQuadData(const mxArray* A, int noe, int NumQuadPoints, int numComponents);
+
+
+static inline double QuadDataValue(const QuadData* D, int ie, int q, int c)
+{
+    return D->data[ie*D->strideE + q*D->strideQ + c*D->strideC];
+}
+
+/* true if the coefficient does not vary inside the elements */
+static inline int QuadDataIsElementwise(const QuadData* D)
+{
+    return D->strideQ == 0;
+}
+
+/*************************************************************************/
+/* Element batches: the kinematic quantities of ELEMENT_BATCH elements are
+ * stored as structure of arrays, X[d1][d2][l] with l the element of the
+ * batch, so that the innermost loops run over the elements of the batch
+ * and can be vectorized. Batches at the end of the mesh with nb <
+ * ELEMENT_BATCH elements are padded with copies of the last element.
+ * Compile with -DELEMENT_BATCH=1 to disable the batched kernels. */
 
+#ifndef ELEMENT_BATCH
+#define ELEMENT_BATCH 4
+#endif
 
-void MatrixProduct(int dim, double X[dim][dim], double Y[dim][dim], double result[dim][dim] );
+FORCE_INLINE void BatchLocalDisplacement(const int dim, const int ie0, const int nb, const int nln, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* U_h, double Uloc[dim][nln][ELEMENT_BATCH])
+{
+    int d1, k, l;
+    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+    {
+        int ie = ie0 + (l < nb ? l : nb - 1);
+        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+        {
+            for (k = 0; k < nln; k = k + 1 )
+            {
+                Uloc[d1][k][l] = U_h[elements[ie*numRowsElements + k] + d1*NumNodes - 1];
+            }
+        }
+    }
+}
 
+FORCE_INLINE void BatchGradients(const int dim, const int ie0, const int nb, const int q, const int nln,
+        const GeometryCache* cache, double gradphi[dim][nln][ELEMENT_BATCH])
+{
+    int l;
+    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+    {
+        int ie = ie0 + (l < nb ? l : nb - 1);
+        cache->PhysicalGradients(cache, ie, q, &gradphi[0][0][l], nln*ELEMENT_BATCH, ELEMENT_BATCH);
+    }
+}
 
-void MatrixScalar(int dim, double alpha, double X[dim][dim], double result[dim][dim] );
+/* F = I + grad(U) */
+FORCE_INLINE void BatchDeformationGradient(const int dim, const int nln, double gradphi[dim][nln][ELEMENT_BATCH],
+        double Uloc[dim][nln][ELEMENT_BATCH], double F[dim][dim][ELEMENT_BATCH])
+{
+    int d1, d2, k, l;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            #pragma omp simd
+            for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+            {
+                F[d1][d2][l] = (d1 == d2 ? 1.0 : 0.0);
+            }
+            for (k = 0; k < nln; k = k + 1 )
+            {
+                #pragma omp simd
+                for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                {
+                    F[d1][d2][l] = F[d1][d2][l] + Uloc[d1][k][l] * gradphi[d2][k][l];
+                }
+            }
+        }
+    }
+}
 
+/* G = grad(V), e.g. the directional derivative of F along V */
+FORCE_INLINE void BatchDisplacementGradient(const int dim, const int nln, double gradphi[dim][nln][ELEMENT_BATCH],
+        double Vloc[dim][nln][ELEMENT_BATCH], double G[dim][dim][ELEMENT_BATCH])
+{
+    int d1, d2, k, l;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            #pragma omp simd
+            for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+            {
+                G[d1][d2][l] = 0.0;
+            }
+            for (k = 0; k < nln; k = k + 1 )
+            {
+                #pragma omp simd
+                for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                {
+                    G[d1][d2][l] = G[d1][d2][l] + Vloc[d1][k][l] * gradphi[d2][k][l];
+                }
+            }
+        }
+    }
+}
 
-void MatrixProductAlpha(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] );
+/* detF and F^{-T} of 3x3 tensors */
+FORCE_INLINE void BatchInvT3(double F[3][3][ELEMENT_BATCH], double detF[ELEMENT_BATCH], double invFT[3][3][ELEMENT_BATCH])
+{
+    int l;
+    #pragma omp simd
+    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+    {
+        double det = F[0][0][l]*(F[1][1][l]*F[2][2][l]-F[2][1][l]*F[1][2][l])
+                    -F[0][1][l]*(F[1][0][l]*F[2][2][l]-F[1][2][l]*F[2][0][l])
+                    +F[0][2][l]*(F[1][0][l]*F[2][1][l]-F[1][1][l]*F[2][0][l]);
+        double invdet = 1/det;
+        
+        detF[l] = det;
+        invFT[0][0][l] =  (F[1][1][l]*F[2][2][l]-F[2][1][l]*F[1][2][l])*invdet;
+        invFT[1][0][l] = -(F[0][1][l]*F[2][2][l]-F[0][2][l]*F[2][1][l])*invdet;
+        invFT[2][0][l] =  (F[0][1][l]*F[1][2][l]-F[0][2][l]*F[1][1][l])*invdet;
+        invFT[0][1][l] = -(F[1][0][l]*F[2][2][l]-F[1][2][l]*F[2][0][l])*invdet;
+        invFT[1][1][l] =  (F[0][0][l]*F[2][2][l]-F[0][2][l]*F[2][0][l])*invdet;
+        invFT[2][1][l] = -(F[0][0][l]*F[1][2][l]-F[1][0][l]*F[0][2][l])*invdet;
+        invFT[0][2][l] =  (F[1][0][l]*F[2][1][l]-F[2][0][l]*F[1][1][l])*invdet;
+        invFT[1][2][l] = -(F[0][0][l]*F[2][1][l]-F[2][0][l]*F[0][1][l])*invdet;
+        invFT[2][2][l] =  (F[0][0][l]*F[1][1][l]-F[1][0][l]*F[0][1][l])*invdet;
+    }
+}
 
+/* detF and F^{-T} of 2x2 or 3x3 tensors */
+FORCE_INLINE void BatchInvT(const int dim, double F[dim][dim][ELEMENT_BATCH], double detF[ELEMENT_BATCH], double invFT[dim][dim][ELEMENT_BATCH])
+{
+    int l;
+    if ( dim == 2 )
+    {
+        #pragma omp simd
+        for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+        {
+            double det = F[0][0][l]*F[1][1][l]-F[0][1][l]*F[1][0][l];
+            double invdet = 1/det;
+            
+            detF[l] = det;
+            invFT[0][0][l] =   F[1][1][l]*invdet;
+            invFT[1][0][l] =  -F[0][1][l]*invdet;
+            invFT[0][1][l] =  -F[1][0][l]*invdet;
+            invFT[1][1][l] =   F[0][0][l]*invdet;
+        }
+    }
+    
+    if ( dim == 3 )
+    {
+        BatchInvT3(F, detF, invFT);
+    }
+}
 
-void MatrixProductAlphaT1(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] );
+/* C = F^T F */
+FORCE_INLINE void BatchRightCauchyGreen(const int dim, double F[dim][dim][ELEMENT_BATCH], double C[dim][dim][ELEMENT_BATCH])
+{
+    int d1, d2, d3, l;
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+        {
+            #pragma omp simd
+            for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+            {
+                C[d1][d2][l] = 0;
+            }
+            for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+            {
+                #pragma omp simd
+                for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                {
+                    C[d1][d2][l] = C[d1][d2][l] + F[d3][d1][l] * F[d3][d2][l];
+                }
+            }
+        }
+    }
+}
 
+FORCE_INLINE void BatchTrace(const int dim, double X[dim][dim][ELEMENT_BATCH], double T[ELEMENT_BATCH])
+{
+    int d1, l;
+    #pragma omp simd
+    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+    {
+        T[l] = 0;
+    }
+    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+    {
+        #pragma omp simd
+        for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+        {
+            T[l] = T[l] + X[d1][d1][l];
+        }
+    }
+}
 
-void MatrixProductAlphaT2(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] );
+/* Contraction of the material tangent A = dP/dF with the gradients of the
+ * test (a) and trial (b) functions:
+ * aloc[a][i][b][k] += w * sum_{J,L} gradphi[J][a] A[i][J][k][L] gradphi[L][b] */
+FORCE_INLINE void BatchTangentContraction(const int dim, const int nln, const double w, double gradphi[dim][nln][ELEMENT_BATCH],
+        double A[dim][dim][dim][dim][ELEMENT_BATCH], double aloc[nln][dim][nln][dim][ELEMENT_BATCH])
+{
+    int a, b, i, J, k, L, l;
+    double AG[dim][dim][dim][ELEMENT_BATCH];
+    
+    for (b = 0; b < nln; b = b + 1 )
+    {
+        for (i = 0; i < dim; i = i + 1 )
+        {
+            for (J = 0; J < dim; J = J + 1 )
+            {
+                for (k = 0; k < dim; k = k + 1 )
+                {
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        double tmp = 0;
+                        for (L = 0; L < dim; L = L + 1 )
+                        {
+                            tmp = tmp + A[i][J][k][L][l] * gradphi[L][b][l];
+                        }
+                        AG[i][J][k][l] = w * tmp;
+                    }
+                }
+            }
+        }
+        
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            for (i = 0; i < dim; i = i + 1 )
+            {
+                for (k = 0; k < dim; k = k + 1 )
+                {
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        double tmp = 0;
+                        for (J = 0; J < dim; J = J + 1 )
+                        {
+                            tmp = tmp + gradphi[J][a][l] * AG[i][J][k][l];
+                        }
+                        aloc[a][i][b][k][l] = aloc[a][i][b][k][l] + tmp;
+                    }
+                }
+            }
+        }
+    }
+}
 
+/* As BatchTangentContraction for a tangent with major symmetry
+ * A[i][J][k][L] = A[k][L][i][J]: only the entries (a,i) <= (b,k), in the
+ * ordering a*dim+i, of the local matrix are computed */
+FORCE_INLINE void BatchTangentContractionSymmetric(const int dim, const int nln, const double w, double gradphi[dim][nln][ELEMENT_BATCH],
+        double A[dim][dim][dim][dim][ELEMENT_BATCH], double aloc[nln][dim][nln][dim][ELEMENT_BATCH])
+{
+    int a, b, i, J, k, L, l;
+    double AG[dim][dim][dim][ELEMENT_BATCH];
+    
+    for (b = 0; b < nln; b = b + 1 )
+    {
+        for (i = 0; i < dim; i = i + 1 )
+        {
+            for (J = 0; J < dim; J = J + 1 )
+            {
+                for (k = 0; k < dim; k = k + 1 )
+                {
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        double tmp = 0;
+                        for (L = 0; L < dim; L = L + 1 )
+                        {
+                            tmp = tmp + A[i][J][k][L][l] * gradphi[L][b][l];
+                        }
+                        AG[i][J][k][l] = w * tmp;
+                    }
+                }
+            }
+        }
+        
+        for (a = 0; a <= b; a = a + 1 )
+        {
+            for (i = 0; i < dim; i = i + 1 )
+            {
+                for (k = (a == b ? i : 0); k < dim; k = k + 1 )
+                {
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        double tmp = 0;
+                        for (J = 0; J < dim; J = J + 1 )
+                        {
+                            tmp = tmp + gradphi[J][a][l] * AG[i][J][k][l];
+                        }
+                        aloc[a][i][b][k][l] = aloc[a][i][b][k][l] + tmp;
+                    }
+                }
+            }
+        }
+    }
+}
 
-void MatrixProductAlphaT3(int dim, double alpha, double X[dim][dim], double Y[dim][dim], double result[dim][dim] );
+/* Contraction of the first Piola-Kirchhoff stress P with the gradients of
+ * the test functions: rloc[a][i] += w * sum_J P[i][J] gradphi[J][a] */
+FORCE_INLINE void BatchStressContraction(const int dim, const int nln, const double w, double gradphi[dim][nln][ELEMENT_BATCH],
+        double P[dim][dim][ELEMENT_BATCH], double rloc[nln][dim][ELEMENT_BATCH])
+{
+    int a, i, J, l;
+    for (a = 0; a < nln; a = a + 1 )
+    {
+        for (i = 0; i < dim; i = i + 1 )
+        {
+            #pragma omp simd
+            for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+            {
+                double tmp = 0;
+                for (J = 0; J < dim; J = J + 1 )
+                {
+                    tmp = tmp + P[i][J][l] * gradphi[J][a][l];
+                }
+                rloc[a][i][l] = rloc[a][i][l] + w * tmp;
+            }
+        }
+    }
+}
 
+/* dP[i][J] = sum_{k,L} A[i][J][k][L] G[k][L] */
+FORCE_INLINE void BatchTangentApply(const int dim, double A[dim][dim][dim][dim][ELEMENT_BATCH],
+        double G[dim][dim][ELEMENT_BATCH], double dP[dim][dim][ELEMENT_BATCH])
+{
+    int i, J, k, L, l;
+    for (i = 0; i < dim; i = i + 1 )
+    {
+        for (J = 0; J < dim; J = J + 1 )
+        {
+            #pragma omp simd
+            for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+            {
+                double tmp = 0;
+                for (k = 0; k < dim; k = k + 1 )
+                {
+                    for (L = 0; L < dim; L = L + 1 )
+                    {
+                        tmp = tmp + A[i][J][k][L][l] * G[k][L][l];
+                    }
+                }
+                dP[i][J][l] = tmp;
+            }
+        }
+    }
+}
 
-void MatrixProductQ1(int dim, int numQuadPoints, double X[dim][dim][numQuadPoints], double Y[dim][dim], double result[dim][dim], int q );
+/* Tangent cache: A = dP/dF of a hyperelastic material has the major
+ * symmetry A[i][J][k][L] = A[k][L][i][J], hence only the upper triangle of
+ * the dim^2 x dim^2 matrix (iJ, kL) is stored, i.e. dim^2*(dim^2+1)/2
+ * values for each quadrature point (45 instead of 81 in 3D); quadrature
+ * points of the same element are contiguous */
+FORCE_INLINE mwSize TangentCacheSize(const int dim)
+{
+    return (mwSize)dim*dim*(dim*dim+1)/2;
+}
 
+FORCE_INLINE void BatchStoreTangent(const int dim, const int ie0, const int nb, const int q, const int NumQuadPoints,
+        double A[dim][dim][dim][dim][ELEMENT_BATCH], double* TangentCache)
+{
+    int l, p, r;
+    const int dim2 = dim*dim;
+    for (l = 0; l < nb; l = l + 1 )
+    {
+        double* cache = TangentCache + ((mwSize)(ie0 + l) * NumQuadPoints + q) * TangentCacheSize(dim);
+        int iii = 0;
+        for (p = 0; p < dim2; p = p + 1 )
+        {
+            for (r = p; r < dim2; r = r + 1 )
+            {
+                cache[iii] = A[p/dim][p%dim][r/dim][r%dim][l];
+                iii = iii + 1;
+            }
+        }
+    }
+}
 
-double Trace(int dim, double X[dim][dim]);
+FORCE_INLINE void BatchLoadTangent(const int dim, const int ie0, const int nb, const int q, const int NumQuadPoints,
+        const double* TangentCache, double A[dim][dim][dim][dim][ELEMENT_BATCH])
+{
+    int l, p, r;
+    const int dim2 = dim*dim;
+    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+    {
+        const double* cache = TangentCache + ((mwSize)(ie0 + (l < nb ? l : nb - 1)) * NumQuadPoints + q) * TangentCacheSize(dim);
+        int iii = 0;
+        for (p = 0; p < dim2; p = p + 1 )
+        {
+            for (r = p; r < dim2; r = r + 1 )
+            {
+                A[p/dim][p%dim][r/dim][r%dim][l] = cache[iii];
+                A[r/dim][r%dim][p/dim][p%dim][l] = cache[iii];
+                iii = iii + 1;
+            }
+        }
+    }
+}
 
+/* Scatter the local vectors rloc[a][i_c][l] of a batch, same ordering of
+ * the element-wise assemblers */
+FORCE_INLINE void BatchScatterVector(const int dim, const int ie0, const int nb, const int nln, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* detjac, double rloc[nln][dim][ELEMENT_BATCH], IndexArray myRrows, double* myRcoef)
+{
+    int l, a, i_c;
+    for (l = 0; l < nb; l = l + 1 )
+    {
+        int ie = ie0 + l;
+        long long localRrows[nln*dim];
 
-double TraceQ(int dim, int numQuadPoints, double X[dim][dim][numQuadPoints], int q);
+        int ii = 0;
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            for (i_c = 0; i_c < dim; i_c = i_c + 1 )
+            {
+                localRrows[ii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                myRcoef[(mwSize) ie*nln*dim+ii] = rloc[a][i_c][l]*detjac[ie];
+                ii = ii + 1;
+            }
+        }
+        SetIndexBlock(myRrows, (mwSize) ie*nln*dim, localRrows, nln*dim);
+    }
+}
 
+/* Scatter the local matrices aloc[a][i_c][b][j_c][l] of a batch */
+FORCE_INLINE void BatchScatterMatrix(const int dim, const int ie0, const int nb, const int nln, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* detjac, double aloc[nln][dim][nln][dim][ELEMENT_BATCH],
+        IndexArray myArows, IndexArray myAcols, CoefArray myAcoef)
+{
+    int l, a, b, i_c, j_c;
+    mwSize localSize = nln*nln*dim*dim;
+    for (l = 0; l < nb; l = l + 1 )
+    {
+        int ie = ie0 + l;
+        long long localArows[localSize], localAcols[localSize];
 
-void compute_GreenStrainTensor(int dim, int numQuadPoints, double F[dim][dim][numQuadPoints], double Id[dim][dim], double E[dim][dim][numQuadPoints], int q );
+        mwSize iii = 0;
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            for (i_c = 0; i_c < dim; i_c = i_c + 1 )
+            {
+                for (b = 0; b < nln; b = b + 1 )
+                {
+                    for (j_c = 0; j_c < dim; j_c = j_c + 1 )
+                    {
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*localSize+iii, aloc[a][i_c][b][j_c][l]*detjac[ie]);
+                        iii = iii + 1;
+                    }
+                }
+            }
+        }
+        SetIndexBlock(myArows, ie*localSize, localArows, localSize);
+        SetIndexBlock(myAcols, ie*localSize, localAcols, localSize);
+    }
+}
 
+/* Scatter the upper triangle (a,i_c) <= (b,j_c) of the local matrices of a
+ * batch, nln*dim*(nln*dim+1)/2 entries per element */
+FORCE_INLINE void BatchScatterMatrixSymmetric(const int dim, const int ie0, const int nb, const int nln, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* detjac, double aloc[nln][dim][nln][dim][ELEMENT_BATCH],
+        IndexArray myArows, IndexArray myAcols, CoefArray myAcoef)
+{
+    int l, a, b, i_c, j_c;
+    mwSize localSize = nln*dim*(nln*dim+1)/2;
+    for (l = 0; l < nb; l = l + 1 )
+    {
+        int ie = ie0 + l;
+        long long localArows[localSize], localAcols[localSize];
 
-void compute_DerGreenStrainTensor(int dim, int numQuadPoints, double F[dim][dim][numQuadPoints], double dF[dim][dim], double dE[dim][dim], int q );
+        mwSize iii = 0;
+        for (b = 0; b < nln; b = b + 1 )
+        {
+            for (j_c = 0; j_c < dim; j_c = j_c + 1 )
+            {
+                for (a = 0; a <= b; a = a + 1 )
+                {
+                    for (i_c = 0; i_c < (a == b ? j_c + 1 : dim); i_c = i_c + 1 )
+                    {
+                        SetSymmetricIndex(localArows, localAcols, iii,
+                                elements[a+ie*numRowsElements] + i_c * NumNodes, elements[b+ie*numRowsElements] + j_c * NumNodes);
+                        SetCoef(myAcoef, ie*localSize+iii, aloc[a][i_c][b][j_c][l]*detjac[ie]);
+                        iii = iii + 1;
+                    }
+                }
+            }
+        }
+        SetIndexBlock(myArows, ie*localSize, localArows, localSize);
+        SetIndexBlock(myAcols, ie*localSize, localAcols, localSize);
+    }
+}
 
 
 #endif
\ No newline at end of file
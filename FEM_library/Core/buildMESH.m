@@ -9,6 +9,24 @@ function [ MESH ] = buildMESH( dim, elements, vertices, boundaries, fem, quad_or
 if nargin < 8
     model = [];
 end
+
+if nargin < 9
+    rings = [];
+end
+
+%% Renumber elements and vertices for locality if required
+% a reduced mesh (nargin > 9) is built from an already renumbered mesh and
+% its reduced elements/boundaries refer to that numbering: it is not
+% renumbered again
+if nargin >= 7 && nargin <= 9 && ~isempty(DATA) && isfield(DATA, 'Mesh') && DATA.Mesh.reorder
+    fprintf('\n Reordering mesh (%s) ... ', DATA.Mesh.node_ordering)
+    time_mesh = tic;
+    [vertices, boundaries, elements, rings] = ...
+        ReorderMesh(vertices, boundaries, elements, dim, DATA.Mesh.node_ordering, rings);
+    time_mesh = toc(time_mesh);
+    fprintf('done in %f s\n', time_mesh)
+end
+
 %% Fill MESH data structure
 MESH.dim         = dim;
 MESH.fem         = fem;
@@ -1,8 +1,33 @@
-function [detjac, invjac, h] = geotrasf(dim, vertices, elements)
+function [detjac, invjac, h] = geotrasf(dim, vertices, elements, layout)
 %GEOTRASF linear 2\3 dimensional geometrical transformation
 %
+%   [DETJAC, INVJAC, H] = GEOTRASF(DIM, VERTICES, ELEMENTS) returns the
+%   determinant and the inverse of the jacobian of the affine map and the
+%   element size. INVJAC is a noe x dim x dim array.
+%
+%   [DETJAC, INVJAC, H] = GEOTRASF(DIM, VERTICES, ELEMENTS, 'AoS') returns
+%   INVJAC as a (dim*dim) x noe matrix (element-contiguous layout), which
+%   is also accepted by the C assemblers.
+%
+%   If available, the C/OpenMP implementation geotrasf_C_omp is called.
+%
 %   F. Saleri 24-08-01, F. Negri 18.11.2014
 
+if nargin < 4 || isempty(layout)
+    layout = 'SoA';
+end
+
+if exist('geotrasf_C_omp', 'file') == 3
+    [detjac, invjac, h] = geotrasf_C_omp(dim, vertices, elements, layout);
+    return;
+end
+
+if strcmp(layout, 'AoS')
+    [detjac, invjac, h] = geotrasf(dim, vertices, elements, 'SoA');
+    invjac = reshape( permute(invjac, [2 3 1]), dim*dim, size(elements,2) );
+    return;
+end
+
 noe    = size(elements,2);
 detjac = zeros(1,noe);
 invjac = zeros(noe, dim, dim);
@@ -0,0 +1,211 @@
+/*   This file is part of redbKIT.
+ *   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+ *   Author: Federico Negri <federico.negri@epfl.ch>
+ */
+
+#include "mex.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include "Tools.h"
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#warning "OpenMP not enabled. Compile with mex geotrasf_C_omp.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp""
+#endif
+
+/* invjac(ie,d1,d2): noe x dim x dim (default) or dim*dim x noe (AoS) */
+#define INVJAC_OUT(i,j,k) invjac[(i)*strideE+((j)+(k)*dim)*strideC]
+
+/*************************************************************************/
+void geotrasf2D(int noe, mwSize numRowsElements, int numRowsVertices, const long long* elements, double* vertices,
+                double* detjac, double* invjac, double* h, mwSize strideE, mwSize strideC)
+{
+    int ie;
+    int dim = 2;
+
+#pragma omp parallel for schedule(runtime) shared(elements,vertices,detjac,invjac,h) private(ie) firstprivate(noe,numRowsElements,numRowsVertices,dim,strideE,strideC)
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        long long a1 = elements[ie*numRowsElements    ] - 1;
+        long long a2 = elements[ie*numRowsElements + 1] - 1;
+        long long a3 = elements[ie*numRowsElements + 2] - 1;
+
+        /* Triangle sides */
+        double s13x = vertices[a1*numRowsVertices]   - vertices[a3*numRowsVertices];
+        double s31y = vertices[a3*numRowsVertices+1] - vertices[a1*numRowsVertices+1];
+        double s32x = vertices[a3*numRowsVertices]   - vertices[a2*numRowsVertices];
+        double s23y = vertices[a2*numRowsVertices+1] - vertices[a3*numRowsVertices+1];
+        double s21x = vertices[a2*numRowsVertices]   - vertices[a1*numRowsVertices];
+        double s21y = vertices[a2*numRowsVertices+1] - vertices[a1*numRowsVertices+1];
+
+        /* Determinant of the Jacobian matrix with sign */
+        double det = s13x*s23y - s31y*s32x;
+        double uno_su_detjac = 1.0 / det;
+
+        INVJAC_OUT(ie,0,0) = s31y*uno_su_detjac;
+        INVJAC_OUT(ie,0,1) = -s21y*uno_su_detjac;
+        INVJAC_OUT(ie,1,0) = s13x*uno_su_detjac;
+        INVJAC_OUT(ie,1,1) = s21x*uno_su_detjac;
+
+        double hmax = s13x*s13x + s31y*s31y;
+        double tmp  = s32x*s32x + s23y*s23y;
+        hmax = (tmp > hmax) ? tmp : hmax;
+        tmp  = s21x*s21x + s21y*s21y;
+        hmax = (tmp > hmax) ? tmp : hmax;
+        h[ie] = sqrt(hmax);
+
+        detjac[ie] = fabs(det);
+    }
+}
+/*************************************************************************/
+void geotrasf3D(int noe, mwSize numRowsElements, int numRowsVertices, const long long* elements, double* vertices,
+                double* detjac, double* invjac, double* h, mwSize strideE, mwSize strideC)
+{
+    int ie;
+    int dim = 3;
+
+#pragma omp parallel for schedule(runtime) shared(elements,vertices,detjac,invjac,h) private(ie) firstprivate(noe,numRowsElements,numRowsVertices,dim,strideE,strideC)
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        double* v1 = vertices + (elements[ie*numRowsElements    ] - 1) * numRowsVertices;
+        double* v2 = vertices + (elements[ie*numRowsElements + 1] - 1) * numRowsVertices;
+        double* v3 = vertices + (elements[ie*numRowsElements + 2] - 1) * numRowsVertices;
+        double* v4 = vertices + (elements[ie*numRowsElements + 3] - 1) * numRowsVertices;
+
+        /* Lengths of the sides */
+        double s21x = v2[0] - v1[0];
+        double s31x = v3[0] - v1[0];
+        double s41x = v4[0] - v1[0];
+        double s21y = v2[1] - v1[1];
+        double s31y = v3[1] - v1[1];
+        double s41y = v4[1] - v1[1];
+        double s21z = v2[2] - v1[2];
+        double s31z = v3[2] - v1[2];
+        double s41z = v4[2] - v1[2];
+
+        double pzkI   = s31y*s41z - s41y*s31z;
+        double pzkII  = s31x*s41z - s41x*s31z;
+        double pzkIII = s31x*s41y - s41x*s31y;
+
+        /* Volumes (multiplied by 6) */
+        double volume = s21x*pzkI - s21y*pzkII + s21z*pzkIII;
+        double uno_su_volume = 1.0 / volume;
+
+        INVJAC_OUT(ie,0,0) = pzkI*uno_su_volume;
+        INVJAC_OUT(ie,1,0) = -pzkII*uno_su_volume;
+        INVJAC_OUT(ie,2,0) = pzkIII*uno_su_volume;
+
+        INVJAC_OUT(ie,0,1) = (s41y*s21z - s21y*s41z)*uno_su_volume;
+        INVJAC_OUT(ie,1,1) = (s21x*s41z - s41x*s21z)*uno_su_volume;
+        INVJAC_OUT(ie,2,1) = (s21y*s41x - s21x*s41y)*uno_su_volume;
+
+        INVJAC_OUT(ie,0,2) = (s21y*s31z - s31y*s21z)*uno_su_volume;
+        INVJAC_OUT(ie,1,2) = (s21z*s31x - s21x*s31z)*uno_su_volume;
+        INVJAC_OUT(ie,2,2) = (s21x*s31y - s31x*s21y)*uno_su_volume;
+
+        double s23x = v2[0] - v3[0];
+        double s43x = v4[0] - v3[0];
+        double s24x = v2[0] - v4[0];
+        double s23y = v2[1] - v3[1];
+        double s43y = v4[1] - v3[1];
+        double s24y = v2[1] - v4[1];
+        double s23z = v2[2] - v3[2];
+        double s43z = v4[2] - v3[2];
+        double s24z = v2[2] - v4[2];
+
+        /* as in geotrasf.m, in 3D h is the max squared edge length */
+        double hmax = s31x*s31x + s31y*s31y + s31z*s31z;
+        double tmp  = s21x*s21x + s21y*s21y + s21z*s21z;
+        hmax = (tmp > hmax) ? tmp : hmax;
+        tmp  = s41x*s41x + s41y*s41y + s41z*s41z;
+        hmax = (tmp > hmax) ? tmp : hmax;
+        tmp  = s23x*s23x + s23y*s23y + s23z*s23z;
+        hmax = (tmp > hmax) ? tmp : hmax;
+        tmp  = s43x*s43x + s43y*s43y + s43z*s43z;
+        hmax = (tmp > hmax) ? tmp : hmax;
+        tmp  = s24x*s24x + s24y*s24y + s24z*s24z;
+        hmax = (tmp > hmax) ? tmp : hmax;
+        h[ie] = hmax;
+
+        detjac[ie] = fabs(volume);
+    }
+}
+/*************************************************************************/
+
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+    SetOmpRuntime();
+
+    /* Check for proper number of arguments. */
+    if(nrhs!=3 && nrhs!=4) {
+        mexErrMsgTxt("3 or 4 inputs are required.");
+    } else if(nlhs>3) {
+        mexErrMsgTxt("Too many output arguments.");
+    }
+
+    int dim              = (int) mxGetScalar(prhs[0]);
+    int numRowsVertices  = mxGetM(prhs[1]);
+    double* vertices     = mxGetPr(prhs[1]);
+    int noe              = mxGetN(prhs[2]);
+    mwSize numRowsElements  = mxGetM(prhs[2]);
+
+    if (dim != 2 && dim != 3) {
+        mexErrMsgTxt("dim must be 2 or 3.");
+    }
+    if (numRowsVertices < dim || numRowsElements < dim+1) {
+        mexErrMsgTxt("vertices or elements have the wrong number of rows.");
+    }
+
+    int AoS = 0;
+    if (nrhs == 4)
+    {
+        char *layout = mxArrayToString(prhs[3]);
+        if (strcmp(layout, "AoS")==0) {
+            AoS = 1;
+        } else if (strcmp(layout, "SoA")!=0) {
+            mexErrMsgTxt("Unknown layout. Valid layouts are 'SoA' and 'AoS'.");
+        }
+        mxFree(layout);
+    }
+
+    long long* elements = GetIndexData(prhs[2]);
+
+    plhs[0] = CreateElementMatrix(1, noe, noe);
+    plhs[2] = CreateElementMatrix(1, noe, noe);
+
+    mwSize strideE, strideC;
+    if (AoS)
+    {
+        /* element-contiguous: dim*dim x noe */
+        plhs[1] = CreateElementMatrix(dim*dim, noe, noe);
+        strideE = dim*dim;
+        strideC = 1;
+    }
+    else
+    {
+        mwSize dims[3];
+        dims[0] = noe;
+        dims[1] = dim;
+        dims[2] = dim;
+        plhs[1] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+        strideE = 1;
+        strideC = noe;
+    }
+
+    double* detjac = mxGetPr(plhs[0]);
+    double* invjac = mxGetPr(plhs[1]);
+    double* h      = mxGetPr(plhs[2]);
+
+    if (dim == 2)
+    {
+        geotrasf2D(noe, numRowsElements, numRowsVertices, elements, vertices, detjac, invjac, h, strideE, strideC);
+    }
+    else
+    {
+        geotrasf3D(noe, numRowsElements, numRowsVertices, elements, vertices, detjac, invjac, h, strideE, strideC);
+    }
+
+    ReleaseIndexData(elements, prhs[2]);
+}
+/*************************************************************************/
@@ -2,6 +2,11 @@
 % LinearSolver methods:
 %    LinearSolver       - constructor
 %    SetPreconditioner  - set preconditioner object
+%    SetReusePreconditioner - keep the preconditioner (and the MUMPS,
+%                         matlab_lu or matlab_chol factorization) across
+%                         calls to Solve
+%    Reset              - discard stored factorization and preconditioner
+%    UsesUpperTriangle  - true if Solve only reads the upper triangle of A
 %    Solve              - solve linear system Ax = b
 %
 % LinearSolver properties:
@@ -21,13 +26,21 @@ properties
     M_precon;
 
     %M_options -
-    %    type (mandatory): 'backslash', 'MUMPS', 'gmres', 'matlab_lu'
+    %    type (mandatory): 'backslash', 'MUMPS', 'gmres', 'matlab_lu',
+    %               'matlab_chol' (symmetric matrices: Cholesky factorization,
+    %               or LDL' if A is not positive definite)
     %    mumps_reordering (only for type = 'MUMPS'):
     %               0 - Approximate Minimum Degree is used
     %               3 - SCOTCH (if available)
     %               4 - PORD (if available)
     %               5 - METIS (if available)
     %               7 - Automatic choice by MUMPS
+    %    symmetric (only for type = 'MUMPS'): passed to MUMPS as SYM
+    %               0 - unsymmetric matrix (LU)
+    %               1 - symmetric positive definite matrix (Cholesky)
+    %               2 - general symmetric matrix (LDL')
+    %               with symmetric > 0 only the upper triangle of A is
+    %               passed to MUMPS, so A can be assembled as upper triangle
     %    tol (only for type = 'gmres'): iterative solver tolerance
     %    maxit (only for type = 'gmres'): max number of iterations
     %    gmres_verbosity (only for type = 'gmres'): print convergence
@@ -45,6 +58,7 @@ classdef LinearSolver < handle
         M_precon;
         M_verbose;
         M_haveFactorization;
+        M_reusePrecon;
         M_solveTime;
     end
     
@@ -53,6 +67,8 @@ classdef LinearSolver < handle
         M_U;
         M_perm;
         M_invperm;
+        M_isPosDef;
+        M_mumps;
     end
     
     methods
@@ -65,6 +81,7 @@ classdef LinearSolver < handle
             obj.M_verbose   = false;
             obj.M_solveTime = 0;
             obj.M_haveFactorization = false;
+            obj.M_reusePrecon       = false;
             
         end
         
@@ -81,6 +98,59 @@ classdef LinearSolver < handle
             obj.M_precon = Precon;
         end
         
+        %% SetReusePreconditioner
+        function obj = SetReusePreconditioner( obj, reuse )
+            %SetReusePreconditioner method
+            %   LinearSolver.SetReusePreconditioner( true ) keeps the
+            %   preconditioner after each gmres solve, and the factorization
+            %   after each MUMPS, matlab_lu or matlab_chol solve, so that
+            %   they can be applied to several linear systems (e.g.
+            %   modified Newton). Without reuse every Solve factorizes A.
+            %   Call Reset before building a new preconditioner or
+            %   solving with a new matrix.
+            
+            obj.M_reusePrecon = reuse;
+        end
+        
+        %% Reset
+        function obj = Reset( obj )
+            %Reset method
+            %   LinearSolver.Reset( ) discards the stored factorization
+            %   (type = 'matlab_lu', 'matlab_chol', or 'MUMPS' with reuse)
+            %   and cleans the preconditioner, so that the next Solve
+            %   refers to a new matrix
+            
+            if ~isempty(obj.M_mumps)
+                % JOB = -2 releases the MUMPS instance
+                obj.M_mumps.JOB = -2;
+                dmumps(obj.M_mumps);
+                obj.M_mumps = [];
+            end
+            
+            obj.M_L       = [];
+            obj.M_U       = [];
+            obj.M_perm    = [];
+            obj.M_invperm = [];
+            obj.M_haveFactorization = false;
+            
+            % without reuse, the preconditioner is cleaned by Solve
+            if obj.M_reusePrecon && ~isempty(obj.M_precon)
+                obj.M_precon.Clean();
+            end
+        end
+        
+        %% UsesUpperTriangle
+        function upper = UsesUpperTriangle( obj )
+            %UsesUpperTriangle method
+            %   LinearSolver.UsesUpperTriangle( ) returns true if Solve only
+            %   reads the upper triangle of A (type = 'matlab_chol', or
+            %   type = 'MUMPS' with symmetric > 0). In this case A can be
+            %   passed as an upper triangular matrix.
+            
+            upper = strcmp(obj.M_type, 'matlab_chol') || ( strcmp(obj.M_type, 'MUMPS') ...
+                && isfield(obj.M_options, 'symmetric') && obj.M_options.symmetric > 0 );
+        end
+        
         %% GetSolveTime
         function t = GetSolveTime( obj )
             t = obj.M_solveTime;
@@ -90,11 +160,18 @@ classdef LinearSolver < handle
         function x = Solve( obj, A, b, x0 )
             %Solve method
             %   x = LinearSolver.Solve( A, b, x0 )
+            %
+            %   With type = 'gmres', A can be a function handle returning
+            %   the matrix-vector product A*x.
             
             if nargin < 4 || isempty(x0)
                 x0 = zeros(length(b),1);
             end
             
+            if isa(A, 'function_handle') && ~strcmp(obj.M_type, 'gmres')
+                error('LinearSolver: a matrix-free operator A requires type = ''gmres''')
+            end
+            
             if obj.M_verbose
                 fprintf('\n         Solving Linear System ...\n')
             end
@@ -110,32 +187,61 @@ classdef LinearSolver < handle
                 case 'MUMPS'
                     time_solve = tic;
                     
-                    % initialization of a matlab MUMPS structure
-                    id     = initmumps;
-                    id.SYM = 0;
-                    % here JOB = -1, the call to MUMPS will initialize C
-                    % and fortran MUMPS structure
-                    id = dmumps(id);
-                    % JOB = 6 means analysis + factorization + solve
-                    id.JOB = 6;
-                    
-                    id.ICNTL(1:4) = -1; % no output
-                    id.ICNTL(7)   = obj.M_options.mumps_reordering; % Typer of reordering
-                    % set RHS
-                    id.RHS = b;
-                    
-                    % Call Mumps
-                    [id] = dmumps(id,A);
-                    x = id.SOL;
-                    
-                    id.JOB = -2;
-                    id = dmumps(id);
+                    if isfield(obj.M_options, 'symmetric') && obj.M_options.symmetric > 0
+                        A      = triu(A);
+                    end
+                    
+                    if isempty(obj.M_mumps)
+                        % initialization of a matlab MUMPS structure
+                        id     = initmumps;
+                        id.SYM = 0;
+                        if isfield(obj.M_options, 'symmetric') && obj.M_options.symmetric > 0
+                            id.SYM = obj.M_options.symmetric;
+                        end
+                        % here JOB = -1, the call to MUMPS will initialize C
+                        % and fortran MUMPS structure
+                        id = dmumps(id);
+                        
+                        id.ICNTL(1:4) = -1; % no output
+                        id.ICNTL(7)   = obj.M_options.mumps_reordering; % Typer of reordering
+                        
+                        if obj.M_reusePrecon
+                            % JOB = 4 means analysis + factorization; the
+                            % MUMPS instance is kept until Reset
+                            id.JOB = 4;
+                            [id]   = dmumps(id,A);
+                            obj.M_mumps = id;
+                            obj.M_haveFactorization = true;
+                        end
+                    end
+                    
+                    if ~isempty(obj.M_mumps)
+                        % JOB = 3 means solve with the stored factorization
+                        obj.M_mumps.JOB = 3;
+                        obj.M_mumps.RHS = b;
+                        obj.M_mumps     = dmumps(obj.M_mumps,A);
+                        x = obj.M_mumps.SOL;
+                    else
+                        % JOB = 6 means analysis + factorization + solve
+                        id.JOB = 6;
+                        % set RHS
+                        id.RHS = b;
+                        
+                        % Call Mumps
+                        [id] = dmumps(id,A);
+                        x = id.SOL;
+                        
+                        id.JOB = -2;
+                        id = dmumps(id);
+                    end
                     obj.M_solveTime = toc(time_solve);
                     
                 case 'matlab_lu'
                     time_solve = tic;
                     
-                    if  ~obj.M_haveFactorization
+                    % the factorization is kept for the next Solve only
+                    % with SetReusePreconditioner( true )
+                    if  ~obj.M_reusePrecon || ~obj.M_haveFactorization
                         [obj.M_L , obj.M_U , obj.M_perm , q ]  = lu(A, 'vector');
                         obj.M_invperm             = 0*q ;
                         obj.M_invperm(q)          = 1:length(q);
@@ -148,6 +254,30 @@ classdef LinearSolver < handle
                     
                     obj.M_solveTime = toc(time_solve);
                     
+                case 'matlab_chol'
+                    time_solve = tic;
+                    
+                    % A(p,p) = U'*U, or A(p,p) = L*D*L' if A is not
+                    % positive definite. chol only reads the upper
+                    % triangle of A, ldl needs the full matrix
+                    if  ~obj.M_reusePrecon || ~obj.M_haveFactorization
+                        [obj.M_U, flag, obj.M_perm] = chol(A, 'vector');
+                        obj.M_isPosDef = (flag == 0);
+                        if ~obj.M_isPosDef
+                            [obj.M_L, obj.M_U, obj.M_perm] = ldl(triu(A) + triu(A,1).', 'vector');
+                        end
+                        obj.M_haveFactorization = true;
+                    end
+                    
+                    x = zeros(size(b));
+                    if obj.M_isPosDef
+                        x(obj.M_perm,:) = obj.M_U \ (obj.M_U' \ b(obj.M_perm,:));
+                    else
+                        x(obj.M_perm,:) = obj.M_L' \ (obj.M_U \ (obj.M_L \ b(obj.M_perm,:)));
+                    end
+                    
+                    obj.M_solveTime = toc(time_solve);
+                    
                 case 'gmres'
                     
                     time_solve = tic;
@@ -157,7 +287,9 @@ classdef LinearSolver < handle
                     
                     obj.M_solveTime = toc(time_solve);
                     
-                    obj.M_precon.Clean();
+                    if ~obj.M_reusePrecon
+                        obj.M_precon.Clean();
+                    end
                     
                     if flagITER == 0
                         fprintf('\nGmres converged in %d iterations\n',length(resvec));
@@ -0,0 +1,128 @@
+function [vertices, boundaries, elements, rings, vertex_perm, element_perm] = ...
+    ReorderMesh(vertices, boundaries, elements, dim, node_ordering, rings)
+%REORDERMESH renumber a P1 mesh for locality
+%
+%   [VERTICES, BOUNDARIES, ELEMENTS, RINGS, VERTEX_PERM, ELEMENT_PERM] = ...
+%       REORDERMESH(VERTICES, BOUNDARIES, ELEMENTS, DIM, NODE_ORDERING, RINGS)
+%   sorts the ELEMENTS along a Hilbert curve through their barycenters and
+%   renumbers the VERTICES by reverse Cuthill-McKee (NODE_ORDERING = 'rcm',
+%   default) or nested dissection ('nd') of the vertex graph. Consecutive
+%   elements then gather and scatter nearby dofs, and the bandwidth (or
+%   fill-in) of the assembled matrices is reduced.
+%
+%   VERTEX_PERM(i) is the original index of the new vertex i, and
+%   ELEMENT_PERM(e) the original index of the new element e: a vertex field
+%   U in the new numbering is mapped back to the input one by
+%   U_orig(VERTEX_PERM) = U(1:numVertices).
+%
+%   RINGS is optional and may be empty.
+
+%   This file is part of redbKIT.
+%   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+%   Author: Federico Negri <federico.negri at epfl.ch>
+
+if nargin < 5 || isempty(node_ordering)
+    node_ordering = 'rcm';
+end
+
+if nargin < 6
+    rings = [];
+end
+
+nov = size(vertices,2);
+nln = dim + 1;
+
+%% Element order: Hilbert curve through the barycenters
+barycenters = zeros(dim, size(elements,2));
+for k = 1 : nln
+    barycenters = barycenters + vertices(1:dim, elements(k,:));
+end
+barycenters = barycenters / nln;
+
+[~, element_perm] = sort( hilbert_key(barycenters) );
+elements          = elements(:, element_perm);
+
+%% Vertex order: RCM or nested dissection of the vertex graph
+[X, Y] = meshgrid(1:nln, 1:nln);
+A      = sparse(elements(X(:),:), elements(Y(:),:), 1, nov, nov);
+
+switch node_ordering
+    case 'rcm'
+        vertex_perm = symrcm(A);
+
+    case 'nd'
+        vertex_perm = dissect(A);
+
+    otherwise
+        error('ReorderMesh: unknown node ordering %s', node_ordering);
+end
+
+vertex_iperm(vertex_perm) = 1 : nov;
+
+vertices          = vertices(:, vertex_perm);
+elements(1:nln,:) = vertex_iperm(elements(1:nln,:));
+
+boundaries(1:dim,:) = vertex_iperm(boundaries(1:dim,:));
+
+if ~isempty(rings)
+    rings(1:dim-1,:) = vertex_iperm(rings(1:dim-1,:));
+end
+
+element_perm = element_perm(:);
+vertex_perm  = vertex_perm(:);
+
+end
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+function key = hilbert_key(P)
+% Hilbert index of the points P (dim x N) on a 2^nbits grid of their
+% bounding box (Skilling's transpose algorithm, vectorized over points)
+
+[n, N] = size(P);
+nbits  = floor(52 / n);
+nbits  = min(nbits, 16);
+
+Pmin   = min(P, [], 2);
+Pext   = max(P, [], 2) - Pmin;
+Pext(Pext == 0) = 1;
+
+X = uint32( floor( (P - Pmin*ones(1,N)) ./ (Pext*ones(1,N)) * (2^nbits - 1) ) );
+
+% inverse undo
+Q = uint32(2^(nbits-1));
+while Q > 1
+    Pm = Q - 1;
+    for i = 1 : n
+        flip = bitand(X(i,:), Q) ~= 0;
+        X(1,flip) = bitxor(X(1,flip), Pm);
+        t = bitand(bitxor(X(1,~flip), X(i,~flip)), Pm);
+        X(1,~flip) = bitxor(X(1,~flip), t);
+        X(i,~flip) = bitxor(X(i,~flip), t);
+    end
+    Q = Q / 2;
+end
+
+% Gray encode
+for i = 2 : n
+    X(i,:) = bitxor(X(i,:), X(i-1,:));
+end
+t = zeros(1, N, 'uint32');
+Q = uint32(2^(nbits-1));
+while Q > 1
+    set    = bitand(X(n,:), Q) ~= 0;
+    t(set) = bitxor(t(set), Q - 1);
+    Q = Q / 2;
+end
+for i = 1 : n
+    X(i,:) = bitxor(X(i,:), t);
+end
+
+% interleave the bits of the transposed index, most significant first
+key = zeros(1, N);
+for b = nbits-1 : -1 : 0
+    for i = 1 : n
+        key = 2*key + double(bitget(X(i,:), b+1));
+    end
+end
+
+end
@@ -8,6 +8,10 @@ function [vertices, boundaries, elements, rings] = msh_to_Mmesh(filename, dimens
 %   [VERTICES, BOUNDARIES, ELEMENTS, RINGS] = MSH_TO_MMESH(FILENAME, DIMENSION)
 %   if available, returns also RINGS "elements", i.e. points in 2D and
 %   lines in 3D.
+%
+%   The mesh is read by the C reader read_msh_C (MSH versions 2 and 4.1,
+%   ASCII or binary) if it has been compiled (see make.m), by READ_MSH
+%   otherwise.
 
 %   This file is part of redbKIT.
 %   Copyright (c) 2015, Ecole Polytechnique Federale de Lausanne (EPFL)
@@ -23,7 +27,7 @@ time_load = tic;
 
 if dimension == 2
       mesh_filename    =  strcat(filename,'.msh');
-      mesh             =  read_msh(mesh_filename);
+      mesh             =  load_msh(mesh_filename);
       vertices         =  mesh.NODES(1:2,:);
       elements         =  mesh.ELEMENTS{2};
       tmp_boundaries   =  mesh.ELEMENTS{1};
@@ -46,7 +50,7 @@ if dimension == 2
 elseif dimension == 3  
     
       mesh_filename    =  strcat(filename,'.msh');
-      mesh             =  read_msh(mesh_filename);
+      mesh             =  load_msh(mesh_filename);
       vertices         =  mesh.NODES;
       elements         =  mesh.ELEMENTS{4};
       tmp_boundaries   =  mesh.ELEMENTS{2};
@@ -68,4 +72,15 @@ time_load = toc(time_load);
 fprintf('done in %3.2f s \n\n',time_load);
 
 
-return
\ No newline at end of file
+return
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+function mesh = load_msh(mesh_filename)
+
+if exist('read_msh_C', 'file') == 3
+    mesh = read_msh_C(mesh_filename);
+else
+    mesh = read_msh(mesh_filename);
+end
+
+return
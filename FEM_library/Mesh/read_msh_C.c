@@ -0,0 +1,810 @@
+/*   This file is part of redbKIT.
+ *   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+ *   Author: Federico Negri <federico.negri@epfl.ch>
+ */
+
+/* Gmsh mesh reader
+ *
+ *  MESH = read_msh_C(FILENAME)
+ *
+ *  reads a mesh in MSH format version 2 (ASCII or binary) or 4.1 (ASCII or
+ *  binary) and returns the same fields of read_msh:
+ *
+ *  MESH.NODES: a 3 x NumNodes matrix containing the nodes coordinates
+ *
+ *  MESH.ELEMENTS: a 31x1 cell array. The i-th cell contains a matrix of size
+ *     (NumNodesPerElem+1) x HowMany with the elements of type i: the first
+ *     NumNodesPerElem rows contain the indices of their nodes, the last one
+ *     the physical entity they belong to (0 if none)
+ *
+ *  The file is memory-mapped (read at once on Windows). In ASCII version 2 files, the lines of the
+ *  $Nodes and $Elements sections are located first and then parsed in
+ *  parallel; binary files are read record by record. Node tags need not be
+ *  contiguous: the nodes are numbered as they appear in the file.
+ */
+
+#include "mex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#warning "OpenMP not enabled. Compile with mex read_msh_C.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp""
+#endif
+
+#define MSH_NUM_TYPES 31
+
+/* number of nodes of the Gmsh element types 1,...,31 */
+static const int NodesPerElement[MSH_NUM_TYPES+1] =
+    {0, 2, 3, 4, 4, 8, 6, 5, 3, 6, 9, 10, 27, 18, 14, 1, 8, 20, 15, 13, 9, 10, 12, 15, 15, 21, 4, 5, 6, 20, 35, 56};
+
+/*************************************************************************/
+/* Mapped file: data[0:size-1] is the content, data[size] = 0 so that the
+ * ASCII parsing functions stop at the end of the file */
+typedef struct
+{
+    char*   data;
+    size_t  size;
+    int     mapped;
+} MshFile;
+
+static void OpenMshFile(const char* filename, MshFile* file)
+{
+    file->data   = NULL;
+    file->size   = 0;
+    file->mapped = 0;
+
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        mexErrMsgTxt("read_msh_C: cannot open the file.");
+    }
+    struct stat st;
+    fstat(fd, &st);
+    file->size = st.st_size;
+
+    /* the byte after the end of the file is 0 only if it is in the same
+     * page of the last one */
+    long page = sysconf(_SC_PAGESIZE);
+    if (file->size > 0 && file->size % page != 0)
+    {
+        void* data = mmap(NULL, file->size + 1, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            file->data   = (char*) data;
+            file->mapped = 1;
+        }
+    }
+    close(fd);
+
+    if (file->mapped)
+    {
+        return;
+    }
+#endif
+
+    FILE* fid = fopen(filename, "rb");
+    if (fid == NULL)
+    {
+        mexErrMsgTxt("read_msh_C: cannot open the file.");
+    }
+    fseek(fid, 0, SEEK_END);
+    file->size = ftell(fid);
+    fseek(fid, 0, SEEK_SET);
+    file->data = mxMalloc(file->size + 1);
+    if (fread(file->data, 1, file->size, fid) != file->size)
+    {
+        fclose(fid);
+        mexErrMsgTxt("read_msh_C: error reading the file.");
+    }
+    file->data[file->size] = 0;
+    fclose(fid);
+}
+
+static void CloseMshFile(MshFile* file)
+{
+#ifndef _WIN32
+    if (file->mapped)
+    {
+        munmap(file->data, file->size + 1);
+        return;
+    }
+#endif
+    mxFree(file->data);
+}
+/*************************************************************************/
+/* Cursor on the file: numbers are parsed from text or read as binary
+ * records (int: 4 bytes, size_t: sizeSize bytes, double: 8 bytes) */
+typedef struct
+{
+    const char* begin;
+    const char* p;
+    const char* end;
+    int         binary;
+    int         sizeSize;
+} MshCursor;
+
+static void CheckAvailable(const MshCursor* c, size_t n)
+{
+    if (c->p + n > c->end)
+    {
+        mexErrMsgTxt("read_msh_C: unexpected end of file.");
+    }
+}
+
+static long long ReadInt(MshCursor* c)
+{
+    if (c->binary)
+    {
+        int value;
+        CheckAvailable(c, sizeof(int));
+        memcpy(&value, c->p, sizeof(int));
+        c->p += sizeof(int);
+        return value;
+    }
+    char* next;
+    long long value = strtoll(c->p, &next, 10);
+    if (next == c->p)
+    {
+        mexErrMsgTxt("read_msh_C: integer expected.");
+    }
+    c->p = next;
+    return value;
+}
+
+static long long ReadSize(MshCursor* c)
+{
+    if (c->binary)
+    {
+        if (c->sizeSize == 4)
+        {
+            return ReadInt(c);
+        }
+        long long value;
+        CheckAvailable(c, sizeof(long long));
+        memcpy(&value, c->p, sizeof(long long));
+        c->p += sizeof(long long);
+        return value;
+    }
+    return ReadInt(c);
+}
+
+static double ReadDouble(MshCursor* c)
+{
+    double value;
+    if (c->binary)
+    {
+        CheckAvailable(c, sizeof(double));
+        memcpy(&value, c->p, sizeof(double));
+        c->p += sizeof(double);
+        return value;
+    }
+    char* next;
+    value = strtod(c->p, &next);
+    if (next == c->p)
+    {
+        mexErrMsgTxt("read_msh_C: real number expected.");
+    }
+    c->p = next;
+    return value;
+}
+
+/* move to the beginning of the next line */
+static void NextLine(MshCursor* c)
+{
+    const char* eol = memchr(c->p, '\n', c->end - c->p);
+    c->p = eol ? eol + 1 : c->end;
+}
+
+/* move to the next line starting with '$', 0 if there is none */
+static int NextDollar(MshCursor* c)
+{
+    while (c->p < c->end)
+    {
+        if (*c->p == '$' && (c->p == c->begin || c->p[-1] == '\n' || c->p[-1] == '\r'))
+        {
+            return 1;
+        }
+        const char* next = memchr(c->p + 1, '$', c->end - c->p - 1);
+        c->p = next ? next : c->end;
+    }
+    return 0;
+}
+
+/* read the name of the next section ($Name) and move to the next line */
+static int NextSection(MshCursor* c, char* name, const int len)
+{
+    if (!NextDollar(c))
+    {
+        return 0;
+    }
+    int k = 0;
+    while (c->p < c->end && k < len - 1 && !isspace((unsigned char) *c->p))
+    {
+        name[k++] = *c->p++;
+    }
+    name[k] = 0;
+    NextLine(c);
+    return 1;
+}
+
+/*************************************************************************/
+/* Nodes and elements read so far. The elements of type t are stored in
+ * elements[t], (NodesPerElement[t]+1) values each: the node tags and the
+ * physical tag */
+typedef struct
+{
+    mwSize      numNodes;
+    double*     coord;          /* 3 x numNodes */
+    long long*  nodeTags;
+
+    mwSize      count[MSH_NUM_TYPES+1];
+    mwSize      capacity[MSH_NUM_TYPES+1];
+    double*     elements[MSH_NUM_TYPES+1];
+
+    /* physical tag of the entities of each dimension (version 4) */
+    long long   maxEntityTag[4];
+    int*        entityPhysical[4];
+} MshMesh;
+
+static void CheckType(const long long type)
+{
+    if (type < 1 || type > MSH_NUM_TYPES)
+    {
+        mexErrMsgTxt("read_msh_C: unsupported element type.");
+    }
+}
+
+static double* AppendElement(MshMesh* mesh, const int type)
+{
+    int rows = NodesPerElement[type] + 1;
+    if (mesh->count[type] == mesh->capacity[type])
+    {
+        mesh->capacity[type] = 2 * mesh->capacity[type] + 64;
+        mesh->elements[type] = mxRealloc(mesh->elements[type], sizeof(double) * rows * mesh->capacity[type]);
+    }
+    return mesh->elements[type] + rows * (mesh->count[type]++);
+}
+
+static void AllocateNodes(MshMesh* mesh, const mwSize numNodes)
+{
+    mesh->numNodes = numNodes;
+    mesh->coord    = mxMalloc(sizeof(double) * 3 * (numNodes > 0 ? numNodes : 1));
+    mesh->nodeTags = mxMalloc(sizeof(long long) * (numNodes > 0 ? numNodes : 1));
+}
+/*************************************************************************/
+/* version 2, ASCII: the starting points of the lines are located serially,
+ * the lines are then parsed in parallel */
+static const char** LineStarts(MshCursor* c, const mwSize n)
+{
+    const char** lines = mxMalloc(sizeof(char*) * (n > 0 ? n : 1));
+    mwSize i;
+    for (i = 0; i < n; i++)
+    {
+        if (c->p >= c->end)
+        {
+            mexErrMsgTxt("read_msh_C: unexpected end of file.");
+        }
+        lines[i] = c->p;
+        NextLine(c);
+    }
+    return lines;
+}
+
+static void ReadNodesASCII2(MshCursor* c, MshMesh* mesh)
+{
+    mwSize n = ReadInt(c);
+    NextLine(c);
+    AllocateNodes(mesh, n);
+
+    const char** lines = LineStarts(c, n);
+    double* coord = mesh->coord;
+    long long* tags = mesh->nodeTags;
+    mwSize i;
+
+    #pragma omp parallel for schedule(static) shared(lines,coord,tags) private(i) firstprivate(n)
+    for (i = 0; i < n; i++)
+    {
+        char* q;
+        tags[i]       = strtoll(lines[i], &q, 10);
+        coord[3*i]    = strtod(q, &q);
+        coord[3*i+1]  = strtod(q, &q);
+        coord[3*i+2]  = strtod(q, &q);
+    }
+
+    mxFree(lines);
+}
+
+static void ReadElementsASCII2(MshCursor* c, MshMesh* mesh)
+{
+    mwSize n = ReadInt(c);
+    NextLine(c);
+
+    const char** lines = LineStarts(c, n);
+    int* type       = mxMalloc(sizeof(int) * (n > 0 ? n : 1));
+    long long* phys = mxMalloc(sizeof(long long) * (n > 0 ? n : 1));
+    mwSize* column  = mxMalloc(sizeof(mwSize) * (n > 0 ? n : 1));
+    mwSize e;
+    int t;
+
+    /* elm-number elm-type number-of-tags < tag > ... node-number-list:
+     * the first tag is the physical entity */
+    #pragma omp parallel for schedule(static) shared(lines,type,phys) private(e) firstprivate(n)
+    for (e = 0; e < n; e++)
+    {
+        char* q;
+        int k;
+        strtoll(lines[e], &q, 10);
+        type[e] = (int) strtol(q, &q, 10);
+        int numTags = (int) strtol(q, &q, 10);
+        phys[e] = 0;
+        for (k = 0; k < numTags; k++)
+        {
+            long long tag = strtoll(q, &q, 10);
+            if (k == 0)
+            {
+                phys[e] = tag;
+            }
+        }
+        lines[e] = q;
+    }
+
+    for (e = 0; e < n; e++)
+    {
+        CheckType(type[e]);
+        column[e] = mesh->count[type[e]]++;
+    }
+    for (t = 1; t <= MSH_NUM_TYPES; t++)
+    {
+        mwSize size = (NodesPerElement[t] + 1) * mesh->count[t];
+        mesh->capacity[t] = mesh->count[t];
+        mesh->elements[t] = mxRealloc(mesh->elements[t], sizeof(double) * (size > 0 ? size : 1));
+    }
+
+    double** elements = mesh->elements;
+    #pragma omp parallel for schedule(static) shared(lines,type,phys,column,elements) private(e) firstprivate(n)
+    for (e = 0; e < n; e++)
+    {
+        int rows = NodesPerElement[type[e]] + 1;
+        double* elem = elements[type[e]] + rows * column[e];
+        char* q = (char*) lines[e];
+        int k;
+        for (k = 0; k < rows - 1; k++)
+        {
+            elem[k] = (double) strtoll(q, &q, 10);
+        }
+        elem[rows-1] = (double) phys[e];
+    }
+
+    mxFree(column);
+    mxFree(phys);
+    mxFree(type);
+    mxFree(lines);
+}
+/*************************************************************************/
+/* version 2, binary */
+static void ReadNodesBinary2(MshCursor* c, MshMesh* mesh)
+{
+    c->binary = 0;
+    mwSize n = ReadInt(c);
+    NextLine(c);
+    c->binary = 1;
+    AllocateNodes(mesh, n);
+
+    mwSize i;
+    for (i = 0; i < n; i++)
+    {
+        mesh->nodeTags[i]   = ReadInt(c);
+        mesh->coord[3*i]    = ReadDouble(c);
+        mesh->coord[3*i+1]  = ReadDouble(c);
+        mesh->coord[3*i+2]  = ReadDouble(c);
+    }
+}
+
+static void ReadElementsBinary2(MshCursor* c, MshMesh* mesh)
+{
+    c->binary = 0;
+    mwSize n = ReadInt(c);
+    NextLine(c);
+    c->binary = 1;
+
+    /* blocks of elements of the same type and number of tags */
+    mwSize read = 0;
+    while (read < n)
+    {
+        int type     = ReadInt(c);
+        mwSize block = ReadInt(c);
+        int numTags  = ReadInt(c);
+        CheckType(type);
+
+        mwSize e;
+        int k;
+        for (e = 0; e < block; e++)
+        {
+            double* elem = AppendElement(mesh, type);
+            double phys  = 0;
+            ReadInt(c);
+            for (k = 0; k < numTags; k++)
+            {
+                int tag = ReadInt(c);
+                if (k == 0)
+                {
+                    phys = tag;
+                }
+            }
+            for (k = 0; k < NodesPerElement[type]; k++)
+            {
+                elem[k] = ReadInt(c);
+            }
+            elem[NodesPerElement[type]] = phys;
+        }
+        read += block;
+    }
+}
+/*************************************************************************/
+/* version 4.1, ASCII or binary: the physical tags of the elements are
+ * those of the entities (points, curves, surfaces, volumes) they belong to */
+static void ReadEntities4(MshCursor* c, MshMesh* mesh)
+{
+    long long numEntities[4];
+    int dim;
+    for (dim = 0; dim < 4; dim++)
+    {
+        numEntities[dim] = ReadSize(c);
+    }
+
+    /* entity tags and their first physical tag */
+    for (dim = 0; dim < 4; dim++)
+    {
+        long long* tags = mxMalloc(sizeof(long long) * (numEntities[dim] > 0 ? numEntities[dim] : 1));
+        int* phys       = mxMalloc(sizeof(int) * (numEntities[dim] > 0 ? numEntities[dim] : 1));
+        long long maxTag = 0;
+        long long e, k;
+
+        for (e = 0; e < numEntities[dim]; e++)
+        {
+            tags[e] = ReadInt(c);
+            maxTag  = (tags[e] > maxTag) ? tags[e] : maxTag;
+
+            /* point: X Y Z, other entities: bounding box */
+            for (k = 0; k < (dim == 0 ? 3 : 6); k++)
+            {
+                ReadDouble(c);
+            }
+
+            long long numPhys = ReadSize(c);
+            phys[e] = 0;
+            for (k = 0; k < numPhys; k++)
+            {
+                int tag = ReadInt(c);
+                if (k == 0)
+                {
+                    phys[e] = tag;
+                }
+            }
+
+            if (dim > 0)
+            {
+                long long numBounding = ReadSize(c);
+                for (k = 0; k < numBounding; k++)
+                {
+                    ReadInt(c);
+                }
+            }
+        }
+
+        mesh->maxEntityTag[dim]   = maxTag;
+        mesh->entityPhysical[dim] = mxCalloc(maxTag + 1, sizeof(int));
+        for (e = 0; e < numEntities[dim]; e++)
+        {
+            if (tags[e] >= 0)
+            {
+                mesh->entityPhysical[dim][tags[e]] = phys[e];
+            }
+        }
+
+        mxFree(phys);
+        mxFree(tags);
+    }
+}
+
+static void ReadNodes4(MshCursor* c, MshMesh* mesh)
+{
+    long long numBlocks = ReadSize(c);
+    long long n         = ReadSize(c);
+    ReadSize(c);
+    ReadSize(c);
+    AllocateNodes(mesh, n);
+
+    mwSize i = 0;
+    long long b, k;
+    for (b = 0; b < numBlocks; b++)
+    {
+        int entityDim   = ReadInt(c);
+        ReadInt(c);
+        int parametric  = ReadInt(c);
+        long long block = ReadSize(c);
+
+        if (i + block > n)
+        {
+            mexErrMsgTxt("read_msh_C: inconsistent number of nodes.");
+        }
+
+        for (k = 0; k < block; k++)
+        {
+            mesh->nodeTags[i+k] = ReadSize(c);
+        }
+        for (k = 0; k < block; k++)
+        {
+            int l;
+            mesh->coord[3*(i+k)]    = ReadDouble(c);
+            mesh->coord[3*(i+k)+1]  = ReadDouble(c);
+            mesh->coord[3*(i+k)+2]  = ReadDouble(c);
+            for (l = 0; parametric && l < entityDim; l++)
+            {
+                ReadDouble(c);
+            }
+        }
+        i += block;
+    }
+}
+
+static void ReadElements4(MshCursor* c, MshMesh* mesh)
+{
+    long long numBlocks = ReadSize(c);
+    ReadSize(c);
+    ReadSize(c);
+    ReadSize(c);
+
+    long long b, e;
+    int k;
+    for (b = 0; b < numBlocks; b++)
+    {
+        int entityDim   = ReadInt(c);
+        int entityTag   = ReadInt(c);
+        int type        = ReadInt(c);
+        long long block = ReadSize(c);
+        CheckType(type);
+
+        double phys = 0;
+        if (entityDim >= 0 && entityDim < 4 && mesh->entityPhysical[entityDim] != NULL
+            && entityTag >= 0 && entityTag <= mesh->maxEntityTag[entityDim])
+        {
+            phys = mesh->entityPhysical[entityDim][entityTag];
+        }
+
+        for (e = 0; e < block; e++)
+        {
+            double* elem = AppendElement(mesh, type);
+            ReadSize(c);
+            for (k = 0; k < NodesPerElement[type]; k++)
+            {
+                elem[k] = ReadSize(c);
+            }
+            elem[NodesPerElement[type]] = phys;
+        }
+    }
+}
+/*************************************************************************/
+/* MESH struct; the node tags of the elements are replaced by the indices
+ * of the nodes */
+static mxArray* CreateMeshStruct(MshMesh* mesh)
+{
+    const char* fields[] = {"NODES", "ELEMENTS"};
+    mxArray* S = mxCreateStructMatrix(1, 1, 2, fields);
+    mwSize i;
+
+    mxArray* NODES = mxCreateDoubleMatrix(3, mesh->numNodes, mxREAL);
+    memcpy(mxGetPr(NODES), mesh->coord, sizeof(double) * 3 * mesh->numNodes);
+    mxSetField(S, 0, "NODES", NODES);
+
+    /* node tag -> index, unless the tags are 1,...,numNodes */
+    long long maxTag = 0;
+    int contiguous = 1;
+    for (i = 0; i < mesh->numNodes; i++)
+    {
+        maxTag = (mesh->nodeTags[i] > maxTag) ? mesh->nodeTags[i] : maxTag;
+        contiguous = contiguous && (mesh->nodeTags[i] == (long long)(i+1));
+    }
+    double* index = NULL;
+    if (!contiguous)
+    {
+        index = mxCalloc(maxTag + 1, sizeof(double));
+        for (i = 0; i < mesh->numNodes; i++)
+        {
+            if (mesh->nodeTags[i] > 0)
+            {
+                index[mesh->nodeTags[i]] = i + 1;
+            }
+        }
+    }
+
+    mxArray* ELEMENTS = mxCreateCellMatrix(MSH_NUM_TYPES, 1);
+    int t;
+    int invalid = 0;
+    for (t = 1; t <= MSH_NUM_TYPES; t++)
+    {
+        int rows = NodesPerElement[t] + 1;
+        mwSize n = mesh->count[t];
+        mxArray* E = mxCreateDoubleMatrix(rows, n, mxREAL);
+        double* out = mxGetPr(E);
+        double* in  = mesh->elements[t];
+        mwSize e;
+
+        #pragma omp parallel for schedule(static) shared(out,in,index) private(e) firstprivate(n,rows,maxTag) reduction(||:invalid)
+        for (e = 0; e < n; e++)
+        {
+            int k;
+            for (k = 0; k < rows - 1; k++)
+            {
+                double tag = in[k+rows*e];
+                if (index)
+                {
+                    tag = (tag >= 1 && tag <= maxTag) ? index[(long long) tag] : 0;
+                }
+                invalid = invalid || (tag < 1 || tag > mesh->numNodes);
+                out[k+rows*e] = tag;
+            }
+            out[rows-1+rows*e] = in[rows-1+rows*e];
+        }
+
+        mxSetCell(ELEMENTS, t-1, E);
+    }
+    mxSetField(S, 0, "ELEMENTS", ELEMENTS);
+
+    if (index)
+    {
+        mxFree(index);
+    }
+    if (invalid)
+    {
+        mexErrMsgTxt("read_msh_C: elements refer to undefined nodes.");
+    }
+    return S;
+}
+/*************************************************************************/
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+    /* Check for proper number of arguments */
+    if(nrhs!=1) {
+        mexErrMsgTxt("1 input is required.");
+    } else if(nlhs>1) {
+        mexErrMsgTxt("Too many output arguments.");
+    }
+
+    char *filename = mxArrayToString(prhs[0]);
+    MshFile file;
+    OpenMshFile(filename, &file);
+    mxFree(filename);
+
+    MshCursor c;
+    c.begin    = file.data;
+    c.p        = file.data;
+    c.end      = file.data + file.size;
+    c.binary   = 0;
+    c.sizeSize = sizeof(long long);
+
+    MshMesh mesh;
+    memset(&mesh, 0, sizeof(MshMesh));
+    AllocateNodes(&mesh, 0);
+
+    /* $MeshFormat: version file-type data-size */
+    char name[64];
+    if (!NextSection(&c, name, 64) || strcmp(name, "$MeshFormat") != 0)
+    {
+        mexErrMsgTxt("read_msh_C: $MeshFormat not found.");
+    }
+    double version = ReadDouble(&c);
+    int binary     = ReadInt(&c);
+    c.sizeSize     = ReadInt(&c);
+    NextLine(&c);
+
+    int v4 = (version >= 4.1 && version < 5);
+    if (!v4 && !(version >= 2 && version < 3))
+    {
+        mexErrMsgTxt("read_msh_C: only MSH versions 2 and 4.1 are supported.");
+    }
+    if (binary)
+    {
+        int one;
+        CheckAvailable(&c, sizeof(int));
+        memcpy(&one, c.p, sizeof(int));
+        if (one != 1)
+        {
+            mexErrMsgTxt("read_msh_C: binary files with different endianness are not supported.");
+        }
+        if (c.sizeSize != 4 && c.sizeSize != 8)
+        {
+            mexErrMsgTxt("read_msh_C: unsupported data size.");
+        }
+    }
+
+    /* sections: after a section has been read, or to skip an unknown one,
+     * the cursor is moved after the next $End line */
+    while (NextSection(&c, name, 64))
+    {
+        if (strncmp(name, "$End", 4) == 0)
+        {
+            continue;
+        }
+
+        c.binary = binary;
+        if (strcmp(name, "$Entities") == 0 && v4)
+        {
+            ReadEntities4(&c, &mesh);
+        }
+        else if (strcmp(name, "$Nodes") == 0)
+        {
+            mxFree(mesh.coord);
+            mxFree(mesh.nodeTags);
+            if (v4)
+            {
+                ReadNodes4(&c, &mesh);
+            }
+            else if (binary)
+            {
+                ReadNodesBinary2(&c, &mesh);
+            }
+            else
+            {
+                ReadNodesASCII2(&c, &mesh);
+            }
+        }
+        else if (strcmp(name, "$Elements") == 0)
+        {
+            if (v4)
+            {
+                ReadElements4(&c, &mesh);
+            }
+            else if (binary)
+            {
+                ReadElementsBinary2(&c, &mesh);
+            }
+            else
+            {
+                ReadElementsASCII2(&c, &mesh);
+            }
+        }
+        c.binary = 0;
+
+        do
+        {
+            if (!NextSection(&c, name, 64))
+            {
+                mexErrMsgTxt("read_msh_C: unterminated section.");
+            }
+        } while (strncmp(name, "$End", 4) != 0);
+    }
+
+    plhs[0] = CreateMeshStruct(&mesh);
+
+    int t, dim;
+    for (t = 1; t <= MSH_NUM_TYPES; t++)
+    {
+        if (mesh.elements[t])
+        {
+            mxFree(mesh.elements[t]);
+        }
+    }
+    for (dim = 0; dim < 4; dim++)
+    {
+        if (mesh.entityPhysical[dim])
+        {
+            mxFree(mesh.entityPhysical[dim]);
+        }
+    }
+    mxFree(mesh.coord);
+    mxFree(mesh.nodeTags);
+    CloseMshFile(&file);
+}
+/*************************************************************************/
@@ -20,6 +20,24 @@ function [A, F, M] = ADR_Assembler(MESH, DATA, FE_SPACE, OPERATOR, TC_d, TC_t, s
 %   returns the matrix corresponding to the (i)-th first derivative 
 %   (advection operator) assembled over the subdomain \Omega_k
 %   A spatial dependent coefficient has to be defined in DATA.transport{i}
+%
+%   [Aq, Fq] = ADR_ASSEMBLER(MESH, DATA, FE_SPACE, TERMS) assembles all the
+%   terms of an affine decomposition in a single loop over the elements.
+%   TERMS is a cell array with one row {OPERATOR, TC_d, TC_t, subdomain}
+%   per term, OPERATOR being 'diffusion', 'transport', 'reaction' or
+%   'source'; Aq{q} (matrix terms) and Fq{q} (source terms) are the
+%   matrices and vectors that would be returned by the corresponding
+%   call ADR_ASSEMBLER(MESH, DATA, FE_SPACE, OPERATOR, TC_d, TC_t, subdomain).
+%
+%   If DATA.Assembly.symmetric is true and the operator is symmetric (no
+%   transport term, diagonal second derivatives), only the upper triangle
+%   of the local matrices is computed and A and M are built by
+%   GlobalAssembleSymmetric.
+%
+%   If DATA.Assembly.precision is 'single', the local matrices are computed
+%   in double precision and their coefficients are rounded to single
+%   precision before the global assembly; the rhs vectors are always
+%   assembled in double precision.
 
 %   This file is part of redbKIT.
 %   Copyright (c) 2015, Ecole Polytechnique Federale de Lausanne (EPFL)
@@ -66,13 +84,16 @@ end
 
 
 %% Computations of all quadrature nodes in the elements
+% (only needed if some coefficients are given as functions)
 coord_ref = MESH.chi;
+need_quad_nodes = any(cellfun(@(c) isa(c,'function_handle') || isa(c,'inline'), ...
+    [{DATA.diffusion, DATA.reaction, DATA.force}, DATA.transport(1:MESH.dim)]));
 
 switch MESH.dim
     case 2
-        x = zeros(MESH.numElem,FE_SPACE.numQuadNodes); y = x;
+        x = zeros(MESH.numElem,FE_SPACE.numQuadNodes*need_quad_nodes); y = x;
 
-        for j = 1 : 3
+        for j = 1 : 3*need_quad_nodes
             i = MESH.elements(j,:);
             vtemp = MESH.vertices(1,i);
             x = x + vtemp'*coord_ref(j,:);
@@ -88,12 +109,12 @@ switch MESH.dim
         bx  = EvalDataQuad(MESH, DATA.param, FE_SPACE, t, {x, y}, DATA.transport{1}, index_subd);
         by  = EvalDataQuad(MESH, DATA.param, FE_SPACE, t, {x, y}, DATA.transport{2}, index_subd);
         
-        b = [bx by];
+        b = ConvectiveField(bx, by);
         
     case 3
-        x = zeros(MESH.numElem,FE_SPACE.numQuadNodes); y = x; z = x;
+        x = zeros(MESH.numElem,FE_SPACE.numQuadNodes*need_quad_nodes); y = x; z = x;
 
-        for j = 1:4
+        for j = 1 : 4*need_quad_nodes
             i = MESH.elements(j,:);
             vtemp = MESH.vertices(1,i);
             x = x + vtemp'*coord_ref(j,:);
@@ -112,19 +133,56 @@ switch MESH.dim
         by  = EvalDataQuad(MESH, DATA.param, FE_SPACE, t, {x, y, z}, DATA.transport{2}, index_subd);
         bz  = EvalDataQuad(MESH, DATA.param, FE_SPACE, t, {x, y, z}, DATA.transport{3}, index_subd);
         
-        b = [bx by bz];
+        b = ConvectiveField(bx, by, bz);
+end
+
+% suffix of the C assembly names selecting single precision matrix
+% coefficients ('mixed' only applies to preconditioner matrices, which are
+% not assembled here)
+precision_suffix = '';
+if isfield(DATA, 'Assembly') && isfield(DATA.Assembly, 'precision') && strcmp(DATA.Assembly.precision, 'single')
+    precision_suffix = '_single';
+end
+
+% connectivity passed to the C assemblers
+elements = MESH.elements;
+if isfield(DATA, 'Assembly') && isfield(DATA.Assembly, 'index_type') && any(strcmp(DATA.Assembly.index_type, {'int32', 'int64'}))
+    elements = cast( MESH.elements, DATA.Assembly.index_type );
+end
+
+%% Affine decomposition: all the terms in a single loop over the elements
+if iscell( OPERATOR )
+    if ~isempty(subdomain)
+        error('ADR_Assembler: the subdomains of the affine terms are given in TERMS');
+    end
+    [A, F] = AffineTerms(MESH, elements, FE_SPACE, OPERATOR, mu, b, si, f, precision_suffix);
+    M      = [];
+    return;
 end
 
 %% Assembly
 if isempty( stabilization )
     
+    symmetric = isfield(DATA, 'Assembly') && isfield(DATA.Assembly, 'symmetric') && DATA.Assembly.symmetric ...
+        && ~strcmp(OPERATOR, 'transport') && TC_d(1) == TC_d(2) && ~any(b(:));
+    
     % C assembly, returns matrices in sparse vector format
-    [Arows, Acols, Acoef, Mcoef, Rrows, Rcoef] = ADR_assembler_C_omp(MESH.dim, OPERATOR, TC_d, TC_t, MESH.elements, FE_SPACE.numElemDof, mu, b, si, f,...
-        FE_SPACE.quad_weights, MESH.invjac(index_subd,:,:), MESH.jac(index_subd), FE_SPACE.phi, FE_SPACE.dphi_ref);
+    [Arows, Acols, Acoef, Mcoef, Rrows, Rcoef] = ADR_assembler_C_omp(MESH.dim, [OPERATOR, precision_suffix], TC_d, TC_t, elements, FE_SPACE.numElemDof, mu, b, si, f,...
+        FE_SPACE.quad_weights, MESH.invjac(index_subd,:,:), MESH.jac(index_subd), FE_SPACE.phi, FE_SPACE.dphi_ref, symmetric);
     
-    % Build sparse matrices and rhs
-    A    = GlobalAssemble(Arows,Acols,Acoef,MESH.numNodes,MESH.numNodes);
-    M    = GlobalAssemble(Arows,Acols,Mcoef,MESH.numNodes,MESH.numNodes);
+    % Build sparse matrices and rhs (the mass matrix only if requested)
+    M    = [];
+    if symmetric
+        A    = GlobalAssembleSymmetric(Arows,Acols,Acoef,MESH.numNodes);
+        if nargout > 2
+            M    = GlobalAssembleSymmetric(Arows,Acols,Mcoef,MESH.numNodes);
+        end
+    else
+        A    = GlobalAssemble(Arows,Acols,Acoef,MESH.numNodes,MESH.numNodes);
+        if nargout > 2
+            M    = GlobalAssemble(Arows,Acols,Mcoef,MESH.numNodes,MESH.numNodes);
+        end
+    end
     F    = GlobalAssemble(Rrows,1,Rcoef,MESH.numNodes,1);
     
 else
@@ -134,7 +192,7 @@ else
         case 'SUPG'
             
             % C assembly, returns matrices in sparse vector format
-            [Arows, Acols, Acoef, Mcoef, Rrows, Rcoef] = ADR_SUPGassembler_C_omp(MESH.dim, stabilization, dt, MESH.elements, FE_SPACE.numElemDof, mu, b, si, f,...
+            [Arows, Acols, Acoef, Mcoef, Rrows, Rcoef] = ADR_SUPGassembler_C_omp(MESH.dim, [stabilization, precision_suffix], dt, elements, FE_SPACE.numElemDof, mu, b, si, f,...
                 FE_SPACE.quad_weights, MESH.invjac(index_subd,:,:), MESH.jac(index_subd), FE_SPACE.phi, FE_SPACE.dphi_ref);
             
             M = [];
@@ -142,7 +200,7 @@ else
         case 'SUPGt'
             
             % C assembly, returns matrices in sparse vector format
-            [Arows, Acols, Acoef, Mcoef, Rrows, Rcoef] = ADR_SUPGassembler_C_omp(MESH.dim, stabilization, dt, MESH.elements, FE_SPACE.numElemDof, mu, b, si, f,...
+            [Arows, Acols, Acoef, Mcoef, Rrows, Rcoef] = ADR_SUPGassembler_C_omp(MESH.dim, [stabilization, precision_suffix], dt, elements, FE_SPACE.numElemDof, mu, b, si, f,...
                 FE_SPACE.quad_weights, MESH.invjac(index_subd,:,:), MESH.jac(index_subd), FE_SPACE.phi, FE_SPACE.dphi_ref);
         
             M    = GlobalAssemble(Arows,Acols,Mcoef,MESH.numNodes,MESH.numNodes);
@@ -154,4 +212,78 @@ else
     
 end
 
-return
\ No newline at end of file
+return
+
+end
+
+%% Assemble the affine terms listed in TERMS, see ADR_assembler_C_omp
+function [Aq, Fq] = AffineTerms(MESH, elements, FE_SPACE, TERMS, mu, b, si, f, precision_suffix)
+
+numTerms   = size(TERMS, 1);
+TermCodes  = zeros(numTerms, 3);
+numFlags   = max(MESH.elements(FE_SPACE.numElemDof+1,:));
+SUBDOMAINS = ones(numTerms, numFlags);
+
+for q = 1 : numTerms
+    
+    TERMS(q,end+1:4) = {[]};
+    [TC_d, TC_t, subdomain] = TERMS{q,2:4};
+    
+    switch TERMS{q,1}
+        case 'diffusion'
+            if isempty(TC_d)
+                TC_d = [10 10];
+            end
+            TermCodes(q,:) = [1 TC_d];
+        case 'transport'
+            if isempty(TC_t)
+                TC_t = 10;
+            end
+            TermCodes(q,:) = [2 TC_t 0];
+        case 'reaction'
+            TermCodes(q,:) = [3 0 0];
+        case 'source'
+            TermCodes(q,:) = [4 0 0];
+        otherwise
+            error('ADR_Assembler: unknown affine term %s', TERMS{q,1});
+    end
+    
+    if ~isempty(subdomain)
+        SUBDOMAINS(q,:)         = 0;
+        SUBDOMAINS(q,subdomain) = 1;
+    end
+end
+
+[Arows, Acols, Acoef, Rrows, Rcoef] = ADR_assembler_C_omp(MESH.dim, ['affine', precision_suffix], TermCodes, SUBDOMAINS, elements, FE_SPACE.numElemDof, mu, b, si, f,...
+    FE_SPACE.quad_weights, MESH.invjac, MESH.jac, FE_SPACE.phi, FE_SPACE.dphi_ref);
+
+Aq = cell(numTerms, 1);
+Fq = cell(numTerms, 1);
+
+isSource = TermCodes(:,1) == 4;
+matrix_terms = find(~isSource);
+source_terms = find(isSource);
+
+for q = 1 : length(matrix_terms)
+    Aq{matrix_terms(q)} = GlobalAssemble(Arows,Acols,Acoef(:,q),MESH.numNodes,MESH.numNodes);
+end
+
+for q = 1 : length(source_terms)
+    Fq{source_terms(q)} = GlobalAssemble(Rrows,1,Rcoef(:,q),MESH.numNodes,1);
+end
+
+end
+
+%% Components of the convective field, expanded to a common size
+% (constant, per element or at the quadrature nodes)
+function b = ConvectiveField(varargin)
+
+numRows = max(cellfun(@(c) size(c,1), varargin));
+numCols = max(cellfun(@(c) size(c,2), varargin));
+
+b = [];
+for k = 1 : length(varargin)
+    b = [b repmat(varargin{k}, numRows/size(varargin{k},1), numCols/size(varargin{k},2))];
+end
+
+end
@@ -10,8 +10,7 @@
 #include <string.h>
 #include "../../Core/Tools.h"
 
-#define INVJAC(i,j,k) invjac[i+(j+k*dim)*noe]
-#define GRADREFPHI(i,j,k) gradrefphi[i+(j+k*NumQuadPoints)*nln]
+#define INVJAC(i,j,k) invjac[i*invjacStrideE+(j+k*dim)*invjacStrideC]
 #ifdef _OPENMP
     #include <omp.h>
 #else
@@ -20,6 +19,7 @@
 
 void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
 {
+    SetOmpRuntime();
     
     /* Check for proper number of arguments. */
     if(nrhs!=14) {
@@ -33,30 +33,15 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
     int noe     = mxGetN(prhs[3]);
     double* nln_ptr = mxGetPr(prhs[4]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[3]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[3]);
+    mwSize nln2    = nln*nln;
     
     double* tmp_ptr1 = mxGetPr(prhs[2]);
     double dt = tmp_ptr1[0];
     
-    /**/
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL); 
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL); 
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL);
-    plhs[3] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL);
-    plhs[4] = mxCreateDoubleMatrix(nln*noe,1, mxREAL);
-    plhs[5] = mxCreateDoubleMatrix(nln*noe,1, mxREAL);
-       
-    
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
-    double* myMcoef    = mxGetPr(plhs[3]);
-    double* myRrows    = mxGetPr(plhs[4]);
-    double* myRcoef    = mxGetPr(plhs[5]);
-    
     /* copy the string data from prhs[0] into a C string input_ buf.    */
     char *StabType = mxArrayToString(prhs[1]);
+    int coefSingle = ParsePrecision(StabType);
     bool flag_t = false;
     if (strcmp(StabType, "SUPGt")==0)
     {
@@ -64,48 +49,63 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
     }
     mxFree(StabType);
     
+    /**/
+    double numNodes = GetNumNodes(prhs[3], nln);
+    plhs[0] = CreateIndexMatrix(nln2*noe, 1, prhs[3], numNodes);
+    plhs[1] = CreateIndexMatrix(nln2*noe, 1, prhs[3], numNodes);
+    plhs[2] = CreateCoefMatrix(nln2*noe,1, noe, coefSingle);
+    plhs[3] = CreateCoefMatrix(nln2*noe,1, noe, coefSingle);
+    plhs[4] = CreateIndexMatrix((mwSize) nln*noe, 1, prhs[3], numNodes);
+    plhs[5] = CreateElementMatrix((mwSize) nln*noe,1, noe);
+       
+    
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetCoefArray(plhs[2]);
+    CoefArray myMcoef  = GetCoefArray(plhs[3]);
+    IndexArray myRrows    = GetIndexArray(plhs[4]);
+    double* myRcoef    = mxGetPr(plhs[5]);
+    
     /* Local mass matrix (computed only once) with quadrature nodes */
-    double LocalMass[nln][nln];
     int q;
     int NumQuadPoints     = mxGetN(prhs[9]);
     
-    double* mu   = mxGetPr(prhs[5]);
-    double* conv_field   = mxGetPr(prhs[6]);
-    double* si   = mxGetPr(prhs[7]);
-    double* f    = mxGetPr(prhs[8]);
+    /* coefficients: at the quadrature nodes, per element or constant */
+    QuadData mu         = GetQuadData(prhs[5], noe, NumQuadPoints, 1);
+    QuadData conv_field = GetQuadData(prhs[6], noe, NumQuadPoints, dim);
+    QuadData si         = GetQuadData(prhs[7], noe, NumQuadPoints, 1);
+    QuadData f          = GetQuadData(prhs[8], noe, NumQuadPoints, 1);
     double* w   = mxGetPr(prhs[9]);
+    
+    /* the stabilization parameter is constant in the element if mu and
+     * the convective field are */
+    int elementwise_tau = QuadDataIsElementwise(&mu) && QuadDataIsElementwise(&conv_field);
     double* invjac = mxGetPr(prhs[10]);
+    int invjacStrideE, invjacStrideC;
+    GetInvJacStrides(prhs[10], dim, noe, &invjacStrideE, &invjacStrideC);
     double* detjac = mxGetPr(prhs[11]);
     double* phi = mxGetPr(prhs[12]);
-    double* gradrefphi = mxGetPr(prhs[13]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[13], prhs[10], dim, nln, NumQuadPoints, noe);
 
-    int l,k;
-    double* elements  = mxGetPr(prhs[3]);
+    int k;
+    long long* elements  = GetIndexData(prhs[3]);
 
     /* Assembly: loop over the elements */
     int ie;
             
-    #pragma omp parallel for shared(invjac,mu,conv_field,si,f,detjac,elements, myRrows, myRcoef,myAcols, myArows, myAcoef, myMcoef) private(ie,k,l,q) firstprivate(phi,gradrefphi, w, numRowsElements, nln2, nln)
+    #pragma omp parallel for schedule(runtime) shared(invjac,mu,conv_field,si,f,detjac,elements, myRrows, myRcoef,myAcols, myArows, myAcoef, myMcoef) private(ie,k,q) firstprivate(phi,w, numRowsElements, nln2, nln, elementwise_tau)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        
+        long long localArows[nln2], localAcols[nln2];
+        long long localRrows[nln];
+
         double gradphi[dim][nln][NumQuadPoints];
 
         int d1, d2;
-        for (k = 0; k < nln; k = k + 1 )
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
-            for (q = 0; q < NumQuadPoints; q = q + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
         }
         
          /*  compute metric tensors G and g */
@@ -131,16 +131,23 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
         
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
+            if (elementwise_tau && q > 0)
+            {
+                tauK[q] = tauK[0];
+                continue;
+            }
+            
             double b_hq[dim];
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
-                b_hq[d1] = conv_field[ie+(q+d1*NumQuadPoints)*noe];
+                b_hq[d1] = QuadDataValue(&conv_field, ie, q, d1);
             }
             
             double G_U_hq[dim];
             MatrixVector(dim, dim, G, b_hq, G_U_hq);
-             
-            tauK[q] = pow( flag_t * 4/(dt*dt) + ScalarProduct(dim, b_hq, G_U_hq) + 9*mu[ie+q*noe]*mu[ie+q*noe]*traceGtG, -0.5);
+            
+            double mu_hq = QuadDataValue(&mu, ie, q, 0);
+            tauK[q] = pow( flag_t * 4/(dt*dt) + ScalarProduct(dim, b_hq, G_U_hq) + 9*mu_hq*mu_hq*traceGtG, -0.5);
         }
         
         int iii = 0;
@@ -155,7 +162,7 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
                 bh_gradPHI[k][q] = 0;
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    bh_gradPHI[k][q] += conv_field[ie+(q+d1*NumQuadPoints)*noe] * gradphi[d1][k][q];
+                    bh_gradPHI[k][q] += QuadDataValue(&conv_field, ie, q, d1) * gradphi[d1][k][q];
                 }
             }
         }
@@ -169,15 +176,15 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
                 double mloc = 0;
                 for (q = 0; q < NumQuadPoints; q = q + 1 )
                 {
-                    aloc +=  (bh_gradPHI[b][q] + si[ie+q*noe] * phi[b+q*nln]) * bh_gradPHI[a][q] * tauK[q] * w[q];
+                    aloc +=  (bh_gradPHI[b][q] + QuadDataValue(&si, ie, q, 0) * phi[b+q*nln]) * bh_gradPHI[a][q] * tauK[q] * w[q];
                     
                     mloc +=  phi[b+q*nln] * bh_gradPHI[a][q] * tauK[q] * w[q];
                 }
  
-                myArows[ie*nln2+iii] = elements[a+ie*numRowsElements];
-                myAcols[ie*nln2+iii] = elements[b+ie*numRowsElements];
-                myAcoef[ie*nln2+iii] = aloc*detjac[ie];
-                myMcoef[ie*nln2+iii] = mloc*detjac[ie];
+                localArows[iii] = elements[a+ie*numRowsElements];
+                localAcols[iii] = elements[b+ie*numRowsElements];
+                SetCoef(myAcoef, ie*nln2+iii, aloc*detjac[ie]);
+                SetCoef(myMcoef, ie*nln2+iii, mloc*detjac[ie]);
                 
                 iii = iii + 1;
             }
@@ -185,15 +192,19 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
             double floc = 0;
             for (q = 0; q < NumQuadPoints; q = q + 1 )
             {
-                floc += ( bh_gradPHI[a][q] * f[ie+q*noe] * tauK[q] ) * w[q];
+                floc += ( bh_gradPHI[a][q] * QuadDataValue(&f, ie, q, 0) * tauK[q] ) * w[q];
             }
-            myRrows[ie*nln+ii] = elements[a+ie*numRowsElements];
-            myRcoef[ie*nln+ii] = floc*detjac[ie];
+            localRrows[ii] = elements[a+ie*numRowsElements];
+            myRcoef[(mwSize) ie*nln+ii] = floc*detjac[ie];
     
             ii = ii + 1;
         }
         
+        SetIndexBlock(myArows, ie*nln2, localArows, nln2);
+        SetIndexBlock(myAcols, ie*nln2, localAcols, nln2);
+        SetIndexBlock(myRrows, (mwSize) ie*nln, localRrows, nln);
     }
-            
+    
+    ReleaseIndexData(elements, prhs[3]);
 }
 
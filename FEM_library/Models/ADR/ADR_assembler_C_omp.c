@@ -8,7 +8,8 @@
 #include <math.h>
 #include "blas.h"
 #include <string.h>
-#define INVJAC(i,j,k) invjac[i+(j+k*dim)*noe]
+#include "../../Core/Tools.h"
+#define INVJAC(i,j,k) invjac[i*invjacStrideE+(j+k*dim)*invjacStrideC]
 #define GRADREFPHI(i,j,k) gradrefphi[i+(j+k*NumQuadPoints)*nln]
 #ifdef _OPENMP
     #include <omp.h>
@@ -16,42 +17,288 @@
     #warning "OpenMP not enabled. Compile with mex ADR_assembler_C_omp.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp""
 #endif
 
+/*************************************************************************/
+/* Affine decomposition: all the terms listed in TERMS = prhs[2] are
+ * assembled in a single loop over the elements. Each row of TERMS is
+ * [type c1 c2], type being 1 (diffusion, second derivative c1 c2, or
+ * c1 = c2 = 10 for the laplacian), 2 (transport, first derivative c1, or
+ * c1 = 10 for all components), 3 (reaction) or 4 (source). Row q of
+ * SUBDOMAINS = prhs[3] selects the element flags on which term q is
+ * assembled (an empty SUBDOMAINS means all elements).
+ *
+ * Returns the shared rows and cols of the matrices and the coefficients
+ * of the matrix terms as columns of plhs[2], and the rows and the
+ * coefficients (columns of plhs[4]) of the source terms. */
+void AssembleAffineTerms(mxArray* plhs[], const mxArray* prhs[], const int coefSingle)
+{
+    int dim     = (int)(mxGetScalar(prhs[0]));
+    int noe     = mxGetN(prhs[4]);
+    int nln     = (int)(mxGetScalar(prhs[5]));
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
+    
+    int numTerms    = mxGetM(prhs[2]);
+    double* TERMS   = mxGetPr(prhs[2]);
+    if (mxGetN(prhs[2]) != 3)
+    {
+        mexErrMsgTxt("TERMS must be a numTerms x 3 array.");
+    }
+    
+    int numFlags      = mxIsEmpty(prhs[3]) ? 0 : mxGetN(prhs[3]);
+    double* SUBDOMAINS = mxIsEmpty(prhs[3]) ? NULL : mxGetPr(prhs[3]);
+    if (SUBDOMAINS && mxGetM(prhs[3]) != numTerms)
+    {
+        mexErrMsgTxt("SUBDOMAINS must have one row per term.");
+    }
+    if (SUBDOMAINS && numRowsElements <= nln)
+    {
+        mexErrMsgTxt("The elements array does not contain the subdomain flags.");
+    }
+    
+    /* position of each term in the matrix or in the vector outputs */
+    int TermType[numTerms];
+    int TermPos[numTerms];
+    double C_d[numTerms][dim][dim];
+    double C_t[numTerms][dim];
+    int numMatrixTerms = 0, numSourceTerms = 0;
+    int t, d1, d2;
+    for (t = 0; t < numTerms; t = t + 1 )
+    {
+        TermType[t] = (int)(TERMS[t]);
+        int c1 = (int)(TERMS[t+numTerms]);
+        int c2 = (int)(TERMS[t+2*numTerms]);
+        
+        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+        {
+            for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+            {
+                C_d[t][d1][d2] = (TermType[t] == 1) && ((c1 == 10 && c2 == 10 && d1 == d2) || (c1 == d1+1 && c2 == d2+1));
+            }
+            C_t[t][d1] = (TermType[t] == 2) && (c1 == 10 || c1 == d1+1);
+        }
+        
+        if (TermType[t] < 1 || TermType[t] > 4)
+        {
+            mexErrMsgTxt("Unknown term type.");
+        }
+        
+        if (TermType[t] == 4)
+        {
+            TermPos[t] = numSourceTerms;
+            numSourceTerms = numSourceTerms + 1;
+        }
+        else
+        {
+            TermPos[t] = numMatrixTerms;
+            numMatrixTerms = numMatrixTerms + 1;
+        }
+    }
+    
+    double numNodes = GetNumNodes(prhs[4], nln);
+    plhs[0] = CreateIndexMatrix(nln2*noe, 1, prhs[4], numNodes);
+    plhs[1] = CreateIndexMatrix(nln2*noe, 1, prhs[4], numNodes);
+    plhs[2] = CreateCoefMatrix(nln2*noe, numMatrixTerms, noe, coefSingle);
+    plhs[3] = CreateIndexMatrix((mwSize) nln*noe, 1, prhs[4], numNodes);
+    plhs[4] = CreateElementMatrix((mwSize) nln*noe, numSourceTerms, noe);
+    
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef     = GetCoefArray(plhs[2]);
+    IndexArray myRrows    = GetIndexArray(plhs[3]);
+    double* myRcoef       = mxGetPr(plhs[4]);
+    
+    int NumQuadPoints     = mxGetN(prhs[10]);
+    
+    QuadData mu         = GetQuadData(prhs[6], noe, NumQuadPoints, 1);
+    QuadData conv_field = GetQuadData(prhs[7], noe, NumQuadPoints, dim);
+    QuadData si         = GetQuadData(prhs[8], noe, NumQuadPoints, 1);
+    QuadData f          = GetQuadData(prhs[9], noe, NumQuadPoints, 1);
+    double* w   = mxGetPr(prhs[10]);
+    double* detjac = mxGetPr(prhs[12]);
+    double* phi = mxGetPr(prhs[13]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[14], prhs[11], dim, nln, NumQuadPoints, noe);
+    
+    long long* elements  = GetIndexData(prhs[4]);
+    
+    /* Assembly: loop over the elements */
+    int ie;
+    
+#pragma omp parallel for schedule(runtime) shared(mu,conv_field,si,f,detjac,elements,myRrows,myRcoef,myAcols,myArows,myAcoef,TermType,TermPos,C_d,C_t,SUBDOMAINS) private(ie) firstprivate(phi,w,numRowsElements,nln2,nln,noe,numTerms,numFlags,NumQuadPoints)
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        long long localArows[nln2], localAcols[nln2];
+        long long localRrows[nln];
+
+        int q, d1, d2, t;
+        double gradphi[dim][nln][NumQuadPoints];
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
+        {
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
+        }
+        
+        /* terms active on this element */
+        double active[numTerms];
+        for (t = 0; t < numTerms; t = t + 1 )
+        {
+            active[t] = 1.0;
+            if (SUBDOMAINS)
+            {
+                int flag = elements[nln+ie*numRowsElements];
+                active[t] = (flag >= 1 && flag <= numFlags) ? SUBDOMAINS[t+(flag-1)*numTerms] : 0.0;
+            }
+        }
+        
+        int iii = 0;
+        int ii = 0;
+        int a, b;
+        
+        /* a test, b trial */
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            for (b = 0; b < nln; b = b + 1 )
+            {
+                /* all the derivatives of the diffusion and transport
+                 * operators are computed once and then combined */
+                double diffusion[dim][dim];
+                double transport[dim];
+                double reaction = 0;
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                    {
+                        diffusion[d1][d2] = 0;
+                    }
+                    transport[d1] = 0;
+                }
+                
+                for (q = 0; q < NumQuadPoints; q = q + 1 )
+                {
+                    double mu_q = QuadDataValue(&mu, ie, q, 0) * w[q];
+                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    {
+                        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                        {
+                            diffusion[d1][d2] = diffusion[d1][d2] + mu_q * gradphi[d1][b][q] * gradphi[d2][a][q];
+                        }
+                        transport[d1] = transport[d1] + QuadDataValue(&conv_field, ie, q, d1) * gradphi[d1][b][q] * phi[a+q*nln] * w[q];
+                    }
+                    reaction = reaction + QuadDataValue(&si, ie, q, 0) * phi[b+q*nln] * phi[a+q*nln] * w[q];
+                }
+                
+                localArows[iii] = elements[a+ie*numRowsElements];
+                localAcols[iii] = elements[b+ie*numRowsElements];
+                
+                for (t = 0; t < numTerms; t = t + 1 )
+                {
+                    double aloc = 0;
+                    switch (TermType[t])
+                    {
+                        case 1:
+                            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                            {
+                                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                                {
+                                    aloc = aloc + C_d[t][d1][d2] * diffusion[d1][d2];
+                                }
+                            }
+                            break;
+                        case 2:
+                            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                            {
+                                aloc = aloc + C_t[t][d1] * transport[d1];
+                            }
+                            break;
+                        case 3:
+                            aloc = reaction;
+                            break;
+                        default:
+                            continue;
+                    }
+                    SetCoef(myAcoef, ie*nln2+iii + (mwSize)TermPos[t]*nln2*noe, active[t] * aloc * detjac[ie]);
+                }
+                
+                iii = iii + 1;
+            }
+            
+            double floc = 0;
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                floc = floc + phi[a+q*nln] * QuadDataValue(&f, ie, q, 0) * w[q];
+            }
+            
+            localRrows[ii] = elements[a+ie*numRowsElements];
+            for (t = 0; t < numTerms; t = t + 1 )
+            {
+                if (TermType[t] == 4)
+                {
+                    myRcoef[(mwSize) ie*nln+ii + (mwSize)TermPos[t]*nln*noe] = active[t] * floc * detjac[ie];
+                }
+            }
+            
+            ii = ii + 1;
+        }
+        SetIndexBlock(myArows, ie*nln2, localArows, nln2);
+        SetIndexBlock(myAcols, ie*nln2, localAcols, nln2);
+        SetIndexBlock(myRrows, (mwSize) ie*nln, localRrows, nln);
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
 void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
 {
+    SetOmpRuntime();
     
     /* Check for proper number of arguments. */
-    if(nrhs!=15) {
-        mexErrMsgTxt("15 inputs are required.");
+    if(nrhs!=15 && nrhs!=16) {
+        mexErrMsgTxt("15 or 16 inputs are required.");
     } else if(nlhs>6) {
         mexErrMsgTxt("Too many output arguments.");
     }
+    
+    char *OP_string = mxArrayToString(prhs[1]);
+    int coefSingle = ParsePrecision(OP_string);
+    if (strcmp(OP_string, "affine")==0)
+    {
+        mxFree(OP_string);
+        AssembleAffineTerms(plhs, prhs, coefSingle);
+        return;
+    }
 
     double* dim_ptr = mxGetPr(prhs[0]);
     int dim     = (int)(dim_ptr[0]);
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
+    
+    /* optional 16th input: if true, only the upper triangle of the local
+     * matrices is returned (see SetSymmetricIndex); the caller has to
+     * ensure that the transport term vanishes */
+    int symmetric = (nrhs > 15) && mxGetScalar(prhs[15]) != 0;
+    if (symmetric)
+    {
+        nln2 = nln*(nln+1)/2;
+    }
     
     /**/
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL); 
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL); 
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL);
-    plhs[3] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL);
-    plhs[4] = mxCreateDoubleMatrix(nln*noe,1, mxREAL);
-    plhs[5] = mxCreateDoubleMatrix(nln*noe,1, mxREAL);
+    double numNodes = GetNumNodes(prhs[4], nln);
+    plhs[0] = CreateIndexMatrix(nln2*noe, 1, prhs[4], numNodes);
+    plhs[1] = CreateIndexMatrix(nln2*noe, 1, prhs[4], numNodes);
+    plhs[2] = CreateCoefMatrix(nln2*noe,1, noe, coefSingle);
+    plhs[3] = CreateCoefMatrix(nln2*noe,1, noe, coefSingle);
+    plhs[4] = CreateIndexMatrix((mwSize) nln*noe, 1, prhs[4], numNodes);
+    plhs[5] = CreateElementMatrix((mwSize) nln*noe,1, noe);
        
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
-    double* myMcoef    = mxGetPr(plhs[3]);
-    double* myRrows    = mxGetPr(plhs[4]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetCoefArray(plhs[2]);
+    CoefArray myMcoef  = GetCoefArray(plhs[3]);
+    IndexArray myRrows    = GetIndexArray(plhs[4]);
     double* myRcoef    = mxGetPr(plhs[5]);
     
-    /* copy the string data from prhs[0] into a C string input_ buf.    */
-    char *OP_string = mxArrayToString(prhs[1]);
     int OP[4] = {0, 0, 0, 0};
     if (strcmp(OP_string, "diffusion")==0)
     {
@@ -60,6 +307,10 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
     
     if (strcmp(OP_string, "transport")==0)
     {
+        if (symmetric)
+        {
+            mexErrMsgTxt("The transport operator is not symmetric.");
+        }
         OP[1] = 1;
     }
     
@@ -108,6 +359,10 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
     }
     else
     {
+        if (symmetric && TC_d[0] != TC_d[1])
+        {
+            mexErrMsgTxt("Mixed second derivatives are not symmetric.");
+        }
         C_d[(int)(TC_d[0]-1)][(int)(TC_d[1]-1)] = 1;
     }
     
@@ -128,15 +383,19 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
     int q;
     int NumQuadPoints     = mxGetN(prhs[10]);
     
-    double* mu   = mxGetPr(prhs[6]);
-    double* conv_field   = mxGetPr(prhs[7]);
-    double* si   = mxGetPr(prhs[8]);
-    double* f    = mxGetPr(prhs[9]);
+    /* coefficients: at the quadrature nodes, per element or constant */
+    QuadData mu         = GetQuadData(prhs[6], noe, NumQuadPoints, 1);
+    QuadData conv_field = GetQuadData(prhs[7], noe, NumQuadPoints, dim);
+    QuadData si         = GetQuadData(prhs[8], noe, NumQuadPoints, 1);
+    QuadData f          = GetQuadData(prhs[9], noe, NumQuadPoints, 1);
     double* w   = mxGetPr(prhs[10]);
     double* invjac = mxGetPr(prhs[11]);
+    int invjacStrideE, invjacStrideC;
+    GetInvJacStrides(prhs[11], dim, noe, &invjacStrideE, &invjacStrideC);
     double* detjac = mxGetPr(prhs[12]);
     double* phi = mxGetPr(prhs[13]);
-    double* gradrefphi = mxGetPr(prhs[14]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[14], prhs[11], dim, nln, NumQuadPoints, noe);
+    const double* gradrefphi = GeoCache.gradrefphi;
 
     for (k = 0; k < nln; k = k + 1 )
     {
@@ -151,84 +410,194 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
         }
     }
 
+    /* If all the coefficients are constant in each element, they are
+     * factored out of the quadrature sums: on affine elements the local
+     * matrices are then combinations of the reference integrals below,
+     * which are computed only once */
+    int elementwise = QuadDataIsElementwise(&mu) && QuadDataIsElementwise(&conv_field)
+                   && QuadDataIsElementwise(&si) && QuadDataIsElementwise(&f);
+    
+    double RefStiffness[nln][nln][dim][dim];
+    double RefTransport[nln][nln][dim];
+    double RefLoad[nln];
+    if (elementwise)
+    {
+        int d1, d2;
+        for (k = 0; k < nln; k = k + 1 )
+        {
+            for (l = 0; l < nln; l = l + 1 )
+            {
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                    {
+                        double tmp = 0;
+                        for (q = 0; q < NumQuadPoints; q = q + 1 )
+                        {
+                            tmp = tmp + GRADREFPHI(k,q,d1) * GRADREFPHI(l,q,d2) * w[q];
+                        }
+                        RefStiffness[k][l][d1][d2] = tmp;
+                    }
+                    
+                    double tmp = 0;
+                    for (q = 0; q < NumQuadPoints; q = q + 1 )
+                    {
+                        tmp = tmp + phi[k+q*nln] * GRADREFPHI(l,q,d1) * w[q];
+                    }
+                    RefTransport[k][l][d1] = tmp;
+                }
+            }
+            
+            RefLoad[k] = 0;
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                RefLoad[k] = RefLoad[k] + phi[k+q*nln] * w[q];
+            }
+        }
+    }
     
     double gradphi[dim][nln][NumQuadPoints];
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
 
     /* Assembly: loop over the elements */
     int ie;
             
-    #pragma omp parallel for shared(invjac,mu,conv_field,si,f,detjac,elements, myRrows, myRcoef,myAcols, myArows, myAcoef, myMcoef) private(gradphi,ie,k,l,q) firstprivate(phi,gradrefphi, w, numRowsElements, nln2, nln, OP, C_t, C_d, LocalMass)
+    #pragma omp parallel for schedule(runtime) shared(invjac,mu,conv_field,si,f,detjac,elements, myRrows, myRcoef,myAcols, myArows, myAcoef, myMcoef, RefStiffness, RefTransport, RefLoad) private(gradphi,ie,k,l,q) firstprivate(phi,w, numRowsElements, nln2, nln, OP, C_t, C_d, LocalMass, symmetric, elementwise)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        int d1, d2;
-        for (k = 0; k < nln; k = k + 1 )
+        long long localArows[nln2], localAcols[nln2];
+        long long localRrows[nln];
+
+        int d1, d2, i, j;
+        
+        /* elementwise coefficients: diffusion and transport tensors mapped
+         * to the reference element */
+        double mu_e = 0, si_e = 0, f_e = 0;
+        double Kd[dim][dim];
+        double Kt[dim];
+        
+        if (elementwise)
         {
-            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            mu_e = QuadDataValue(&mu, ie, 0, 0);
+            si_e = QuadDataValue(&si, ie, 0, 0);
+            f_e  = QuadDataValue(&f, ie, 0, 0);
+            for (i = 0; i < dim; i = i + 1 )
             {
+                Kt[i] = 0;
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    gradphi[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                    Kt[i] = Kt[i] + C_t[d1] * QuadDataValue(&conv_field, ie, 0, d1) * INVJAC(ie,d1,i);
+                }
+                
+                for (j = 0; j < dim; j = j + 1 )
+                {
+                    Kd[i][j] = 0;
+                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                     {
-                        gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
+                        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                        {
+                            Kd[i][j] = Kd[i][j] + C_d[d1][d2] * INVJAC(ie,d1,i) * INVJAC(ie,d2,j);
+                        }
                     }
                 }
             }
         }
+        else
+        {
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
+            }
+        }
         
         int iii = 0;
         int ii = 0;
         int a, b;
     
-        /* a tes, b trial */
+        /* a tes, b trial (b >= a only in symmetric mode) */
         for (a = 0; a < nln; a = a + 1 )
         {
-            for (b = 0; b < nln; b = b + 1 )
+            for (b = (symmetric ? a : 0); b < nln; b = b + 1 )
             {
                 double aloc = 0;                
-                for (q = 0; q < NumQuadPoints; q = q + 1 )
+                if (elementwise)
                 {
                     double diffusion = 0;
-                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    double transport = 0;
+                    for (i = 0; i < dim; i = i + 1 )
                     {
-                        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                        for (j = 0; j < dim; j = j + 1 )
                         {
-                            diffusion = diffusion + C_d[d1][d2] * mu[ie+q*noe] * gradphi[d1][b][q] * gradphi[d2][a][q];
+                            diffusion = diffusion + Kd[i][j] * RefStiffness[b][a][i][j];
                         }
+                        transport = transport + Kt[i] * RefTransport[a][b][i];
                     }
-                    double transport = 0;
-                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    
+                    aloc = OP[0] * mu_e * diffusion + OP[1] * transport + OP[2] * si_e * LocalMass[a][b];
+                }
+                else
+                {
+                    for (q = 0; q < NumQuadPoints; q = q + 1 )
                     {
-                        transport = transport + C_t[d1] * conv_field[ie+(q+d1*NumQuadPoints)*noe] * gradphi[d1][b][q] * phi[a+q*nln];
+                        double diffusion = 0;
+                        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                        {
+                            for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                            {
+                                diffusion = diffusion + C_d[d1][d2] * QuadDataValue(&mu, ie, q, 0) * gradphi[d1][b][q] * gradphi[d2][a][q];
+                            }
+                        }
+                        double transport = 0;
+                        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                        {
+                            transport = transport + C_t[d1] * QuadDataValue(&conv_field, ie, q, d1) * gradphi[d1][b][q] * phi[a+q*nln];
+                        }
+                        
+                        double reaction  = QuadDataValue(&si, ie, q, 0) * phi[b+q*nln] * phi[a+q*nln];
+                        
+                        aloc = aloc + (OP[0] * diffusion + OP[1] * transport + OP[2] * reaction) * w[q];
                     }
-                    
-                    double reaction  = si[ie+q*noe] * phi[b+q*nln] * phi[a+q*nln];
-                    
-                    aloc = aloc + (OP[0] * diffusion + OP[1] * transport + OP[2] * reaction) * w[q];
                 }
  
-                myArows[ie*nln2+iii] = elements[a+ie*numRowsElements];
-                myAcols[ie*nln2+iii] = elements[b+ie*numRowsElements];
-                myAcoef[ie*nln2+iii] = aloc*detjac[ie];
-                myMcoef[ie*nln2+iii] = LocalMass[a][b]*detjac[ie];
+                if (symmetric)
+                {
+                    SetSymmetricIndex(localArows, localAcols, iii, elements[a+ie*numRowsElements], elements[b+ie*numRowsElements]);
+                }
+                else
+                {
+                    localArows[iii] = elements[a+ie*numRowsElements];
+                    localAcols[iii] = elements[b+ie*numRowsElements];
+                }
+                SetCoef(myAcoef, ie*nln2+iii, aloc*detjac[ie]);
+                SetCoef(myMcoef, ie*nln2+iii, LocalMass[a][b]*detjac[ie]);
                 
                 iii = iii + 1;
             }
             
             double floc = 0;
-            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            if (elementwise)
             {
-                floc = floc + ( OP[3] * phi[a+q*nln] * f[ie+q*noe] ) * w[q];
+                floc = OP[3] * f_e * RefLoad[a];
             }
-            myRrows[ie*nln+ii] = elements[a+ie*numRowsElements];
-            myRcoef[ie*nln+ii] = floc*detjac[ie];
+            else
+            {
+                for (q = 0; q < NumQuadPoints; q = q + 1 )
+                {
+                    floc = floc + ( OP[3] * phi[a+q*nln] * QuadDataValue(&f, ie, q, 0) ) * w[q];
+                }
+            }
+            localRrows[ii] = elements[a+ie*numRowsElements];
+            myRcoef[(mwSize) ie*nln+ii] = floc*detjac[ie];
     
             ii = ii + 1;
         }
         
+        SetIndexBlock(myArows, ie*nln2, localArows, nln2);
+        SetIndexBlock(myAcols, ie*nln2, localAcols, nln2);
+        SetIndexBlock(myRrows, (mwSize) ie*nln, localRrows, nln);
     }
-            
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 
@@ -84,10 +84,18 @@ if isfield(DATA.Preconditioner, 'type') && strcmp( DATA.Preconditioner.type, 'Ad
     Precon.SetRestrictions( R );
 end
 
-%% Assemble mass matrix
-fprintf('\n Assembling mass matrix... ');
+%% Mass operator
+% the BDF rhs is computed by the mass operator, element by element; the
+% consistent mass matrix is returned at each time step by the same ADR
+% assembly as A, while a lumped mass (DATA.Assembly.mass_type = 'rowsum' or
+% 'HRZ') is diagonal and built once
+fprintf('\n Assembling mass operator... ');
 t_assembly = tic;
-[~, ~, M]  =  ADR_Assembler(MESH, DATA, FE_SPACE, [], [], [], [], t);
+MassOp     =  MassOperator(MESH, FE_SPACE, DATA.Assembly.mass_type, [], DATA.Assembly.coloring);
+M          =  [];
+if MassOp.IsLumped()
+    M      =  MassOp.GetMatrix();
+end
 t_assembly = toc(t_assembly);
 fprintf('done in %3.3f s', t_assembly);
 
@@ -108,7 +116,11 @@ while (t < tf)
     %% Assemble matrix and right-hand side
     fprintf('\n Assembling ... ');
     t_assembly = tic;
-    [A, F]     =  ADR_Assembler(MESH, DATA, FE_SPACE, [], [], [], [], t);
+    if MassOp.IsLumped()
+        [A, F]     =  ADR_Assembler(MESH, DATA, FE_SPACE, [], [], [], [], t);
+    else
+        [A, F, M]  =  ADR_Assembler(MESH, DATA, FE_SPACE, [], [], [], [], t);
+    end
     t_assembly = toc(t_assembly);
     fprintf('done in %3.3f s', t_assembly);
        
@@ -126,7 +138,7 @@ while (t < tf)
     else
         
         C = alpha/dt * M + A;
-        b = 1/dt * M * u_BDF + F;
+        b = 1/dt * MassOp.Apply( u_BDF ) + F;
         
     end
     
@@ -1,5 +1,11 @@
 function [f_quad] = EvalDataQuad(MESH, param, FE_SPACE, t, X_quad, f, index_subd)
 %EVALDATAQUAD Evaluation of coefficients in the quadrature nodes
+%
+%   Constant coefficients (scalars, or function handles returning a
+%   scalar) are returned as scalars and coefficients given per element
+%   (vectors with one entry per element, different from MESH.numNodes) as a
+%   column vector: the ADR assemblers then factor them out of the
+%   quadrature sums.
 
 %   This file is part of redbKIT.
 %   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
@@ -19,7 +25,10 @@ switch class(f)
         
     case 'double'
         
-        if size(f,1)>1 && size(f,2)>1
+        if isscalar(f)
+            f_quad = f;
+            
+        elseif size(f,1)>1 && size(f,2)>1
             f_quad = f(index_subd,:);
             
         elseif length(f)==MESH.numNodes
@@ -29,6 +38,13 @@ switch class(f)
                 i = MESH.elements(j,:);
                 f_quad = f_quad + f(i)*FE_SPACE.phi(j,:);
             end
+            
+        elseif length(f)==length(MESH.jac)
+            
+            % one value per element of the whole mesh (MESH.jac is not
+            % restricted to the subdomain)
+            f_quad = f(index_subd);
+            f_quad = f_quad(:);
         end
 end
 
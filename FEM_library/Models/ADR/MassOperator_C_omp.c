@@ -0,0 +1,235 @@
+/*   This file is part of redbKIT.
+ *   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+ *   Author: Federico Negri <federico.negri@epfl.ch>
+ */
+
+/* Compact mass operator on affine elements: the element mass matrices are
+ * detjac[ie] * LocalMass, so only the reference mass is computed and the
+ * global matrix is never stored.
+ *
+ *  Y = MassOperator_C_omp('apply', dim, elements, nln, numDofScalar, w, detjac, phi, V)
+ *      returns Y = M * V, V being numDofScalar x numComponents
+ *
+ *  Y = MassOperator_C_omp('apply', ..., V, colorPtr, colorElements)
+ *      as before, scattering the element products color by color (see
+ *      ElementColoring) instead of using atomic updates
+ *
+ *  d = MassOperator_C_omp('lumped_rowsum', dim, elements, nln, numDofScalar, w, detjac, phi)
+ *  d = MassOperator_C_omp('lumped_HRZ', dim, elements, nln, numDofScalar, w, detjac, phi)
+ *      return the diagonal of the row-sum and HRZ (diagonal scaling)
+ *      lumped mass matrices
+ */
+
+#include "mex.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include "../../Core/Tools.h"
+#ifdef _OPENMP
+    #include <omp.h>
+#else
+    #warning "OpenMP not enabled. Compile with mex MassOperator_C_omp.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp""
+#endif
+
+/*************************************************************************/
+void ComputeLocalMass(int nln, int NumQuadPoints, double* w, double* phi, double* LocalMass)
+{
+    int k, l, q;
+    for (k = 0; k < nln; k = k + 1 )
+    {
+        for (l = 0; l < nln; l = l + 1 )
+        {
+            double tmp = 0;
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                tmp = tmp + phi[k+q*nln] * phi[l+q*nln] * w[q];
+            }
+            LocalMass[k+l*nln] = tmp;
+        }
+    }
+}
+/*************************************************************************/
+/* Y(elements(:,ie),:) += detjac[ie] * LocalMass * V(elements(:,ie),:) */
+void ApplyElementMass(int ie, int nln, mwSize numRowsElements, int numComponents, long long numDofScalar,
+        const long long* elements, const double* LocalMass, const double* detjac, const double* V, double* Y, const int atomic)
+{
+    int a, b, c;
+    for (c = 0; c < numComponents; c = c + 1 )
+    {
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            double tmp = 0;
+            for (b = 0; b < nln; b = b + 1 )
+            {
+                tmp = tmp + LocalMass[a+b*nln] * V[elements[b+ie*numRowsElements] - 1 + c*numDofScalar];
+            }
+            tmp = tmp * detjac[ie];
+
+            long long row = elements[a+ie*numRowsElements] - 1 + c*numDofScalar;
+            if (atomic)
+            {
+                #pragma omp atomic
+                Y[row] += tmp;
+            }
+            else
+            {
+                Y[row] += tmp;
+            }
+        }
+    }
+}
+/*************************************************************************/
+void ApplyMass(mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+    int noe     = mxGetN(prhs[2]);
+    int nln     = (int)(mxGetScalar(prhs[3]));
+    mwSize numRowsElements  = mxGetM(prhs[2]);
+    long long numDofScalar = (long long)(mxGetScalar(prhs[4]));
+    int NumQuadPoints    = mxGetN(prhs[5]);
+
+    if (mxGetM(prhs[8]) != numDofScalar)
+    {
+        mexErrMsgTxt("V must have numDofScalar rows.");
+    }
+    int numComponents = mxGetN(prhs[8]);
+
+    double* w      = mxGetPr(prhs[5]);
+    double* detjac = mxGetPr(prhs[6]);
+    double* phi    = mxGetPr(prhs[7]);
+    double* V      = mxGetPr(prhs[8]);
+
+    plhs[0] = mxCreateDoubleMatrix(numDofScalar, numComponents, mxREAL);
+    double* Y = mxGetPr(plhs[0]);
+
+    double LocalMass[nln*nln];
+    ComputeLocalMass(nln, NumQuadPoints, w, phi, LocalMass);
+
+    long long* elements  = GetIndexData(prhs[2]);
+
+    int ie, e;
+
+    /* with a coloring, the elements of a color do not share any node and
+     * are scattered in parallel without atomics */
+    if (nrhs == 11)
+    {
+        if (!mxIsInt32(prhs[9]) || !mxIsInt32(prhs[10]) || mxGetM(prhs[10]) * mxGetN(prhs[10]) != noe) {
+            mexErrMsgTxt("colorPtr and colorElements must be int32, with one entry per element in colorElements.");
+        }
+        int* colorPtr      = (int*) mxGetData(prhs[9]);
+        int* colorElements = (int*) mxGetData(prhs[10]);
+        int numColors      = mxGetM(prhs[9]) * mxGetN(prhs[9]) - 1;
+        int c;
+
+        for (c = 0; c < numColors; c = c + 1 )
+        {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,V,Y,colorElements) private(e) firstprivate(LocalMass,numRowsElements,nln,numComponents,numDofScalar)
+            for (e = colorPtr[c]; e < colorPtr[c+1]; e = e + 1 )
+            {
+                ApplyElementMass(colorElements[e], nln, numRowsElements, numComponents, numDofScalar,
+                        elements, LocalMass, detjac, V, Y, 0);
+            }
+        }
+    }
+    else
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,V,Y) private(ie) firstprivate(LocalMass,numRowsElements,nln,noe,numComponents,numDofScalar)
+        for (ie = 0; ie < noe; ie = ie + 1 )
+        {
+            ApplyElementMass(ie, nln, numRowsElements, numComponents, numDofScalar,
+                    elements, LocalMass, detjac, V, Y, 1);
+        }
+    }
+
+    ReleaseIndexData(elements, prhs[2]);
+}
+/*************************************************************************/
+void LumpedMass(mxArray* plhs[], const mxArray* prhs[], const int HRZ)
+{
+    int noe     = mxGetN(prhs[2]);
+    int nln     = (int)(mxGetScalar(prhs[3]));
+    mwSize numRowsElements  = mxGetM(prhs[2]);
+    long long numDofScalar = (long long)(mxGetScalar(prhs[4]));
+    int NumQuadPoints    = mxGetN(prhs[5]);
+
+    double* w      = mxGetPr(prhs[5]);
+    double* detjac = mxGetPr(prhs[6]);
+    double* phi    = mxGetPr(prhs[7]);
+
+    plhs[0] = mxCreateDoubleMatrix(numDofScalar, 1, mxREAL);
+    double* d = mxGetPr(plhs[0]);
+
+    double LocalMass[nln*nln];
+    ComputeLocalMass(nln, NumQuadPoints, w, phi, LocalMass);
+
+    /* reference lumped mass: row sums, or diagonal scaled so that the
+     * total mass of the element is preserved (HRZ) */
+    double LocalLumped[nln];
+    double total = 0, trace = 0;
+    int a, b;
+    for (a = 0; a < nln; a = a + 1 )
+    {
+        LocalLumped[a] = 0;
+        for (b = 0; b < nln; b = b + 1 )
+        {
+            LocalLumped[a] = LocalLumped[a] + LocalMass[a+b*nln];
+        }
+        total = total + LocalLumped[a];
+        trace = trace + LocalMass[a+a*nln];
+    }
+
+    if (HRZ)
+    {
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            LocalLumped[a] = LocalMass[a+a*nln] * total / trace;
+        }
+    }
+
+    long long* elements  = GetIndexData(prhs[2]);
+
+    int ie;
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            d[elements[a+ie*numRowsElements] - 1] += LocalLumped[a] * detjac[ie];
+        }
+    }
+
+    ReleaseIndexData(elements, prhs[2]);
+}
+/*************************************************************************/
+void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+    SetOmpRuntime();
+    if (nrhs < 8) {
+        mexErrMsgTxt("At least 8 inputs are required.");
+    } else if(nlhs>1) {
+        mexErrMsgTxt("Too many output arguments.");
+    }
+
+    char *Operation = mxArrayToString(prhs[0]);
+
+    if (strcmp(Operation, "apply")==0)
+    {
+        if(nrhs!=9 && nrhs!=11) {
+            mexErrMsgTxt("9 or 11 inputs are required.");
+        }
+        ApplyMass(plhs, nrhs, prhs);
+    }
+    else if (strcmp(Operation, "lumped_rowsum")==0)
+    {
+        LumpedMass(plhs, prhs, 0);
+    }
+    else if (strcmp(Operation, "lumped_HRZ")==0)
+    {
+        LumpedMass(plhs, prhs, 1);
+    }
+    else
+    {
+        mexErrMsgTxt("Unknown operation.");
+    }
+
+    mxFree(Operation);
+}
+/*************************************************************************/
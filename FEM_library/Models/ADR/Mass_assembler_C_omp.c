@@ -8,6 +8,7 @@
 #include <math.h>
 #include "blas.h"
 #include <string.h>
+#include "../../Core/Tools.h"
 #ifdef _OPENMP
     #include <omp.h>
 #else
@@ -16,10 +17,11 @@
 
 void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
 {
+    SetOmpRuntime();
     
     /* Check for proper number of arguments. */
-    if(nrhs!=6) {
-        mexErrMsgTxt("6 inputs are required.");
+    if(nrhs<6 || nrhs>8) {
+        mexErrMsgTxt("6, 7 or 8 inputs are required.");
     } else if(nlhs>3) {
         mexErrMsgTxt("Too many output arguments.");
     }
@@ -29,17 +31,30 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
     int noe     = mxGetN(prhs[1]);
     double* nln_ptr = mxGetPr(prhs[2]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[1]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[1]);
+    mwSize nln2    = nln*nln;
+    
+    /* optional 7th input: if true, only the upper triangle of the local
+     * matrices is returned (see SetSymmetricIndex) */
+    int symmetric = (nrhs > 6) && mxGetScalar(prhs[6]) != 0;
+    if (symmetric)
+    {
+        nln2 = nln*(nln+1)/2;
+    }
+    
+    /* optional 8th input: if true, the coefficients are returned in
+     * single precision (see CreateCoefMatrix) */
+    int coefSingle = (nrhs > 7) && mxGetScalar(prhs[7]) != 0;
     
     /**/
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL); 
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL); 
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe,1, mxREAL);
+    double numNodes = GetNumNodes(prhs[1], nln);
+    plhs[0] = CreateIndexMatrix(nln2*noe, 1, prhs[1], numNodes);
+    plhs[1] = CreateIndexMatrix(nln2*noe, 1, prhs[1], numNodes);
+    plhs[2] = CreateCoefMatrix(nln2*noe,1, noe, coefSingle);
     
-    double* myMrows    = mxGetPr(plhs[0]);
-    double* myMcols    = mxGetPr(plhs[1]);
-    double* myMcoef    = mxGetPr(plhs[2]);
+    IndexArray myMrows    = GetIndexArray(plhs[0]);
+    IndexArray myMcols    = GetIndexArray(plhs[1]);
+    CoefArray myMcoef  = GetCoefArray(plhs[2]);
         
     /* Local mass matrix (computed only once) with quadrature nodes */
     double LocalMass[nln][nln];
@@ -64,32 +79,43 @@ void mexFunction(int nlhs,mxArray* plhs[], int nrhs, const mxArray* prhs[])
         }
     }
 
-    double* elements  = mxGetPr(prhs[1]);
+    long long* elements  = GetIndexData(prhs[1]);
 
     /* Assembly: loop over the elements */
     int ie;
             
-    #pragma omp parallel for shared(detjac,elements,myMcols, myMrows, myMcoef) private(ie) firstprivate(phi, numRowsElements, nln2, LocalMass)
+    #pragma omp parallel for schedule(runtime) shared(detjac,elements,myMcols, myMrows, myMcoef) private(ie) firstprivate(phi, numRowsElements, nln2, LocalMass, symmetric)
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-       
+        long long localMrows[nln2], localMcols[nln2];
+
         int iii = 0;
         int a, b;
     
-        /* a tes, b trial */
+        /* a tes, b trial (b >= a only in symmetric mode) */
         for (a = 0; a < nln; a = a + 1 )
         {
-            for (b = 0; b < nln; b = b + 1 )
+            for (b = (symmetric ? a : 0); b < nln; b = b + 1 )
             {
-                myMrows[ie*nln2+iii] = elements[a+ie*numRowsElements];
-                myMcols[ie*nln2+iii] = elements[b+ie*numRowsElements];
-                myMcoef[ie*nln2+iii] = LocalMass[a][b]*detjac[ie];
+                if (symmetric)
+                {
+                    SetSymmetricIndex(localMrows, localMcols, iii, elements[a+ie*numRowsElements], elements[b+ie*numRowsElements]);
+                }
+                else
+                {
+                    localMrows[iii] = elements[a+ie*numRowsElements];
+                    localMcols[iii] = elements[b+ie*numRowsElements];
+                }
+                SetCoef(myMcoef, ie*nln2+iii, LocalMass[a][b]*detjac[ie]);
                 
                 iii = iii + 1;
             }
         }
         
+        SetIndexBlock(myMrows, ie*nln2, localMrows, nln2);
+        SetIndexBlock(myMcols, ie*nln2, localMcols, nln2);
     }
-            
+    
+    ReleaseIndexData(elements, prhs[1]);
 }
 
@@ -2,6 +2,7 @@
 % CFD_ASSEMBLER methods:
 %    CFD_ASSEMBLER                     - constructor
 %    SetFluidParameters                - set parameters vector
+%    SetMesh                           - update the mesh of a moving domain in place
 %    compute_external_forces           - assemble volumetric rhs contribute 
 %    compute_Stokes_matrix             - assemble Stokes operator
 %    compute_convective_Oseen_matrix   - assemble convective Oseen matrix 
@@ -11,6 +12,16 @@
 %    compute_SUPG_semiimplicit         - assemble SUPG stabilization for semi-implicit scheme
 %    compute_SUPG_implicit             - assemble SUPG stabilization for implicit scheme
 %    compute_SUPG_implicit_ALE         - assemble SUPG stabilization for implicit scheme in ALE formulation 
+%    compute_NewtonStep                - assemble jacobian and residual of the implicit scheme in a single sweep
+%    compute_NewtonStep_ALE            - assemble jacobian and residual of the implicit scheme in ALE formulation
+%    compute_NewtonStepSteady          - assemble jacobian and residual of the steady problem in a single sweep
+%    compute_residual_matrixfree       - evaluate the implicit NS (+ SUPG) residual without assembling matrices
+%    compute_jacobian_vector           - evaluate the product of the implicit NS (+ SUPG) jacobian with a vector
+%    assemble_matrix                   - build sparse matrix, reusing the cached
+%                                        sparsity pattern if DATA.Assembly.cache_pattern
+%    precision_suffix                  - suffix of the C assembly names selecting
+%                                        single precision matrix coefficients
+%                                        (DATA.Assembly.precision)
 
 % CFD_ASSEMBLER properties:
 %    M_MESH                - struct containing MESH data
@@ -37,6 +48,15 @@ classdef CFD_Assembler < handle
         M_dynamic_viscosity;
         M_gravity;
     end
+    
+    properties (Access = protected)
+        M_ScatterMaps;
+        M_Coloring;
+        M_precision;
+        M_elements;
+        M_dphi_ref_v;
+        M_dphi_ref_p;
+    end
    
     methods
         
@@ -51,6 +71,36 @@ classdef CFD_Assembler < handle
             obj.M_totSize     = FE_SPACE_v.numDof + FE_SPACE_p.numDof;
             obj = SetFluidParameters( obj );
             
+            % connectivity passed to the C assemblers
+            if isfield(DATA, 'Assembly') && isfield(DATA.Assembly, 'index_type') && any(strcmp(DATA.Assembly.index_type, {'int32', 'int64'}))
+                obj.M_elements = cast( MESH.elements, DATA.Assembly.index_type );
+            else
+                obj.M_elements = MESH.elements;
+            end
+            
+            % cached sparsity patterns (DATA.Assembly.cache_pattern) and
+            % element coloring for the race-free parallel scatter of the
+            % elemental contributions (DATA.Assembly.coloring)
+            [obj.M_ScatterMaps, obj.M_Coloring] = SparseScatterMap.CreateCache(DATA, obj.M_elements, FE_SPACE_v.numElemDof, MESH.numNodes);
+            
+            % precision of the matrix coefficients returned by the C
+            % assemblers: 'double', 'single' or 'mixed'
+            obj.M_precision = 'double';
+            if isfield(DATA, 'Assembly') && isfield(DATA.Assembly, 'precision')
+                obj.M_precision = DATA.Assembly.precision;
+            end
+            
+            % reference gradients passed to the C assemblers, possibly
+            % replaced by the precomputed physical gradients
+            obj.M_dphi_ref_v = FE_SPACE_v.dphi_ref;
+            obj.M_dphi_ref_p = FE_SPACE_p.dphi_ref;
+            if isfield(DATA, 'Assembly') && isfield(DATA.Assembly, 'geometry_cache') && ~strcmp(DATA.Assembly.geometry_cache, 'none')
+                GeoCache_v = GeometryCache(MESH, FE_SPACE_v, DATA.Assembly.geometry_cache, DATA.Assembly.geometry_cache_budget);
+                GeoCache_p = GeometryCache(MESH, FE_SPACE_p, DATA.Assembly.geometry_cache, DATA.Assembly.geometry_cache_budget);
+                obj.M_dphi_ref_v = GeoCache_v.GetData();
+                obj.M_dphi_ref_p = GeoCache_p.GetData();
+            end
+            
             if isfield(obj.M_DATA, 'gravity')
                 obj.M_gravity = obj.M_DATA.gravity;
             else
@@ -79,6 +129,21 @@ classdef CFD_Assembler < handle
              
         end
         
+        %==========================================================================
+        %% SetMesh
+        function obj = SetMesh( obj, MESH )
+            % Update the mesh of a moving domain (ALE). The connectivity is
+            % unchanged, so the cached scatter maps and the element
+            % coloring are kept. The geometry cache would have to be
+            % recomputed at each update, hence it is dropped and the C
+            % assemblers compute the physical gradients on the fly.
+            
+            obj.M_MESH       = MESH;
+            obj.M_dphi_ref_v = obj.M_FE_SPACE_v.dphi_ref;
+            obj.M_dphi_ref_p = obj.M_FE_SPACE_p.dphi_ref;
+            
+        end
+        
         %==========================================================================
         %% Compute_external_forces
         function F_ext = compute_external_forces(obj, t)
@@ -132,7 +197,7 @@ classdef CFD_Assembler < handle
             F_ext = [];
             for k = 1 : obj.M_MESH.dim
                 
-                [rowF, coefF] = CSM_assembler_ExtForces(f{k}, obj.M_MESH.elements, obj.M_FE_SPACE_v.numElemDof, ...
+                [rowF, coefF] = CSM_assembler_ExtForces(f{k}, obj.M_elements, obj.M_FE_SPACE_v.numElemDof, ...
                     obj.M_FE_SPACE_v.quad_weights, obj.M_MESH.jac, obj.M_FE_SPACE_v.phi);
                 
                 % Build sparse matrix and vector
@@ -147,35 +212,58 @@ classdef CFD_Assembler < handle
         %% compute_Stokes_matrix
         function A = compute_Stokes_matrix(obj)
             
+            if isfield(obj.M_DATA, 'Assembly') && isfield(obj.M_DATA.Assembly, 'symmetric') && obj.M_DATA.Assembly.symmetric
+                % only the upper triangle of the viscous block and the
+                % velocity-pressure block B' are computed: A = [K B'; -B 0]
+                [rowA, colA, coefA, rowB, colB, coefB] = ...
+                    CFD_assembler_C_omp(['Stokes_symmetric',precision_suffix(obj)], obj.M_dynamic_viscosity, obj.M_MESH.dim, obj.M_elements, ...
+                    obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, obj.M_FE_SPACE_v.numDof, ...
+                    obj.M_FE_SPACE_v.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, ...
+                    obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, obj.M_FE_SPACE_p.phi);
+                
+                K   = GlobalAssembleSymmetric(rowA, colA, coefA, obj.M_totSize);
+                BT  = GlobalAssemble(rowB, colB, coefB, obj.M_totSize, obj.M_totSize);
+                A   = K + BT - BT.';
+                return;
+            end
+            
             % C_OMP assembly, returns matrices in sparse vector format
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'Stokes');
             [rowA, colA, coefA] = ...
-                CFD_assembler_C_omp('Stokes', obj.M_dynamic_viscosity, obj.M_MESH.dim, obj.M_MESH.elements, ...
+                CFD_assembler_C_omp(['Stokes',precision_suffix(obj),scatter], obj.M_dynamic_viscosity, obj.M_MESH.dim, obj.M_elements, ...
                 obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, obj.M_FE_SPACE_v.numDof, ...
                 obj.M_FE_SPACE_v.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, ...
-                obj.M_FE_SPACE_v.phi, obj.M_FE_SPACE_v.dphi_ref, obj.M_FE_SPACE_p.phi);
+                obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, obj.M_FE_SPACE_p.phi, scatter_inputs{:});
             
             % Build sparse matrix
-            A   = GlobalAssemble(rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            A   = assemble_matrix(obj, 'Stokes', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
 
         end
         
         %==========================================================================
         %% compute_convective_Oseen_matrix
-        function C = compute_convective_Oseen_matrix(obj, conv_velocity)
+        function C = compute_convective_Oseen_matrix(obj, conv_velocity, preconditioner)
+            % if PRECONDITIONER is true, the matrix is only used to build a
+            % preconditioner (see precision_suffix)
             
             if nargin < 2 || isempty(conv_velocity)
                 conv_velocity = zeros(obj.M_totSize,1);
             end
+            
+            if nargin < 3
+                preconditioner = false;
+            end
 
             % C_OMP assembly, returns matrices in sparse vector format
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'convective_Oseen');
             [rowA, colA, coefA] = ...
-                CFD_assembler_C_omp('convective_Oseen', 1.0, obj.M_MESH.dim, obj.M_MESH.elements, ...
+                CFD_assembler_C_omp(['convective_Oseen',precision_suffix(obj, preconditioner),scatter], 1.0, obj.M_MESH.dim, obj.M_elements, ...
                 obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_v.numDof, ...
                 obj.M_FE_SPACE_v.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, ...
-                obj.M_FE_SPACE_v.phi, obj.M_FE_SPACE_v.dphi_ref, conv_velocity);
+                obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, conv_velocity, scatter_inputs{:});
             
             % Build sparse matrix
-            C   = GlobalAssemble(rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            C   = assemble_matrix(obj, 'convective_Oseen', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
             C   = obj.M_density * C;
 
         end
@@ -189,15 +277,16 @@ classdef CFD_Assembler < handle
             end
             
             % C_OMP assembly, returns matrices in sparse vector format
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'convective_C1');
             [rowA, colA, coefA, rowB, colB, coefB] = ...
-                CFD_assembler_C_omp('convective', 1.0, obj.M_MESH.dim, obj.M_MESH.elements, ...
+                CFD_assembler_C_omp(['convective',precision_suffix(obj),scatter], 1.0, obj.M_MESH.dim, obj.M_elements, ...
                 obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_v.numDof, ...
                 obj.M_FE_SPACE_v.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, ...
-                obj.M_FE_SPACE_v.phi, obj.M_FE_SPACE_v.dphi_ref, U_h);
+                obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, U_h, scatter_inputs{:});
             
             % Build sparse matrix
-            C1   = GlobalAssemble(rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
-            C2   = GlobalAssemble(rowB, colB, coefB, obj.M_totSize, obj.M_totSize);
+            C1   = assemble_matrix(obj, 'convective_C1', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            C2   = assemble_matrix(obj, 'convective_C2', rowB, colB, coefB, obj.M_totSize, obj.M_totSize);
 
             C1   = obj.M_density * C1;
             C2   = obj.M_density * C2;
@@ -218,15 +307,16 @@ classdef CFD_Assembler < handle
             convective_velocity = U_h - ALE_velocity;
             
             % C_OMP assembly, returns matrices in sparse vector format
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'convectiveALE_C1');
             [rowA, colA, coefA, rowB, colB, coefB] = ...
-                CFD_assembler_C_omp('convectiveALE', 1.0, obj.M_MESH.dim, obj.M_MESH.elements, ...
+                CFD_assembler_C_omp(['convectiveALE',precision_suffix(obj),scatter], 1.0, obj.M_MESH.dim, obj.M_elements, ...
                 obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_v.numDof, ...
                 obj.M_FE_SPACE_v.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, ...
-                obj.M_FE_SPACE_v.phi, obj.M_FE_SPACE_v.dphi_ref, U_h, convective_velocity);
+                obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, U_h, convective_velocity, scatter_inputs{:});
             
             % Build sparse matrix
-            C1   = GlobalAssemble(rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
-            C2   = GlobalAssemble(rowB, colB, coefB, obj.M_totSize, obj.M_totSize);
+            C1   = assemble_matrix(obj, 'convectiveALE_C1', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            C2   = assemble_matrix(obj, 'convectiveALE_C2', rowB, colB, coefB, obj.M_totSize, obj.M_totSize);
 
             C1   = obj.M_density * C1;
             C2   = obj.M_density * C2;
@@ -237,11 +327,17 @@ classdef CFD_Assembler < handle
         function [M] = compute_mass(obj, FE_SPACE)
             
             % C_OMP assembly, returns matrices in sparse vector format
-            [rowM, colM, coefM] = Mass_assembler_C_omp(obj.M_MESH.dim, obj.M_MESH.elements, FE_SPACE.numElemDof, ...
-                FE_SPACE.quad_weights, obj.M_MESH.jac, FE_SPACE.phi);
+            symmetric = isfield(obj.M_DATA, 'Assembly') && isfield(obj.M_DATA.Assembly, 'symmetric') ...
+                && obj.M_DATA.Assembly.symmetric;
+            [rowM, colM, coefM] = Mass_assembler_C_omp(obj.M_MESH.dim, obj.M_elements, FE_SPACE.numElemDof, ...
+                FE_SPACE.quad_weights, obj.M_MESH.jac, FE_SPACE.phi, symmetric, ~isempty(precision_suffix(obj)));
             
             % Build sparse matrix
-            M_scalar   = GlobalAssemble(rowM, colM, coefM, FE_SPACE.numDofScalar, FE_SPACE.numDofScalar);
+            if symmetric
+                M_scalar   = GlobalAssembleSymmetric(rowM, colM, coefM, FE_SPACE.numDofScalar);
+            else
+                M_scalar   = GlobalAssemble(rowM, colM, coefM, FE_SPACE.numDofScalar, FE_SPACE.numDofScalar);
+            end
             M          = [];
             for k = 1 : FE_SPACE.numComponents
                 M = blkdiag(M, M_scalar);
@@ -263,25 +359,30 @@ classdef CFD_Assembler < handle
         
         %==========================================================================
         %% compute_SUPG_semiimplicit
-        function [A_SUPG, F_SUPG] = compute_SUPG_semiimplicit(obj, conv_velocity, v_n, dt, alpha_BDF)
+        function [A_SUPG, F_SUPG] = compute_SUPG_semiimplicit(obj, conv_velocity, v_n, dt, alpha_BDF, preconditioner)
+            
+            if nargin < 6
+                preconditioner = false;
+            end
 
             if ~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1')
                 error('SUPG stabilization only available for P1-P1 finite elements')
             end
 
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'SUPG_SemiImplicit');
             [rowA, colA, coefA, rowF, coefF] = ...
-                CFD_assembler_C_omp('SUPG_SemiImplicit', obj.M_MESH.dim, ... %0 1
-                obj.M_MESH.elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
-                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_FE_SPACE_v.dphi_ref, ... %5 6 7
+                CFD_assembler_C_omp(['SUPG_SemiImplicit',precision_suffix(obj, preconditioner),scatter], obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
                 obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
                 obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
                 conv_velocity, v_n, ... %13 14
                 obj.M_density, obj.M_dynamic_viscosity, dt, alpha_BDF,... %15 16 17 18
-                obj.M_FE_SPACE_p.dphi_ref); % 19
+                obj.M_dphi_ref_p, scatter_inputs{:}); % 19
              
             % Build sparse matrix
-            A_SUPG   = GlobalAssemble(rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
-            F_SUPG   = GlobalAssemble(rowF, 1,    coefF, obj.M_totSize, 1);
+            A_SUPG   = assemble_matrix(obj, 'SUPG_SemiImplicit', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            F_SUPG   = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
             
         end
         
@@ -293,19 +394,20 @@ classdef CFD_Assembler < handle
                 error('SUPG stabilization only available for P1-P1 finite elements')
             end
 
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'SUPG_Implicit');
             [rowA, colA, coefA, rowF, coefF] = ...
-                CFD_assembler_C_omp('SUPG_Implicit', obj.M_MESH.dim, ... %0 1
-                obj.M_MESH.elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
-                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_FE_SPACE_v.dphi_ref, ... %5 6 7
+                CFD_assembler_C_omp(['SUPG_Implicit',precision_suffix(obj),scatter], obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
                 obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
                 obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
                 U_k, v_n, ... %13 14
                 obj.M_density, obj.M_dynamic_viscosity, dt, alpha_BDF,... %15 16 17 18
-                obj.M_FE_SPACE_p.dphi_ref); % 19
+                obj.M_dphi_ref_p, scatter_inputs{:}); % 19
             
             % Build sparse matrix
-            dG_SUPG   = GlobalAssemble(rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
-            G_SUPG    = GlobalAssemble(rowF, 1,    coefF, obj.M_totSize, 1);
+            dG_SUPG   = assemble_matrix(obj, 'SUPG_Implicit', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            G_SUPG    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
 
         end
         
@@ -322,19 +424,20 @@ classdef CFD_Assembler < handle
             end
             convective_velocity = U_k(1:obj.M_FE_SPACE_v.numDof) - ALE_velocity;
 
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'SUPG_ImplicitALE');
             [rowA, colA, coefA, rowF, coefF] = ...
-                CFD_assembler_C_omp('SUPG_ImplicitALE', obj.M_MESH.dim, ... %0 1
-                obj.M_MESH.elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
-                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_FE_SPACE_v.dphi_ref, ... %5 6 7
+                CFD_assembler_C_omp(['SUPG_ImplicitALE',precision_suffix(obj),scatter], obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
                 obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
                 obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
                 U_k, v_n, ... %13 14
                 obj.M_density, obj.M_dynamic_viscosity, dt, alpha_BDF,... %15 16 17 18
-                obj.M_FE_SPACE_p.dphi_ref, convective_velocity, obj.M_gravity); % 19, 20, 21
+                obj.M_dphi_ref_p, convective_velocity, obj.M_gravity, scatter_inputs{:}); % 19, 20, 21
             
             % Build sparse matrix
-            dG_SUPG   = GlobalAssemble(rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
-            G_SUPG    = GlobalAssemble(rowF, 1,    coefF, obj.M_totSize, 1);
+            dG_SUPG   = assemble_matrix(obj, 'SUPG_ImplicitALE', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            G_SUPG    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
 
         end
         
@@ -346,22 +449,321 @@ classdef CFD_Assembler < handle
                 error('SUPG stabilization only available for P1-P1 finite elements')
             end
 
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'SUPG_ImplicitSteady');
+            [rowA, colA, coefA, rowF, coefF] = ...
+                CFD_assembler_C_omp(['SUPG_ImplicitSteady',precision_suffix(obj),scatter], obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
+                obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
+                obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
+                U_k, ... %13
+                obj.M_density, obj.M_dynamic_viscosity,... %14 15
+                obj.M_dphi_ref_p, scatter_inputs{:}); % 16
+            
+            % Build sparse matrix
+            dG_SUPG   = assemble_matrix(obj, 'SUPG_ImplicitSteady', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            G_SUPG    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
+
+        end
+        
+        %==========================================================================
+        %% compute_NewtonStep
+        function [dG, G] = compute_NewtonStep(obj, U_k, v_n, dt, alpha_BDF, use_SUPG)
+            % dG = alpha/dt M + S + C1(U_k) + C2(U_k) [+ dG_SUPG]
+            % G  = 1/dt M (alpha U_k - v_n) + S U_k + C1(U_k) U_k [+ G_SUPG]
+            
+            if use_SUPG && (~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1'))
+                error('SUPG stabilization only available for P1-P1 finite elements')
+            end
+
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'NS_NewtonStep');
+            [rowA, colA, coefA, rowF, coefF] = ...
+                CFD_assembler_C_omp(['NS_NewtonStep',precision_suffix(obj),scatter], obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
+                obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
+                obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
+                U_k, v_n, ... %13 14
+                obj.M_density, obj.M_dynamic_viscosity, dt, alpha_BDF,... %15 16 17 18
+                obj.M_dphi_ref_p, double(use_SUPG), scatter_inputs{:}); % 19 20
+            
+            % Build sparse matrix
+            dG   = assemble_matrix(obj, 'NS_NewtonStep', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            G    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
+
+        end
+        
+        %==========================================================================
+        %% compute_NewtonStep_ALE
+        function [dG, G] = compute_NewtonStep_ALE(obj, U_k, ALE_velocity, v_n, dt, alpha_BDF, use_SUPG)
+            % as compute_NewtonStep, with convective velocity U_k - ALE_velocity
+            
+            if use_SUPG && (~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1'))
+                error('SUPG stabilization only available for P1-P1 finite elements')
+            end
+            
+            if isempty(ALE_velocity)
+                ALE_velocity = zeros(obj.M_FE_SPACE_v.numDof,1);
+            end
+            convective_velocity = U_k(1:obj.M_FE_SPACE_v.numDof) - ALE_velocity;
+
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'NS_NewtonStepALE');
+            [rowA, colA, coefA, rowF, coefF] = ...
+                CFD_assembler_C_omp(['NS_NewtonStepALE',precision_suffix(obj),scatter], obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
+                obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
+                obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
+                U_k, v_n, ... %13 14
+                obj.M_density, obj.M_dynamic_viscosity, dt, alpha_BDF,... %15 16 17 18
+                obj.M_dphi_ref_p, double(use_SUPG), convective_velocity, obj.M_gravity, scatter_inputs{:}); % 19 20 21 22
+            
+            % Build sparse matrix
+            dG   = assemble_matrix(obj, 'NS_NewtonStepALE', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            G    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
+
+        end
+        
+        %==========================================================================
+        %% compute_NewtonStepSteady
+        function [dG, G] = compute_NewtonStepSteady(obj, U_k, use_SUPG)
+            % dG = S + C1(U_k) + C2(U_k) [+ dG_SUPG], G = S U_k + C1(U_k) U_k [+ G_SUPG]
+            
+            if use_SUPG && (~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1'))
+                error('SUPG stabilization only available for P1-P1 finite elements')
+            end
+
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'NS_NewtonStepSteady');
             [rowA, colA, coefA, rowF, coefF] = ...
-                CFD_assembler_C_omp('SUPG_ImplicitSteady', obj.M_MESH.dim, ... %0 1
-                obj.M_MESH.elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
-                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_FE_SPACE_v.dphi_ref, ... %5 6 7
+                CFD_assembler_C_omp(['NS_NewtonStepSteady',precision_suffix(obj),scatter], obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
                 obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
                 obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
                 U_k, ... %13
                 obj.M_density, obj.M_dynamic_viscosity,... %14 15
-                obj.M_FE_SPACE_p.dphi_ref); % 16
+                obj.M_dphi_ref_p, double(use_SUPG), scatter_inputs{:}); % 16 17
             
             % Build sparse matrix
-            dG_SUPG   = GlobalAssemble(rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
-            G_SUPG    = GlobalAssemble(rowF, 1,    coefF, obj.M_totSize, 1);
+            dG   = assemble_matrix(obj, 'NS_NewtonStepSteady', rowA, colA, coefA, obj.M_totSize, obj.M_totSize);
+            G    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
+
+        end
+        
+        %==========================================================================
+        %% compute_SUPG_implicit_residual
+        function [G_SUPG] = compute_SUPG_implicit_residual(obj, U_k, v_n, dt, alpha_BDF)
+            % as compute_SUPG_implicit, without computing the jacobian
+
+            if ~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1')
+                error('SUPG stabilization only available for P1-P1 finite elements')
+            end
+
+            [rowF, coefF] = ...
+                CFD_assembler_C_omp('SUPG_Implicit_residual', obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
+                obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
+                obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
+                U_k, v_n, ... %13 14
+                obj.M_density, obj.M_dynamic_viscosity, dt, alpha_BDF,... %15 16 17 18
+                obj.M_dphi_ref_p); % 19
+            
+            G_SUPG    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
+
+        end
+        
+        %==========================================================================
+        %% compute_SUPG_implicit_ALE_residual
+        function [G_SUPG] = compute_SUPG_implicit_ALE_residual(obj, U_k, ALE_velocity, v_n, dt, alpha_BDF)
+            % as compute_SUPG_implicit_ALE, without computing the jacobian
+
+            if ~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1')
+                error('SUPG stabilization only available for P1-P1 finite elements')
+            end
+            
+            if isempty(ALE_velocity)
+                ALE_velocity = zeros(obj.M_FE_SPACE_v.numDof,1);
+            end
+            convective_velocity = U_k(1:obj.M_FE_SPACE_v.numDof) - ALE_velocity;
+
+            [rowF, coefF] = ...
+                CFD_assembler_C_omp('SUPG_ImplicitALE_residual', obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
+                obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
+                obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
+                U_k, v_n, ... %13 14
+                obj.M_density, obj.M_dynamic_viscosity, dt, alpha_BDF,... %15 16 17 18
+                obj.M_dphi_ref_p, convective_velocity, obj.M_gravity); % 19, 20, 21
+            
+            G_SUPG    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
+
+        end
+        
+        %==========================================================================
+        %% compute_SUPG_implicitSteady_residual
+        function [G_SUPG] = compute_SUPG_implicitSteady_residual(obj, U_k)
+            % as compute_SUPG_implicitSteady, without computing the jacobian
+
+            if ~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1')
+                error('SUPG stabilization only available for P1-P1 finite elements')
+            end
+
+            [rowF, coefF] = ...
+                CFD_assembler_C_omp('SUPG_ImplicitSteady_residual', obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
+                obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
+                obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
+                U_k, ... %13
+                obj.M_density, obj.M_dynamic_viscosity,... %14 15
+                obj.M_dphi_ref_p); % 16
+            
+            G_SUPG    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
+
+        end
+        
+        %==========================================================================
+        %% compute_NewtonStep_residual
+        function [G] = compute_NewtonStep_residual(obj, U_k, v_n, dt, alpha_BDF, use_SUPG)
+            % residual G of compute_NewtonStep, without computing the jacobian
+            
+            if use_SUPG && (~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1'))
+                error('SUPG stabilization only available for P1-P1 finite elements')
+            end
+
+            [rowF, coefF] = ...
+                CFD_assembler_C_omp('NS_NewtonStep_residual', obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
+                obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
+                obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
+                U_k, v_n, ... %13 14
+                obj.M_density, obj.M_dynamic_viscosity, dt, alpha_BDF,... %15 16 17 18
+                obj.M_dphi_ref_p, double(use_SUPG)); % 19 20
+            
+            G    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
+
+        end
+        
+        %==========================================================================
+        %% compute_NewtonStep_ALE_residual
+        function [G] = compute_NewtonStep_ALE_residual(obj, U_k, ALE_velocity, v_n, dt, alpha_BDF, use_SUPG)
+            % residual G of compute_NewtonStep_ALE, without computing the jacobian
+            
+            if use_SUPG && (~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1'))
+                error('SUPG stabilization only available for P1-P1 finite elements')
+            end
+            
+            if isempty(ALE_velocity)
+                ALE_velocity = zeros(obj.M_FE_SPACE_v.numDof,1);
+            end
+            convective_velocity = U_k(1:obj.M_FE_SPACE_v.numDof) - ALE_velocity;
+
+            [rowF, coefF] = ...
+                CFD_assembler_C_omp('NS_NewtonStepALE_residual', obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
+                obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
+                obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
+                U_k, v_n, ... %13 14
+                obj.M_density, obj.M_dynamic_viscosity, dt, alpha_BDF,... %15 16 17 18
+                obj.M_dphi_ref_p, double(use_SUPG), convective_velocity, obj.M_gravity); % 19 20 21 22
+            
+            G    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
+
+        end
+        
+        %==========================================================================
+        %% compute_NewtonStepSteady_residual
+        function [G] = compute_NewtonStepSteady_residual(obj, U_k, use_SUPG)
+            % residual G of compute_NewtonStepSteady, without computing the jacobian
+            
+            if use_SUPG && (~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1'))
+                error('SUPG stabilization only available for P1-P1 finite elements')
+            end
+
+            [rowF, coefF] = ...
+                CFD_assembler_C_omp('NS_NewtonStepSteady_residual', obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
+                obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
+                obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
+                U_k, ... %13
+                obj.M_density, obj.M_dynamic_viscosity,... %14 15
+                obj.M_dphi_ref_p, double(use_SUPG)); % 16 17
+            
+            G    = GlobalAssembleColored(rowF, coefF, obj.M_totSize, obj.M_Coloring);
+
+        end
+        
+        %==========================================================================
+        %% compute_residual_matrixfree
+        function [G] = compute_residual_matrixfree(obj, U_k, v_n, dt, alpha_BDF, use_SUPG)
+            % G = 1/dt M (alpha U_k - v_n) + S U_k + C1(U_k) U_k [+ G_SUPG]
+            % computed element-wise, without assembling any matrix; same
+            % as compute_NewtonStep_residual
+            
+            G = compute_NewtonStep_residual(obj, U_k, v_n, dt, alpha_BDF, use_SUPG);
+
+        end
+        
+        %==========================================================================
+        %% compute_jacobian_vector
+        function [JX] = compute_jacobian_vector(obj, U_k, X, v_n, dt, alpha_BDF, use_SUPG)
+            % JX = (alpha/dt M + S + C1(U_k) + C2(U_k) [+ dG_SUPG(U_k)]) X
+            % computed element-wise, without assembling any matrix
+            
+            if use_SUPG && (~strcmp(obj.M_FE_SPACE_v.fem, 'P1') || ~strcmp(obj.M_FE_SPACE_p.fem, 'P1'))
+                error('SUPG stabilization only available for P1-P1 finite elements')
+            end
+
+            [rowJX, coefJX] = ...
+                CFD_assembler_C_omp('NS_JacobianVector', obj.M_MESH.dim, ... %0 1
+                obj.M_elements,  obj.M_MESH.jac, obj.M_MESH.invjac, ... %2 3 4
+                obj.M_FE_SPACE_v.quad_weights, obj.M_FE_SPACE_v.phi, obj.M_dphi_ref_v, ... %5 6 7
+                obj.M_FE_SPACE_v.numElemDof, obj.M_FE_SPACE_p.numElemDof, ... %8 9
+                obj.M_FE_SPACE_v.numDof, obj.M_FE_SPACE_p.numDof,  obj.M_FE_SPACE_p.phi, ... %10 11 12
+                U_k, v_n, ... %13 14
+                obj.M_density, obj.M_dynamic_viscosity, dt, alpha_BDF,... %15 16 17 18
+                obj.M_dphi_ref_p, double(use_SUPG), X); % 19 20 21
+            
+            JX   = GlobalAssembleColored(rowJX, coefJX, obj.M_totSize, obj.M_Coloring);
 
         end
         
+        %==========================================================================
+        %% Build sparse matrix from elemental contributions
+        function [A] = assemble_matrix(obj, name, rows, cols, coef, m, n)
+            % if DATA.Assembly.cache_pattern is true, the sparsity pattern
+            % associated with NAME is computed the first time and then
+            % reused, see SparseScatterMap.AssembleCached; from then on the
+            % C assembly of NAME gets the ScatterInputs and returns directly
+            % the values of the cached matrix, with ROWS and COLS empty
+            
+            A = SparseScatterMap.AssembleCached(obj.M_ScatterMaps, name, rows, cols, coef, m, n, obj.M_Coloring);
+        end
+        
+        %==========================================================================
+        %% Suffix of the C assembly names selecting the precision of the matrix coefficients
+        function [suffix] = precision_suffix(obj, preconditioner)
+            % with DATA.Assembly.precision = 'single' all the matrices are
+            % assembled from local matrices rounded to single precision,
+            % with 'mixed' only those used to build a preconditioner; the
+            % residuals are always assembled in double precision
+            
+            if nargin < 2
+                preconditioner = false;
+            end
+            
+            if strcmp(obj.M_precision, 'single') || (preconditioner && strcmp(obj.M_precision, 'mixed'))
+                suffix = '_single';
+            else
+                suffix = '';
+            end
+        end
+        
     end
     
 end
\ No newline at end of file
@@ -10,9 +10,7 @@
 #include <string.h>
 #include "../../Core/Tools.h"
 
-#define INVJAC(i,j,k) invjac[i+(j+k*dim)*noe]
-#define GRADREFPHIV(i,j,k) gradrefphiV[i+(j+k*NumQuadPoints)*nlnV]
-#define GRADREFPHIP(i,j,k) gradrefphiP[i+(j+k*NumQuadPoints)*nlnP]
+#define INVJAC(i,j,k) invjac[i*invjacStrideE+(j+k*dim)*invjacStrideC]
 #ifdef _OPENMP
 #include <omp.h>
 #else
@@ -21,7 +19,11 @@
 
 
 /*************************************************************************/
-void AssembleStokes(mxArray* plhs[], const mxArray* prhs[])
+/* Stokes matrix. If symmetric is set, only the upper triangle of the
+ * viscous block is returned in plhs[0..2] (see SetSymmetricIndex), while
+ * plhs[3..5] contain the velocity-pressure block B^T: the pressure-velocity
+ * block is -B */
+void AssembleStokes(mxArray* plhs[], const mxArray* prhs[], const int symmetric, const CoefFormat coefFormat)
 {
     double* dim_ptr = mxGetPr(prhs[2]);
     int dim     = (int)(dim_ptr[0]);
@@ -30,34 +32,46 @@ void AssembleStokes(mxArray* plhs[], const mxArray* prhs[])
     int nlnV     = (int)(nln_ptrV[0]);
     double* nln_ptrP = mxGetPr(prhs[5]);
     int nlnP     = (int)(nln_ptrP[0]);
-    int numRowsElements  = mxGetM(prhs[3]);
+    mwSize numRowsElements  = mxGetM(prhs[3]);
     
-    int nln  = nlnV + nlnP;
-    int nln2 = nln*nln;
-    int local_matrix_size = nlnV*nlnV*dim*dim + 2*nlnV*nlnP*dim;
-    int global_lenght = noe * local_matrix_size;
+    mwSize local_matrix_size = nlnV*nlnV*dim*dim + 2*nlnV*nlnP*dim;
+    mwSize local_div_size    = nlnV*nlnP*dim;
+    if (symmetric)
+    {
+        local_matrix_size = nlnV*dim*(nlnV*dim+1)/2;
+    }
+    mwSize global_lenght = noe * local_matrix_size;
     
-    plhs[0] = mxCreateDoubleMatrix(global_lenght,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(global_lenght,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(global_lenght,1, mxREAL);
+    CreateMatrixOutputs(plhs, global_lenght, prhs[3], (dim+1) * mxGetScalar(prhs[6]) / dim, noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
+    
+    IndexArray myBrows = {NULL, NULL, NULL};
+    IndexArray myBcols = {NULL, NULL, NULL};
+    CoefArray myBcoef  = {NULL, NULL};
+    if (symmetric)
+    {
+        plhs[3] = CreateIndexMatrix((mwSize) noe * local_div_size, 1, prhs[3], (dim+1) * mxGetScalar(prhs[6]) / dim);
+        plhs[4] = CreateIndexMatrix((mwSize) noe * local_div_size, 1, prhs[3], (dim+1) * mxGetScalar(prhs[6]) / dim);
+        plhs[5] = CreateCoefMatrix((mwSize) noe * local_div_size,1, noe, coefFormat.single);
+        myBrows = GetIndexArray(plhs[3]);
+        myBcols = GetIndexArray(plhs[4]);
+        myBcoef = GetCoefArray(plhs[5]);
+    }
     
     int NumQuadPoints     = mxGetN(prhs[7]);
     
     double* NumNodes_ptr = mxGetPr(prhs[6]);
-    int NumScalarDofsV     = (int)(NumNodes_ptr[0] / dim);
+    long long NumScalarDofsV = (long long)(NumNodes_ptr[0] / dim);
     
     double* w   = mxGetPr(prhs[7]);
-    double* invjac = mxGetPr(prhs[8]);
     double* detjac = mxGetPr(prhs[9]);
-    double* phiV = mxGetPr(prhs[10]);
-    double* gradrefphiV = mxGetPr(prhs[11]);
+    GeometryCache GeoCacheV = GetGeometryCache(prhs[11], prhs[8], dim, nlnV, NumQuadPoints, noe);
     double* phiP = mxGetPr(prhs[12]);
     
-    double* elements  = mxGetPr(prhs[3]);
+    long long* elements  = GetIndexData(prhs[3]);
         
     double* material_param = mxGetPr(prhs[1]);
     double viscosity = material_param[0];
@@ -65,25 +79,18 @@ void AssembleStokes(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef) private(ie) firstprivate(phiV,phiP,gradrefphiV,w,numRowsElements,local_matrix_size,nlnV,nlnP,NumQuadPoints,NumScalarDofsV,viscosity,dim)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,myBcols,myBrows,myBcoef) private(ie) firstprivate(phiP,w,numRowsElements,local_matrix_size,local_div_size,nlnV,nlnP,NumQuadPoints,NumScalarDofsV,viscosity,dim,symmetric)
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        int k, q, d1, d2;
+        long long localArows[local_matrix_size], localAcols[local_matrix_size];
+        long long localBrows[local_div_size], localBcols[local_div_size];
+
+        int q, d1, d2;
         
         double gradphiV[NumQuadPoints][nlnV][dim];
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
-            for (k = 0; k < nlnV; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiV[q][k][d1] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiV[q][k][d1] = gradphiV[q][k][d1] + INVJAC(ie,d1,d2)*GRADREFPHIV(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheV.PhysicalGradients(&GeoCacheV, ie, q, &gradphiV[q][0][0], 1, dim);
         }
         
         int iii = 0;
@@ -93,8 +100,8 @@ void AssembleStokes(mxArray* plhs[], const mxArray* prhs[])
         /* loop over velocity test functions --> a */
         for (a = 0; a < nlnV; a = a + 1 )
         {
-            /* loop over velocity trial functions --> b */
-            for (b = 0; b < nlnV; b = b + 1 )
+            /* loop over velocity trial functions --> b (b >= a only in symmetric mode) */
+            for (b = (symmetric ? a : 0); b < nlnV; b = b + 1 )
             {
                 double aloc[dim][dim];
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
@@ -128,11 +135,24 @@ void AssembleStokes(mxArray* plhs[], const mxArray* prhs[])
                 }
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
+                    if (symmetric)
+                    {
+                        for (d2 = (a == b ? d1 : 0); d2 < dim; d2 = d2 + 1 )
+                        {
+                            SetSymmetricIndex(localArows, localAcols, iii,
+                                    elements[a+ie*numRowsElements] + d1 * NumScalarDofsV, elements[b+ie*numRowsElements] + d2 * NumScalarDofsV);
+                            SetCoef(myAcoef, ie*local_matrix_size+iii, aloc[d1][d2]*detjac[ie]);
+                            
+                            iii = iii + 1;
+                        }
+                        continue;
+                    }
+                    
                     for (d2 = 0; d2 < dim; d2 = d2 + 1 )
                     {
-                        myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                        myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
-                        myAcoef[ie*local_matrix_size+iii] = aloc[d1][d2]*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
+                        SetCoef(myAcoef, ie*local_matrix_size+iii, aloc[d1][d2]*detjac[ie]);
                         
                         iii = iii + 1;
                     }
@@ -158,88 +178,93 @@ void AssembleStokes(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = alocDiv[d1]*detjac[ie];
+                    if (symmetric)
+                    {
+                        localBrows[ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                        localBcols[ii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                        SetCoef(myBcoef, ie*local_div_size+ii, alocDiv[d1]*detjac[ie]);
+                        
+                        ii = ii + 1;
+                        continue;
+                    }
+                    
+                    localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, alocDiv[d1]*detjac[ie]);
                     
                     iii = iii + 1;
                     
-                    myAcols[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1  * NumScalarDofsV;
-                    myArows[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = -alocDiv[d1]*detjac[ie];
+                    localAcols[iii] = elements[a+ie*numRowsElements] + d1  * NumScalarDofsV;
+                    localArows[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, -alocDiv[d1]*detjac[ie]);
                     
                     iii = iii + 1;
                 }
                 
             }
         }
+        SetIndexBlock(myArows, ie*local_matrix_size, localArows, local_matrix_size);
+        SetIndexBlock(myAcols, ie*local_matrix_size, localAcols, local_matrix_size);
+        if (symmetric)
+        {
+            SetIndexBlock(myBrows, ie*local_div_size, localBrows, local_div_size);
+            SetIndexBlock(myBcols, ie*local_div_size, localBcols, local_div_size);
+        }
     }
+    
+    ReleaseIndexData(elements, prhs[3]);
 }
 /*************************************************************************/
-void AssembleConvective_Oseen(mxArray* plhs[], const mxArray* prhs[])
+void AssembleConvective_Oseen(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     double* dim_ptr = mxGetPr(prhs[2]);
     int dim     = (int)(dim_ptr[0]);
     int noe     = mxGetN(prhs[3]);
     double* nln_ptrV = mxGetPr(prhs[4]);
     int nlnV     = (int)(nln_ptrV[0]);
-    int numRowsElements  = mxGetM(prhs[3]);
+    mwSize numRowsElements  = mxGetM(prhs[3]);
     
-    int local_matrix_size = nlnV*nlnV*dim;
-    int global_lenght = noe * local_matrix_size;
+    mwSize local_matrix_size = nlnV*nlnV*dim;
+    mwSize global_lenght = noe * local_matrix_size;
     
-    plhs[0] = mxCreateDoubleMatrix(global_lenght,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(global_lenght,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(global_lenght,1, mxREAL);
+    CreateMatrixOutputs(plhs, global_lenght, prhs[3], (dim+1) * mxGetScalar(prhs[5]) / dim, noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
     
     double* NumNodes_ptr = mxGetPr(prhs[5]);
-    int NumScalarDofsV     = (int)(NumNodes_ptr[0] / dim);
+    long long NumScalarDofsV = (long long)(NumNodes_ptr[0] / dim);
     
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
     double* phiV = mxGetPr(prhs[9]);
-    double* gradrefphiV = mxGetPr(prhs[10]);
+    GeometryCache GeoCacheV = GetGeometryCache(prhs[10], prhs[7], dim, nlnV, NumQuadPoints, noe);
     double* U_h   = mxGetPr(prhs[11]);
     
     double gradphiV[NumQuadPoints][dim][nlnV];
-    double* elements  = mxGetPr(prhs[3]);
+    long long* elements  = GetIndexData(prhs[3]);
     
-    double GradV[dim][dim];
-    double GradU[dim][dim];
     double U_hq[NumQuadPoints][dim];
     
     double* material_param = mxGetPr(prhs[1]);
     double density = material_param[0];
     
     /* Assembly: loop over the elements */
-    int ie, d1, d2;
+    int ie, d1;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(gradphiV,GradV,GradU,U_hq,ie,k,l,q,d1,d2) firstprivate(phiV,gradrefphiV,w,numRowsElements,local_matrix_size,nlnV,NumScalarDofsV,density)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,U_h) private(gradphiV,U_hq,ie,k,q,d1) firstprivate(phiV,w,numRowsElements,local_matrix_size,nlnV,NumScalarDofsV,density)
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        
+        long long localArows[local_matrix_size], localAcols[local_matrix_size];
+
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
-            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-            {
-                for (k = 0; k < nlnV; k = k + 1 )
-                {
-                    gradphiV[q][d1][k] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiV[q][d1][k] = gradphiV[q][d1][k] + INVJAC(ie,d1,d2)*GRADREFPHIV(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheV.PhysicalGradients(&GeoCacheV, ie, q, &gradphiV[q][0][0], nlnV, 1);
         }
 
         for (q = 0; q < NumQuadPoints; q = q + 1 )
@@ -249,15 +274,15 @@ void AssembleConvective_Oseen(mxArray* plhs[], const mxArray* prhs[])
                 U_hq[q][d1] = 0;
                 for (k = 0; k < nlnV; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                     U_hq[q][d1] = U_hq[q][d1] + U_h[e_k] * phiV[k+q*nlnV];
                 }
             }
         }
         
         int iii = 0;
-        int a, b, i_c, j_c;
+        int a, b;
         
         /* loop over velocity test functions --> a */
         for (a = 0; a < nlnV; a = a + 1 )
@@ -276,68 +301,66 @@ void AssembleConvective_Oseen(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = density*aloc*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, density*aloc*detjac[ie]);
                     
                     iii = iii + 1;
                 }
             }
         }
+        SetIndexBlock(myArows, ie*local_matrix_size, localArows, local_matrix_size);
+        SetIndexBlock(myAcols, ie*local_matrix_size, localAcols, local_matrix_size);
     }
     
+    ReleaseIndexData(elements, prhs[3]);
 }
 /*************************************************************************/
-void AssembleConvective(mxArray* plhs[], const mxArray* prhs[])
+void AssembleConvective(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     double* dim_ptr = mxGetPr(prhs[2]);
     int dim     = (int)(dim_ptr[0]);
     int noe     = mxGetN(prhs[3]);
     double* nln_ptrV = mxGetPr(prhs[4]);
     int nlnV     = (int)(nln_ptrV[0]);
-    int numRowsElements  = mxGetM(prhs[3]);
+    mwSize numRowsElements  = mxGetM(prhs[3]);
     
-    int local_matrix_size1 = nlnV*nlnV*dim;
-    int local_matrix_size2 = nlnV*nlnV*dim*dim;
+    mwSize local_matrix_size1 = nlnV*nlnV*dim;
+    mwSize local_matrix_size2 = nlnV*nlnV*dim*dim;
 
-    int global_lenght1 = noe * local_matrix_size1;
-    int global_lenght2 = noe * local_matrix_size2;
+    mwSize global_lenght1 = noe * local_matrix_size1;
+    mwSize global_lenght2 = noe * local_matrix_size2;
 
-    plhs[0] = mxCreateDoubleMatrix(global_lenght1,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(global_lenght1,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(global_lenght1,1, mxREAL);
+    CreateMatrixOutputs(plhs, global_lenght1, prhs[3], (dim+1) * mxGetScalar(prhs[5]) / dim, noe, coefFormat);
     
-    plhs[3] = mxCreateDoubleMatrix(global_lenght2,1, mxREAL);
-    plhs[4] = mxCreateDoubleMatrix(global_lenght2,1, mxREAL);
-    plhs[5] = mxCreateDoubleMatrix(global_lenght2,1, mxREAL);
+    plhs[3] = CreateIndexMatrix(global_lenght2, 1, prhs[3], (dim+1) * mxGetScalar(prhs[5]) / dim);
+    plhs[4] = CreateIndexMatrix(global_lenght2, 1, prhs[3], (dim+1) * mxGetScalar(prhs[5]) / dim);
+    plhs[5] = CreateCoefMatrix(global_lenght2,1, noe, coefFormat.single);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    double* myBrows    = mxGetPr(plhs[3]);
-    double* myBcols    = mxGetPr(plhs[4]);
-    double* myBcoef    = mxGetPr(plhs[5]);
+    IndexArray myBrows    = GetIndexArray(plhs[3]);
+    IndexArray myBcols    = GetIndexArray(plhs[4]);
+    CoefArray myBcoef  = GetCoefArray(plhs[5]);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
     
     double* NumNodes_ptr = mxGetPr(prhs[5]);
-    int NumScalarDofsV     = (int)(NumNodes_ptr[0] / dim);
+    long long NumScalarDofsV = (long long)(NumNodes_ptr[0] / dim);
     
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
     double* phiV = mxGetPr(prhs[9]);
-    double* gradrefphiV = mxGetPr(prhs[10]);
+    GeometryCache GeoCacheV = GetGeometryCache(prhs[10], prhs[7], dim, nlnV, NumQuadPoints, noe);
     double* U_h   = mxGetPr(prhs[11]);
     
     double gradphiV[dim][nlnV][NumQuadPoints];
-    double* elements  = mxGetPr(prhs[3]);
+    long long* elements  = GetIndexData(prhs[3]);
     
-    double GradV[dim][dim];
-    double GradU[dim][dim];
     double U_hq[dim][NumQuadPoints];
     double GradUh[dim][dim][NumQuadPoints];
     
@@ -347,31 +370,24 @@ void AssembleConvective(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie, d1, d2;
         
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myBrows,myBcols,myBcoef,U_h) private(gradphiV,GradV,GradU,GradUh,U_hq,ie,k,l,q,d1,d2) firstprivate(phiV,gradrefphiV,w,numRowsElements,local_matrix_size1,local_matrix_size2,nlnV,NumScalarDofsV,density)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,myBrows,myBcols,myBcoef,U_h) private(gradphiV,GradUh,U_hq,ie,k,q,d1,d2) firstprivate(phiV,w,numRowsElements,local_matrix_size1,local_matrix_size2,nlnV,NumScalarDofsV,density)
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localArows[local_matrix_size1], localAcols[local_matrix_size1];
+        long long localBrows[local_matrix_size2], localBcols[local_matrix_size2];
+
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nlnV; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiV[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiV[d1][k][q] = gradphiV[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHIV(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheV.PhysicalGradients(&GeoCacheV, ie, q, &gradphiV[0][0][q], nlnV*NumQuadPoints, NumQuadPoints);
             /* Compute U_h and Grad(U_h) on the quadrature nodes of the current element*/
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
                 U_hq[d1][q] = 0;
                 for (k = 0; k < nlnV; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                     U_hq[d1][q] = U_hq[d1][q] + U_h[e_k] * phiV[k+q*nlnV];
                 }
                 
@@ -380,8 +396,8 @@ void AssembleConvective(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[d1][d2][q] = 0;
                     for (k = 0; k < nlnV; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                         GradUh[d1][d2][q] = GradUh[d1][d2][q] + U_h[e_k] * gradphiV[d2][k][q];
                     }
                 }
@@ -409,9 +425,9 @@ void AssembleConvective(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size1+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size1+iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size1+iii] = density*aloc*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size1+iii, density*aloc*detjac[ie]);
                     
                     iii = iii + 1;
                 }
@@ -432,9 +448,9 @@ void AssembleConvective(mxArray* plhs[], const mxArray* prhs[])
                         {
                             aloc  = aloc + phiV[b+q*nlnV] * GradUh[i_c][j_c][q] * phiV[a+q*nlnV] * w[q];
                         }
-                        myBrows[ie*local_matrix_size2+iii2] = elements[a+ie*numRowsElements] + i_c * NumScalarDofsV;
-                        myBcols[ie*local_matrix_size2+iii2] = elements[b+ie*numRowsElements] + j_c * NumScalarDofsV;
-                        myBcoef[ie*local_matrix_size2+iii2] = density*aloc*detjac[ie];
+                        localBrows[iii2] = elements[a+ie*numRowsElements] + i_c * NumScalarDofsV;
+                        localBcols[iii2] = elements[b+ie*numRowsElements] + j_c * NumScalarDofsV;
+                        SetCoef(myBcoef, ie*local_matrix_size2+iii2, density*aloc*detjac[ie]);
                         
                         iii2 = iii2 + 1;
                         
@@ -443,56 +459,59 @@ void AssembleConvective(mxArray* plhs[], const mxArray* prhs[])
             }
                 
         }
+        SetIndexBlock(myArows, ie*local_matrix_size1, localArows, local_matrix_size1);
+        SetIndexBlock(myAcols, ie*local_matrix_size1, localAcols, local_matrix_size1);
+        SetIndexBlock(myBrows, ie*local_matrix_size2, localBrows, local_matrix_size2);
+        SetIndexBlock(myBcols, ie*local_matrix_size2, localBcols, local_matrix_size2);
     }
+    
+    ReleaseIndexData(elements, prhs[3]);
 }
 /*************************************************************************/
-void AssembleConvectiveALE(mxArray* plhs[], const mxArray* prhs[])
+void AssembleConvectiveALE(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     double* dim_ptr = mxGetPr(prhs[2]);
     int dim     = (int)(dim_ptr[0]);
     int noe     = mxGetN(prhs[3]);
     double* nln_ptrV = mxGetPr(prhs[4]);
     int nlnV     = (int)(nln_ptrV[0]);
-    int numRowsElements  = mxGetM(prhs[3]);
+    mwSize numRowsElements  = mxGetM(prhs[3]);
     
-    int local_matrix_size1 = nlnV*nlnV*dim;
-    int local_matrix_size2 = nlnV*nlnV*dim*dim;
+    mwSize local_matrix_size1 = nlnV*nlnV*dim;
+    mwSize local_matrix_size2 = nlnV*nlnV*dim*dim;
 
-    int global_lenght1 = noe * local_matrix_size1;
-    int global_lenght2 = noe * local_matrix_size2;
+    mwSize global_lenght1 = noe * local_matrix_size1;
+    mwSize global_lenght2 = noe * local_matrix_size2;
 
-    plhs[0] = mxCreateDoubleMatrix(global_lenght1,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(global_lenght1,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(global_lenght1,1, mxREAL);
+    CreateMatrixOutputs(plhs, global_lenght1, prhs[3], (dim+1) * mxGetScalar(prhs[5]) / dim, noe, coefFormat);
     
-    plhs[3] = mxCreateDoubleMatrix(global_lenght2,1, mxREAL);
-    plhs[4] = mxCreateDoubleMatrix(global_lenght2,1, mxREAL);
-    plhs[5] = mxCreateDoubleMatrix(global_lenght2,1, mxREAL);
+    plhs[3] = CreateIndexMatrix(global_lenght2, 1, prhs[3], (dim+1) * mxGetScalar(prhs[5]) / dim);
+    plhs[4] = CreateIndexMatrix(global_lenght2, 1, prhs[3], (dim+1) * mxGetScalar(prhs[5]) / dim);
+    plhs[5] = CreateCoefMatrix(global_lenght2,1, noe, coefFormat.single);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    double* myBrows    = mxGetPr(plhs[3]);
-    double* myBcols    = mxGetPr(plhs[4]);
-    double* myBcoef    = mxGetPr(plhs[5]);
+    IndexArray myBrows    = GetIndexArray(plhs[3]);
+    IndexArray myBcols    = GetIndexArray(plhs[4]);
+    CoefArray myBcoef  = GetCoefArray(plhs[5]);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
     
     double* NumNodes_ptr = mxGetPr(prhs[5]);
-    int NumScalarDofsV     = (int)(NumNodes_ptr[0] / dim);
+    long long NumScalarDofsV = (long long)(NumNodes_ptr[0] / dim);
     
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
     double* phiV = mxGetPr(prhs[9]);
-    double* gradrefphiV = mxGetPr(prhs[10]);
+    GeometryCache GeoCacheV = GetGeometryCache(prhs[10], prhs[7], dim, nlnV, NumQuadPoints, noe);
     double* U_h   = mxGetPr(prhs[11]);
     double* Conv_velocity   = mxGetPr(prhs[12]);
     
-    double* elements  = mxGetPr(prhs[3]);
+    long long* elements  = GetIndexData(prhs[3]);
     
     double* material_param = mxGetPr(prhs[1]);
     double density = material_param[0];
@@ -500,30 +519,21 @@ void AssembleConvectiveALE(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie, d1, d2;
         
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myBrows,myBcols,myBcoef,U_h,Conv_velocity) private(ie,k,l,q,d1,d2) firstprivate(phiV,gradrefphiV,w,numRowsElements,local_matrix_size1,local_matrix_size2,nlnV,NumScalarDofsV,density)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,myBrows,myBcols,myBcoef,U_h,Conv_velocity) private(ie,k,q,d1,d2) firstprivate(phiV,w,numRowsElements,local_matrix_size1,local_matrix_size2,nlnV,NumScalarDofsV,density)
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localArows[local_matrix_size1], localAcols[local_matrix_size1];
+        long long localBrows[local_matrix_size2], localBcols[local_matrix_size2];
+
         double gradphiV[dim][nlnV][NumQuadPoints];
         double U_hq[dim][NumQuadPoints];
-        double GradV[dim][dim];
-        double GradU[dim][dim];
         double GradUh[dim][dim][NumQuadPoints];
         double ConvVel_hq[dim][NumQuadPoints];
 
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nlnV; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiV[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiV[d1][k][q] = gradphiV[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHIV(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheV.PhysicalGradients(&GeoCacheV, ie, q, &gradphiV[0][0][q], nlnV*NumQuadPoints, NumQuadPoints);
             /* Compute U_h and Grad(U_h) on the quadrature nodes of the current element*/
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
@@ -531,8 +541,8 @@ void AssembleConvectiveALE(mxArray* plhs[], const mxArray* prhs[])
                 ConvVel_hq[d1][q] = 0;
                 for (k = 0; k < nlnV; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                     U_hq[d1][q] = U_hq[d1][q] + U_h[e_k] * phiV[k+q*nlnV];
                     ConvVel_hq[d1][q] = ConvVel_hq[d1][q] + Conv_velocity[e_k] * phiV[k+q*nlnV];
                 }
@@ -542,8 +552,8 @@ void AssembleConvectiveALE(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[d1][d2][q] = 0;
                     for (k = 0; k < nlnV; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                         GradUh[d1][d2][q] = GradUh[d1][d2][q] + U_h[e_k] * gradphiV[d2][k][q];
                     }
                 }
@@ -571,9 +581,9 @@ void AssembleConvectiveALE(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size1+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size1+iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size1+iii] = density*aloc*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size1+iii, density*aloc*detjac[ie]);
                     
                     iii = iii + 1;
                 }
@@ -594,9 +604,9 @@ void AssembleConvectiveALE(mxArray* plhs[], const mxArray* prhs[])
                         {
                             aloc  = aloc + phiV[b+q*nlnV] * GradUh[i_c][j_c][q] * phiV[a+q*nlnV] * w[q];
                         }
-                        myBrows[ie*local_matrix_size2+iii2] = elements[a+ie*numRowsElements] + i_c * NumScalarDofsV;
-                        myBcols[ie*local_matrix_size2+iii2] = elements[b+ie*numRowsElements] + j_c * NumScalarDofsV;
-                        myBcoef[ie*local_matrix_size2+iii2] = density*aloc*detjac[ie];
+                        localBrows[iii2] = elements[a+ie*numRowsElements] + i_c * NumScalarDofsV;
+                        localBcols[iii2] = elements[b+ie*numRowsElements] + j_c * NumScalarDofsV;
+                        SetCoef(myBcoef, ie*local_matrix_size2+iii2, density*aloc*detjac[ie]);
                         
                         iii2 = iii2 + 1;
                         
@@ -605,10 +615,16 @@ void AssembleConvectiveALE(mxArray* plhs[], const mxArray* prhs[])
             }
                 
         }
+        SetIndexBlock(myArows, ie*local_matrix_size1, localArows, local_matrix_size1);
+        SetIndexBlock(myAcols, ie*local_matrix_size1, localAcols, local_matrix_size1);
+        SetIndexBlock(myBrows, ie*local_matrix_size2, localBrows, local_matrix_size2);
+        SetIndexBlock(myBcols, ie*local_matrix_size2, localBcols, local_matrix_size2);
     }
+    
+    ReleaseIndexData(elements, prhs[3]);
 }
 /*************************************************************************/
-void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
+void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     double* dim_ptr = mxGetPr(prhs[1]);
     int dim     = (int)(dim_ptr[0]);
@@ -617,48 +633,43 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
     int nlnV     = (int)(nln_ptrV[0]);
     double* nln_ptrP = mxGetPr(prhs[9]);
     int nlnP     = (int)(nln_ptrP[0]);
-    int numRowsElements  = mxGetM(prhs[2]);
+    mwSize numRowsElements  = mxGetM(prhs[2]);
         
-    int nln  = nlnV + nlnP;
-    int nln2 = nln*nln;
-    int local_matrix_size = ( dim*nlnV + nlnP ) * ( dim*nlnV + nlnP );
-    int local_rhs_size = dim*nlnV + nlnP;
+    mwSize local_matrix_size = ( dim*nlnV + nlnP ) * ( dim*nlnV + nlnP );
+    mwSize local_rhs_size = dim*nlnV + nlnP;
 
-    plhs[0] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
+    CreateMatrixOutputs(plhs, noe*local_matrix_size, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim, noe, coefFormat);
     
-    plhs[3] = mxCreateDoubleMatrix(noe*local_rhs_size,1, mxREAL);
-    plhs[4] = mxCreateDoubleMatrix(noe*local_rhs_size,1, mxREAL);
+    plhs[3] = CreateIndexMatrix((mwSize) noe*local_rhs_size, 1, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim);
+    plhs[4] = CreateElementMatrix((mwSize) noe*local_rhs_size,1, noe);
         
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    double* myRrows    = mxGetPr(plhs[3]);
+    IndexArray myRrows    = GetIndexArray(plhs[3]);
     double* myRcoef    = mxGetPr(plhs[4]);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[5]);
     
     double* NumNodes_ptr = mxGetPr(prhs[10]);
-    int NumScalarDofsV     = (int)(NumNodes_ptr[0] / dim);
+    long long NumScalarDofsV = (long long)(NumNodes_ptr[0] / dim);
         
-    double* NumNodes_ptrP  = mxGetPr(prhs[11]);
-    int NumScalarDofsP     = (int)(NumNodes_ptrP[0]);
         
     double* w   = mxGetPr(prhs[5]);
     double* invjac = mxGetPr(prhs[4]);
+    int invjacStrideE, invjacStrideC;
+    GetInvJacStrides(prhs[4], dim, noe, &invjacStrideE, &invjacStrideC);
     double* detjac = mxGetPr(prhs[3]);
     double* phiV = mxGetPr(prhs[6]);
-    double* phiP = mxGetPr(prhs[12]);
-    double* gradrefphiV = mxGetPr(prhs[7]);
-    double* gradrefphiP = mxGetPr(prhs[19]);
+    GeometryCache GeoCacheV = GetGeometryCache(prhs[7], prhs[4], dim, nlnV, NumQuadPoints, noe);
+    GeometryCache GeoCacheP = GetGeometryCache(prhs[19], prhs[4], dim, nlnP, NumQuadPoints, noe);
     double* U_h   = mxGetPr(prhs[13]);
     double* v_n   = mxGetPr(prhs[14]);
     
-    double* elements  = mxGetPr(prhs[2]);
+    long long* elements  = GetIndexData(prhs[2]);
             
     double* tmp_ptr1 = mxGetPr(prhs[15]);
     double density = tmp_ptr1[0];
@@ -672,43 +683,25 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie, d1, d2;
     
-    #pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h,v_n) private(ie,k,l,q,d1,d2) firstprivate(phiV,gradrefphiV,gradrefphiP,w,numRowsElements,local_rhs_size,local_matrix_size,nlnV,nlnP,NumScalarDofsV,density,viscosity,dt,alpha)
+    #pragma omp parallel for schedule(runtime) shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h,v_n) private(ie,k,q,d1,d2) firstprivate(phiV,w,numRowsElements,local_rhs_size,local_matrix_size,nlnV,nlnP,NumScalarDofsV,density,viscosity,dt,alpha)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localArows[local_matrix_size], localAcols[local_matrix_size];
+        long long localRrows[local_rhs_size];
+
         double gradphiV[dim][nlnV][NumQuadPoints];
         double gradphiP[dim][nlnP][NumQuadPoints];
         double U_hq[NumQuadPoints][dim];
         double v_nq[NumQuadPoints][dim];
-        double GradUh[NumQuadPoints][dim][dim];
         
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Vel Basis functions*/
-            for (k = 0; k < nlnV; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiV[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiV[d1][k][q] = gradphiV[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHIV(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheV.PhysicalGradients(&GeoCacheV, ie, q, &gradphiV[0][0][q], nlnV*NumQuadPoints, NumQuadPoints);
 
             /* Compute Gradient of Pressure Basis functions*/
-            for (k = 0; k < nlnP; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiP[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiP[d1][k][q] = gradphiP[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHIP(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheP.PhysicalGradients(&GeoCacheP, ie, q, &gradphiP[0][0][q], nlnP*NumQuadPoints, NumQuadPoints);
             
             /* Compute U_h and Grad(U_h) on the quadrature nodes of the current element*/
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
@@ -717,8 +710,8 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
                 v_nq[q][d1] = 0;
                 for (k = 0; k < nlnV; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                     U_hq[q][d1] = U_hq[q][d1] + U_h[e_k] * phiV[k+q*nlnV];
                     v_nq[q][d1] = v_nq[q][d1] + v_n[e_k] * phiV[k+q*nlnV];
                 }
@@ -729,8 +722,8 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[q][d1][d2] = 0;
                     for (k = 0; k < nlnV; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                         GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphiV[d2][k][q];
                     }
                 }
@@ -770,7 +763,7 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
         
         int iii = 0;
         int ii = 0;
-        int a, b, i_c, j_c;
+        int a, b;
         double aloc;
         double rloc;
         
@@ -805,9 +798,9 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
                         {
                             aloc  += gradphiV[d1][a][q] * gradphiV[d2][b][q] * tauC[q] * w[q];
                         }
-                        myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                        myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
-                        myAcoef[ie*local_matrix_size+iii] = aloc*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
+                        SetCoef(myAcoef, ie*local_matrix_size+iii, aloc*detjac[ie]);
                         
                         tmp_index[d1][d2] = iii;
                         iii = iii + 1;
@@ -823,7 +816,7 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myAcoef[ie*local_matrix_size+tmp_index[d1][d1]] += aloc*detjac[ie];
+                    AddCoef(myAcoef, ie*local_matrix_size+tmp_index[d1][d1], aloc*detjac[ie]);
                 }
 
             }
@@ -845,7 +838,7 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
-                myRrows[ie*local_rhs_size+ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                localRrows[ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
                 myRcoef[ie*local_rhs_size+ii] = rloc_v[d1]*detjac[ie];
                 ii = ii + 1;
             }
@@ -867,9 +860,9 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
                 }
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = aloc_vp[d1]*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_vp[d1]*detjac[ie]);
                     iii = iii + 1;
                 }
             }
@@ -899,9 +892,9 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = aloc_pv[d1]*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_pv[d1]*detjac[ie]);
                     iii = iii + 1;
                 }
             }
@@ -917,9 +910,9 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
                         aloc  += gradphiP[d1][a][q] * gradphiP[d1][b][q] * tauM[q] * w[q];
                     }
                 }
-                myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
-                myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
-                myAcoef[ie*local_matrix_size+iii] = aloc*detjac[ie];
+                localArows[iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+                localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                SetCoef(myAcoef, ie*local_matrix_size+iii, aloc*detjac[ie]);
                 iii = iii + 1;
             }
            
@@ -931,15 +924,19 @@ void AssembleSUPG_SemiImplicit(mxArray* plhs[], const mxArray* prhs[])
                     rloc += tauM[q] * ( - density / dt * v_nq[q][d1] ) * gradphiP[d1][a][q] * w[q];
                 }
             }
-            myRrows[ie*local_rhs_size+ii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+            localRrows[ii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
             myRcoef[ie*local_rhs_size+ii] = rloc*detjac[ie];
             ii = ii + 1;
         }
+        SetIndexBlock(myArows, ie*local_matrix_size, localArows, local_matrix_size);
+        SetIndexBlock(myAcols, ie*local_matrix_size, localAcols, local_matrix_size);
+        SetIndexBlock(myRrows, ie*local_rhs_size, localRrows, local_rhs_size);
     }
     
+    ReleaseIndexData(elements, prhs[2]);
 }
 /*************************************************************************/
-void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
+void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[], const int computeJacobian, const CoefFormat coefFormat)
 {
     double* dim_ptr = mxGetPr(prhs[1]);
     int dim     = (int)(dim_ptr[0]);
@@ -948,48 +945,57 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
     int nlnV     = (int)(nln_ptrV[0]);
     double* nln_ptrP = mxGetPr(prhs[9]);
     int nlnP     = (int)(nln_ptrP[0]);
-    int numRowsElements  = mxGetM(prhs[2]);
+    mwSize numRowsElements  = mxGetM(prhs[2]);
         
-    int nln  = nlnV + nlnP;
-    int nln2 = nln*nln;
-    int local_matrix_size = ( dim*nlnV + nlnP ) * ( dim*nlnV + nlnP );
-    int local_rhs_size = dim*nlnV + nlnP;
+    mwSize local_matrix_size = ( dim*nlnV + nlnP ) * ( dim*nlnV + nlnP );
+    mwSize local_rhs_size = dim*nlnV + nlnP;
 
-    plhs[0] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
+    /* without the jacobian, the residual is returned in plhs[0] and plhs[1] */
+    int outR = 0;
+    IndexArray myArows = {NULL, NULL, NULL};
+    IndexArray myAcols = {NULL, NULL, NULL};
+    CoefArray myAcoef  = {NULL, NULL};
     
-    plhs[3] = mxCreateDoubleMatrix(noe*local_rhs_size,1, mxREAL);
-    plhs[4] = mxCreateDoubleMatrix(noe*local_rhs_size,1, mxREAL);
+    if (computeJacobian)
+    {
+        CreateMatrixOutputs(plhs, noe*local_matrix_size, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim, noe, coefFormat);
         
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+        myArows    = GetIndexArray(plhs[0]);
+        myAcols    = GetIndexArray(plhs[1]);
+        myAcoef    = GetMatrixCoefArray(plhs[2], coefFormat);
+        outR       = 3;
+    }
     
-    double* myRrows    = mxGetPr(plhs[3]);
-    double* myRcoef    = mxGetPr(plhs[4]);
+    plhs[outR]   = CreateIndexMatrix((mwSize) noe*local_rhs_size, 1, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim);
+    plhs[outR+1] = CreateElementMatrix((mwSize) noe*local_rhs_size,1, noe);
+    
+    IndexArray myRrows    = GetIndexArray(plhs[outR]);
+    double* myRcoef    = mxGetPr(plhs[outR+1]);
     
-    int k,l;
+    /* the loops over the trial functions are skipped if only the residual is required */
+    int nlnVtrial = computeJacobian ? nlnV : 0;
+    int nlnPtrial = computeJacobian ? nlnP : 0;
+    
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[5]);
     
     double* NumNodes_ptr = mxGetPr(prhs[10]);
-    int NumScalarDofsV     = (int)(NumNodes_ptr[0] / dim);
+    long long NumScalarDofsV = (long long)(NumNodes_ptr[0] / dim);
         
-    double* NumNodes_ptrP  = mxGetPr(prhs[11]);
-    int NumScalarDofsP     = (int)(NumNodes_ptrP[0]);
         
     double* w   = mxGetPr(prhs[5]);
     double* invjac = mxGetPr(prhs[4]);
+    int invjacStrideE, invjacStrideC;
+    GetInvJacStrides(prhs[4], dim, noe, &invjacStrideE, &invjacStrideC);
     double* detjac = mxGetPr(prhs[3]);
     double* phiV = mxGetPr(prhs[6]);
-    double* phiP = mxGetPr(prhs[12]);
-    double* gradrefphiV = mxGetPr(prhs[7]);
-    double* gradrefphiP = mxGetPr(prhs[19]);
+    GeometryCache GeoCacheV = GetGeometryCache(prhs[7], prhs[4], dim, nlnV, NumQuadPoints, noe);
+    GeometryCache GeoCacheP = GetGeometryCache(prhs[19], prhs[4], dim, nlnP, NumQuadPoints, noe);
     double* U_h   = mxGetPr(prhs[13]);
     double* v_n   = mxGetPr(prhs[14]);
     
-    double* elements  = mxGetPr(prhs[2]);
+    long long* elements  = GetIndexData(prhs[2]);
             
     double* tmp_ptr1 = mxGetPr(prhs[15]);
     double density = tmp_ptr1[0];
@@ -1003,10 +1009,13 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie, d1, d2;
     
-    #pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h,v_n) private(ie,k,l,q,d1,d2) firstprivate(phiV,gradrefphiV,gradrefphiP,w,numRowsElements,local_rhs_size,local_matrix_size,nlnV,nlnP,NumScalarDofsV,density,viscosity,dt,alpha)
+    #pragma omp parallel for schedule(runtime) shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h,v_n) private(ie,k,q,d1,d2) firstprivate(phiV,w,numRowsElements,local_rhs_size,local_matrix_size,nlnV,nlnP,NumScalarDofsV,density,viscosity,dt,alpha)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localArows[local_matrix_size], localAcols[local_matrix_size];
+        long long localRrows[local_rhs_size];
+
         double gradphiV[dim][nlnV][NumQuadPoints];
         double gradphiP[dim][nlnP][NumQuadPoints];
         double U_hq[NumQuadPoints][dim];
@@ -1017,30 +1026,10 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Vel Basis functions*/
-            for (k = 0; k < nlnV; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiV[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiV[d1][k][q] = gradphiV[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHIV(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheV.PhysicalGradients(&GeoCacheV, ie, q, &gradphiV[0][0][q], nlnV*NumQuadPoints, NumQuadPoints);
 
             /* Compute Gradient of Pressure Basis functions*/
-            for (k = 0; k < nlnP; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiP[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiP[d1][k][q] = gradphiP[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHIP(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheP.PhysicalGradients(&GeoCacheP, ie, q, &gradphiP[0][0][q], nlnP*NumQuadPoints, NumQuadPoints);
             
             /* Compute U_h and Grad(U_h) on the quadrature nodes of the current element*/
             /* Compute Grad( p_h ) on the quadrature nodes of the current element*/
@@ -1050,8 +1039,8 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
                 v_nq[q][d1] = 0;
                 for (k = 0; k < nlnV; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                     U_hq[q][d1] = U_hq[q][d1] + U_h[e_k] * phiV[k+q*nlnV];
                     v_nq[q][d1] = v_nq[q][d1] + v_n[e_k] * phiV[k+q*nlnV];
                 }
@@ -1061,8 +1050,8 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[q][d1][d2] = 0;
                     for (k = 0; k < nlnV; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                         GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphiV[d2][k][q];
                     }
                 }
@@ -1070,8 +1059,8 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
                 GradPh[q][d1] = 0;
                 for (k = 0; k < nlnP; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + dim*NumScalarDofsV - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + dim*NumScalarDofsV - 1;
                     GradPh[q][d1] = GradPh[q][d1] + U_h[e_k] * gradphiP[d1][k][q];
                 }
 
@@ -1141,7 +1130,7 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
         
         int iii = 0;
         int ii = 0;
-        int a, b, i_c, j_c;
+        int a, b;
         double aloc;
         double rloc;
         
@@ -1151,7 +1140,7 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
         for (a = 0; a < nlnV; a = a + 1 )
         {
             /* loop over velocity trial functions --> b */
-            for (b = 0; b < nlnV; b = b + 1 )
+            for (b = 0; b < nlnVtrial; b = b + 1 )
             {
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
@@ -1167,9 +1156,9 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
                                        ) 
                                        * w[q];
                         }
-                        myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                        myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
-                        myAcoef[ie*local_matrix_size+iii] = aloc*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
+                        SetCoef(myAcoef, ie*local_matrix_size+iii, aloc*detjac[ie]);
                         
                         tmp_index[d1][d2] = iii;
                         iii = iii + 1;
@@ -1185,7 +1174,7 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myAcoef[ie*local_matrix_size+tmp_index[d1][d1]] += aloc*detjac[ie];
+                    AddCoef(myAcoef, ie*local_matrix_size+tmp_index[d1][d1], aloc*detjac[ie]);
                 }
 
             }
@@ -1208,14 +1197,14 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
-                myRrows[ie*local_rhs_size+ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                localRrows[ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
                 myRcoef[ie*local_rhs_size+ii] = rloc_v[d1]*detjac[ie];
                 ii = ii + 1;
             }
             
             /* loop over pressure trial functions --> b */
             double aloc_vp[dim];
-            for (b = 0; b < nlnP; b = b + 1 )
+            for (b = 0; b < nlnPtrial; b = b + 1 )
             {
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
@@ -1231,9 +1220,9 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
                 }
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = aloc_vp[d1]*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_vp[d1]*detjac[ie]);
                     iii = iii + 1;
                 }
             }
@@ -1245,7 +1234,7 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
         {
             double aloc_pv[dim];
             /* loop over velocity trial functions --> b */
-            for (b = 0; b < nlnV; b = b + 1 )
+            for (b = 0; b < nlnVtrial; b = b + 1 )
             {
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
@@ -1267,15 +1256,15 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = aloc_pv[d1]*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_pv[d1]*detjac[ie]);
                     iii = iii + 1;
                 }
             }
             
             /* loop over pressure trial functions --> b */
-            for (b = 0; b < nlnP; b = b + 1 )
+            for (b = 0; b < nlnPtrial; b = b + 1 )
             {
                 aloc = 0;
                 for (q = 0; q < NumQuadPoints; q = q + 1 )
@@ -1285,9 +1274,9 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
                         aloc  += gradphiP[d1][a][q] * gradphiP[d1][b][q] * tauM[q] * w[q];
                     }
                 }
-                myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
-                myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
-                myAcoef[ie*local_matrix_size+iii] = aloc*detjac[ie];
+                localArows[iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+                localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                SetCoef(myAcoef, ie*local_matrix_size+iii, aloc*detjac[ie]);
                 iii = iii + 1;
             }
            
@@ -1299,15 +1288,22 @@ void AssembleSUPG_Implicit(mxArray* plhs[], const mxArray* prhs[])
                     rloc += tauM[q] * Res_M[d1][q] * gradphiP[d1][a][q] * w[q];
                 }
             }
-            myRrows[ie*local_rhs_size+ii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+            localRrows[ii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
             myRcoef[ie*local_rhs_size+ii] = rloc*detjac[ie];
             ii = ii + 1;
         }
+        if (computeJacobian)
+        {
+            SetIndexBlock(myArows, ie*local_matrix_size, localArows, local_matrix_size);
+            SetIndexBlock(myAcols, ie*local_matrix_size, localAcols, local_matrix_size);
+        }
+        SetIndexBlock(myRrows, ie*local_rhs_size, localRrows, local_rhs_size);
     }
     
+    ReleaseIndexData(elements, prhs[2]);
 }
 /*************************************************************************/
-void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
+void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[], const int computeJacobian, const CoefFormat coefFormat)
 {
     double* dim_ptr = mxGetPr(prhs[1]);
     int dim     = (int)(dim_ptr[0]);
@@ -1316,49 +1312,58 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
     int nlnV     = (int)(nln_ptrV[0]);
     double* nln_ptrP = mxGetPr(prhs[9]);
     int nlnP     = (int)(nln_ptrP[0]);
-    int numRowsElements  = mxGetM(prhs[2]);
+    mwSize numRowsElements  = mxGetM(prhs[2]);
         
-    int nln  = nlnV + nlnP;
-    int nln2 = nln*nln;
-    int local_matrix_size = ( dim*nlnV + nlnP ) * ( dim*nlnV + nlnP );
-    int local_rhs_size = dim*nlnV + nlnP;
+    mwSize local_matrix_size = ( dim*nlnV + nlnP ) * ( dim*nlnV + nlnP );
+    mwSize local_rhs_size = dim*nlnV + nlnP;
 
-    plhs[0] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
+    /* without the jacobian, the residual is returned in plhs[0] and plhs[1] */
+    int outR = 0;
+    IndexArray myArows = {NULL, NULL, NULL};
+    IndexArray myAcols = {NULL, NULL, NULL};
+    CoefArray myAcoef  = {NULL, NULL};
     
-    plhs[3] = mxCreateDoubleMatrix(noe*local_rhs_size,1, mxREAL);
-    plhs[4] = mxCreateDoubleMatrix(noe*local_rhs_size,1, mxREAL);
+    if (computeJacobian)
+    {
+        CreateMatrixOutputs(plhs, noe*local_matrix_size, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim, noe, coefFormat);
         
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+        myArows    = GetIndexArray(plhs[0]);
+        myAcols    = GetIndexArray(plhs[1]);
+        myAcoef    = GetMatrixCoefArray(plhs[2], coefFormat);
+        outR       = 3;
+    }
     
-    double* myRrows    = mxGetPr(plhs[3]);
-    double* myRcoef    = mxGetPr(plhs[4]);
+    plhs[outR]   = CreateIndexMatrix((mwSize) noe*local_rhs_size, 1, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim);
+    plhs[outR+1] = CreateElementMatrix((mwSize) noe*local_rhs_size,1, noe);
     
-    int k,l;
+    IndexArray myRrows    = GetIndexArray(plhs[outR]);
+    double* myRcoef    = mxGetPr(plhs[outR+1]);
+    
+    /* the loops over the trial functions are skipped if only the residual is required */
+    int nlnVtrial = computeJacobian ? nlnV : 0;
+    int nlnPtrial = computeJacobian ? nlnP : 0;
+    
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[5]);
     
     double* NumNodes_ptr = mxGetPr(prhs[10]);
-    int NumScalarDofsV     = (int)(NumNodes_ptr[0] / dim);
+    long long NumScalarDofsV = (long long)(NumNodes_ptr[0] / dim);
         
-    double* NumNodes_ptrP  = mxGetPr(prhs[11]);
-    int NumScalarDofsP     = (int)(NumNodes_ptrP[0]);
         
     double* w   = mxGetPr(prhs[5]);
     double* invjac = mxGetPr(prhs[4]);
+    int invjacStrideE, invjacStrideC;
+    GetInvJacStrides(prhs[4], dim, noe, &invjacStrideE, &invjacStrideC);
     double* detjac = mxGetPr(prhs[3]);
     double* phiV = mxGetPr(prhs[6]);
-    double* phiP = mxGetPr(prhs[12]);
-    double* gradrefphiV = mxGetPr(prhs[7]);
-    double* gradrefphiP = mxGetPr(prhs[19]);
+    GeometryCache GeoCacheV = GetGeometryCache(prhs[7], prhs[4], dim, nlnV, NumQuadPoints, noe);
+    GeometryCache GeoCacheP = GetGeometryCache(prhs[19], prhs[4], dim, nlnP, NumQuadPoints, noe);
     double* U_h   = mxGetPr(prhs[13]);
     double* v_n   = mxGetPr(prhs[14]);
     double* Conv_velocity   = mxGetPr(prhs[20]);
     
-    double* elements  = mxGetPr(prhs[2]);
+    long long* elements  = GetIndexData(prhs[2]);
             
     double* tmp_ptr1 = mxGetPr(prhs[15]);
     double density = tmp_ptr1[0];
@@ -1374,10 +1379,13 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie, d1, d2;
     
-    #pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h,v_n,Conv_velocity) private(ie,k,l,q,d1,d2) firstprivate(phiV,gradrefphiV,gradrefphiP,w,numRowsElements,local_rhs_size,local_matrix_size,nlnV,nlnP,NumScalarDofsV,density,viscosity,dt,alpha)
+    #pragma omp parallel for schedule(runtime) shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h,v_n,Conv_velocity) private(ie,k,q,d1,d2) firstprivate(phiV,w,numRowsElements,local_rhs_size,local_matrix_size,nlnV,nlnP,NumScalarDofsV,density,viscosity,dt,alpha)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localArows[local_matrix_size], localAcols[local_matrix_size];
+        long long localRrows[local_rhs_size];
+
         double gradphiV[dim][nlnV][NumQuadPoints];
         double gradphiP[dim][nlnP][NumQuadPoints];
         double U_hq[NumQuadPoints][dim];
@@ -1389,30 +1397,10 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Vel Basis functions*/
-            for (k = 0; k < nlnV; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiV[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiV[d1][k][q] = gradphiV[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHIV(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheV.PhysicalGradients(&GeoCacheV, ie, q, &gradphiV[0][0][q], nlnV*NumQuadPoints, NumQuadPoints);
 
             /* Compute Gradient of Pressure Basis functions*/
-            for (k = 0; k < nlnP; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiP[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiP[d1][k][q] = gradphiP[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHIP(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheP.PhysicalGradients(&GeoCacheP, ie, q, &gradphiP[0][0][q], nlnP*NumQuadPoints, NumQuadPoints);
             
             /* Compute U_h and Grad(U_h) on the quadrature nodes of the current element*/
             /* Compute Grad( p_h ) on the quadrature nodes of the current element*/
@@ -1423,8 +1411,8 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
                 ConvVel_hq[q][d1] = 0;
                 for (k = 0; k < nlnV; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                     U_hq[q][d1] = U_hq[q][d1] + U_h[e_k] * phiV[k+q*nlnV];
                     v_nq[q][d1] = v_nq[q][d1] + v_n[e_k] * phiV[k+q*nlnV];
                     ConvVel_hq[q][d1] = ConvVel_hq[q][d1] + Conv_velocity[e_k] * phiV[k+q*nlnV];
@@ -1435,8 +1423,8 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[q][d1][d2] = 0;
                     for (k = 0; k < nlnV; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                         GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphiV[d2][k][q];
                     }
                 }
@@ -1444,8 +1432,8 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
                 GradPh[q][d1] = 0;
                 for (k = 0; k < nlnP; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + dim*NumScalarDofsV - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + dim*NumScalarDofsV - 1;
                     GradPh[q][d1] = GradPh[q][d1] + U_h[e_k] * gradphiP[d1][k][q];
                 }
 
@@ -1515,7 +1503,7 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
         
         int iii = 0;
         int ii = 0;
-        int a, b, i_c, j_c;
+        int a, b;
         double aloc;
         double rloc;
         
@@ -1525,7 +1513,7 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
         for (a = 0; a < nlnV; a = a + 1 )
         {
             /* loop over velocity trial functions --> b */
-            for (b = 0; b < nlnV; b = b + 1 )
+            for (b = 0; b < nlnVtrial; b = b + 1 )
             {
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
@@ -1541,9 +1529,9 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
                                        ) 
                                        * w[q];
                         }
-                        myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                        myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
-                        myAcoef[ie*local_matrix_size+iii] = aloc*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
+                        SetCoef(myAcoef, ie*local_matrix_size+iii, aloc*detjac[ie]);
                         
                         tmp_index[d1][d2] = iii;
                         iii = iii + 1;
@@ -1559,7 +1547,7 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myAcoef[ie*local_matrix_size+tmp_index[d1][d1]] += aloc*detjac[ie];
+                    AddCoef(myAcoef, ie*local_matrix_size+tmp_index[d1][d1], aloc*detjac[ie]);
                 }
 
             }
@@ -1582,14 +1570,14 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
-                myRrows[ie*local_rhs_size+ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                localRrows[ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
                 myRcoef[ie*local_rhs_size+ii] = rloc_v[d1]*detjac[ie];
                 ii = ii + 1;
             }
             
             /* loop over pressure trial functions --> b */
             double aloc_vp[dim];
-            for (b = 0; b < nlnP; b = b + 1 )
+            for (b = 0; b < nlnPtrial; b = b + 1 )
             {
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
@@ -1605,9 +1593,9 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
                 }
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = aloc_vp[d1]*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_vp[d1]*detjac[ie]);
                     iii = iii + 1;
                 }
             }
@@ -1619,7 +1607,7 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
         {
             double aloc_pv[dim];
             /* loop over velocity trial functions --> b */
-            for (b = 0; b < nlnV; b = b + 1 )
+            for (b = 0; b < nlnVtrial; b = b + 1 )
             {
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
@@ -1641,15 +1629,15 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = aloc_pv[d1]*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_pv[d1]*detjac[ie]);
                     iii = iii + 1;
                 }
             }
             
             /* loop over pressure trial functions --> b */
-            for (b = 0; b < nlnP; b = b + 1 )
+            for (b = 0; b < nlnPtrial; b = b + 1 )
             {
                 aloc = 0;
                 for (q = 0; q < NumQuadPoints; q = q + 1 )
@@ -1659,9 +1647,9 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
                         aloc  += gradphiP[d1][a][q] * gradphiP[d1][b][q] * tauM[q] * w[q];
                     }
                 }
-                myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
-                myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
-                myAcoef[ie*local_matrix_size+iii] = aloc*detjac[ie];
+                localArows[iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+                localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                SetCoef(myAcoef, ie*local_matrix_size+iii, aloc*detjac[ie]);
                 iii = iii + 1;
             }
            
@@ -1673,16 +1661,23 @@ void AssembleSUPG_ImplicitALE(mxArray* plhs[], const mxArray* prhs[])
                     rloc += tauM[q] * Res_M[d1][q] * gradphiP[d1][a][q] * w[q];
                 }
             }
-            myRrows[ie*local_rhs_size+ii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+            localRrows[ii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
             myRcoef[ie*local_rhs_size+ii] = rloc*detjac[ie];
             ii = ii + 1;
         }
+        if (computeJacobian)
+        {
+            SetIndexBlock(myArows, ie*local_matrix_size, localArows, local_matrix_size);
+            SetIndexBlock(myAcols, ie*local_matrix_size, localAcols, local_matrix_size);
+        }
+        SetIndexBlock(myRrows, ie*local_rhs_size, localRrows, local_rhs_size);
     }
     
+    ReleaseIndexData(elements, prhs[2]);
 }
 
 /*************************************************************************/
-void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
+void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[], const int computeJacobian, const CoefFormat coefFormat)
 {
     double* dim_ptr = mxGetPr(prhs[1]);
     int dim     = (int)(dim_ptr[0]);
@@ -1691,47 +1686,56 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
     int nlnV     = (int)(nln_ptrV[0]);
     double* nln_ptrP = mxGetPr(prhs[9]);
     int nlnP     = (int)(nln_ptrP[0]);
-    int numRowsElements  = mxGetM(prhs[2]);
+    mwSize numRowsElements  = mxGetM(prhs[2]);
         
-    int nln  = nlnV + nlnP;
-    int nln2 = nln*nln;
-    int local_matrix_size = ( dim*nlnV + nlnP ) * ( dim*nlnV + nlnP );
-    int local_rhs_size = dim*nlnV + nlnP;
+    mwSize local_matrix_size = ( dim*nlnV + nlnP ) * ( dim*nlnV + nlnP );
+    mwSize local_rhs_size = dim*nlnV + nlnP;
 
-    plhs[0] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(noe*local_matrix_size,1, mxREAL);
+    /* without the jacobian, the residual is returned in plhs[0] and plhs[1] */
+    int outR = 0;
+    IndexArray myArows = {NULL, NULL, NULL};
+    IndexArray myAcols = {NULL, NULL, NULL};
+    CoefArray myAcoef  = {NULL, NULL};
     
-    plhs[3] = mxCreateDoubleMatrix(noe*local_rhs_size,1, mxREAL);
-    plhs[4] = mxCreateDoubleMatrix(noe*local_rhs_size,1, mxREAL);
+    if (computeJacobian)
+    {
+        CreateMatrixOutputs(plhs, noe*local_matrix_size, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim, noe, coefFormat);
         
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+        myArows    = GetIndexArray(plhs[0]);
+        myAcols    = GetIndexArray(plhs[1]);
+        myAcoef    = GetMatrixCoefArray(plhs[2], coefFormat);
+        outR       = 3;
+    }
     
-    double* myRrows    = mxGetPr(plhs[3]);
-    double* myRcoef    = mxGetPr(plhs[4]);
+    plhs[outR]   = CreateIndexMatrix((mwSize) noe*local_rhs_size, 1, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim);
+    plhs[outR+1] = CreateElementMatrix((mwSize) noe*local_rhs_size,1, noe);
+    
+    IndexArray myRrows    = GetIndexArray(plhs[outR]);
+    double* myRcoef    = mxGetPr(plhs[outR+1]);
     
-    int k,l;
+    /* the loops over the trial functions are skipped if only the residual is required */
+    int nlnVtrial = computeJacobian ? nlnV : 0;
+    int nlnPtrial = computeJacobian ? nlnP : 0;
+    
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[5]);
     
     double* NumNodes_ptr = mxGetPr(prhs[10]);
-    int NumScalarDofsV     = (int)(NumNodes_ptr[0] / dim);
+    long long NumScalarDofsV = (long long)(NumNodes_ptr[0] / dim);
         
-    double* NumNodes_ptrP  = mxGetPr(prhs[11]);
-    int NumScalarDofsP     = (int)(NumNodes_ptrP[0]);
         
     double* w   = mxGetPr(prhs[5]);
     double* invjac = mxGetPr(prhs[4]);
+    int invjacStrideE, invjacStrideC;
+    GetInvJacStrides(prhs[4], dim, noe, &invjacStrideE, &invjacStrideC);
     double* detjac = mxGetPr(prhs[3]);
     double* phiV = mxGetPr(prhs[6]);
-    double* phiP = mxGetPr(prhs[12]);
-    double* gradrefphiV = mxGetPr(prhs[7]);
-    double* gradrefphiP = mxGetPr(prhs[16]);
+    GeometryCache GeoCacheV = GetGeometryCache(prhs[7], prhs[4], dim, nlnV, NumQuadPoints, noe);
+    GeometryCache GeoCacheP = GetGeometryCache(prhs[16], prhs[4], dim, nlnP, NumQuadPoints, noe);
     double* U_h   = mxGetPr(prhs[13]);
     
-    double* elements  = mxGetPr(prhs[2]);
+    long long* elements  = GetIndexData(prhs[2]);
             
     double* tmp_ptr1 = mxGetPr(prhs[14]);
     double density = tmp_ptr1[0];
@@ -1741,10 +1745,13 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie, d1, d2;
     
-    #pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phiV,gradrefphiV,gradrefphiP,w,numRowsElements,local_rhs_size,local_matrix_size,nlnV,nlnP,NumScalarDofsV,density,viscosity)
+    #pragma omp parallel for schedule(runtime) shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h) private(ie,k,q,d1,d2) firstprivate(phiV,w,numRowsElements,local_rhs_size,local_matrix_size,nlnV,nlnP,NumScalarDofsV,density,viscosity)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localArows[local_matrix_size], localAcols[local_matrix_size];
+        long long localRrows[local_rhs_size];
+
         double gradphiV[dim][nlnV][NumQuadPoints];
         double gradphiP[dim][nlnP][NumQuadPoints];
         double U_hq[NumQuadPoints][dim];
@@ -1754,30 +1761,10 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Vel Basis functions*/
-            for (k = 0; k < nlnV; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiV[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiV[d1][k][q] = gradphiV[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHIV(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheV.PhysicalGradients(&GeoCacheV, ie, q, &gradphiV[0][0][q], nlnV*NumQuadPoints, NumQuadPoints);
 
             /* Compute Gradient of Pressure Basis functions*/
-            for (k = 0; k < nlnP; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphiP[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphiP[d1][k][q] = gradphiP[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHIP(k,q,d2);
-                    }
-                }
-            }
+            GeoCacheP.PhysicalGradients(&GeoCacheP, ie, q, &gradphiP[0][0][q], nlnP*NumQuadPoints, NumQuadPoints);
             
             /* Compute U_h and Grad(U_h) on the quadrature nodes of the current element*/
             /* Compute Grad( p_h ) on the quadrature nodes of the current element*/
@@ -1786,8 +1773,8 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
                 U_hq[q][d1] = 0;
                 for (k = 0; k < nlnV; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                     U_hq[q][d1] = U_hq[q][d1] + U_h[e_k] * phiV[k+q*nlnV];
                 }
                 
@@ -1796,8 +1783,8 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[q][d1][d2] = 0;
                     for (k = 0; k < nlnV; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
                         GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphiV[d2][k][q];
                     }
                 }
@@ -1805,8 +1792,8 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
                 GradPh[q][d1] = 0;
                 for (k = 0; k < nlnP; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + dim*NumScalarDofsV - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + dim*NumScalarDofsV - 1;
                     GradPh[q][d1] = GradPh[q][d1] + U_h[e_k] * gradphiP[d1][k][q];
                 }
 
@@ -1876,7 +1863,7 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
         
         int iii = 0;
         int ii = 0;
-        int a, b, i_c, j_c;
+        int a, b;
         double aloc;
         double rloc;
         
@@ -1886,7 +1873,7 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
         for (a = 0; a < nlnV; a = a + 1 )
         {
             /* loop over velocity trial functions --> b */
-            for (b = 0; b < nlnV; b = b + 1 )
+            for (b = 0; b < nlnVtrial; b = b + 1 )
             {
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
@@ -1902,9 +1889,9 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
                                        ) 
                                        * w[q];
                         }
-                        myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                        myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
-                        myAcoef[ie*local_matrix_size+iii] = aloc*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
+                        SetCoef(myAcoef, ie*local_matrix_size+iii, aloc*detjac[ie]);
                         
                         tmp_index[d1][d2] = iii;
                         iii = iii + 1;
@@ -1920,7 +1907,7 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myAcoef[ie*local_matrix_size+tmp_index[d1][d1]] += aloc*detjac[ie];
+                    AddCoef(myAcoef, ie*local_matrix_size+tmp_index[d1][d1], aloc*detjac[ie]);
                 }
 
             }
@@ -1943,14 +1930,14 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
-                myRrows[ie*local_rhs_size+ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                localRrows[ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
                 myRcoef[ie*local_rhs_size+ii] = rloc_v[d1]*detjac[ie];
                 ii = ii + 1;
             }
             
             /* loop over pressure trial functions --> b */
             double aloc_vp[dim];
-            for (b = 0; b < nlnP; b = b + 1 )
+            for (b = 0; b < nlnPtrial; b = b + 1 )
             {
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
@@ -1966,9 +1953,9 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
                 }
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = aloc_vp[d1]*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_vp[d1]*detjac[ie]);
                     iii = iii + 1;
                 }
             }
@@ -1980,7 +1967,7 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
         {
             double aloc_pv[dim];
             /* loop over velocity trial functions --> b */
-            for (b = 0; b < nlnV; b = b + 1 )
+            for (b = 0; b < nlnVtrial; b = b + 1 )
             {
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
@@ -2002,15 +1989,15 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
                 
                 for (d1 = 0; d1 < dim; d1 = d1 + 1 )
                 {
-                    myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
-                    myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
-                    myAcoef[ie*local_matrix_size+iii] = aloc_pv[d1]*detjac[ie];
+                    localArows[iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_pv[d1]*detjac[ie]);
                     iii = iii + 1;
                 }
             }
             
             /* loop over pressure trial functions --> b */
-            for (b = 0; b < nlnP; b = b + 1 )
+            for (b = 0; b < nlnPtrial; b = b + 1 )
             {
                 aloc = 0;
                 for (q = 0; q < NumQuadPoints; q = q + 1 )
@@ -2020,9 +2007,9 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
                         aloc  += gradphiP[d1][a][q] * gradphiP[d1][b][q] * tauM[q] * w[q];
                     }
                 }
-                myArows[ie*local_matrix_size+iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
-                myAcols[ie*local_matrix_size+iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
-                myAcoef[ie*local_matrix_size+iii] = aloc*detjac[ie];
+                localArows[iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+                localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                SetCoef(myAcoef, ie*local_matrix_size+iii, aloc*detjac[ie]);
                 iii = iii + 1;
             }
            
@@ -2034,79 +2021,866 @@ void AssembleSUPG_ImplicitSteady(mxArray* plhs[], const mxArray* prhs[])
                     rloc += tauM[q] * Res_M[d1][q] * gradphiP[d1][a][q] * w[q];
                 }
             }
-            myRrows[ie*local_rhs_size+ii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+            localRrows[ii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
             myRcoef[ie*local_rhs_size+ii] = rloc*detjac[ie];
             ii = ii + 1;
         }
+        if (computeJacobian)
+        {
+            SetIndexBlock(myArows, ie*local_matrix_size, localArows, local_matrix_size);
+            SetIndexBlock(myAcols, ie*local_matrix_size, localAcols, local_matrix_size);
+        }
+        SetIndexBlock(myRrows, ie*local_rhs_size, localRrows, local_rhs_size);
     }
     
+    ReleaseIndexData(elements, prhs[2]);
 }
 
 /*************************************************************************/
-void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+/* Matrix-free jacobian-vector product of the Navier-Stokes (+ SUPG)
+ * equations for the implicit BDF scheme:
+ * J(U_k) X = (alpha/dt M + S + C1 + C2 [+ dG_SUPG]) X
+ * The elemental contributions are returned in sparse vector format: no
+ * matrix is formed. The residual is given by NS_NewtonStep_residual */
+void AssembleNS_MatrixFree(mxArray* plhs[], const mxArray* prhs[])
 {
-    
-    char *Assembly_name = mxArrayToString(prhs[0]);
-            
-    if (strcmp(Assembly_name, "Stokes")==0)
-    {
-        /* Check for proper number of arguments */
-        if(nrhs!=13) {
-            mexErrMsgTxt("13 inputs are required.");
-        } else if(nlhs>3) {
-            mexErrMsgTxt("Too many output arguments.");
-        }
+    double* dim_ptr = mxGetPr(prhs[1]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[2]);
+    double* nln_ptrV = mxGetPr(prhs[8]);
+    int nlnV     = (int)(nln_ptrV[0]);
+    double* nln_ptrP = mxGetPr(prhs[9]);
+    int nlnP     = (int)(nln_ptrP[0]);
+    mwSize numRowsElements  = mxGetM(prhs[2]);
+        
+    mwSize local_rhs_size = dim*nlnV + nlnP;
 
-        AssembleStokes(plhs, prhs);
-    }  
+    plhs[0] = CreateIndexMatrix((mwSize) noe*local_rhs_size, 1, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim);
+    plhs[1] = CreateElementMatrix((mwSize) noe*local_rhs_size,1, noe);
+        
+    IndexArray myRrows    = GetIndexArray(plhs[0]);
+    double* myRcoef    = mxGetPr(plhs[1]);
     
+    int k;
+    int q;
+    int NumQuadPoints     = mxGetN(prhs[5]);
     
-    if (strcmp(Assembly_name, "convective_Oseen")==0)
-    {
-        /* Check for proper number of arguments */
-        if(nrhs!=12) {
-            mexErrMsgTxt("12 inputs are required.");
-        } else if(nlhs>3) {
-            mexErrMsgTxt("Too many output arguments.");
-        }
+    double* NumNodes_ptr = mxGetPr(prhs[10]);
+    long long NumScalarDofsV = (long long)(NumNodes_ptr[0] / dim);
         
-        AssembleConvective_Oseen(plhs, prhs);
-    }
+    double* w   = mxGetPr(prhs[5]);
+    double* invjac = mxGetPr(prhs[4]);
+    int invjacStrideE, invjacStrideC;
+    GetInvJacStrides(prhs[4], dim, noe, &invjacStrideE, &invjacStrideC);
+    double* detjac = mxGetPr(prhs[3]);
+    double* phiV = mxGetPr(prhs[6]);
+    double* phiP = mxGetPr(prhs[12]);
+    GeometryCache GeoCacheV = GetGeometryCache(prhs[7], prhs[4], dim, nlnV, NumQuadPoints, noe);
+    GeometryCache GeoCacheP = GetGeometryCache(prhs[19], prhs[4], dim, nlnP, NumQuadPoints, noe);
+    double* U_h   = mxGetPr(prhs[13]);
+    double* v_n   = mxGetPr(prhs[14]);
     
-    if (strcmp(Assembly_name, "convective")==0)
-    {
-        /* Check for proper number of arguments */
-        if(nrhs!=12) {
-            mexErrMsgTxt("12 inputs are required.");
-        } else if(nlhs>6) {
-            mexErrMsgTxt("Too many output arguments.");
-        }
-        
-        AssembleConvective(plhs, prhs);
-    }
+    long long* elements  = GetIndexData(prhs[2]);
+            
+    double density   = mxGetScalar(prhs[15]);
+    double viscosity = mxGetScalar(prhs[16]);
+    double dt        = mxGetScalar(prhs[17]);
+    double alpha     = mxGetScalar(prhs[18]);
+    int use_SUPG     = (int)(mxGetScalar(prhs[20]));
     
-    if (strcmp(Assembly_name, "convectiveALE")==0)
-    {
-        /* Check for proper number of arguments */
-        if(nrhs!=13) {
-            mexErrMsgTxt("13 inputs are required.");
-        } else if(nlhs>6) {
-            mexErrMsgTxt("Too many output arguments.");
-        }
-        
-        AssembleConvectiveALE(plhs, prhs);
-    }
+    /* the vector the jacobian is applied to */
+    double* X_h   = mxGetPr(prhs[21]);
     
-    if (strcmp(Assembly_name, "SUPG_SemiImplicit")==0)
+    /* Assembly: loop over the elements */
+    int ie, d1, d2;
+    
+    #pragma omp parallel for schedule(runtime) shared(invjac,detjac,elements,myRrows,myRcoef,U_h,v_n,X_h) private(ie,k,q,d1,d2) firstprivate(phiV,phiP,w,numRowsElements,local_rhs_size,nlnV,nlnP,NumScalarDofsV,density,viscosity,dt,alpha,use_SUPG)
+    
+    for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        /* Check for proper number of arguments */
+        long long localRrows[local_rhs_size];
+
+        double gradphiV[dim][nlnV][NumQuadPoints];
+        double gradphiP[dim][nlnP][NumQuadPoints];
+        double U_hq[NumQuadPoints][dim];
+        double v_nq[NumQuadPoints][dim];
+        double GradUh[NumQuadPoints][dim][dim];
+        double GradPh[NumQuadPoints][dim];
+        double X_hq[NumQuadPoints][dim];
+        double GradXh[NumQuadPoints][dim][dim];
+        double GradXp[NumQuadPoints][dim];
+        double Xp[NumQuadPoints];
+        
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
+        {
+            /* Compute Gradient of Vel Basis functions*/
+            GeoCacheV.PhysicalGradients(&GeoCacheV, ie, q, &gradphiV[0][0][q], nlnV*NumQuadPoints, NumQuadPoints);
+
+            /* Compute Gradient of Pressure Basis functions*/
+            GeoCacheP.PhysicalGradients(&GeoCacheP, ie, q, &gradphiP[0][0][q], nlnP*NumQuadPoints, NumQuadPoints);
+            
+            /* Compute U_h, X_h and their gradients on the quadrature nodes of the current element*/
+            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+            {
+                U_hq[q][d1] = 0;
+                v_nq[q][d1] = 0;
+                X_hq[q][d1] = 0;
+                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                {
+                    GradUh[q][d1][d2] = 0;
+                    GradXh[q][d1][d2] = 0;
+                }
+                
+                for (k = 0; k < nlnV; k = k + 1 )
+                {
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
+                    U_hq[q][d1] = U_hq[q][d1] + U_h[e_k] * phiV[k+q*nlnV];
+                    v_nq[q][d1] = v_nq[q][d1] + v_n[e_k] * phiV[k+q*nlnV];
+                    X_hq[q][d1] = X_hq[q][d1] + X_h[e_k] * phiV[k+q*nlnV];
+                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                    {
+                        GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphiV[d2][k][q];
+                        GradXh[q][d1][d2] = GradXh[q][d1][d2] + X_h[e_k] * gradphiV[d2][k][q];
+                    }
+                }
+                
+                GradPh[q][d1] = 0;
+                GradXp[q][d1] = 0;
+                for (k = 0; k < nlnP; k = k + 1 )
+                {
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + dim*NumScalarDofsV - 1;
+                    GradPh[q][d1] = GradPh[q][d1] + U_h[e_k] * gradphiP[d1][k][q];
+                    GradXp[q][d1] = GradXp[q][d1] + X_h[e_k] * gradphiP[d1][k][q];
+                }
+            }
+            
+            Xp[q] = 0;
+            for (k = 0; k < nlnP; k = k + 1 )
+            {
+                Xp[q] = Xp[q] + X_h[elements[ie*numRowsElements + k] + dim*NumScalarDofsV - 1] * phiP[k+q*nlnP];
+            }
+        }
+        
+        /* Res_M: strong residual of the momentum equation
+         * Lin_M: linearized momentum operator applied to X_h
+         * Visc:  viscous stress of X_h
+         * Lin_C: divergence of X_h */
+        double Res_M[dim][NumQuadPoints];
+        double Lin_M[dim][NumQuadPoints];
+        double Lin_C[NumQuadPoints];
+        double Visc[NumQuadPoints][dim][dim];
+        
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
+        {
+            Lin_C[q] = 0.0;
+            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+            {
+                Lin_C[q] += GradXh[q][d1][d1];
+                
+                Res_M[d1][q] =   density / dt * (alpha * U_hq[q][d1] - v_nq[q][d1]) + GradPh[q][d1];
+                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                {
+                     Res_M[d1][q] += density * U_hq[q][d2] * GradUh[q][d1][d2];
+                     Visc[q][d1][d2] = viscosity * ( GradXh[q][d1][d2] + GradXh[q][d2][d1] );
+                }
+                
+                Lin_M[d1][q] = density * alpha / dt * X_hq[q][d1] + GradXp[q][d1];
+                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                {
+                    Lin_M[d1][q] += density * ( U_hq[q][d2] * GradXh[q][d1][d2] + GradUh[q][d1][d2] * X_hq[q][d2] );
+                }
+            }
+        }
+        
+        /* SUPG stabilization parameters, as in AssembleSUPG_Implicit */
+        double tauM[NumQuadPoints];
+        double tauC[NumQuadPoints];
+        double uh_gradPHI[nlnV][NumQuadPoints];
+        
+        if (use_SUPG)
+        {
+            double G[dim][dim];
+            double g[dim];
+            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+            {
+                g[d1] = 0;
+                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                {
+                    G[d1][d2] = 0.0;
+                    int d3;
+                    for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+                    {
+                        G[d1][d2] += INVJAC(ie,d1,d3) * INVJAC(ie,d2,d3);
+                    }
+                    g[d1] = g[d1] + INVJAC(ie,d1,d2);
+                }
+            }
+            
+            double traceGtG = Mdot(dim, G, G);
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                double G_U_hq[dim];
+                MatrixVector(dim, dim, G, U_hq[q], G_U_hq);
+                
+                tauM[q] = pow( 4*density*density/(dt*dt) + density*density*ScalarProduct(dim, U_hq[q], G_U_hq) + 30*viscosity*viscosity*traceGtG, -0.5);
+                tauC[q] = 1 / ( tauM[q] * ScalarProduct(dim, g, g) ) ;
+            }
+            
+            for (k = 0; k < nlnV; k = k + 1 )
+            {
+                for (q = 0; q < NumQuadPoints; q = q + 1 )
+                {
+                    uh_gradPHI[k][q] = 0;
+                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    {
+                        uh_gradPHI[k][q] += density * U_hq[q][d1] * gradphiV[d1][k][q];
+                    }
+                }
+            }
+        }
+        
+        int ii = 0;
+        int a;
+        double rloc;
+        double rloc_v[dim];
+        
+        /* loop over velocity test functions --> a */
+        for (a = 0; a < nlnV; a = a + 1 )
+        {
+            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+            {
+                rloc_v[d1] = 0.0;
+            }
+            
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                double gradphi_X = 0.0;
+                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                {
+                    gradphi_X += gradphiV[d2][a][q] * X_hq[q][d2];
+                }
+                
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    double r = phiV[a+q*nlnV] * ( Lin_M[d1][q] - GradXp[q][d1] ) - Xp[q] * gradphiV[d1][a][q];
+                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                    {
+                        r += Visc[q][d1][d2] * gradphiV[d2][a][q];
+                    }
+                    
+                    if (use_SUPG)
+                    {
+                        r +=   tauM[q] * uh_gradPHI[a][q] * Lin_M[d1][q]
+                             + tauC[q] * gradphiV[d1][a][q] * Lin_C[q];
+                        r += density * tauM[q] * Res_M[d1][q] * gradphi_X;
+                    }
+                    
+                    rloc_v[d1] += r * w[q];
+                }
+            }
+            
+            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+            {
+                localRrows[ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                myRcoef[ie*local_rhs_size+ii] = rloc_v[d1]*detjac[ie];
+                ii = ii + 1;
+            }
+        }
+        
+        /* loop over pressure test functions --> a */
+        for (a = 0; a < nlnP; a = a + 1 )
+        {
+            rloc = 0.0;
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                double r = phiP[a+q*nlnP] * Lin_C[q];
+                
+                if (use_SUPG)
+                {
+                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    {
+                        r += tauM[q] * Lin_M[d1][q] * gradphiP[d1][a][q];
+                    }
+                }
+                rloc += r * w[q];
+            }
+            localRrows[ii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+            myRcoef[ie*local_rhs_size+ii] = rloc*detjac[ie];
+            ii = ii + 1;
+        }
+        SetIndexBlock(myRrows, ie*local_rhs_size, localRrows, local_rhs_size);
+    }
+    
+    ReleaseIndexData(elements, prhs[2]);
+}
+
+/*************************************************************************/
+/* Newton step of the implicit Navier-Stokes (+ SUPG) scheme in a single element
+ * sweep: the whole jacobian alpha/dt M + S + C1 + C2 [+ dG_SUPG] and the residual
+ * 1/dt M (alpha U_k - v_n) + S U_k + C1 U_k [+ G_SUPG] share the evaluation of
+ * the basis function gradients and of U_h, Grad(U_h) on the quadrature nodes.
+ * ALE:    the convective velocity U_h - w is given and the gravity enters the SUPG residual
+ * steady: no time derivative, reduced argument list as in SUPG_ImplicitSteady */
+void AssembleNS_NewtonStep(mxArray* plhs[], const mxArray* prhs[], const int ALE, const int steady, const int computeJacobian, const CoefFormat coefFormat)
+{
+    double* dim_ptr = mxGetPr(prhs[1]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[2]);
+    double* nln_ptrV = mxGetPr(prhs[8]);
+    int nlnV     = (int)(nln_ptrV[0]);
+    double* nln_ptrP = mxGetPr(prhs[9]);
+    int nlnP     = (int)(nln_ptrP[0]);
+    mwSize numRowsElements  = mxGetM(prhs[2]);
+        
+    mwSize local_matrix_size = ( dim*nlnV + nlnP ) * ( dim*nlnV + nlnP );
+    mwSize local_rhs_size = dim*nlnV + nlnP;
+
+    /* without the jacobian, the residual is returned in plhs[0] and plhs[1] */
+    int outR = 0;
+    IndexArray myArows = {NULL, NULL, NULL};
+    IndexArray myAcols = {NULL, NULL, NULL};
+    CoefArray myAcoef  = {NULL, NULL};
+    
+    if (computeJacobian)
+    {
+        CreateMatrixOutputs(plhs, noe*local_matrix_size, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim, noe, coefFormat);
+        
+        myArows    = GetIndexArray(plhs[0]);
+        myAcols    = GetIndexArray(plhs[1]);
+        myAcoef    = GetMatrixCoefArray(plhs[2], coefFormat);
+        outR       = 3;
+    }
+    
+    plhs[outR]   = CreateIndexMatrix((mwSize) noe*local_rhs_size, 1, prhs[2], (dim+1) * mxGetScalar(prhs[10]) / dim);
+    plhs[outR+1] = CreateElementMatrix((mwSize) noe*local_rhs_size,1, noe);
+    
+    IndexArray myRrows    = GetIndexArray(plhs[outR]);
+    double* myRcoef    = mxGetPr(plhs[outR+1]);
+    
+    /* the loops over the trial functions are skipped if only the residual is required */
+    int nlnVtrial = computeJacobian ? nlnV : 0;
+    int nlnPtrial = computeJacobian ? nlnP : 0;
+    
+    int k;
+    int q;
+    int NumQuadPoints     = mxGetN(prhs[5]);
+    
+    double* NumNodes_ptr = mxGetPr(prhs[10]);
+    long long NumScalarDofsV = (long long)(NumNodes_ptr[0] / dim);
+        
+    double* w   = mxGetPr(prhs[5]);
+    double* invjac = mxGetPr(prhs[4]);
+    int invjacStrideE, invjacStrideC;
+    GetInvJacStrides(prhs[4], dim, noe, &invjacStrideE, &invjacStrideC);
+    double* detjac = mxGetPr(prhs[3]);
+    double* phiV = mxGetPr(prhs[6]);
+    double* phiP = mxGetPr(prhs[12]);
+    GeometryCache GeoCacheV = GetGeometryCache(prhs[7], prhs[4], dim, nlnV, NumQuadPoints, noe);
+    double* U_h   = mxGetPr(prhs[13]);
+    
+    long long* elements  = GetIndexData(prhs[2]);
+    
+    GeometryCache GeoCacheP;
+    double* v_n = NULL;
+    double* Conv_velocity = U_h;
+    double* gravity = NULL;
+    double density, viscosity, dt = 1.0, alpha = 0.0;
+    int use_SUPG;
+    
+    if (steady)
+    {
+        density   = mxGetScalar(prhs[14]);
+        viscosity = mxGetScalar(prhs[15]);
+        GeoCacheP = GetGeometryCache(prhs[16], prhs[4], dim, nlnP, NumQuadPoints, noe);
+        use_SUPG  = (int)(mxGetScalar(prhs[17]));
+    }
+    else
+    {
+        v_n       = mxGetPr(prhs[14]);
+        density   = mxGetScalar(prhs[15]);
+        viscosity = mxGetScalar(prhs[16]);
+        dt        = mxGetScalar(prhs[17]);
+        alpha     = mxGetScalar(prhs[18]);
+        GeoCacheP = GetGeometryCache(prhs[19], prhs[4], dim, nlnP, NumQuadPoints, noe);
+        use_SUPG  = (int)(mxGetScalar(prhs[20]));
+        if (ALE)
+        {
+            Conv_velocity = mxGetPr(prhs[21]);
+            gravity       = mxGetPr(prhs[22]);
+        }
+    }
+    
+    /* coefficients of the time derivative in the residual/jacobian and in tauM */
+    double inertia      = steady ? 0.0 : density * alpha / dt;
+    double tau_inertia  = steady ? 0.0 : 4*density*density/(dt*dt);
+        
+    /* Assembly: loop over the elements */
+    int ie, d1, d2;
+    
+    #pragma omp parallel for schedule(runtime) shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h,v_n,Conv_velocity,gravity) private(ie,k,q,d1,d2) firstprivate(phiV,phiP,w,numRowsElements,local_rhs_size,local_matrix_size,nlnV,nlnP,NumScalarDofsV,density,viscosity,dt,alpha,inertia,tau_inertia,use_SUPG,ALE,steady)
+    
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        long long localArows[local_matrix_size], localAcols[local_matrix_size];
+        long long localRrows[local_rhs_size];
+
+        double gradphiV[dim][nlnV][NumQuadPoints];
+        double gradphiP[dim][nlnP][NumQuadPoints];
+        double U_hq[NumQuadPoints][dim];
+        double ConvVel_hq[NumQuadPoints][dim];
+        double v_nq[NumQuadPoints][dim];
+        double GradUh[NumQuadPoints][dim][dim];
+        double GradPh[NumQuadPoints][dim];
+        double P_hq[NumQuadPoints];
+        
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
+        {
+            /* Compute Gradient of Vel Basis functions*/
+            GeoCacheV.PhysicalGradients(&GeoCacheV, ie, q, &gradphiV[0][0][q], nlnV*NumQuadPoints, NumQuadPoints);
+
+            /* Compute Gradient of Pressure Basis functions*/
+            GeoCacheP.PhysicalGradients(&GeoCacheP, ie, q, &gradphiP[0][0][q], nlnP*NumQuadPoints, NumQuadPoints);
+            
+            /* Compute U_h, Grad(U_h), p_h and Grad(p_h) on the quadrature nodes of the current element*/
+            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+            {
+                U_hq[q][d1] = 0;
+                ConvVel_hq[q][d1] = 0;
+                v_nq[q][d1] = 0;
+                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                {
+                    GradUh[q][d1][d2] = 0;
+                }
+                
+                for (k = 0; k < nlnV; k = k + 1 )
+                {
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumScalarDofsV - 1;
+                    U_hq[q][d1] = U_hq[q][d1] + U_h[e_k] * phiV[k+q*nlnV];
+                    ConvVel_hq[q][d1] = ConvVel_hq[q][d1] + Conv_velocity[e_k] * phiV[k+q*nlnV];
+                    if (!steady)
+                    {
+                        v_nq[q][d1] = v_nq[q][d1] + v_n[e_k] * phiV[k+q*nlnV];
+                    }
+                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                    {
+                        GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphiV[d2][k][q];
+                    }
+                }
+                
+                GradPh[q][d1] = 0;
+                for (k = 0; k < nlnP; k = k + 1 )
+                {
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + dim*NumScalarDofsV - 1;
+                    GradPh[q][d1] = GradPh[q][d1] + U_h[e_k] * gradphiP[d1][k][q];
+                }
+            }
+            
+            P_hq[q] = 0;
+            for (k = 0; k < nlnP; k = k + 1 )
+            {
+                P_hq[q] = P_hq[q] + U_h[elements[ie*numRowsElements + k] + dim*NumScalarDofsV - 1] * phiP[k+q*nlnP];
+            }
+        }
+        
+        /* Gal_M: time derivative and convective term of the momentum equation
+         * Res_M: strong momentum residual, Res_C: strong continuity residual */
+        double Gal_M[dim][NumQuadPoints];
+        double Res_M[dim][NumQuadPoints];
+        double Res_C[NumQuadPoints];
+        
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
+        {
+            Res_C[q] = 0.0;
+            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+            {
+                Res_C[q] += GradUh[q][d1][d1];
+                
+                Gal_M[d1][q] = 0.0;
+                if (!steady)
+                {
+                    Gal_M[d1][q] = density / dt * (alpha * U_hq[q][d1] - v_nq[q][d1]);
+                }
+                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                {
+                     Gal_M[d1][q] += density * ConvVel_hq[q][d2] * GradUh[q][d1][d2];
+                }
+                
+                Res_M[d1][q] = Gal_M[d1][q] + GradPh[q][d1];
+                if (ALE)
+                {
+                    Res_M[d1][q] -= gravity[d1];
+                }
+            }
+        }
+        
+        /* convective derivative of the velocity basis functions */
+        double uh_gradPHI[nlnV][NumQuadPoints];
+        for (k = 0; k < nlnV; k = k + 1 )
+        {
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                uh_gradPHI[k][q] = 0;
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    uh_gradPHI[k][q] += density * ConvVel_hq[q][d1] * gradphiV[d1][k][q];
+                }
+            }
+        }
+        
+        /* SUPG stabilization parameters, as in AssembleSUPG_Implicit */
+        double tauM[NumQuadPoints];
+        double tauC[NumQuadPoints];
+        if (use_SUPG)
+        {
+            double G[dim][dim];
+            double g[dim];
+            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+            {
+                g[d1] = 0;
+                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                {
+                    G[d1][d2] = 0.0;
+                    int d3;
+                    for (d3 = 0; d3 < dim; d3 = d3 + 1 )
+                    {
+                        G[d1][d2] += INVJAC(ie,d1,d3) * INVJAC(ie,d2,d3);
+                    }
+                    g[d1] = g[d1] + INVJAC(ie,d1,d2);
+                }
+            }
+            
+            double traceGtG = Mdot(dim, G, G);
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                double G_U_hq[dim];
+                MatrixVector(dim, dim, G, ConvVel_hq[q], G_U_hq);
+                
+                tauM[q] = pow( tau_inertia + density*density*ScalarProduct(dim, ConvVel_hq[q], G_U_hq) + 30*viscosity*viscosity*traceGtG, -0.5);
+                tauC[q] = 1 / ( tauM[q] * ScalarProduct(dim, g, g) ) ;
+            }
+        }
+        
+        int iii = 0;
+        int ii = 0;
+        int a, b;
+        double aloc;
+        double rloc;
+        double aloc_vv[dim][dim];
+        double aloc_vp[dim];
+        double rloc_v[dim];
+                
+        /* loop over velocity test functions --> a */
+        for (a = 0; a < nlnV; a = a + 1 )
+        {
+            /* weighted test function factors, independent of the trial function:
+             * the velocity-velocity block reads
+             * w * [ delta_d1d2 ( Phi_a (inertia phi_b + uh_gradPHI_b) + mu gradphi_a . gradphi_b )
+             *       + phi_b Coef_a[d1][d2] + mu d_d2 phi_a d_d1 phi_b + tauC d_d1 phi_a d_d2 phi_b ]
+             * with Phi_a = phi_a (+ tauM uh_gradPHI_a for SUPG) */
+            double Phi_a[NumQuadPoints];
+            double Coef_a[NumQuadPoints][dim][dim];
+            double ViscGrad_a[NumQuadPoints][dim];
+            double DivGrad_a[NumQuadPoints][dim];
+            
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                Phi_a[q] = phiV[a+q*nlnV];
+                if (use_SUPG)
+                {
+                    Phi_a[q] += tauM[q] * uh_gradPHI[a][q];
+                }
+                Phi_a[q] = Phi_a[q] * w[q];
+                
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    ViscGrad_a[q][d1] = viscosity * gradphiV[d1][a][q] * w[q];
+                    DivGrad_a[q][d1]  = use_SUPG ? tauC[q] * gradphiV[d1][a][q] * w[q] : 0.0;
+                    
+                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                    {
+                        Coef_a[q][d1][d2] = density * GradUh[q][d1][d2] * Phi_a[q];
+                        if (use_SUPG)
+                        {
+                            Coef_a[q][d1][d2] += density * tauM[q] * Res_M[d1][q] * gradphiV[d2][a][q] * w[q];
+                        }
+                    }
+                }
+            }
+            
+            /* loop over velocity trial functions --> b */
+            for (b = 0; b < nlnVtrial; b = b + 1 )
+            {
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                    {
+                        aloc_vv[d1][d2] = 0.0;
+                    }
+                }
+                
+                for (q = 0; q < NumQuadPoints; q = q + 1 )
+                {
+                    /* mass, convective (C1) and viscous diagonal blocks */
+                    aloc = Phi_a[q] * ( inertia * phiV[b+q*nlnV] + uh_gradPHI[b][q] );
+                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    {
+                        aloc += ViscGrad_a[q][d1] * gradphiV[d1][b][q];
+                    }
+                    
+                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    {
+                        aloc_vv[d1][d1] += aloc;
+                        
+                        /* viscous transposed gradient, C2 and SUPG couplings */
+                        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                        {
+                            aloc_vv[d1][d2] +=   phiV[b+q*nlnV] * Coef_a[q][d1][d2]
+                                               + ViscGrad_a[q][d2] * gradphiV[d1][b][q]
+                                               + DivGrad_a[q][d1]  * gradphiV[d2][b][q];
+                        }
+                    }
+                }
+                
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                    {
+                        localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + d2 * NumScalarDofsV;
+                        SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_vv[d1][d2]*detjac[ie]);
+                        iii = iii + 1;
+                    }
+                }
+            }
+            
+            /* loop over pressure trial functions --> b */
+            for (b = 0; b < nlnPtrial; b = b + 1 )
+            {
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    aloc_vp[d1] = 0.0;
+                }
+                
+                for (q = 0; q < NumQuadPoints; q = q + 1 )
+                {
+                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    {
+                        aloc_vp[d1] += - phiP[b+q*nlnP] * gradphiV[d1][a][q] * w[q];
+                        if (use_SUPG)
+                        {
+                            aloc_vp[d1] += tauM[q] * uh_gradPHI[a][q] * gradphiP[d1][b][q] * w[q];
+                        }
+                    }
+                }
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    localArows[iii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_vp[d1]*detjac[ie]);
+                    iii = iii + 1;
+                }
+            }
+            
+            /* residual of the momentum equation */
+            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+            {
+                rloc_v[d1] = 0.0;
+            }
+            
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    double r = phiV[a+q*nlnV] * Gal_M[d1][q] - P_hq[q] * gradphiV[d1][a][q];
+                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                    {
+                        r += viscosity * ( GradUh[q][d1][d2] + GradUh[q][d2][d1] ) * gradphiV[d2][a][q];
+                    }
+                    if (use_SUPG)
+                    {
+                        r +=   tauM[q] * uh_gradPHI[a][q] * Res_M[d1][q] 
+                             + tauC[q] * gradphiV[d1][a][q]  * Res_C[q];
+                    }
+                    rloc_v[d1] += r * w[q];
+                }
+            }
+            
+            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+            {
+                localRrows[ii] = elements[a+ie*numRowsElements] + d1 * NumScalarDofsV;
+                myRcoef[ie*local_rhs_size+ii] = rloc_v[d1]*detjac[ie];
+                ii = ii + 1;
+            }
+        }
+        
+        /* loop over pressure test functions --> a */
+        for (a = 0; a < nlnP; a = a + 1 )
+        {
+            double aloc_pv[dim];
+            /* loop over velocity trial functions --> b */
+            for (b = 0; b < nlnVtrial; b = b + 1 )
+            {
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    aloc_pv[d1] = 0.0;
+                }
+                
+                for (q = 0; q < NumQuadPoints; q = q + 1 )
+                {
+                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    {
+                        aloc_pv[d1] += phiP[a+q*nlnP] * gradphiV[d1][b][q] * w[q];
+                        if (use_SUPG)
+                        {
+                            aloc_pv[d1] += tauM[q] * ( inertia * phiV[b+q*nlnV] + uh_gradPHI[b][q] )
+                                                   * gradphiP[d1][a][q] * w[q];
+                            for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                            {
+                                aloc_pv[d1] += density * phiV[b+q*nlnV] * GradUh[q][d2][d1] * gradphiP[d2][a][q] * tauM[q] * w[q]; 
+                            }
+                        }
+                    }
+                }
+                
+                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                {
+                    localArows[iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+                    localAcols[iii] = elements[b+ie*numRowsElements] + d1 * NumScalarDofsV;
+                    SetCoef(myAcoef, ie*local_matrix_size+iii, aloc_pv[d1]*detjac[ie]);
+                    iii = iii + 1;
+                }
+            }
+            
+            /* loop over pressure trial functions --> b */
+            for (b = 0; b < nlnPtrial; b = b + 1 )
+            {
+                aloc = 0;
+                if (use_SUPG)
+                {
+                    for (q = 0; q < NumQuadPoints; q = q + 1 )
+                    {
+                        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                        {
+                            aloc  += gradphiP[d1][a][q] * gradphiP[d1][b][q] * tauM[q] * w[q];
+                        }
+                    }
+                }
+                localArows[iii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+                localAcols[iii] = elements[b+ie*numRowsElements] + dim * NumScalarDofsV;
+                SetCoef(myAcoef, ie*local_matrix_size+iii, aloc*detjac[ie]);
+                iii = iii + 1;
+            }
+           
+            rloc = 0.0;
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                rloc += phiP[a+q*nlnP] * Res_C[q] * w[q];
+                if (use_SUPG)
+                {
+                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    {
+                        rloc += tauM[q] * Res_M[d1][q] * gradphiP[d1][a][q] * w[q];
+                    }
+                }
+            }
+            localRrows[ii] = elements[a+ie*numRowsElements] + dim * NumScalarDofsV;
+            myRcoef[ie*local_rhs_size+ii] = rloc*detjac[ie];
+            ii = ii + 1;
+        }
+        if (computeJacobian)
+        {
+            SetIndexBlock(myArows, ie*local_matrix_size, localArows, local_matrix_size);
+            SetIndexBlock(myAcols, ie*local_matrix_size, localAcols, local_matrix_size);
+        }
+        SetIndexBlock(myRrows, ie*local_rhs_size, localRrows, local_rhs_size);
+    }
+    
+    ReleaseIndexData(elements, prhs[2]);
+}
+
+/*************************************************************************/
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+    SetOmpRuntime();
+    
+    char *Assembly_name = mxArrayToString(prhs[0]);
+    CoefFormat coefFormat = ParseCoefFormat(Assembly_name, &nrhs, prhs);
+            
+    if (strcmp(Assembly_name, "Stokes")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=13) {
+            mexErrMsgTxt("13 inputs are required.");
+        } else if(nlhs>3) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+
+        AssembleStokes(plhs, prhs, 0, coefFormat);
+    }  
+    
+    if (strcmp(Assembly_name, "Stokes_symmetric")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=13) {
+            mexErrMsgTxt("13 inputs are required.");
+        } else if(nlhs>6) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+
+        AssembleStokes(plhs, prhs, 1, coefFormat);
+    }
+    
+    
+    if (strcmp(Assembly_name, "convective_Oseen")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=12) {
+            mexErrMsgTxt("12 inputs are required.");
+        } else if(nlhs>3) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleConvective_Oseen(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "convective")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=12) {
+            mexErrMsgTxt("12 inputs are required.");
+        } else if(nlhs>6) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleConvective(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "convectiveALE")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=13) {
+            mexErrMsgTxt("13 inputs are required.");
+        } else if(nlhs>6) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleConvectiveALE(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "SUPG_SemiImplicit")==0)
+    {
+        /* Check for proper number of arguments */
         if(nrhs!=20) {
             mexErrMsgTxt("20 inputs are required.");
         } else if(nlhs>5) {
             mexErrMsgTxt("Too many output arguments.");
         }
         
-        AssembleSUPG_SemiImplicit(plhs, prhs);
+        AssembleSUPG_SemiImplicit(plhs, prhs, coefFormat);
     }
     
     if (strcmp(Assembly_name, "SUPG_Implicit")==0)
@@ -2118,7 +2892,19 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
             mexErrMsgTxt("Too many output arguments.");
         }
         
-        AssembleSUPG_Implicit(plhs, prhs);
+        AssembleSUPG_Implicit(plhs, prhs, 1, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "SUPG_Implicit_residual")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=20) {
+            mexErrMsgTxt("20 inputs are required.");
+        } else if(nlhs>2) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleSUPG_Implicit(plhs, prhs, 0, coefFormat);
     }
     
     if (strcmp(Assembly_name, "SUPG_ImplicitALE")==0)
@@ -2130,7 +2916,103 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
             mexErrMsgTxt("Too many output arguments.");
         }
         
-        AssembleSUPG_ImplicitALE(plhs, prhs);
+        AssembleSUPG_ImplicitALE(plhs, prhs, 1, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "SUPG_ImplicitALE_residual")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=22) {
+            mexErrMsgTxt("22 inputs are required.");
+        } else if(nlhs>2) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleSUPG_ImplicitALE(plhs, prhs, 0, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "NS_NewtonStep")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=21) {
+            mexErrMsgTxt("21 inputs are required.");
+        } else if(nlhs>5) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleNS_NewtonStep(plhs, prhs, 0, 0, 1, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "NS_NewtonStep_residual")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=21) {
+            mexErrMsgTxt("21 inputs are required.");
+        } else if(nlhs>2) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleNS_NewtonStep(plhs, prhs, 0, 0, 0, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "NS_NewtonStepALE")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=23) {
+            mexErrMsgTxt("23 inputs are required.");
+        } else if(nlhs>5) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleNS_NewtonStep(plhs, prhs, 1, 0, 1, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "NS_NewtonStepALE_residual")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=23) {
+            mexErrMsgTxt("23 inputs are required.");
+        } else if(nlhs>2) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleNS_NewtonStep(plhs, prhs, 1, 0, 0, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "NS_NewtonStepSteady")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=18) {
+            mexErrMsgTxt("18 inputs are required.");
+        } else if(nlhs>5) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleNS_NewtonStep(plhs, prhs, 0, 1, 1, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "NS_NewtonStepSteady_residual")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=18) {
+            mexErrMsgTxt("18 inputs are required.");
+        } else if(nlhs>2) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleNS_NewtonStep(plhs, prhs, 0, 1, 0, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "NS_JacobianVector")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=22) {
+            mexErrMsgTxt("22 inputs are required.");
+        } else if(nlhs>2) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleNS_MatrixFree(plhs, prhs);
     }
     
     if (strcmp(Assembly_name, "SUPG_ImplicitSteady")==0)
@@ -2142,7 +3024,19 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
             mexErrMsgTxt("Too many output arguments.");
         }
         
-        AssembleSUPG_ImplicitSteady(plhs, prhs);
+        AssembleSUPG_ImplicitSteady(plhs, prhs, 1, coefFormat);
+    }
+    
+    if (strcmp(Assembly_name, "SUPG_ImplicitSteady_residual")==0)
+    {
+        /* Check for proper number of arguments */
+        if(nrhs!=17) {
+            mexErrMsgTxt("17 inputs are required.");
+        } else if(nlhs>2) {
+            mexErrMsgTxt("Too many output arguments.");
+        }
+        
+        AssembleSUPG_ImplicitSteady(plhs, prhs, 0, coefFormat);
     }
     
     mxFree(Assembly_name);
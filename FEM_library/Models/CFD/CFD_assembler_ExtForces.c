@@ -8,6 +8,7 @@
 #include <math.h>
 #include "blas.h"
 #include <string.h>
+#include "../../Core/Tools.h"
 #ifdef _OPENMP
 #include <omp.h>
 #else
@@ -17,6 +18,7 @@
 
 void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 {
+    SetOmpRuntime();
     
     /* Check for proper number of arguments. */
     if(nrhs!=6) {
@@ -27,16 +29,16 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
     
     double* f   = mxGetPr(prhs[0]);
     int noe     = mxGetN(prhs[1]);
-    int numRowsElements  = mxGetM(prhs[1]);
-    double* elements  = mxGetPr(prhs[1]);
+    mwSize numRowsElements  = mxGetM(prhs[1]);
+    long long* elements  = GetIndexData(prhs[1]);
 
     double* nln_ptr = mxGetPr(prhs[2]);
     int nln     = (int)(nln_ptr[0]);
     
-    plhs[0] = mxCreateDoubleMatrix(nln*noe,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln*noe,1, mxREAL);
+    plhs[0] = CreateIndexMatrix((mwSize) nln*noe, 1, prhs[1], 0);
+    plhs[1] = CreateElementMatrix((mwSize) nln*noe,1, noe);
     
-    double* myRrows    = mxGetPr(plhs[0]);
+    IndexArray myRrows    = GetIndexArray(plhs[0]);
     double* myRcoef    = mxGetPr(plhs[1]);
     
     int k,l;
@@ -52,10 +54,12 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
     int ie;
     int a;
     
-#pragma omp parallel for shared(detjac,elements,myRrows,myRcoef) private(ie,a,q) firstprivate(phi,w,numRowsElements,nln)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef) private(ie,a,q) firstprivate(phi,w,numRowsElements,nln)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localRrows[nln];
+
         int ii = 0;
         
         /* loop over test functions --> a */
@@ -68,12 +72,14 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
                 floc = floc + ( phi[a+q*nln] * f[ie+q*noe] ) * w[q];
             }
             
-            myRrows[ie*nln+ii] = elements[a+ie*numRowsElements];
-            myRcoef[ie*nln+ii] = floc*detjac[ie];
+            localRrows[ii] = elements[a+ie*numRowsElements];
+            myRcoef[(mwSize) ie*nln+ii] = floc*detjac[ie];
             ii = ii + 1;
         }
+        SetIndexBlock(myRrows, (mwSize) ie*nln, localRrows, nln);
     }
     
+    ReleaseIndexData(elements, prhs[1]);
 }
 
 
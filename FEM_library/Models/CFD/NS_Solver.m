@@ -75,13 +75,6 @@ end
 %% Create Fluid Assembler Object
 FluidModel = CFD_Assembler( MESH, DATA, FE_SPACE_v, FE_SPACE_p );
 
-%% Assemble Constant Terms
-fprintf('\n   -- Assembling Stokes terms... ');
-t_assembly = tic;
-[A_Stokes] = FluidModel.compute_Stokes_matrix();
-t_assembly = toc(t_assembly);
-fprintf('done in %3.3f s\n', t_assembly);
-
 
 %% Nonlinear Iterations
 tol        = DATA.NonLinearSolver.tol;
@@ -95,27 +88,13 @@ dU             = zeros(totSize,1);
 U_k            = zeros(totSize,1);
 U_k(MESH.Dirichlet_dof) = u_D;
 
-% Assemble matrix and right-hand side
-fprintf('\n   -- Assembling Convective terms... ');
+% Assemble jacobian and residual
+fprintf('\n   -- Assembling Newton system... ');
 t_assembly = tic;
-[C1, C2] = FluidModel.compute_convective_matrix( U_k );
+[Jacobian, Residual] = FluidModel.compute_NewtonStepSteady( U_k, use_SUPG );
 t_assembly = toc(t_assembly);
 fprintf('done in %3.3f s\n', t_assembly);
 
-Residual = A_Stokes * U_k + C1 * U_k;
-Jacobian = A_Stokes + C1 + C2;
-
-if use_SUPG
-    fprintf('\n   -- Assembling SUPG Terms ... ');
-    t_assembly = tic;
-    [A_SUPG, F_SUPG] = FluidModel.compute_SUPG_implicitSteady( U_k );
-    t_assembly = toc(t_assembly);
-    fprintf('done in %3.3f s\n', t_assembly);
-    
-    Jacobian    = Jacobian + A_SUPG;
-    Residual    = Residual + F_SUPG;
-end
-
 % Apply boundary conditions
 fprintf('\n   -- Apply boundary conditions ... ');
 t_assembly = tic;
@@ -141,27 +120,13 @@ while (k <= maxIter && incrNorm > tol && resRelNorm > tol)
     U_k        = U_k + dU;
     incrNorm   = norm(dU)/norm(U_k);
     
-    % Assemble matrix and right-hand side
-    fprintf('\n   -- Assembling Convective terms... ');
+    % Assemble jacobian and residual
+    fprintf('\n   -- Assembling Newton system... ');
     t_assembly = tic;
-    [C1, C2] = FluidModel.compute_convective_matrix( U_k );
+    [Jacobian, Residual] = FluidModel.compute_NewtonStepSteady( U_k, use_SUPG );
     t_assembly = toc(t_assembly);
     fprintf('done in %3.3f s\n', t_assembly);
     
-    Residual = A_Stokes * U_k + C1 * U_k;
-    Jacobian = A_Stokes + C1 + C2;
-    
-    if use_SUPG
-        fprintf('\n   -- Assembling SUPG Terms ... ');
-        t_assembly = tic;
-        [A_SUPG, F_SUPG] = FluidModel.compute_SUPG_implicitSteady( U_k );
-        t_assembly = toc(t_assembly);
-        fprintf('done in %3.3f s\n', t_assembly);
-        
-        Jacobian    = Jacobian + A_SUPG;
-        Residual    = Residual + F_SUPG;
-    end
-    
     % Apply boundary conditions
     fprintf('\n   -- Apply boundary conditions ... ');
     t_assembly = tic;
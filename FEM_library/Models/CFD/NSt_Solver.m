@@ -126,6 +126,21 @@ fprintf('done in %3.3f s', t_assembly);
 %% Initialize Linear Solver
 LinSolver = LinearSolver( DATA.LinearSolver );
 
+% with DATA.Assembly.matrix_free the jacobian of the implicit scheme is never
+% assembled: the linear systems are solved by gmres using jacobian-vector
+% products, preconditioned by the Oseen linearization around the
+% extrapolated velocity, assembled once per time step
+matrix_free = DATA.Assembly.matrix_free && strcmp(DATA.time.nonlinearity, 'implicit');
+
+% with DATA.NonLinearSolver.type = 'ModifiedNewton' the jacobian and its
+% preconditioner (or its matlab_lu / MUMPS factorization) are kept until the residual norm is
+% reduced by less than DATA.NonLinearSolver.stallFactor; in between only the
+% residual is assembled
+modified_newton = strcmp(DATA.NonLinearSolver.type, 'ModifiedNewton') && ~matrix_free;
+if matrix_free || modified_newton
+    LinSolver.SetReusePreconditioner( true );
+end
+
 
 %% PreProcessing for Drag and Lift Computation
 compute_AerodynamicForces = 0 ;
@@ -257,80 +272,132 @@ while ( t < tf )
             U_k            = u;
             U_k(MESH.Dirichlet_dof) = u_D;
             
-            % Assemble matrix and right-hand side
-            fprintf('\n -- Assembling Convective terms... ');
-            t_assembly = tic;
-            [C1, C2] = FluidModel.compute_convective_matrix( U_k );
-            t_assembly = toc(t_assembly);
-            fprintf('done in %3.3f s\n', t_assembly);
-            
-            Residual = 1/dt * M * (alpha*U_k - u_BDF) + A_Stokes * U_k + C1 * U_k;
-            Jacobian = alpha/dt * M + A_Stokes + C1 + C2;
+            if matrix_free
+                
+                P_precon = [];
+                if ~strcmp(DATA.Preconditioner.type, 'None')
+                    fprintf('\n -- Assembling preconditioner matrix... ');
+                    t_assembly = tic;
+                    v_extrapolated = BDFhandler.Extrapolate();
+                    P_NS           = alpha/dt * M + A_Stokes + FluidModel.compute_convective_Oseen_matrix( v_extrapolated, true );
+                    if use_SUPG
+                        P_NS       = P_NS + FluidModel.compute_SUPG_semiimplicit( v_extrapolated, v_BDF, dt, alpha, true);
+                    end
+                    P_precon       = CFD_ApplyBC(P_NS, [], FE_SPACE_v, FE_SPACE_p, MESH, DATA, t, 1, u);
+                    clear P_NS;
+                    t_assembly = toc(t_assembly);
+                    fprintf('done in %3.3f s\n', t_assembly);
+                end
+                
+                LinSolver.Reset( );
+                Precon.Build( P_precon );
+                fprintf('\n      time to build the preconditioner %3.3f s \n', Precon.GetBuildTime());
+                LinSolver.SetPreconditioner( Precon );
+                
+                fprintf('\n -- Assembling residual... ');
+                t_assembly = tic;
+                Residual = FluidModel.compute_residual_matrixfree( U_k, v_BDF, dt, alpha, use_SUPG );
+                t_assembly = toc(t_assembly);
+                fprintf('done in %3.3f s\n', t_assembly);
+                
+                [~, b]   =  CFD_ApplyBC([], -Residual, FE_SPACE_v, FE_SPACE_p, MESH, DATA, t, 1, u);
+                
+            else
+                
+                % Assemble jacobian and residual
+                fprintf('\n -- Assembling Newton system... ');
+                t_assembly = tic;
+                [Jacobian, Residual] = FluidModel.compute_NewtonStep( U_k, v_BDF, dt, alpha, use_SUPG );
+                t_assembly = toc(t_assembly);
+                fprintf('done in %3.3f s\n', t_assembly);
             
-            if use_SUPG
-                fprintf('\n -- Assembling SUPG Terms ... ');
+                % Apply boundary conditions
+                fprintf('\n -- Apply boundary conditions ... ');
                 t_assembly = tic;
-                [A_SUPG, F_SUPG] = FluidModel.compute_SUPG_implicit( U_k, v_BDF, dt, alpha);
+                [A, b]   =  CFD_ApplyBC(Jacobian, -Residual, FE_SPACE_v, FE_SPACE_p, MESH, DATA, t, 1, u);
                 t_assembly = toc(t_assembly);
                 fprintf('done in %3.3f s\n', t_assembly);
                 
-                Jacobian    = Jacobian + A_SUPG;
-                Residual    = Residual + F_SUPG;
             end
             
-            % Apply boundary conditions
-            fprintf('\n -- Apply boundary conditions ... ');
-            t_assembly = tic;
-            [A, b]   =  CFD_ApplyBC(Jacobian, -Residual, FE_SPACE_v, FE_SPACE_p, MESH, DATA, t, 1, u);
-            t_assembly = toc(t_assembly);
-            fprintf('done in %3.3f s\n', t_assembly);
-            
             res0Norm = norm(b);
+            resNorm  = res0Norm;
+            rebuild_jacobian = true;
             
             fprintf('\n============ Start Newton Iterations ============\n\n');
             while (k <= maxIter && (incrNorm > tol || resRelNorm > tol))
                 
                 % Solve
                 fprintf('\n   -- Solve J x = -R ... ');
-                Precon.Build( A );
-                fprintf('\n        time to build the preconditioner %3.3f s \n', Precon.GetBuildTime());
-                LinSolver.SetPreconditioner( Precon );
+                if matrix_free
+                    A = @(X) NS_JacobianVector(FluidModel, U_k, v_BDF, dt, alpha, use_SUPG, MESH.internal_dof, X);
+                elseif rebuild_jacobian
+                    if modified_newton
+                        LinSolver.Reset( );
+                    end
+                    Precon.Build( A );
+                    fprintf('\n        time to build the preconditioner %3.3f s \n', Precon.GetBuildTime());
+                    LinSolver.SetPreconditioner( Precon );
+                end
                 dU(MESH.internal_dof) = LinSolver.Solve( A, b );
                 fprintf('\n        time to solve the linear system in %3.3f s \n', LinSolver.GetSolveTime());
                 
                 U_k        = U_k + dU;
                 incrNorm   = norm(dU)/norm(U_k);
                 
-                % Assemble matrix and right-hand side
-                fprintf('\n   -- Assembling Convective terms... ');
-                t_assembly = tic;
-                [C1, C2] = FluidModel.compute_convective_matrix( U_k );
-                t_assembly = toc(t_assembly);
-                fprintf('done in %3.3f s\n', t_assembly);
-                
-                Residual = 1/dt * M * (alpha*U_k - u_BDF) + A_Stokes * U_k + C1 * U_k;
-                Jacobian = alpha/dt * M + A_Stokes + C1 + C2;
-                
-                if use_SUPG
+                if matrix_free
                     
-                    fprintf('\n   -- Assembling SUPG Terms ... ');
+                    fprintf('\n   -- Assembling residual... ');
                     t_assembly = tic;
-                    [A_SUPG, F_SUPG] = FluidModel.compute_SUPG_implicit( U_k, v_BDF, dt, alpha);
+                    Residual = FluidModel.compute_residual_matrixfree( U_k, v_BDF, dt, alpha, use_SUPG );
                     t_assembly = toc(t_assembly);
                     fprintf('done in %3.3f s\n', t_assembly);
                     
-                    Jacobian    = Jacobian + A_SUPG;
-                    Residual    = Residual + F_SUPG;
-                end
+                    [~, b]   =  CFD_ApplyBC([], -Residual, FE_SPACE_v, FE_SPACE_p, MESH, DATA, t, 1, u);
+                    
+                elseif modified_newton
+                    
+                    % Assemble residual only, keep the current jacobian
+                    fprintf('\n   -- Assembling residual... ');
+                    t_assembly = tic;
+                    Residual = FluidModel.compute_NewtonStep_residual( U_k, v_BDF, dt, alpha, use_SUPG );
+                    t_assembly = toc(t_assembly);
+                    fprintf('done in %3.3f s\n', t_assembly);
+                    
+                    [~, b]   =  CFD_ApplyBC([], -Residual, FE_SPACE_v, FE_SPACE_p, MESH, DATA, t, 1, u);
+                    
+                    % convergence stalls: rebuild jacobian and preconditioner
+                    rebuild_jacobian = norm(b) > DATA.NonLinearSolver.stallFactor * resNorm;
+                    if rebuild_jacobian
+                        fprintf('\n   -- Assembling jacobian... ');
+                        t_assembly = tic;
+                        Jacobian = FluidModel.compute_NewtonStep( U_k, v_BDF, dt, alpha, use_SUPG );
+                        t_assembly = toc(t_assembly);
+                        fprintf('done in %3.3f s\n', t_assembly);
+                        
+                        A        =  CFD_ApplyBC(Jacobian, [], FE_SPACE_v, FE_SPACE_p, MESH, DATA, t, 1, u);
+                    end
+                    
+                else
+                    
+                    % Assemble jacobian and residual
+                    fprintf('\n   -- Assembling Newton system... ');
+                    t_assembly = tic;
+                    [Jacobian, Residual] = FluidModel.compute_NewtonStep( U_k, v_BDF, dt, alpha, use_SUPG );
+                    t_assembly = toc(t_assembly);
+                    fprintf('done in %3.3f s\n', t_assembly);
                 
-                % Apply boundary conditions
-                fprintf('\n   -- Apply boundary conditions ... ');
-                t_assembly = tic;
-                [A, b]   =  CFD_ApplyBC(Jacobian, -Residual, FE_SPACE_v, FE_SPACE_p, MESH, DATA, t, 1, u);
-                t_assembly = toc(t_assembly);
-                fprintf('done in %3.3f s\n', t_assembly);
+                    % Apply boundary conditions
+                    fprintf('\n   -- Apply boundary conditions ... ');
+                    t_assembly = tic;
+                    [A, b]   =  CFD_ApplyBC(Jacobian, -Residual, FE_SPACE_v, FE_SPACE_p, MESH, DATA, t, 1, u);
+                    t_assembly = toc(t_assembly);
+                    fprintf('done in %3.3f s\n', t_assembly);
+                    
+                end
                 
-                resRelNorm = norm(b) / res0Norm;
+                resNorm    = norm(b);
+                resRelNorm = resNorm / res0Norm;
                 
                 fprintf('\n **** Iteration  k = %d:  norm(dU)/norm(Uk) = %1.2e, Residual Rel Norm = %1.2e \n\n',k, full(incrNorm), full(resRelNorm));
                 k = k + 1;
@@ -353,7 +420,7 @@ while ( t < tf )
     if compute_AerodynamicForces
         
         if strcmp(DATA.time.nonlinearity,'implicit')
-            C_NS = 0*Jacobian;
+            C_NS = sparse(totSize, totSize);
             F_NS = -Residual;
         end
         Z              = zeros(FE_SPACE_v.numDofScalar,1);
@@ -430,3 +497,14 @@ end
 fprintf('\n************************************************************************* \n');
 
 return
+
+%% Matrix-free jacobian restricted to the internal dofs
+function JX = NS_JacobianVector(FluidModel, U_k, v_BDF, dt, alpha, use_SUPG, internal_dof, X)
+
+X_h               = zeros(length(U_k), 1);
+X_h(internal_dof) = X;
+
+JX = FluidModel.compute_jacobian_vector(U_k, X_h, v_BDF, dt, alpha, use_SUPG);
+JX = full( JX(internal_dof) );
+
+return
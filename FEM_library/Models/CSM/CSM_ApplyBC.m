@@ -1,4 +1,4 @@
-function [A_in, F_in, u_D] =  CSM_ApplyBC(A, F, FE_SPACE, MESH, DATA, t, zero_Dirichlet)
+function [A_in, F_in, u_D] =  CSM_ApplyBC(A, F, FE_SPACE, MESH, DATA, t, zero_Dirichlet, upper_triangle)
 %CSM_APPLYBC apply boundary conditions for CSM problem in 2D/3D
 %
 %   [A_IN, F_IN, U_DIRICHLET] = CSM_APPLYBC(A, F, FE_SPACE, MESH, DATA) given an
@@ -17,6 +17,10 @@ function [A_in, F_in, u_D] =  CSM_ApplyBC(A, F, FE_SPACE, MESH, DATA, t, zero_Di
 %   If ZERO_DIRICHLET = 1, applies homogeneous Dirichlet boundary
 %   conditions (useful for Newton iterations). ZERO_DIRICHLET = 0 by
 %   default.
+%
+%   [A_IN, F_IN, U_DIRICHLET] = CSM_APPLYBC(A, F, FE_SPACE, MESH, DATA, T, ZERO_DIRICHLET, UPPER_TRIANGLE)
+%   If UPPER_TRIANGLE = 1, A contains only the upper triangle of a
+%   symmetric matrix, and so does A_IN. UPPER_TRIANGLE = 0 by default.
 
 %   This file is part of redbKIT.
 %   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
@@ -34,10 +38,14 @@ if isempty(F)
     F = sparse(MESH.numNodes*MESH.dim, 1);
 end
 
-if nargin < 7
+if nargin < 7 || isempty(zero_Dirichlet)
     zero_Dirichlet = 0;
 end
 
+if nargin < 8
+    upper_triangle = 0;
+end
+
 param = DATA.param;
 
 u_D = [];
@@ -254,14 +262,22 @@ if ~isempty( MESH.Dirichlet_dof )
     
     F_in = F(MESH.internal_dof) - A(MESH.internal_dof,MESH.Dirichlet_dof)*u_D;
     
-    A_in = A(MESH.internal_dof,MESH.internal_dof);
+    if upper_triangle
+        % the lower block A(internal,Dirichlet) is stored as A(Dirichlet,internal)'
+        F_in = F_in - A(MESH.Dirichlet_dof,MESH.internal_dof).'*u_D;
+    end
     
 else
     
     F_in = F(MESH.internal_dof);
     
-    A_in = A(MESH.internal_dof,MESH.internal_dof);
-    
+end
+
+A_in = A(MESH.internal_dof,MESH.internal_dof);
+
+% A(internal,internal) is upper triangular only if the internal dofs are sorted
+if upper_triangle && ~issorted(MESH.internal_dof)
+    A_in = triu(A_in) + tril(A_in,-1).';
 end
 
 end
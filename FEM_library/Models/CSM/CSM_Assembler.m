@@ -9,6 +9,18 @@
 %    compute_stress               - compute stress for postprocessing
 %    compute_internal_forces      - assemble vector of internal forces
 %    compute_jacobian             - assemble jacobian (tangent stiffness) matrix
+%    compute_internal_forces_jacobian - assemble internal forces and jacobian
+%                                   in a single pass over the elements
+%    compute_jacobian_vector      - matrix-free product of the jacobian with a vector
+%    compute_tangent_cache        - evaluate the material tangent at the
+%                                   quadrature nodes, for compute_jacobian_vector
+%    assemble_matrix              - build sparse matrix, reusing the cached
+%                                   sparsity pattern if DATA.Assembly.cache_pattern
+%    use_symmetric_assembly       - true if only the upper triangle of the
+%                                   jacobian is assembled (DATA.Assembly.symmetric)
+%    precision_suffix             - suffix of the C assembly names selecting
+%                                   single precision matrix coefficients
+%                                   (DATA.Assembly.precision)
 %
 % CSM_ASSEMBLER properties:
 %    M_MESH             - struct containing MESH data
@@ -31,6 +43,14 @@ classdef CSM_Assembler < handle
         M_MaterialModel;
         M_MaterialParam;
     end
+    
+    properties (Access = protected)
+        M_ScatterMaps;
+        M_Coloring;
+        M_precision;
+        M_elements;
+        M_dphi_ref;
+    end
    
     methods
         
@@ -44,6 +64,33 @@ classdef CSM_Assembler < handle
             obj.M_MaterialModel = DATA.Material_Model;
             obj = SetMaterialParameters(obj);
             
+            % connectivity passed to the C assemblers
+            if isfield(DATA, 'Assembly') && isfield(DATA.Assembly, 'index_type') && any(strcmp(DATA.Assembly.index_type, {'int32', 'int64'}))
+                obj.M_elements = cast( MESH.elements, DATA.Assembly.index_type );
+            else
+                obj.M_elements = MESH.elements;
+            end
+            
+            % cached sparsity patterns (DATA.Assembly.cache_pattern) and
+            % element coloring for the race-free parallel scatter of the
+            % elemental contributions (DATA.Assembly.coloring)
+            [obj.M_ScatterMaps, obj.M_Coloring] = SparseScatterMap.CreateCache(DATA, obj.M_elements, FE_SPACE.numElemDof, MESH.numNodes);
+            
+            % precision of the matrix coefficients returned by the C
+            % assemblers: 'double', 'single' or 'mixed'
+            obj.M_precision = 'double';
+            if isfield(DATA, 'Assembly') && isfield(DATA.Assembly, 'precision')
+                obj.M_precision = DATA.Assembly.precision;
+            end
+            
+            % reference gradients passed to the C assemblers, possibly
+            % replaced by the precomputed physical gradients
+            obj.M_dphi_ref = FE_SPACE.dphi_ref;
+            if isfield(DATA, 'Assembly') && isfield(DATA.Assembly, 'geometry_cache') && ~strcmp(DATA.Assembly.geometry_cache, 'none')
+                GeoCache = GeometryCache(MESH, FE_SPACE, DATA.Assembly.geometry_cache, DATA.Assembly.geometry_cache_budget);
+                obj.M_dphi_ref = GeoCache.GetData();
+            end
+            
             if obj.M_MESH.dim == 2 
                 if strcmp(obj.M_MaterialModel, 'NeoHookean')
                     error('NeoHookean material law is available only for 3D simulations.')
@@ -125,7 +172,7 @@ classdef CSM_Assembler < handle
             F_ext = [];
             for k = 1 : obj.M_MESH.dim
                 
-                [rowF, coefF] = CSM_assembler_ExtForces(f{k}, obj.M_MESH.elements, obj.M_FE_SPACE.numElemDof, ...
+                [rowF, coefF] = CSM_assembler_ExtForces(f{k}, obj.M_elements, obj.M_FE_SPACE.numElemDof, ...
                     obj.M_FE_SPACE.quad_weights, obj.M_MESH.jac, obj.M_FE_SPACE.phi);
                 
                 % Build sparse matrix and vector
@@ -424,11 +471,17 @@ classdef CSM_Assembler < handle
         function [M] = compute_mass( obj )
             
             % C_OMP assembly, returns matrices in sparse vector format
-            [rowM, colM, coefM] = Mass_assembler_C_omp(obj.M_MESH.dim, obj.M_MESH.elements, obj.M_FE_SPACE.numElemDof, ...
-                obj.M_FE_SPACE.quad_weights, obj.M_MESH.jac, obj.M_FE_SPACE.phi);
+            symmetric = isfield(obj.M_DATA, 'Assembly') && isfield(obj.M_DATA.Assembly, 'symmetric') ...
+                && obj.M_DATA.Assembly.symmetric;
+            [rowM, colM, coefM] = Mass_assembler_C_omp(obj.M_MESH.dim, obj.M_elements, obj.M_FE_SPACE.numElemDof, ...
+                obj.M_FE_SPACE.quad_weights, obj.M_MESH.jac, obj.M_FE_SPACE.phi, symmetric, ~isempty(precision_suffix(obj)));
             
             % Build sparse matrix
-            M_scalar   = GlobalAssemble(rowM, colM, coefM, obj.M_MESH.numNodes, obj.M_MESH.numNodes);
+            if symmetric
+                M_scalar   = GlobalAssembleSymmetric(rowM, colM, coefM, obj.M_MESH.numNodes);
+            else
+                M_scalar   = GlobalAssemble(rowM, colM, coefM, obj.M_MESH.numNodes, obj.M_MESH.numNodes);
+            end
             M          = [];
             for k = 1 : obj.M_FE_SPACE.numComponents
                 M = blkdiag(M, M_scalar);
@@ -449,7 +502,7 @@ classdef CSM_Assembler < handle
             [phi, dphi_ref]              = fem_basis(obj.M_FE_SPACE.dim, obj.M_FE_SPACE.fem, quad_nodes);
             
             [P, Sigma] = CSM_assembler_C_omp(obj.M_MESH.dim, [obj.M_MaterialModel,'_stress'], obj.M_MaterialParam, ...
-                U_h, obj.M_MESH.elements, obj.M_FE_SPACE.numElemDof,...
+                U_h, obj.M_elements, obj.M_FE_SPACE.numElemDof,...
                 quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, phi, dphi_ref);
             
         end
@@ -461,30 +514,139 @@ classdef CSM_Assembler < handle
             % C_OMP assembly, returns matrices in sparse vector format
             [rowG, coefG] = ...
                 CSM_assembler_C_omp(obj.M_MESH.dim, [obj.M_MaterialModel,'_forces'], obj.M_MaterialParam, full( U_h ), ...
-                obj.M_MESH.elements, obj.M_FE_SPACE.numElemDof, ...
-                obj.M_FE_SPACE.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, obj.M_FE_SPACE.phi, obj.M_FE_SPACE.dphi_ref);
+                obj.M_elements, obj.M_FE_SPACE.numElemDof, ...
+                obj.M_FE_SPACE.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, obj.M_FE_SPACE.phi, obj.M_dphi_ref);
             
             % Build sparse matrix and vector
-            F_in    = GlobalAssemble(rowG, 1, coefG, obj.M_MESH.numNodes*obj.M_MESH.dim, 1);
+            F_in    = GlobalAssembleColored(rowG, coefG, obj.M_MESH.numNodes*obj.M_MESH.dim, obj.M_Coloring);
             
         end
         
         %==========================================================================
         %% Compute internal forces Jacobian
-        function [dF_in] = compute_jacobian(obj, U_h)
+        function [dF_in] = compute_jacobian(obj, U_h, preconditioner, upper_triangle)
+            % if PRECONDITIONER is true, the jacobian is only used to build
+            % a preconditioner (see precision_suffix). If UPPER_TRIANGLE is
+            % true, only the upper triangle of the jacobian is returned
+            % (for symmetric solvers, see LinearSolver.UsesUpperTriangle)
             
             if nargin < 2 || isempty(U_h)
                 U_h = zeros(obj.M_MESH.dim*obj.M_MESH.numNodes,1);
             end
+            
+            if nargin < 3 || isempty(preconditioner)
+                preconditioner = false;
+            end
+            
+            if nargin < 4
+                upper_triangle = false;
+            end
 
-            % C_OMP assembly, returns matrices in sparse vector format
+            symmetric = use_symmetric_assembly(obj);
+            if symmetric
+                assembly_name = '_jacobianSymmetric';
+            else
+                assembly_name = '_jacobian';
+            end
+            
+            % C_OMP assembly, returns matrices in sparse vector format (or
+            % directly the values of the cached pattern, see ScatterInputs)
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, assembly_name(2:end));
             [rowdG, coldG, coefdG] = ...
-                CSM_assembler_C_omp(obj.M_MESH.dim, [obj.M_MaterialModel,'_jacobian'], obj.M_MaterialParam, full( U_h ), ...
-                obj.M_MESH.elements, obj.M_FE_SPACE.numElemDof, ...
-                obj.M_FE_SPACE.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, obj.M_FE_SPACE.phi, obj.M_FE_SPACE.dphi_ref);
+                CSM_assembler_C_omp(obj.M_MESH.dim, [obj.M_MaterialModel,assembly_name,precision_suffix(obj, preconditioner),scatter], obj.M_MaterialParam, full( U_h ), ...
+                obj.M_elements, obj.M_FE_SPACE.numElemDof, ...
+                obj.M_FE_SPACE.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, obj.M_FE_SPACE.phi, obj.M_dphi_ref, scatter_inputs{:});
             
             % Build sparse matrix and vector
-            dF_in   = GlobalAssemble(rowdG, coldG, coefdG, obj.M_MESH.numNodes*obj.M_MESH.dim, obj.M_MESH.numNodes*obj.M_MESH.dim);
+            dF_in   = assemble_matrix(obj, assembly_name(2:end), rowdG, coldG, coefdG, obj.M_MESH.numNodes*obj.M_MESH.dim, obj.M_MESH.numNodes*obj.M_MESH.dim);
+            if symmetric && ~upper_triangle
+                dF_in = dF_in + triu(dF_in, 1).';
+            elseif ~symmetric && upper_triangle
+                dF_in = triu(dF_in);
+            end
+        end
+        
+        %==========================================================================
+        %% Compute internal forces and their Jacobian in a single element loop
+        function [F_in, dF_in] = compute_internal_forces_jacobian(obj, U_h, upper_triangle)
+            % if UPPER_TRIANGLE is true, only the upper triangle of the
+            % jacobian is returned (see compute_jacobian)
+            
+            if nargin < 2 || isempty(U_h)
+                U_h = zeros(obj.M_MESH.dim*obj.M_MESH.numNodes,1);
+            end
+            
+            if nargin < 3
+                upper_triangle = false;
+            end
+            
+            symmetric = use_symmetric_assembly(obj);
+            if symmetric
+                assembly_name = '_jacobianSymmetric';
+            else
+                assembly_name = '_jacobian';
+            end
+            
+            % C_OMP assembly, returns matrices in sparse vector format (or
+            % directly the values of the cached pattern, see ScatterInputs)
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, ['residual',assembly_name]);
+            [rowdG, coldG, coefdG, rowG, coefG] = ...
+                CSM_assembler_C_omp(obj.M_MESH.dim, [obj.M_MaterialModel,'_residual',assembly_name,precision_suffix(obj),scatter], obj.M_MaterialParam, full( U_h ), ...
+                obj.M_elements, obj.M_FE_SPACE.numElemDof, ...
+                obj.M_FE_SPACE.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, obj.M_FE_SPACE.phi, obj.M_dphi_ref, scatter_inputs{:});
+            
+            % Build sparse matrix and vector
+            F_in    = GlobalAssembleColored(rowG, coefG, obj.M_MESH.numNodes*obj.M_MESH.dim, obj.M_Coloring);
+            dF_in   = assemble_matrix(obj, ['residual',assembly_name], rowdG, coldG, coefdG, obj.M_MESH.numNodes*obj.M_MESH.dim, obj.M_MESH.numNodes*obj.M_MESH.dim);
+            if symmetric && ~upper_triangle
+                dF_in = dF_in + triu(dF_in, 1).';
+            elseif ~symmetric && upper_triangle
+                dF_in = triu(dF_in);
+            end
+        end
+        
+        %==========================================================================
+        %% Compute Jacobian-vector product without assembling the Jacobian
+        function [JV] = compute_jacobian_vector(obj, U_h, V_h, TangentCache)
+            % if TangentCache (see compute_tangent_cache) is provided, U_h
+            % is not used and the material tangent is not recomputed
+            
+            if nargin < 4 || isempty(TangentCache)
+                TangentCache = [];
+            end
+            
+            input_args = {obj.M_MESH.dim, [obj.M_MaterialModel,'_jacobianVector'], obj.M_MaterialParam, full( U_h ), ...
+                obj.M_elements, obj.M_FE_SPACE.numElemDof, ...
+                obj.M_FE_SPACE.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, obj.M_FE_SPACE.phi, obj.M_dphi_ref, full( V_h )};
+            
+            if ~isempty(TangentCache)
+                input_args{end+1} = TangentCache;
+            end
+            
+            % C_OMP assembly, returns matrices in sparse vector format
+            [rowG, coefG] = CSM_assembler_C_omp(input_args{:});
+            
+            JV    = GlobalAssembleColored(rowG, coefG, obj.M_MESH.numNodes*obj.M_MESH.dim, obj.M_Coloring);
+        end
+        
+        %==========================================================================
+        %% Compute material tangent at the quadrature nodes
+        function [TangentCache] = compute_tangent_cache(obj, U_h)
+            % upper triangle of the symmetric dim^2 x dim^2 tangent, i.e.
+            % dim^2*(dim^2+1)/2 values (45 in 3D) for each quadrature node of
+            % each element; only available for the hyperelastic models,
+            % since the Jacobian of Linear and SEMMT models does not depend
+            % on U_h
+            
+            switch obj.M_MaterialModel
+                case {'Linear', 'SEMMT'}
+                    TangentCache = [];
+                otherwise
+                    TangentCache = ...
+                        CSM_assembler_C_omp(obj.M_MESH.dim, [obj.M_MaterialModel,'_tangentCache'], obj.M_MaterialParam, full( U_h ), ...
+                        obj.M_elements, obj.M_FE_SPACE.numElemDof, ...
+                        obj.M_FE_SPACE.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, obj.M_FE_SPACE.phi, obj.M_dphi_ref);
+            end
         end
         
         %==========================================================================
@@ -499,15 +661,59 @@ classdef CSM_Assembler < handle
                 S_0 = zeros(obj.M_MESH.numElem*length(obj.M_FE_SPACE.quad_weights)*obj.M_MESH.dim*obj.M_MESH.dim, 1);
             end
 
-            % C_OMP assembly, returns matrices in sparse vector format
+            % C_OMP assembly, returns matrices in sparse vector format (or
+            % directly the values of the cached pattern, see ScatterInputs)
+            [scatter, scatter_inputs] = SparseScatterMap.ScatterInputs(obj.M_ScatterMaps, 'prestress');
             [rowdG, coldG, coefdG, rowG, coefG, S_np1] = ...
-                CSM_assembler_C_omp(obj.M_MESH.dim, [obj.M_MaterialModel,'_prestress'], obj.M_MaterialParam, full( U_h ), ...
-                obj.M_MESH.elements, obj.M_FE_SPACE.numElemDof, ...
-                obj.M_FE_SPACE.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, obj.M_FE_SPACE.phi, obj.M_FE_SPACE.dphi_ref, S_0);
+                CSM_assembler_C_omp(obj.M_MESH.dim, [obj.M_MaterialModel,'_prestress',precision_suffix(obj),scatter], obj.M_MaterialParam, full( U_h ), ...
+                obj.M_elements, obj.M_FE_SPACE.numElemDof, ...
+                obj.M_FE_SPACE.quad_weights, obj.M_MESH.invjac, obj.M_MESH.jac, obj.M_FE_SPACE.phi, obj.M_dphi_ref, S_0, scatter_inputs{:});
             
             % Build sparse matrix and vector
-            R_P   = GlobalAssemble(rowG, 1, coefG, obj.M_MESH.numNodes*obj.M_MESH.dim, 1);
-            J_P   = GlobalAssemble(rowdG, coldG, coefdG, obj.M_MESH.numNodes*obj.M_MESH.dim, obj.M_MESH.numNodes*obj.M_MESH.dim);
+            R_P   = GlobalAssembleColored(rowG, coefG, obj.M_MESH.numNodes*obj.M_MESH.dim, obj.M_Coloring);
+            J_P   = assemble_matrix(obj, 'prestress', rowdG, coldG, coefdG, obj.M_MESH.numNodes*obj.M_MESH.dim, obj.M_MESH.numNodes*obj.M_MESH.dim);
+        end
+        
+        %==========================================================================
+        %% Build sparse matrix from elemental contributions
+        function [A] = assemble_matrix(obj, name, rows, cols, coef, m, n)
+            % if DATA.Assembly.cache_pattern is true, the sparsity pattern
+            % associated with NAME is computed the first time and then
+            % reused, see SparseScatterMap.AssembleCached; from then on the
+            % C assembly of NAME gets the ScatterInputs and returns directly
+            % the values of the cached matrix, with ROWS and COLS empty
+            
+            A = SparseScatterMap.AssembleCached(obj.M_ScatterMaps, name, rows, cols, coef, m, n, obj.M_Coloring);
+        end
+        
+        %==========================================================================
+        %% Check whether the jacobian and mass matrices are assembled from their upper triangle
+        function [symmetric] = use_symmetric_assembly(obj)
+            % the jacobians of the hyperelastic models are symmetric; the
+            % SEMMT model does not provide a symmetric assembly
+            
+            symmetric = isfield(obj.M_DATA, 'Assembly') && isfield(obj.M_DATA.Assembly, 'symmetric') ...
+                && obj.M_DATA.Assembly.symmetric ...
+                && any(strcmp(obj.M_MaterialModel, {'Linear', 'StVenantKirchhoff', 'NeoHookean', 'RaghavanVorp'}));
+        end
+        
+        %==========================================================================
+        %% Suffix of the C assembly names selecting the precision of the matrix coefficients
+        function [suffix] = precision_suffix(obj, preconditioner)
+            % with DATA.Assembly.precision = 'single' all the matrices are
+            % assembled from local matrices rounded to single precision,
+            % with 'mixed' only those used to build a preconditioner; the
+            % residuals are always assembled in double precision
+            
+            if nargin < 2
+                preconditioner = false;
+            end
+            
+            if strcmp(obj.M_precision, 'single') || (preconditioner && strcmp(obj.M_precision, 'mixed'))
+                suffix = '_single';
+            else
+                suffix = '';
+            end
         end
         
         %==========================================================================
@@ -115,9 +115,32 @@ A_robin = SolidModel.assemble_ElasticRobinBC();
 t_assembly = toc(t_assembly);
 fprintf('done in %3.3f s\n', t_assembly);
 
-fprintf('\n -- Assembling internal Forces... ');
-t_assembly = tic;
-F_in      = SolidModel.compute_internal_forces(U_k);
+% with DATA.Assembly.matrix_free the jacobian is never assembled: the
+% linear systems are solved by gmres using jacobian-vector products
+matrix_free = DATA.Assembly.matrix_free;
+P_precon    = [];
+
+LinSolver = LinearSolver( DATA.LinearSolver );
+
+% symmetric direct solvers only read the upper triangle of the jacobian,
+% which is then assembled and constrained without expanding it
+upper_triangle = ~matrix_free && LinSolver.UsesUpperTriangle();
+if upper_triangle
+    A_robin_jac = triu(A_robin);
+else
+    A_robin_jac = A_robin;
+end
+
+if matrix_free
+    fprintf('\n -- Assembling internal Forces... ');
+    t_assembly = tic;
+    F_in       = SolidModel.compute_internal_forces(U_k);
+    dF_in      = [];
+else
+    fprintf('\n -- Assembling internal Forces and jacobian matrix... ');
+    t_assembly = tic;
+    [F_in, dF_in] = SolidModel.compute_internal_forces_jacobian(U_k, upper_triangle);
+end
 t_assembly = toc(t_assembly);
 fprintf('done in %3.3f s\n', t_assembly);
 
@@ -127,27 +150,58 @@ Residual = F_in(MESH.internal_dof) - F_ext;
 res0Norm = norm(full(Residual));
 resNorm_old = norm(full(Residual));
 
-LinSolver = LinearSolver( DATA.LinearSolver );
-
 fprintf('\n============ Start Newton Iterations ============\n\n');
 while (k <= maxIter && incrNorm > tolNewton && resRelNorm > tolNewton)
     
-    fprintf('\n -- Assembling jacobian matrix... ');
-    t_assembly = tic;
-    dF_in     = SolidModel.compute_jacobian(U_k);
-    t_assembly = toc(t_assembly);
-    fprintf('done in %3.3f s\n', t_assembly);
-    
-    % Apply boundary conditions
-    fprintf('\n -- Apply boundary conditions ... ');
-    t_assembly = tic;
-    A   =  CSM_ApplyBC(dF_in + A_robin, [], FE_SPACE, MESH, DATA, [], 1);
-    t_assembly = toc(t_assembly);
-    fprintf('done in %3.3f s\n', t_assembly);
+    if matrix_free
+        
+        TangentCache = [];
+        if DATA.Assembly.tangent_cache
+            fprintf('\n -- Computing material tangent... ');
+            t_assembly = tic;
+            TangentCache = SolidModel.compute_tangent_cache(U_k);
+            t_assembly = toc(t_assembly);
+            fprintf('done in %3.3f s\n', t_assembly);
+        end
+        A = @(V) CSM_JacobianVector(SolidModel, U_k, TangentCache, A_robin, MESH.internal_dof, V);
+        
+        % the preconditioner is built from the jacobian at the initial guess
+        if isempty(P_precon) && ~strcmp(DATA.Preconditioner.type, 'None')
+            fprintf('\n -- Assembling preconditioner matrix... ');
+            t_assembly = tic;
+            P_precon   =  CSM_ApplyBC(SolidModel.compute_jacobian(U_k, true) + A_robin, [], FE_SPACE, MESH, DATA, [], 1);
+            t_assembly = toc(t_assembly);
+            fprintf('done in %3.3f s\n', t_assembly);
+        end
+        
+    else
+        
+        % the jacobian is assembled together with the residual, unless the
+        % last update has been modified by backtracking
+        if isempty(dF_in)
+            fprintf('\n -- Assembling jacobian matrix... ');
+            t_assembly = tic;
+            dF_in     = SolidModel.compute_jacobian(U_k, [], upper_triangle);
+            t_assembly = toc(t_assembly);
+            fprintf('done in %3.3f s\n', t_assembly);
+        end
+        
+        % Apply boundary conditions
+        fprintf('\n -- Apply boundary conditions ... ');
+        t_assembly = tic;
+        A   =  CSM_ApplyBC(dF_in + A_robin_jac, [], FE_SPACE, MESH, DATA, [], 1, upper_triangle);
+        t_assembly = toc(t_assembly);
+        fprintf('done in %3.3f s\n', t_assembly);
+        
+        P_precon = A;
+        if upper_triangle && ~strcmp(DATA.Preconditioner.type, 'None')
+            P_precon = A + triu(A, 1).';
+        end
+    end
 
     % Solve
     fprintf('\n   -- Solve J x = -R ... ');    
-    Precon.Build( A );
+    Precon.Build( P_precon );
     fprintf('\n        time to build the preconditioner: %3.3f s \n', Precon.GetBuildTime());
     LinSolver.SetPreconditioner( Precon );
     dU(MESH.internal_dof) = LinSolver.Solve( A, -Residual );
@@ -160,9 +214,14 @@ while (k <= maxIter && incrNorm > tolNewton && resRelNorm > tolNewton)
     U_k_tmp     = U_k + dU;
     
     % Assemble residual
-    fprintf('\n   -- Assembling internal forces... ');
     t_assembly = tic;
-    F_in       = SolidModel.compute_internal_forces(U_k_tmp);
+    if matrix_free
+        fprintf('\n   -- Assembling internal forces... ');
+        F_in       = SolidModel.compute_internal_forces(U_k_tmp);
+    else
+        fprintf('\n   -- Assembling internal forces and jacobian matrix... ');
+        [F_in, dF_in] = SolidModel.compute_internal_forces_jacobian(U_k_tmp, upper_triangle);
+    end
     t_assembly = toc(t_assembly);
     fprintf('done in %3.3f s\n', t_assembly);
     
@@ -178,6 +237,7 @@ while (k <= maxIter && incrNorm > tolNewton && resRelNorm > tolNewton)
     
         alpha = alpha * backtrackFactor;
         backtrack_iter = backtrack_iter + 1;
+        dF_in = [];
         
         % update solution
         U_k_tmp     = U_k + alpha * dU;
@@ -231,3 +291,14 @@ if DATA.Output.ComputeVonMisesStress
 end
  
 return
+
+%% Matrix-free jacobian restricted to the internal dofs
+function JV = CSM_JacobianVector(SolidModel, U_k, TangentCache, A_robin, internal_dof, V)
+
+V_h               = zeros(length(U_k), 1);
+V_h(internal_dof) = V;
+
+JV = SolidModel.compute_jacobian_vector(U_k, V_h, TangentCache) + A_robin * V_h;
+JV = full( JV(internal_dof) );
+
+return
@@ -8,7 +8,7 @@
 #include <math.h>
 #include "blas.h"
 #include <string.h>
-#define INVJAC(i,j,k) invjac[i+(j+k*dim)*noe]
+#define INVJAC(i,j,k) invjac[i*invjacStrideE+(j+k*dim)*invjacStrideC]
 #define GRADREFPHI(i,j,k) gradrefphi[i+(j+k*NumQuadPoints)*nln]
 
 #include "../../Core/Tools.h"
@@ -17,6 +17,7 @@
 #include "MaterialModels/NeoHookeanMaterial.h"
 #include "MaterialModels/StVenantKirchhoffMaterial.h"
 #include "MaterialModels/RaghavanVorpMaterial.h"
+#include "MaterialModels/TangentOperator.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -28,6 +29,7 @@
 
 void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 {
+    SetOmpRuntime();
     
     /* Check for proper number of arguments. */
     
@@ -40,6 +42,7 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
     */
     
     char *Material_Model = mxArrayToString(prhs[1]);
+    CoefFormat coefFormat = ParseCoefFormat(Material_Model, &nrhs, prhs);
     double* dim_ptr = mxGetPr(prhs[0]);
     int dim     = (int)(dim_ptr[0]);
     
@@ -50,22 +53,46 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
     
     if (strcmp(Material_Model, "Linear_jacobianSlow")==0)
     {
-            LinearElasticMaterial_jacobian(plhs, prhs);
+            LinearElasticMaterial_jacobian(plhs, prhs, coefFormat);
     }
     
     if (strcmp(Material_Model, "Linear_jacobian")==0)
     {
         if (dim == 2)
         {
-            LinearElasticMaterial_jacobianFast2D(plhs, prhs);
+            LinearElasticMaterial_jacobianFast2D(plhs, prhs, coefFormat);
         }
         
         if (dim == 3)
         {
-            LinearElasticMaterial_jacobianFast3D(plhs, prhs);
+            LinearElasticMaterial_jacobianFast3D(plhs, prhs, coefFormat);
         }
     }
     
+    if (strcmp(Material_Model, "Linear_residual_jacobian")==0)
+    {
+            LinearElasticMaterial_residual_jacobian(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "Linear_jacobianSymmetric")==0)
+    {
+            LinearElasticMaterial_jacobianSymmetric(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "Linear_residual_jacobianSymmetric")==0)
+    {
+            LinearElasticMaterial_residual_jacobianSymmetric(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "Linear_jacobianVector")==0)
+    {
+        /* the internal forces are linear in the displacement: J*V = F_in(V) */
+        const mxArray* prhsV[11];
+        memcpy(prhsV, prhs, 11*sizeof(mxArray*));
+        prhsV[3] = prhs[11];
+        LinearElasticMaterial_forces(plhs, prhsV);
+    }
+    
     if (strcmp(Material_Model, "Linear_stress")==0)
     {
             LinearElasticMaterial_stress(plhs, prhs);
@@ -78,47 +105,105 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
     
     if (strcmp(Material_Model, "SEMMT_jacobianSlow")==0)
     {
-            SEMMTMaterial_jacobian(plhs, prhs);
+            SEMMTMaterial_jacobian(plhs, prhs, coefFormat);
     }
     
     if (strcmp(Material_Model, "SEMMT_jacobian")==0)
     {
         if (dim == 2)
         {
-            SEMMTMaterial_jacobianFast2D(plhs, prhs);
+            SEMMTMaterial_jacobianFast2D(plhs, prhs, coefFormat);
         }
         
         if (dim == 3)
         {
-            SEMMTMaterial_jacobianFast3D(plhs, prhs);
+            SEMMTMaterial_jacobianFast3D(plhs, prhs, coefFormat);
         }
     }
     
+    if (strcmp(Material_Model, "SEMMT_residual_jacobian")==0)
+    {
+            SEMMTMaterial_residual_jacobian(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "SEMMT_jacobianVector")==0)
+    {
+        /* the internal forces are linear in the displacement: J*V = F_in(V) */
+        const mxArray* prhsV[11];
+        memcpy(prhsV, prhs, 11*sizeof(mxArray*));
+        prhsV[3] = prhs[11];
+        SEMMTMaterial_forces(plhs, prhsV);
+    }
+    
     
     if (strcmp(Material_Model, "StVenantKirchhoff_forces")==0)
     {
+        if (dim == 3 && ELEMENT_BATCH > 1)
+        {
+            StVenantKirchhoffMaterial_forcesBatch3D(plhs, prhs);
+        }
+        else
+        {
             StVenantKirchhoffMaterial_forces(plhs, prhs);
+        }
     }
     
     if (strcmp(Material_Model, "StVenantKirchhoff_jacobianSlow")==0)
     {
-            StVenantKirchhoffMaterial_jacobian(plhs, prhs);
+            StVenantKirchhoffMaterial_jacobian(plhs, prhs, coefFormat);
     }
     
     if (strcmp(Material_Model, "StVenantKirchhoff_jacobian")==0)
+    {
+            StVenantKirchhoffMaterial_jacobianTangent(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "StVenantKirchhoff_jacobianSymbolic")==0)
     {
         if (dim == 2)
         {
-            StVenantKirchhoffMaterial_jacobianFast2D(plhs, prhs);
+            StVenantKirchhoffMaterial_jacobianFast2D(plhs, prhs, coefFormat);
         }
         
         if (dim == 3)
         {
-            StVenantKirchhoffMaterial_jacobianFast3D(plhs, prhs);
+            StVenantKirchhoffMaterial_jacobianFast3D(plhs, prhs, coefFormat);
         }
         
     }
     
+    if (strcmp(Material_Model, "StVenantKirchhoff_residual_jacobian")==0)
+    {
+            StVenantKirchhoffMaterial_residual_jacobian(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "StVenantKirchhoff_jacobianSymmetric")==0)
+    {
+            StVenantKirchhoffMaterial_jacobianSymmetric(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "StVenantKirchhoff_residual_jacobianSymmetric")==0)
+    {
+            StVenantKirchhoffMaterial_residual_jacobianSymmetric(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "StVenantKirchhoff_jacobianVector")==0)
+    {
+        if (nrhs > 12)
+        {
+            TangentOperator_jacobianVector(plhs, prhs);
+        }
+        else
+        {
+            StVenantKirchhoffMaterial_jacobianVector(plhs, prhs);
+        }
+    }
+    
+    if (strcmp(Material_Model, "StVenantKirchhoff_tangentCache")==0)
+    {
+            StVenantKirchhoffMaterial_tangentCache(plhs, prhs);
+    }
+    
     if (strcmp(Material_Model, "StVenantKirchhoff_stress")==0)
     {
             StVenantKirchhoffMaterial_stress(plhs, prhs);
@@ -126,17 +211,61 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
     
     if (strcmp(Material_Model, "NeoHookean_forces")==0)
     {
+        if (dim == 3 && ELEMENT_BATCH > 1)
+        {
+            NeoHookeanMaterial_forcesBatch3D(plhs, prhs);
+        }
+        else
+        {
             NeoHookeanMaterial_forces(plhs, prhs);
+        }
     }
     
     if (strcmp(Material_Model, "NeoHookean_jacobian")==0)
     {
-            NeoHookeanMaterial_jacobianFast(plhs, prhs);
+            NeoHookeanMaterial_jacobianTangent(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "NeoHookean_jacobianSymbolic")==0)
+    {
+            NeoHookeanMaterial_jacobianFast(plhs, prhs, coefFormat);
     }
     
     if (strcmp(Material_Model, "NeoHookean_jacobianSlow")==0)
     {
-            NeoHookeanMaterial_jacobian(plhs, prhs);
+            NeoHookeanMaterial_jacobian(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "NeoHookean_residual_jacobian")==0)
+    {
+            NeoHookeanMaterial_residual_jacobian(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "NeoHookean_jacobianSymmetric")==0)
+    {
+            NeoHookeanMaterial_jacobianSymmetric(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "NeoHookean_residual_jacobianSymmetric")==0)
+    {
+            NeoHookeanMaterial_residual_jacobianSymmetric(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "NeoHookean_jacobianVector")==0)
+    {
+        if (nrhs > 12)
+        {
+            TangentOperator_jacobianVector(plhs, prhs);
+        }
+        else
+        {
+            NeoHookeanMaterial_jacobianVector(plhs, prhs);
+        }
+    }
+    
+    if (strcmp(Material_Model, "NeoHookean_tangentCache")==0)
+    {
+            NeoHookeanMaterial_tangentCache(plhs, prhs);
     }
     
     if (strcmp(Material_Model, "NeoHookean_stress")==0)
@@ -146,22 +275,66 @@ void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
     
     if (strcmp(Material_Model, "NeoHookean_prestress")==0)
     {
-            NeoHookeanMaterial_prestress(plhs, prhs);
+            NeoHookeanMaterial_prestress(plhs, prhs, coefFormat);
     }
     
     if (strcmp(Material_Model, "RaghavanVorp_forces")==0)
     {
+        if (dim == 3 && ELEMENT_BATCH > 1)
+        {
+            RaghavanVorpMaterial_forcesBatch3D(plhs, prhs);
+        }
+        else
+        {
             RaghavanVorpMaterial_forces(plhs, prhs);
+        }
     }
     
     if (strcmp(Material_Model, "RaghavanVorp_jacobian")==0)
     {
-            RaghavanVorpMaterial_jacobianFast(plhs, prhs);
+            RaghavanVorpMaterial_jacobianTangent(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "RaghavanVorp_jacobianSymbolic")==0)
+    {
+            RaghavanVorpMaterial_jacobianFast(plhs, prhs, coefFormat);
     }
     
     if (strcmp(Material_Model, "RaghavanVorp_jacobianSlow")==0)
     {
-            RaghavanVorpMaterial_jacobian(plhs, prhs);
+            RaghavanVorpMaterial_jacobian(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "RaghavanVorp_residual_jacobian")==0)
+    {
+            RaghavanVorpMaterial_residual_jacobian(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "RaghavanVorp_jacobianSymmetric")==0)
+    {
+            RaghavanVorpMaterial_jacobianSymmetric(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "RaghavanVorp_residual_jacobianSymmetric")==0)
+    {
+            RaghavanVorpMaterial_residual_jacobianSymmetric(plhs, prhs, coefFormat);
+    }
+    
+    if (strcmp(Material_Model, "RaghavanVorp_jacobianVector")==0)
+    {
+        if (nrhs > 12)
+        {
+            TangentOperator_jacobianVector(plhs, prhs);
+        }
+        else
+        {
+            RaghavanVorpMaterial_jacobianVector(plhs, prhs);
+        }
+    }
+    
+    if (strcmp(Material_Model, "RaghavanVorp_tangentCache")==0)
+    {
+            RaghavanVorpMaterial_tangentCache(plhs, prhs);
     }
    
     if (strcmp(Material_Model, "RaghavanVorp_stress")==0)
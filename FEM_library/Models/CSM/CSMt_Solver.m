@@ -109,10 +109,17 @@ end
 SolidModel = CSM_Assembler( MESH, DATA, FE_SPACE );
 
 %% Assemble mass matrix
+% the mass operator computes M*U element by element; with a lumped mass
+% (DATA.Assembly.mass_type = 'rowsum' or 'HRZ') M is diagonal
 fprintf('\n Assembling mass matrix... ');
 t_assembly = tic;
-M    =  SolidModel.compute_mass();
-M    =  M * DATA.Density;
+MassOp = MassOperator( MESH, FE_SPACE, DATA.Assembly.mass_type, DATA.Density, DATA.Assembly.coloring );
+if MassOp.IsLumped()
+    M  =  MassOp.GetMatrix();
+else
+    M  =  SolidModel.compute_mass();
+    M  =  M * DATA.Density;
+end
 t_assembly = toc(t_assembly);
 fprintf('done in %3.3f s', t_assembly);
 
@@ -132,12 +139,27 @@ F_in_0   =  SolidModel.compute_internal_forces( u0 ) + A_robin * u0;
 t_assembly = toc(t_assembly);
 fprintf('done in %3.3f s\n', t_assembly)
 
-d2u0 = M \ (F_ext_0 - F_in_0);
+if MassOp.IsLumped()
+    d2u0 = (F_ext_0 - F_in_0) ./ MassOp.GetDiagonal();
+else
+    d2u0 = M \ (F_ext_0 - F_in_0);
+end
 
 TimeAdvance.Initialize( u0, du0, d2u0 );
 
 LinSolver = LinearSolver( DATA.LinearSolver );
 
+% symmetric direct solvers only read the upper triangle of the jacobian,
+% which is then assembled and constrained without expanding it
+upper_triangle = LinSolver.UsesUpperTriangle();
+if upper_triangle
+    M_jac       = triu(M);
+    A_robin_jac = triu(A_robin);
+else
+    M_jac       = M;
+    A_robin_jac = A_robin;
+end
+
 U_n = u0;
 
 %% Time Loop
@@ -172,27 +194,21 @@ while ( t < tf )
     t_assembly = toc(t_assembly);
     fprintf('done in %3.3f s\n', t_assembly);
     
-    fprintf('\n -- Assembling internal Forces ... ');
+    fprintf('\n -- Assembling internal Forces and Jacobian matrix... ');
     t_assembly = tic;
-    F_in      = SolidModel.compute_internal_forces( (1 - TimeAdvance.M_alpha_f) * U_k + TimeAdvance.M_alpha_f * U_n );
+    [F_in, dF_in] = SolidModel.compute_internal_forces_jacobian( (1 - TimeAdvance.M_alpha_f) * U_k + TimeAdvance.M_alpha_f * U_n, upper_triangle );
     t_assembly = toc(t_assembly);
     fprintf('done in %3.3f s\n', t_assembly);
     
-    Residual  = Coef_Mass * M * U_k + F_in - F_ext - M * Csi ...
+    Residual  = MassOp.Apply( Coef_Mass * U_k - Csi ) + F_in - F_ext ...
                 + A_robin * ((1 - TimeAdvance.M_alpha_f) * U_k + TimeAdvance.M_alpha_f * U_n);
             
-    fprintf('\n -- Assembling Jacobian matrix... ');
-    t_assembly = tic;
-    dF_in     = SolidModel.compute_jacobian( (1 - TimeAdvance.M_alpha_f) * U_k + TimeAdvance.M_alpha_f * U_n );
-    t_assembly = toc(t_assembly);
-    fprintf('done in %3.3f s\n', t_assembly);        
-            
-    Jacobian  = Coef_Mass * M + (1 - TimeAdvance.M_alpha_f) * dF_in + A_robin * (1 - TimeAdvance.M_alpha_f);
+    Jacobian  = Coef_Mass * M_jac + (1 - TimeAdvance.M_alpha_f) * dF_in + A_robin_jac * (1 - TimeAdvance.M_alpha_f);
     
     % Apply boundary conditions
     fprintf('\n -- Apply boundary conditions ... ');
     t_assembly = tic;
-    [A, b]   =  CSM_ApplyBC(Jacobian, -Residual, FE_SPACE, MESH, DATA, t, 1);
+    [A, b]   =  CSM_ApplyBC(Jacobian, -Residual, FE_SPACE, MESH, DATA, t, 1, upper_triangle);
     t_assembly = toc(t_assembly);
     fprintf('done in %3.3f s\n', t_assembly);
     
@@ -203,7 +219,11 @@ while ( t < tf )
         
         % Solve
         fprintf('\n   -- Solve J x = -R ... ');
-        Precon.Build( A );
+        if upper_triangle && ~strcmp(DATA.Preconditioner.type, 'None')
+            Precon.Build( A + triu(A, 1).' );
+        else
+            Precon.Build( A );
+        end
         fprintf('\n        time to build the preconditioner %3.3f s \n', Precon.GetBuildTime());
         LinSolver.SetPreconditioner( Precon );
         dU(MESH.internal_dof) = LinSolver.Solve( A, b );
@@ -220,20 +240,19 @@ while ( t < tf )
         % Assemble matrix and right-hand side
         fprintf('\n   -- Assembling internal forces... ');
         t_assembly = tic;
-        F_in      = SolidModel.compute_internal_forces( (1 - TimeAdvance.M_alpha_f) * U_k + TimeAdvance.M_alpha_f * U_n );
-        dF_in     = SolidModel.compute_jacobian( (1 - TimeAdvance.M_alpha_f) * U_k + TimeAdvance.M_alpha_f * U_n );
+        [F_in, dF_in] = SolidModel.compute_internal_forces_jacobian( (1 - TimeAdvance.M_alpha_f) * U_k + TimeAdvance.M_alpha_f * U_n, upper_triangle );
         t_assembly = toc(t_assembly);
         fprintf('done in %3.3f s\n', t_assembly);
         
-        Residual  = Coef_Mass * M * U_k + F_in - F_ext - M * Csi ...
+        Residual  = MassOp.Apply( Coef_Mass * U_k - Csi ) + F_in - F_ext ...
                     + A_robin * ((1 - TimeAdvance.M_alpha_f) * U_k + TimeAdvance.M_alpha_f * U_n);
             
-        Jacobian  = Coef_Mass * M + (1 - TimeAdvance.M_alpha_f) * dF_in + A_robin * (1 - TimeAdvance.M_alpha_f);
+        Jacobian  = Coef_Mass * M_jac + (1 - TimeAdvance.M_alpha_f) * dF_in + A_robin_jac * (1 - TimeAdvance.M_alpha_f);
 
         % Apply boundary conditions
         fprintf('\n   -- Apply boundary conditions ... ');
         t_assembly = tic;
-        [A, b]   =  CSM_ApplyBC(Jacobian, -Residual, FE_SPACE, MESH, DATA, t, 1);
+        [A, b]   =  CSM_ApplyBC(Jacobian, -Residual, FE_SPACE, MESH, DATA, t, 1, upper_triangle);
         t_assembly = toc(t_assembly);
         fprintf('done in %3.3f s\n', t_assembly);
         
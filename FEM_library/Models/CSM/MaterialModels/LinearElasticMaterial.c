@@ -14,32 +14,28 @@ void LinearElasticMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
     
-    plhs[0] = mxCreateDoubleMatrix(nln*noe*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln*noe*dim,1, mxREAL);
+    plhs[0] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+    plhs[1] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
     
-    double* myRrows    = mxGetPr(plhs[0]);
+    IndexArray myRrows    = GetIndexArray(plhs[0]);
     double* myRcoef    = mxGetPr(plhs[1]);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
     double gradphi[dim][nln][NumQuadPoints];
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double GradV[dim][dim];
-    double GradU[dim][dim];
     double GradUh[dim][dim][NumQuadPoints];
     
     double Id[dim][dim];
@@ -58,7 +54,6 @@ void LinearElasticMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
     
     double F[dim][dim];
     double EPS[dim][dim];
-    double dP[dim][dim];
     double P_Uh[dim][dim];
     
     double* material_param = mxGetPr(prhs[2]);
@@ -70,23 +65,15 @@ void LinearElasticMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myRrows,myRcoef,U_h) private(gradphi,F,EPS,dP,P_Uh,GradV,GradU,GradUh,ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h) private(gradphi,F,EPS,P_Uh,GradV,GradUh,ie,k,q,d1,d2) firstprivate(w,numRowsElements,nln,NumNodes,Id,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        for (k = 0; k < nln; k = k + 1 )
+        long long localRrows[nln*dim];
+
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
-            for (q = 0; q < NumQuadPoints; q = q + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
         }
         
         for (q = 0; q < NumQuadPoints; q = q + 1 )
@@ -98,17 +85,16 @@ void LinearElasticMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[d1][d2][q] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[d1][d2][q] = GradUh[d1][d2][q] + U_h[e_k] * gradphi[d2][k][q];
                     }
                 }
             }
         }
         
-        int iii = 0;
         int ii = 0;
-        int a, b, i_c, j_c;
+        int a, i_c;
         
         /* loop over test functions --> a */
         for (a = 0; a < nln; a = a + 1 )
@@ -161,16 +147,19 @@ void LinearElasticMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
                     rloc  = rloc + Mdot( dim, GradV, P_Uh) * w[q];
                 }
                                             
-                myRrows[ie*nln*dim+ii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                myRcoef[ie*nln*dim+ii] = rloc*detjac[ie];
+                localRrows[ii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                myRcoef[(mwSize) ie*nln*dim+ii] = rloc*detjac[ie];
                 ii = ii + 1;
             }
         }
-    }       
+        SetIndexBlock(myRrows, (mwSize) ie*nln*dim, localRrows, nln*dim);
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 /*************************************************************************/
 
-void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
+void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -178,31 +167,27 @@ void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
     double gradphi[dim][nln][NumQuadPoints];
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double GradV[dim][dim];
     double GradU[dim][dim];
@@ -225,7 +210,6 @@ void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     double F[dim][dim];
     double EPS[dim][dim];
     double dP[dim][dim];
-    double P_Uh[dim][dim];
     
     double* material_param = mxGetPr(prhs[2]);
     double Young = material_param[0];
@@ -236,23 +220,15 @@ void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(gradphi,F,EPS,dP,P_Uh,GradV,GradU,GradUh,ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,U_h) private(gradphi,F,EPS,dP,GradV,GradU,GradUh,ie,k,q,d1,d2) firstprivate(w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        for (k = 0; k < nln; k = k + 1 )
+        long long localArows[nln2*dim*dim], localAcols[nln2*dim*dim];
+
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
-            for (q = 0; q < NumQuadPoints; q = q + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
         }
         
         for (q = 0; q < NumQuadPoints; q = q + 1 )
@@ -264,8 +240,8 @@ void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[d1][d2][q] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[d1][d2][q] = GradUh[d1][d2][q] + U_h[e_k] * gradphi[d2][k][q];
                     }
                 }
@@ -273,7 +249,6 @@ void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
         }
         
         int iii = 0;
-        int ii = 0;
         int a, b, i_c, j_c;
         
         /* loop over test functions --> a */
@@ -343,9 +318,9 @@ void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                             }
                             aloc  = aloc + Mdot( dim, GradV, dP) * w[q];
                         }
-                        myArows[ie*nln2*dim*dim+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*dim*dim+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*dim*dim+iii] = aloc*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*dim*dim+iii, aloc*detjac[ie]);
                         
                         iii = iii + 1;
                     }
@@ -353,11 +328,15 @@ void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                 
             }
         }
-    }       
+        SetIndexBlock(myArows, ie*nln2*dim*dim, localArows, nln2*dim*dim);
+        SetIndexBlock(myAcols, ie*nln2*dim*dim, localAcols, nln2*dim*dim);
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 
 /*************************************************************************/
-void LinearElasticMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[])
+void LinearElasticMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -365,32 +344,25 @@ void LinearElasticMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[]
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
-    double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
-    int d1,d2;
     
     double* material_param = mxGetPr(prhs[2]);
     double Young = material_param[0];
@@ -401,26 +373,18 @@ void LinearElasticMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[]
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef) private(ie,q) firstprivate(w,numRowsElements,nln2,nln,NumNodes,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localArows[nln2*9], localAcols[nln2*9];
+
         double gradphi[NumQuadPoints][dim][nln];
         
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[q][d1][k] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[q][d1][k] = gradphi[q][d1][k] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[q][0][0], nln, 1);
         }
         
         int iii = 0;
@@ -486,19 +450,22 @@ void LinearElasticMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[]
                     /* loop over trial components --> j_c */
                     for (j_c = 0; j_c < 3; j_c = j_c + 1 )
                     {
-                        myArows[ie*nln2*9+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*9+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*9+iii] = aloc[a][i_c][b][j_c]*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*9+iii, aloc[a][i_c][b][j_c]*detjac[ie]);
                         iii = iii + 1;
                     }
                 }
             }
         }
+        SetIndexBlock(myArows, ie*nln2*9, localArows, nln2*9);
+        SetIndexBlock(myAcols, ie*nln2*9, localAcols, nln2*9);
     }
     
+    ReleaseIndexData(elements, prhs[4]);
 }
 /*************************************************************************/
-void LinearElasticMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[])
+void LinearElasticMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -506,32 +473,25 @@ void LinearElasticMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[]
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
-    double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
-    int d1,d2;
     
     double* material_param = mxGetPr(prhs[2]);
     double Young = material_param[0];
@@ -542,26 +502,18 @@ void LinearElasticMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[]
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef) private(ie,q) firstprivate(w,numRowsElements,nln2,nln,NumNodes,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localArows[nln2*4], localAcols[nln2*4];
+
         double gradphi[NumQuadPoints][dim][nln];
         
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[q][d1][k] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[q][d1][k] = gradphi[q][d1][k] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[q][0][0], nln, 1);
         }
         
         int iii = 0;
@@ -616,16 +568,19 @@ void LinearElasticMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[]
                     /* loop over trial components --> j_c */
                     for (j_c = 0; j_c < 2; j_c = j_c + 1 )
                     {
-                        myArows[ie*nln2*4+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*4+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*4+iii] = aloc[a][i_c][b][j_c]*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*4+iii, aloc[a][i_c][b][j_c]*detjac[ie]);
                         iii = iii + 1;
                     }
                 }
             }
         }
+        SetIndexBlock(myArows, ie*nln2*4, localArows, nln2*4);
+        SetIndexBlock(myAcols, ie*nln2*4, localAcols, nln2*4);
     }
     
+    ReleaseIndexData(elements, prhs[4]);
 }
 /*************************************************************************/
 
@@ -637,8 +592,7 @@ void LinearElasticMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
     
     plhs[0] = mxCreateDoubleMatrix(noe,dim*dim, mxREAL);
     plhs[1] = mxCreateDoubleMatrix(noe,dim*dim, mxREAL);
@@ -646,20 +600,16 @@ void LinearElasticMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
     double* P        = mxGetPr(plhs[0]);
     double* Sigma    = mxGetPr(plhs[1]);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
-    double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
-    double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
     double gradphi[dim][nln];
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double GradUh[dim][dim];
     
@@ -689,22 +639,12 @@ void LinearElasticMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,U_h) private(gradphi,F,EPS,GradUh,ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(elements,U_h) private(gradphi,F,EPS,GradUh,ie,k,q,d1,d2) firstprivate(numRowsElements,nln,NumNodes,Id,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
         q = 0;
-        for (k = 0; k < nln; k = k + 1 )
-        {
-            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-            {
-                gradphi[d1][k] = 0;
-                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                {
-                    gradphi[d1][k] = gradphi[d1][k] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                }
-            }
-        }
+        GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0], nln, 1);
         
         for (d1 = 0; d1 < dim; d1 = d1 + 1 )
         {
@@ -713,8 +653,8 @@ void LinearElasticMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
                 GradUh[d1][d2] = 0;
                 for (k = 0; k < nln; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                     GradUh[d1][d2] = GradUh[d1][d2] + U_h[e_k] * gradphi[d2][k];
                 }
                 F[d1][d2] = Id[d1][d2] + GradUh[d1][d2];
@@ -741,5 +681,244 @@ void LinearElasticMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
         }
         
     }
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
-/*************************************************************************/
\ No newline at end of file
+/*************************************************************************/
+
+/*************************************************************************/
+/* Internal forces of a material law which is linear in the displacement,
+ * computed as the product of the element matrices plhs[0..2] (ordered as
+ * in the jacobian assemblers) with the local displacements. The row
+ * indices and the coefficients are returned in plhs[3], plhs[4] */
+void LinearElasticMaterial_forcesFromJacobian(mxArray* plhs[], const mxArray* prhs[])
+{
+    
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[4]);
+    double* nln_ptr = mxGetPr(prhs[5]);
+    int nln     = (int)(nln_ptr[0]);
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize localSize = nln*dim;
+    
+    plhs[3] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+    plhs[4] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
+    
+    IndexArray myRrows    = GetIndexArray(plhs[3]);
+    double* myRcoef    = mxGetPr(plhs[4]);
+    double* myAcoef    = mxGetPr(plhs[2]);
+    
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
+    double* U_h   = mxGetPr(prhs[3]);
+    long long* elements  = GetIndexData(prhs[4]);
+    
+    int ie;
+    
+#pragma omp parallel for schedule(runtime) shared(elements,myRrows,myRcoef,myAcoef,U_h) private(ie) firstprivate(numRowsElements,nln,dim,localSize,NumNodes)
+    
+    for (ie = 0; ie < noe; ie = ie + 1 )
+    {
+        long long localRrows[nln*dim];
+
+        int a, b, i_c, j_c;
+        int ii = 0;
+        double Uloc[localSize];
+        double* aloc = myAcoef + (mwSize)ie*localSize*localSize;
+        
+        for (b = 0; b < nln; b = b + 1 )
+        {
+            for (j_c = 0; j_c < dim; j_c = j_c + 1 )
+            {
+                Uloc[b*dim+j_c] = U_h[elements[b+ie*numRowsElements] + j_c * NumNodes - 1];
+            }
+        }
+        
+        for (a = 0; a < nln; a = a + 1 )
+        {
+            for (i_c = 0; i_c < dim; i_c = i_c + 1 )
+            {
+                double rloc = 0;
+                int jj;
+                for (jj = 0; jj < localSize; jj = jj + 1 )
+                {
+                    rloc = rloc + aloc[ii*localSize+jj] * Uloc[jj];
+                }
+                localRrows[ii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                myRcoef[(mwSize) ie*nln*dim+ii] = rloc;
+                ii = ii + 1;
+            }
+        }
+        SetIndexBlock(myRrows, (mwSize) ie*nln*dim, localRrows, nln*dim);
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Internal forces and jacobian assembled in a single pass over the elements */
+void LinearElasticMaterial_residual_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    
+    if (dim == 2)
+    {
+        LinearElasticMaterial_jacobianFast2D(plhs, prhs, coefFormat);
+    }
+    else
+    {
+        LinearElasticMaterial_jacobianFast3D(plhs, prhs, coefFormat);
+    }
+    
+    if (mxIsSingle(plhs[2]) || coefFormat.map)
+    {
+        /* the residual is not computed from the rounded or already
+         * scattered jacobian */
+        mxArray* plhsF[2];
+        LinearElasticMaterial_forces(plhsF, prhs);
+        plhs[3] = plhsF[0];
+        plhs[4] = plhsF[1];
+    }
+    else
+    {
+        LinearElasticMaterial_forcesFromJacobian(plhs, prhs);
+    }
+}
+/*************************************************************************/
+/*************************************************************************/
+
+/*************************************************************************/
+/* Upper triangle (a,i_c) <= (b,j_c) of the local matrices of a batch of
+ * elements, computed from the constant tangent
+ * A[i][J][k][L] = mu (d_ik d_JL + d_iL d_Jk) + lambda d_iJ d_kL */
+FORCE_INLINE void LinearElasticMaterial_jacobianSymmetric_batch(const int dim, const int ie0, const int nb, const int nln, const int NumQuadPoints, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* w,
+        const double* detjac, const GeometryCache GeoCache, const double mu, const double lambda, IndexArray myArows, IndexArray myAcols, CoefArray myAcoef)
+{
+    int q, a, b, i_c, j_c, d1, l;
+    
+    double gradphi[dim][nln][ELEMENT_BATCH];
+    double aloc[nln][dim][nln][dim][ELEMENT_BATCH];
+    
+    memset(aloc, 0, sizeof(aloc));
+    
+    for (q = 0; q < NumQuadPoints; q = q + 1 )
+    {
+        BatchGradients(dim, ie0, nb, q, nln, &GeoCache, gradphi);
+        
+        for (b = 0; b < nln; b = b + 1 )
+        {
+            for (a = 0; a <= b; a = a + 1 )
+            {
+                double gradab[ELEMENT_BATCH];
+                #pragma omp simd
+                for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                {
+                    gradab[l] = 0;
+                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+                    {
+                        gradab[l] = gradab[l] + gradphi[d1][a][l] * gradphi[d1][b][l];
+                    }
+                }
+                
+                for (j_c = 0; j_c < dim; j_c = j_c + 1 )
+                {
+                    for (i_c = 0; i_c < (a == b ? j_c + 1 : dim); i_c = i_c + 1 )
+                    {
+                        double delta = (i_c == j_c) ? 1.0 : 0.0;
+                        #pragma omp simd
+                        for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                        {
+                            aloc[a][i_c][b][j_c][l] = aloc[a][i_c][b][j_c][l] + w[q] * (
+                                    mu * ( delta * gradab[l] + gradphi[j_c][a][l] * gradphi[i_c][b][l] )
+                                    + lambda * gradphi[i_c][a][l] * gradphi[j_c][b][l] );
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    BatchScatterMatrixSymmetric(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, aloc, myArows, myAcols, myAcoef);
+}
+
+/*************************************************************************/
+/* Upper triangle of the jacobian, see SetSymmetricIndex */
+void LinearElasticMaterial_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[4]);
+    double* nln_ptr = mxGetPr(prhs[5]);
+    int nln     = (int)(nln_ptr[0]);
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize localSize = nln*dim*(nln*dim+1)/2;
+    
+    CreateMatrixOutputs(plhs, localSize*noe, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
+    
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
+    
+    int NumQuadPoints     = mxGetN(prhs[6]);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
+    
+    double* w   = mxGetPr(prhs[6]);
+    double* detjac = mxGetPr(prhs[8]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
+    
+    long long* elements  = GetIndexData(prhs[4]);
+    
+    double* material_param = mxGetPr(prhs[2]);
+    double Young = material_param[0];
+    double Poisson = material_param[1];
+    double mu = Young / (2 + 2 * Poisson);
+    double lambda =  Young * Poisson /( (1+Poisson) * (1-2*Poisson) );
+    
+    /* Assembly: loop over batches of ELEMENT_BATCH elements */
+    int numBatches = (noe + ELEMENT_BATCH - 1) / ELEMENT_BATCH;
+    int ib;
+    
+    if (dim == 2)
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,mu,lambda)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            LinearElasticMaterial_jacobianSymmetric_batch(2, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, w,
+                    detjac, GeoCache, mu, lambda, myArows, myAcols, myAcoef);
+        }
+    }
+    else
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,mu,lambda)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            LinearElasticMaterial_jacobianSymmetric_batch(3, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, w,
+                    detjac, GeoCache, mu, lambda, myArows, myAcols, myAcoef);
+        }
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* As LinearElasticMaterial_residual_jacobian with the upper triangle of the
+ * jacobian; the internal forces are returned in plhs[3], plhs[4] */
+void LinearElasticMaterial_residual_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    mxArray* plhsF[2];
+    
+    LinearElasticMaterial_jacobianSymmetric(plhs, prhs, coefFormat);
+    LinearElasticMaterial_forces(plhsF, prhs);
+    plhs[3] = plhsF[0];
+    plhs[4] = plhsF[1];
+}
+/*************************************************************************/
@@ -10,20 +10,25 @@
 #include <string.h>
 #include "../../../Core/Tools.h"
 
-#define INVJAC(i,j,k) invjac[i+(j+k*dim)*noe]
-#define GRADREFPHI(i,j,k) gradrefphi[i+(j+k*NumQuadPoints)*nln]
-
 #ifndef LEMATERIAL_H_INCLUDED
 #define LEMATERIAL_H_INCLUDED
 
 void LinearElasticMaterial_forces(mxArray* plhs[], const mxArray* prhs[]);
 
-void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[]);
+void LinearElasticMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
-void LinearElasticMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[]);
+void LinearElasticMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
-void LinearElasticMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[]);
+void LinearElasticMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
 void LinearElasticMaterial_stress(mxArray* plhs[], const mxArray* prhs[]);
 
+void LinearElasticMaterial_forcesFromJacobian(mxArray* plhs[], const mxArray* prhs[]);
+
+void LinearElasticMaterial_residual_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void LinearElasticMaterial_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void LinearElasticMaterial_residual_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
 #endif
@@ -5,7 +5,91 @@
 
 #include "NeoHookeanMaterial.h"
 
+/*************************************************************************/
+/* Element contribution to the internal forces. dim is a compile-time
+ * constant at each call site, so that the small tensor kernels of Tools.h
+ * are specialized for 2D and 3D */
+FORCE_INLINE void NeoHookeanMaterial_forces_element(const int dim, const int ie, const int nln, const int NumQuadPoints, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* U_h, const double* w,
+        const double* detjac, const GeometryCache GeoCache, const double mu, const double bulk, IndexArray myRrows, double* myRcoef)
+{
+    long long localRrows[nln*dim];
 
+    int k, q, d1, d2;
+    
+    double F[dim][dim];
+    double invFT[dim][dim];
+    double C[dim][dim];
+    double P_Uh[NumQuadPoints][dim][dim];
+    
+    double gradphi[dim][nln][NumQuadPoints];
+    
+    for (q = 0; q < NumQuadPoints; q = q + 1 )
+    {
+        /* Compute Gradient of Basis functions*/
+        GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
+        
+        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+        {
+            for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+            {
+                double GradUh = 0;
+                for (k = 0; k < nln; k = k + 1 )
+                {
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
+                    GradUh = GradUh + U_h[e_k] * gradphi[d2][k][q];
+                }
+                F[d1][d2] = (d1 == d2 ? 1.0 : 0.0) + GradUh;
+            }
+        }
+        double detF = MatrixDeterminant(dim, F);
+        MatrixInvT(dim, F, invFT );
+        MatrixProductAlphaT1(dim, 1.0, F, F, C );
+        double logdetF = log( detF );
+        double pow23detF = pow(detF, -2.0 / 3.0);
+        double pow2detF = pow(detF, 2.0);
+        double I_C = Trace(dim, C);
+        
+        /* First Piola-Kirchhoff stress tensor, independent of the test function */
+        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+        {
+            for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+            {
+                P_Uh[q][d1][d2] = mu * pow23detF * ( F[d1][d2] - 1.0 / 3.0 * I_C * invFT[d1][d2] )
+                                  + 1.0 / 2.0 * bulk * ( pow2detF - detF + logdetF ) * invFT[d1][d2];
+            }
+        }
+    }
+    
+    int ii = 0;
+    int a, i_c;
+    
+    /* loop over test functions --> a */
+    for (a = 0; a < nln; a = a + 1 )
+    {
+        /* loop over test components --> i_c */
+        for (i_c = 0; i_c < dim; i_c = i_c + 1 )
+        {
+            /* GradV has only the i_c-th row different from zero */
+            double rloc = 0;
+            for (q = 0; q < NumQuadPoints; q = q + 1 )
+            {
+                double GradV_P = 0;
+                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+                {
+                    GradV_P = GradV_P + gradphi[d2][a][q] * P_Uh[q][i_c][d2];
+                }
+                rloc = rloc + GradV_P * w[q];
+            }
+            
+            localRrows[ii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+            myRcoef[(mwSize) ie*nln*dim+ii] = rloc*detjac[ie];
+            ii = ii + 1;
+        }
+    }
+    SetIndexBlock(myRrows, (mwSize) ie*nln*dim, localRrows, nln*dim);
+}
 /*************************************************************************/
 void NeoHookeanMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
 {
@@ -15,42 +99,23 @@ void NeoHookeanMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
     
-    plhs[0] = mxCreateDoubleMatrix(nln*noe*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln*noe*dim,1, mxREAL);
+    plhs[0] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+    plhs[1] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
     
-    double* myRrows    = mxGetPr(plhs[0]);
+    IndexArray myRrows    = GetIndexArray(plhs[0]);
     double* myRcoef    = mxGetPr(plhs[1]);
     
-    int k,l;
-    int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
-    
-    double* elements  = mxGetPr(prhs[4]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
-    double Id[dim][dim];
-    int d1,d2;
-    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-    {
-        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-        {
-            Id[d1][d2] = 0;
-            if (d1==d2)
-            {
-                Id[d1][d2] = 1;
-            }
-        }
-    }
+    long long* elements  = GetIndexData(prhs[4]);
     
     double* material_param = mxGetPr(prhs[2]);
     double Young = material_param[0];
@@ -59,122 +124,36 @@ void NeoHookeanMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
     double lambda =  Young * Poisson /( (1.0 + Poisson) * (1.0-2.0*Poisson) );
     double bulk = ( 2.0 / 3.0 ) * mu + lambda;
     
-    /* Assembly: loop over the elements */
+    /* Assembly: loop over the elements. The dimension is selected once,
+     * outside the element loop */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myRrows,myRcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,NumQuadPoints,numRowsElements,nln2,nln,NumNodes,Id,mu,bulk)
-    
-    for (ie = 0; ie < noe; ie = ie + 1 )
-    {             
-        double I_C[NumQuadPoints];
-        double detF[NumQuadPoints];
-        double logdetF[NumQuadPoints];
-        double pow23detF[NumQuadPoints];
-        double pow2detF[NumQuadPoints];
-        
-        double F[NumQuadPoints][dim][dim];
-        double invFT[NumQuadPoints][dim][dim];
-        double C[NumQuadPoints][dim][dim];
-        
-        double dP[dim][dim];
-        double P_Uh[dim][dim];
-        
-        double GradV[dim][dim];
-        double GradUh[NumQuadPoints][dim][dim];
-        
-        double gradphi[dim][nln][NumQuadPoints];
-
-        for (q = 0; q < NumQuadPoints; q = q + 1 )
+    if (dim == 2)
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h) private(ie) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,mu,bulk)
+        for (ie = 0; ie < noe; ie = ie + 1 )
         {
-            /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
-            
-            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-            {
-                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                {
-                    GradUh[q][d1][d2] = 0;
-                    for (k = 0; k < nln; k = k + 1 )
-                    {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
-                        GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphi[d2][k][q];
-                    }
-                    F[q][d1][d2]  = Id[d1][d2] + GradUh[q][d1][d2];
-                }
-            }
-            detF[q] = MatrixDeterminant(dim, F[q]);
-            MatrixInvT(dim, F[q], invFT[q] );
-            MatrixProductAlphaT1(dim, 1.0, F[q], F[q], C[q] );
-            logdetF[q] = log( detF[q] );
-            pow23detF[q] = pow(detF[q], -2.0 / 3.0);
-            pow2detF[q] = pow(detF[q], 2.0);
-            I_C[q] = Trace(dim, C[q]);
+            NeoHookeanMaterial_forces_element(2, ie, nln, NumQuadPoints, numRowsElements, NumNodes, elements, U_h, w,
+                    detjac, GeoCache, mu, bulk, myRrows, myRcoef);
         }
-
-        int iii = 0;
-        int ii = 0;
-        int a, b, i_c, j_c;
-        
-        /* loop over test functions --> a */
-        for (a = 0; a < nln; a = a + 1 )
+    }
+    else
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h) private(ie) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,mu,bulk)
+        for (ie = 0; ie < noe; ie = ie + 1 )
         {
-            /* loop over test components --> i_c */
-            for (i_c = 0; i_c < dim; i_c = i_c + 1 )
-            {
-                /* set gradV to zero*/
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        GradV[d1][d2] = 0;
-                    }
-                }
-                
-                double rloc = 0;
-                for (q = 0; q < NumQuadPoints; q = q + 1 )
-                {
-                    
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        GradV[i_c][d2] = gradphi[d2][a][q];
-                    }
-                    
-                    double P1[dim][dim];
-                    for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                    {
-                        for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                        {                            
-                            P_Uh[d1][d2] =  mu * pow23detF[q] * ( F[q][d1][d2] - 1.0 / 3.0 * I_C[q]  * invFT[q][d1][d2] ) 
-                                            + 1.0 / 2.0 * bulk * ( pow2detF[q] - detF[q] + logdetF[q] ) * invFT[q][d1][d2];                            
-                        }
-                    }
-                    rloc  = rloc + Mdot( dim, GradV, P_Uh) * w[q];
-                }
-                                            
-                myRrows[ie*nln*dim+ii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                myRcoef[ie*nln*dim+ii] = rloc*detjac[ie];
-                ii = ii + 1;
-            }
+            NeoHookeanMaterial_forces_element(3, ie, nln, NumQuadPoints, numRowsElements, NumNodes, elements, U_h, w,
+                    detjac, GeoCache, mu, bulk, myRrows, myRcoef);
         }
     }
-        
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 /*************************************************************************/
 
 
 /*************************************************************************/
-void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
+void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -182,30 +161,26 @@ void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double Id[dim][dim];
     int d1,d2;
@@ -231,10 +206,12 @@ void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,NumQuadPoints,numRowsElements,nln2,nln,NumNodes,Id,mu,bulk)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,q,d1,d2) firstprivate(w,NumQuadPoints,numRowsElements,nln2,nln,NumNodes,Id,mu,bulk)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {             
+        long long localArows[nln2*dim*dim], localAcols[nln2*dim*dim];
+
         double I_C[NumQuadPoints];
         double detF[NumQuadPoints];
         double logdetF[NumQuadPoints];
@@ -246,7 +223,6 @@ void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
         double C[NumQuadPoints][dim][dim];
         
         double dP[dim][dim];
-        double P_Uh[dim][dim];
         
         double GradV[dim][dim];
         double GradU[dim][dim];
@@ -257,17 +233,7 @@ void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
@@ -276,8 +242,8 @@ void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[q][d1][d2] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphi[d2][k][q];
                     }
                     F[q][d1][d2]  = Id[d1][d2] + GradUh[q][d1][d2];
@@ -293,7 +259,6 @@ void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
         }
 
         int iii = 0;
-        int ii = 0;
         int a, b, i_c, j_c;
         
         /* loop over test functions --> a */
@@ -338,7 +303,6 @@ void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                             
                             /* volumetric part */
                             double dP_vol[dim][dim];
-                            double dP_vol1[dim][dim];
                             double dP_vol2_tmp[dim][dim];
                             double dP_vol2[dim][dim];
                             
@@ -351,7 +315,6 @@ void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                             MatrixSum(dim, dP_vol, dP_vol2);
                             
                             /* isochoric part */
-                            double dP_iso[dim][dim];
                             double dP_iso1[dim][dim];
                             double dP_iso24[dim][dim];
                             double dP_iso3[dim][dim];
@@ -388,9 +351,9 @@ void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                             }
                             aloc  = aloc + Mdot( dim, GradV, dP) * w[q];
                         }
-                        myArows[ie*nln2*dim*dim+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*dim*dim+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*dim*dim+iii] = aloc*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*dim*dim+iii, aloc*detjac[ie]);
                         
                         iii = iii + 1;
                     }
@@ -398,11 +361,14 @@ void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                 
             }
         }
+        SetIndexBlock(myArows, ie*nln2*dim*dim, localArows, nln2*dim*dim);
+        SetIndexBlock(myAcols, ie*nln2*dim*dim, localAcols, nln2*dim*dim);
     }
-        
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 /*************************************************************************/
-void NeoHookeanMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[])
+void NeoHookeanMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -410,30 +376,26 @@ void NeoHookeanMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double Id[dim][dim];
     int d1,d2;
@@ -459,10 +421,12 @@ void NeoHookeanMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,NumQuadPoints,numRowsElements,nln2,nln,NumNodes,Id,mu,bulk)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,q,d1,d2) firstprivate(w,NumQuadPoints,numRowsElements,nln2,nln,NumNodes,Id,mu,bulk)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {             
+        long long localArows[nln2*9], localAcols[nln2*9];
+
         double I_C[NumQuadPoints];
         double detF[NumQuadPoints];
         double logdetF[NumQuadPoints];
@@ -479,17 +443,7 @@ void NeoHookeanMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[])
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[q][d1][k] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[q][d1][k] = gradphi[q][d1][k] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[q][0][0], nln, 1);
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
@@ -498,8 +452,8 @@ void NeoHookeanMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[q][d1][d2] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphi[q][d2][k];
                     }
                     F[q][d1][d2]  = Id[d1][d2] + GradUh[q][d1][d2];
@@ -578,21 +532,24 @@ void NeoHookeanMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[])
                     /* loop over trial components --> j_c */
                     for (j_c = 0; j_c < 3; j_c = j_c + 1 )
                     {
-                        myArows[ie*nln2*9+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*9+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*9+iii] = aloc[a][i_c][b][j_c]*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*9+iii, aloc[a][i_c][b][j_c]*detjac[ie]);
                         iii = iii + 1;
                     }
                 }
             }
         }
+        SetIndexBlock(myArows, ie*nln2*9, localArows, nln2*9);
+        SetIndexBlock(myAcols, ie*nln2*9, localAcols, nln2*9);
     }
-        
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 
 
 /*************************************************************************/
-void NeoHookeanMaterial_prestress(mxArray* plhs[], const mxArray* prhs[])
+void NeoHookeanMaterial_prestress(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -600,40 +557,36 @@ void NeoHookeanMaterial_prestress(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    plhs[3] = mxCreateDoubleMatrix(nln*noe*dim,1, mxREAL);
-    plhs[4] = mxCreateDoubleMatrix(nln*noe*dim,1, mxREAL);
+    plhs[3] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+    plhs[4] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
         
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    double* myRrows    = mxGetPr(plhs[3]);
+    IndexArray myRrows    = GetIndexArray(plhs[3]);
     double* myRcoef    = mxGetPr(plhs[4]);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
-    plhs[5] = mxCreateDoubleMatrix(noe*NumQuadPoints*dim*dim, 1, mxREAL);
+    plhs[5] = CreateElementMatrix(noe*NumQuadPoints*dim*dim, 1, noe);
     double* S_np1 = mxGetPr(plhs[5]);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     double* S_0  = mxGetPr(prhs[11]);
     
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double Id[dim][dim];
     int d1,d2;
@@ -659,10 +612,13 @@ void NeoHookeanMaterial_prestress(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,S_np1,U_h,S_0) private(ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,NumQuadPoints,numRowsElements,nln2,nln,NumNodes,Id,mu,bulk)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,S_np1,U_h,S_0) private(ie,k,q,d1,d2) firstprivate(w,NumQuadPoints,numRowsElements,nln2,nln,NumNodes,Id,mu,bulk)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {             
+        long long localArows[nln2*9], localAcols[nln2*9];
+        long long localRrows[nln*3];
+
         double I_C[NumQuadPoints];
         double detF[NumQuadPoints];
         double logdetF[NumQuadPoints];
@@ -682,17 +638,7 @@ void NeoHookeanMaterial_prestress(mxArray* plhs[], const mxArray* prhs[])
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[q][d1][k] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[q][d1][k] = gradphi[q][d1][k] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[q][0][0], nln, 1);
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
@@ -701,8 +647,8 @@ void NeoHookeanMaterial_prestress(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[q][d1][d2] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphi[q][d2][k];
                     }
                     F[q][d1][d2]  = Id[d1][d2] + GradUh[q][d1][d2];
@@ -787,9 +733,9 @@ void NeoHookeanMaterial_prestress(mxArray* plhs[], const mxArray* prhs[])
                     /* loop over trial components --> j_c */
                     for (j_c = 0; j_c < 3; j_c = j_c + 1 )
                     {
-                        myArows[ie*nln2*9+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*9+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*9+iii] = aloc[a][i_c][b][j_c]*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*9+iii, aloc[a][i_c][b][j_c]*detjac[ie]);
                         iii = iii + 1;
                     }
                 }
@@ -827,15 +773,19 @@ void NeoHookeanMaterial_prestress(mxArray* plhs[], const mxArray* prhs[])
             for (i_c = 0; i_c < 3; i_c = i_c + 1 )
             {
                 
-                myRrows[ie*nln*3+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                myRcoef[ie*nln*3+iii] = rloc[a][i_c]*detjac[ie];
+                localRrows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                myRcoef[(mwSize) ie*nln*3+iii] = rloc[a][i_c]*detjac[ie];
                 iii = iii + 1;
             }
             
         }
         
+        SetIndexBlock(myArows, ie*nln2*9, localArows, nln2*9);
+        SetIndexBlock(myAcols, ie*nln2*9, localAcols, nln2*9);
+        SetIndexBlock(myRrows, (mwSize) ie*nln*3, localRrows, nln*3);
     }
-        
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 /*************************************************************************/
 
@@ -847,8 +797,7 @@ void NeoHookeanMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
     
     plhs[0] = mxCreateDoubleMatrix(noe,dim*dim, mxREAL);
     plhs[1] = mxCreateDoubleMatrix(noe,dim*dim, mxREAL);
@@ -856,20 +805,16 @@ void NeoHookeanMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
     double* P        = mxGetPr(plhs[0]);
     double* Sigma    = mxGetPr(plhs[1]);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
-    double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
-    double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
     double gradphi[dim][nln][NumQuadPoints];
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double GradUh[dim][dim][NumQuadPoints];
     
@@ -897,11 +842,10 @@ void NeoHookeanMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,Sigma,U_h) private(gradphi,GradUh,ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,bulk)
+#pragma omp parallel for schedule(runtime) shared(elements,Sigma,U_h) private(gradphi,GradUh,ie,k,q,d1,d2) firstprivate(numRowsElements,nln,NumNodes,Id,mu,bulk)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        double traceE[NumQuadPoints];
         
         double F[NumQuadPoints][dim][dim];
         double P_Uh[dim][dim];
@@ -916,17 +860,7 @@ void NeoHookeanMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
         q = 0;
         
         /* Compute Gradient of Basis functions*/
-        for (k = 0; k < nln; k = k + 1 )
-        {
-            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-            {
-                gradphi[d1][k][q] = 0;
-                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                {
-                    gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                }
-            }
-        }
+        GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
         
         for (d1 = 0; d1 < dim; d1 = d1 + 1 )
         {
@@ -935,8 +869,8 @@ void NeoHookeanMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
                 GradUh[d1][d2][q] = 0;
                 for (k = 0; k < nln; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                     GradUh[d1][d2][q] = GradUh[d1][d2][q] + U_h[e_k] * gradphi[d2][k][q];
                 }
                 F[q][d1][d2]  = Id[d1][d2] + GradUh[d1][d2][q];
@@ -955,7 +889,6 @@ void NeoHookeanMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
         pow2detF[q] = pow(detF[q], 2.0);
         I_C[q] = Trace(dim, C[q]);
         
-        double P1[dim][dim];
         for (d1 = 0; d1 < dim; d1 = d1 + 1 )
         {
             for (d2 = 0; d2 < dim; d2 = d2 + 1 )
@@ -986,5 +919,512 @@ void NeoHookeanMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
         }
     }
     
+    ReleaseIndexData(elements, prhs[4]);
 }
-/*************************************************************************/
\ No newline at end of file
+/*************************************************************************/
+
+/*************************************************************************/
+/* Element-batched internal forces (3D), see ELEMENT_BATCH in Tools.h */
+void NeoHookeanMaterial_forcesBatch3D(mxArray* plhs[], const mxArray* prhs[])
+{
+    
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[4]);
+    double* nln_ptr = mxGetPr(prhs[5]);
+    int nln     = (int)(nln_ptr[0]);
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    
+    plhs[0] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+    plhs[1] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
+    
+    IndexArray myRrows    = GetIndexArray(plhs[0]);
+    double* myRcoef    = mxGetPr(plhs[1]);
+    
+    int NumQuadPoints     = mxGetN(prhs[6]);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
+    
+    double* U_h   = mxGetPr(prhs[3]);
+    double* w   = mxGetPr(prhs[6]);
+    double* detjac = mxGetPr(prhs[8]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
+    
+    long long* elements  = GetIndexData(prhs[4]);
+    
+    double* material_param = mxGetPr(prhs[2]);
+    double Young = material_param[0];
+    double Poisson = material_param[1];
+    double mu = Young / (2.0 + 2.0 * Poisson);
+    double lambda =  Young * Poisson /( (1.0 + Poisson) * (1.0-2.0*Poisson) );
+    double bulk = ( 2.0 / 3.0 ) * mu + lambda;
+    
+    /* Assembly: loop over batches of ELEMENT_BATCH elements */
+    int numBatches = (noe + ELEMENT_BATCH - 1) / ELEMENT_BATCH;
+    int ib;
+    
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,mu,bulk)
+    
+    for (ib = 0; ib < numBatches; ib = ib + 1 )
+    {
+        int ie0 = ib * ELEMENT_BATCH;
+        int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+        int q, d1, d2, l, a, i_c;
+        
+        double Uloc[3][nln][ELEMENT_BATCH];
+        double gradphi[3][nln][ELEMENT_BATCH];
+        double F[3][3][ELEMENT_BATCH];
+        double detF[ELEMENT_BATCH];
+        double logdetF[ELEMENT_BATCH];
+        double pow23detF[ELEMENT_BATCH];
+        double pow2detF[ELEMENT_BATCH];
+        double I_C[ELEMENT_BATCH];
+        double invFT[3][3][ELEMENT_BATCH];
+        double C[3][3][ELEMENT_BATCH];
+        double P_Uh[3][3][ELEMENT_BATCH];
+        double rloc[nln][3][ELEMENT_BATCH];
+        
+        memset(rloc, 0, sizeof(rloc));
+        
+        BatchLocalDisplacement(3, ie0, nb, nln, numRowsElements, NumNodes, elements, U_h, Uloc);
+        
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
+        {
+            BatchGradients(3, ie0, nb, q, nln, &GeoCache, gradphi);
+            BatchDeformationGradient(3, nln, gradphi, Uloc, F);
+            BatchInvT3(F, detF, invFT);
+            BatchRightCauchyGreen(3, F, C);
+            BatchTrace(3, C, I_C);
+            
+            #pragma omp simd
+            for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+            {
+                logdetF[l]   = log( detF[l] );
+                pow23detF[l] = pow(detF[l], -2.0 / 3.0);
+                pow2detF[l]  = pow(detF[l], 2.0);
+            }
+            
+            /* First Piola-Kirchhoff stress tensor */
+            for (d1 = 0; d1 < 3; d1 = d1 + 1 )
+            {
+                for (d2 = 0; d2 < 3; d2 = d2 + 1 )
+                {
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        P_Uh[d1][d2][l] = mu * pow23detF[l] * ( F[d1][d2][l] - 1.0 / 3.0 * I_C[l] * invFT[d1][d2][l] )
+                                        + 1.0 / 2.0 * bulk * ( pow2detF[l] - detF[l] + logdetF[l] ) * invFT[d1][d2][l];
+                    }
+                }
+            }
+            
+            for (a = 0; a < nln; a = a + 1 )
+            {
+                for (i_c = 0; i_c < 3; i_c = i_c + 1 )
+                {
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        rloc[a][i_c][l] = rloc[a][i_c][l] + ( gradphi[0][a][l] * P_Uh[i_c][0][l]
+                                                            + gradphi[1][a][l] * P_Uh[i_c][1][l]
+                                                            + gradphi[2][a][l] * P_Uh[i_c][2][l] ) * w[q];
+                    }
+                }
+            }
+        }
+        
+        BatchScatterVector(3, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, rloc, myRrows, myRcoef);
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* First Piola-Kirchhoff stress P[i][J] and material tangent
+ * A[i][J][k][L] = dP_iJ / dF_kL */
+FORCE_INLINE void NeoHookeanMaterial_tangent(const int dim, const double mu, const double bulk, double F[dim][dim][ELEMENT_BATCH],
+        double invFT[dim][dim][ELEMENT_BATCH], double detF[ELEMENT_BATCH], double I_C[ELEMENT_BATCH], double P[dim][dim][ELEMENT_BATCH], double A[dim][dim][dim][dim][ELEMENT_BATCH])
+{
+    int i, J, k, L, l;
+    double mu_p23[ELEMENT_BATCH];
+    double vol_factor1[ELEMENT_BATCH];
+    double vol_factor2[ELEMENT_BATCH];
+    
+    #pragma omp simd
+    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+    {
+        mu_p23[l]      = mu * pow(detF[l], -2.0 / 3.0);
+        vol_factor1[l] = 0.5*bulk * (2.0*pow(detF[l], 2.0) -detF[l] + 1.0);
+        vol_factor2[l] = 0.5*bulk * ( - pow(detF[l], 2.0) + detF[l] - log( detF[l] ));
+    }
+    
+    /* First Piola-Kirchhoff stress tensor */
+    for (i = 0; i < dim; i = i + 1 )
+    {
+        for (J = 0; J < dim; J = J + 1 )
+        {
+            #pragma omp simd
+            for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+            {
+                P[i][J][l] = mu_p23[l] * ( F[i][J][l] - 1.0 / 3.0 * I_C[l] * invFT[i][J][l] ) - vol_factor2[l] * invFT[i][J][l];
+            }
+        }
+    }
+    
+    for (i = 0; i < dim; i = i + 1 )
+    {
+        for (J = 0; J < dim; J = J + 1 )
+        {
+            for (k = 0; k < dim; k = k + 1 )
+            {
+                for (L = 0; L < dim; L = L + 1 )
+                {
+                    double delta = (i == k && J == L) ? 1.0 : 0.0;
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        double P_F = F[i][J][l] - 1.0 / 3.0 * I_C[l] * invFT[i][J][l];
+                        
+                        A[i][J][k][L][l] = mu_p23[l] * ( - 2.0 / 3.0 * invFT[k][L][l] * P_F + delta
+                                                         - 1.0 / 3.0 * ( 2.0 * F[k][L][l] * invFT[i][J][l] - I_C[l] * invFT[i][L][l] * invFT[k][J][l] ) )
+                                           + vol_factor1[l] * invFT[i][J][l] * invFT[k][L][l]
+                                           + vol_factor2[l] * invFT[i][L][l] * invFT[k][J][l];
+                    }
+                }
+            }
+        }
+    }
+}
+/*************************************************************************/
+/* Jacobian of a batch of elements: the material tangent is evaluated once
+ * per quadrature point and contracted with the gradients of the basis
+ * functions. If computeResidual is set, the internal forces are assembled
+ * in the same pass from the stress evaluated alongside the tangent. If
+ * symmetric is set, only the upper triangle of the local matrices is
+ * computed and scattered (the tangent of hyperelastic materials has major
+ * symmetry) */
+FORCE_INLINE void NeoHookeanMaterial_jacobian_batch(const int dim, const int ie0, const int nb, const int nln, const int NumQuadPoints, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* U_h, const double* w,
+        const double* detjac, const GeometryCache GeoCache, const double mu, const double bulk, IndexArray myArows, IndexArray myAcols, CoefArray myAcoef,
+        const int computeResidual, IndexArray myRrows, double* myRcoef, const int symmetric)
+{
+    int q;
+    
+    double Uloc[dim][nln][ELEMENT_BATCH];
+    double gradphi[dim][nln][ELEMENT_BATCH];
+    double F[dim][dim][ELEMENT_BATCH];
+    double invFT[dim][dim][ELEMENT_BATCH];
+    double C[dim][dim][ELEMENT_BATCH];
+    double detF[ELEMENT_BATCH];
+    double I_C[ELEMENT_BATCH];
+    double P[dim][dim][ELEMENT_BATCH];
+    double A[dim][dim][dim][dim][ELEMENT_BATCH];
+    double aloc[nln][dim][nln][dim][ELEMENT_BATCH];
+    double rloc[nln][dim][ELEMENT_BATCH];
+    
+    memset(aloc, 0, sizeof(aloc));
+    memset(rloc, 0, sizeof(rloc));
+    
+    BatchLocalDisplacement(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, U_h, Uloc);
+    
+    for (q = 0; q < NumQuadPoints; q = q + 1 )
+    {
+        BatchGradients(dim, ie0, nb, q, nln, &GeoCache, gradphi);
+        BatchDeformationGradient(dim, nln, gradphi, Uloc, F);
+        BatchInvT(dim, F, detF, invFT);
+        BatchRightCauchyGreen(dim, F, C);
+        BatchTrace(dim, C, I_C);
+        
+        NeoHookeanMaterial_tangent(dim, mu, bulk, F, invFT, detF, I_C, P, A);
+        if (symmetric)
+        {
+            BatchTangentContractionSymmetric(dim, nln, w[q], gradphi, A, aloc);
+        }
+        else
+        {
+            BatchTangentContraction(dim, nln, w[q], gradphi, A, aloc);
+        }
+        if (computeResidual)
+        {
+            BatchStressContraction(dim, nln, w[q], gradphi, P, rloc);
+        }
+    }
+    
+    if (symmetric)
+    {
+        BatchScatterMatrixSymmetric(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, aloc, myArows, myAcols, myAcoef);
+    }
+    else
+    {
+        BatchScatterMatrix(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, aloc, myArows, myAcols, myAcoef);
+    }
+    if (computeResidual)
+    {
+        BatchScatterVector(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, rloc, myRrows, myRcoef);
+    }
+}
+
+/*************************************************************************/
+/* Jacobian based on the material tangent, see NeoHookeanMaterial_tangent;
+ * if computeResidual is set, the internal forces are returned in plhs[3],
+ * plhs[4] as well; if symmetric is set, only the upper triangle of the
+ * jacobian is returned (see SetSymmetricIndex) */
+static void NeoHookeanMaterial_tangentAssembly(mxArray* plhs[], const mxArray* prhs[], const int computeResidual, const int symmetric, const CoefFormat coefFormat)
+{
+    
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[4]);
+    double* nln_ptr = mxGetPr(prhs[5]);
+    int nln     = (int)(nln_ptr[0]);
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
+    mwSize localSize = symmetric ? nln*dim*(nln*dim+1)/2 : nln2*dim*dim;
+    
+    CreateMatrixOutputs(plhs, localSize*noe, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
+    
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
+    
+    IndexArray myRrows = {NULL, NULL, NULL};
+    double* myRcoef    = NULL;
+    if (computeResidual)
+    {
+        plhs[3] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+        plhs[4] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
+        myRrows = GetIndexArray(plhs[3]);
+        myRcoef = mxGetPr(plhs[4]);
+    }
+    
+    int NumQuadPoints     = mxGetN(prhs[6]);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
+    
+    double* U_h   = mxGetPr(prhs[3]);
+    double* w   = mxGetPr(prhs[6]);
+    double* detjac = mxGetPr(prhs[8]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
+    
+    long long* elements  = GetIndexData(prhs[4]);
+    
+    double* material_param = mxGetPr(prhs[2]);
+    double Young = material_param[0];
+    double Poisson = material_param[1];
+    double mu = Young / (2.0 + 2.0 * Poisson);
+    double lambda =  Young * Poisson /( (1.0 + Poisson) * (1.0-2.0*Poisson) );
+    double bulk = ( 2.0 / 3.0 ) * mu + lambda;
+    
+    /* Assembly: loop over batches of ELEMENT_BATCH elements */
+    int numBatches = (noe + ELEMENT_BATCH - 1) / ELEMENT_BATCH;
+    int ib;
+    
+    if (dim == 2)
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,computeResidual,symmetric,mu,bulk)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            NeoHookeanMaterial_jacobian_batch(2, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, U_h, w,
+                    detjac, GeoCache, mu, bulk, myArows, myAcols, myAcoef, computeResidual, myRrows, myRcoef, symmetric);
+        }
+    }
+    else
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,computeResidual,symmetric,mu,bulk)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            NeoHookeanMaterial_jacobian_batch(3, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, U_h, w,
+                    detjac, GeoCache, mu, bulk, myArows, myAcols, myAcoef, computeResidual, myRrows, myRcoef, symmetric);
+        }
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+void NeoHookeanMaterial_jacobianTangent(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    NeoHookeanMaterial_tangentAssembly(plhs, prhs, 0, 0, coefFormat);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Internal forces and jacobian assembled in a single pass over the elements */
+void NeoHookeanMaterial_residual_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    NeoHookeanMaterial_tangentAssembly(plhs, prhs, 1, 0, coefFormat);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Upper triangle of the jacobian, see SetSymmetricIndex */
+void NeoHookeanMaterial_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    NeoHookeanMaterial_tangentAssembly(plhs, prhs, 0, 1, coefFormat);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+void NeoHookeanMaterial_residual_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    NeoHookeanMaterial_tangentAssembly(plhs, prhs, 1, 1, coefFormat);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Action of the jacobian on V_h for a batch of elements, without forming
+ * the local matrices: r_a += w (A : grad(V)) gradphi_a. If TangentCache is
+ * not NULL the material tangent is stored as well; V_h may be NULL if only
+ * the tangent is needed */
+FORCE_INLINE void NeoHookeanMaterial_tangentOperator_batch(const int dim, const int ie0, const int nb, const int nln, const int NumQuadPoints, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* U_h, const double* V_h, const double* w,
+        const double* detjac, const GeometryCache GeoCache, const double mu, const double bulk, IndexArray myRrows, double* myRcoef, double* TangentCache)
+{
+    int q;
+    
+    double Uloc[dim][nln][ELEMENT_BATCH];
+    double Vloc[dim][nln][ELEMENT_BATCH];
+    double gradphi[dim][nln][ELEMENT_BATCH];
+    double F[dim][dim][ELEMENT_BATCH];
+    double invFT[dim][dim][ELEMENT_BATCH];
+    double C[dim][dim][ELEMENT_BATCH];
+    double detF[ELEMENT_BATCH];
+    double I_C[ELEMENT_BATCH];
+    double P[dim][dim][ELEMENT_BATCH];
+    double A[dim][dim][dim][dim][ELEMENT_BATCH];
+    double G[dim][dim][ELEMENT_BATCH];
+    double dP[dim][dim][ELEMENT_BATCH];
+    double rloc[nln][dim][ELEMENT_BATCH];
+    
+    memset(rloc, 0, sizeof(rloc));
+    
+    BatchLocalDisplacement(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, U_h, Uloc);
+    if (V_h != NULL)
+    {
+        BatchLocalDisplacement(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, V_h, Vloc);
+    }
+    
+    for (q = 0; q < NumQuadPoints; q = q + 1 )
+    {
+        BatchGradients(dim, ie0, nb, q, nln, &GeoCache, gradphi);
+        BatchDeformationGradient(dim, nln, gradphi, Uloc, F);
+        BatchInvT(dim, F, detF, invFT);
+        BatchRightCauchyGreen(dim, F, C);
+        BatchTrace(dim, C, I_C);
+        
+        NeoHookeanMaterial_tangent(dim, mu, bulk, F, invFT, detF, I_C, P, A);
+        if (TangentCache != NULL)
+        {
+            BatchStoreTangent(dim, ie0, nb, q, NumQuadPoints, A, TangentCache);
+        }
+        if (V_h != NULL)
+        {
+            BatchDisplacementGradient(dim, nln, gradphi, Vloc, G);
+            BatchTangentApply(dim, A, G, dP);
+            BatchStressContraction(dim, nln, w[q], gradphi, dP, rloc);
+        }
+    }
+    
+    if (V_h != NULL)
+    {
+        BatchScatterVector(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, rloc, myRrows, myRcoef);
+    }
+}
+
+/*************************************************************************/
+/* Matrix-free jacobian: if computeProduct is set, returns the vector
+ * J(U_h)*V_h, with V_h = prhs[11], in sparse vector format; otherwise
+ * returns the material tangent at each quadrature point */
+static void NeoHookeanMaterial_tangentOperator(mxArray* plhs[], const mxArray* prhs[], const int computeProduct)
+{
+    
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[4]);
+    double* nln_ptr = mxGetPr(prhs[5]);
+    int nln     = (int)(nln_ptr[0]);
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    
+    int NumQuadPoints     = mxGetN(prhs[6]);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
+    
+    IndexArray myRrows = {NULL, NULL, NULL};
+    double* myRcoef      = NULL;
+    double* V_h          = NULL;
+    double* TangentCache = NULL;
+    if (computeProduct)
+    {
+        plhs[0] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+        plhs[1] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
+        myRrows = GetIndexArray(plhs[0]);
+        myRcoef = mxGetPr(plhs[1]);
+        V_h     = mxGetPr(prhs[11]);
+    }
+    else
+    {
+        plhs[0] = CreateElementMatrix(TangentCacheSize(dim)*NumQuadPoints*noe,1, noe);
+        TangentCache = mxGetPr(plhs[0]);
+    }
+    
+    double* U_h   = mxGetPr(prhs[3]);
+    double* w   = mxGetPr(prhs[6]);
+    double* detjac = mxGetPr(prhs[8]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
+    
+    long long* elements  = GetIndexData(prhs[4]);
+    
+    double* material_param = mxGetPr(prhs[2]);
+    double Young = material_param[0];
+    double Poisson = material_param[1];
+    double mu = Young / (2.0 + 2.0 * Poisson);
+    double lambda =  Young * Poisson /( (1.0 + Poisson) * (1.0-2.0*Poisson) );
+    double bulk = ( 2.0 / 3.0 ) * mu + lambda;
+    
+    /* Assembly: loop over batches of ELEMENT_BATCH elements */
+    int numBatches = (noe + ELEMENT_BATCH - 1) / ELEMENT_BATCH;
+    int ib;
+    
+    if (dim == 2)
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h,V_h,TangentCache) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,mu,bulk)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            NeoHookeanMaterial_tangentOperator_batch(2, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, U_h, V_h, w,
+                    detjac, GeoCache, mu, bulk, myRrows, myRcoef, TangentCache);
+        }
+    }
+    else
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h,V_h,TangentCache) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,mu,bulk)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            NeoHookeanMaterial_tangentOperator_batch(3, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, U_h, V_h, w,
+                    detjac, GeoCache, mu, bulk, myRrows, myRcoef, TangentCache);
+        }
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+void NeoHookeanMaterial_jacobianVector(mxArray* plhs[], const mxArray* prhs[])
+{
+    NeoHookeanMaterial_tangentOperator(plhs, prhs, 1);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+void NeoHookeanMaterial_tangentCache(mxArray* plhs[], const mxArray* prhs[])
+{
+    NeoHookeanMaterial_tangentOperator(plhs, prhs, 0);
+}
+/*************************************************************************/
@@ -9,8 +9,6 @@
 #include <string.h>
 #include "../../../Core/Tools.h"
 
-#define INVJAC(i,j,k) invjac[i+(j+k*dim)*noe]
-#define GRADREFPHI(i,j,k) gradrefphi[i+(j+k*NumQuadPoints)*nln]
 #define PRESTRESS_0(ie,q,d1,d2) S_0[ie + q*noe + d1*noe*NumQuadPoints + d2*noe*NumQuadPoints*dim]
 #define PRESTRESS_NP1(ie,q,d1,d2) S_np1[ie + q*noe + d1*noe*NumQuadPoints + d2*noe*NumQuadPoints*dim]
 
@@ -20,13 +18,27 @@
 /*************************************************************************/
 void NeoHookeanMaterial_forces(mxArray* plhs[], const mxArray* prhs[]);
 
-void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[]);
+void NeoHookeanMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
-void NeoHookeanMaterial_prestress(mxArray* plhs[], const mxArray* prhs[]);
+void NeoHookeanMaterial_prestress(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
-void NeoHookeanMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[]);
+void NeoHookeanMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
 void NeoHookeanMaterial_stress(mxArray* plhs[], const mxArray* prhs[]);
 
+void NeoHookeanMaterial_forcesBatch3D(mxArray* plhs[], const mxArray* prhs[]);
+
+void NeoHookeanMaterial_jacobianTangent(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void NeoHookeanMaterial_residual_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void NeoHookeanMaterial_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void NeoHookeanMaterial_residual_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void NeoHookeanMaterial_jacobianVector(mxArray* plhs[], const mxArray* prhs[]);
+
+void NeoHookeanMaterial_tangentCache(mxArray* plhs[], const mxArray* prhs[]);
+
 #endif
 
@@ -9,20 +9,31 @@
 #include <string.h>
 #include "../../../Core/Tools.h"
 
-#define INVJAC(i,j,k) invjac[i+(j+k*dim)*noe]
-#define GRADREFPHI(i,j,k) gradrefphi[i+(j+k*NumQuadPoints)*nln]
-
 #ifndef RVMATERIAL_H_INCLUDED
 #define RVMATERIAL_H_INCLUDED
 
 /*************************************************************************/
 void RaghavanVorpMaterial_forces(mxArray* plhs[], const mxArray* prhs[]);
 
-void RaghavanVorpMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[]);
+void RaghavanVorpMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
-void RaghavanVorpMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[]);
+void RaghavanVorpMaterial_jacobianFast(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
 void RaghavanVorpMaterial_stress(mxArray* plhs[], const mxArray* prhs[]);
 
+void RaghavanVorpMaterial_forcesBatch3D(mxArray* plhs[], const mxArray* prhs[]);
+
+void RaghavanVorpMaterial_jacobianTangent(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void RaghavanVorpMaterial_residual_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void RaghavanVorpMaterial_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void RaghavanVorpMaterial_residual_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void RaghavanVorpMaterial_jacobianVector(mxArray* plhs[], const mxArray* prhs[]);
+
+void RaghavanVorpMaterial_tangentCache(mxArray* plhs[], const mxArray* prhs[]);
+
 #endif
 
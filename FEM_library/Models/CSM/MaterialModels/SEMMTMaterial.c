@@ -4,6 +4,7 @@
  */
 
 #include "SEMMTMaterial.h"
+#include "LinearElasticMaterial.h"
 
 /*************************************************************************/
 void SEMMTMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
@@ -14,32 +15,28 @@ void SEMMTMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
     
-    plhs[0] = mxCreateDoubleMatrix(nln*noe*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln*noe*dim,1, mxREAL);
+    plhs[0] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+    plhs[1] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
     
-    double* myRrows    = mxGetPr(plhs[0]);
+    IndexArray myRrows    = GetIndexArray(plhs[0]);
     double* myRcoef    = mxGetPr(plhs[1]);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
     double gradphi[dim][nln][NumQuadPoints];
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double GradV[dim][dim];
-    double GradU[dim][dim];
     double GradUh[dim][dim][NumQuadPoints];
     
     double Id[dim][dim];
@@ -58,7 +55,6 @@ void SEMMTMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
     
     double F[dim][dim];
     double EPS[dim][dim];
-    double dP[dim][dim];
     double P_Uh[dim][dim];
     
     double* material_param = mxGetPr(prhs[2]);
@@ -71,23 +67,15 @@ void SEMMTMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myRrows,myRcoef,U_h) private(gradphi,F,EPS,dP,P_Uh,GradV,GradU,GradUh,ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h) private(gradphi,F,EPS,P_Uh,GradV,GradUh,ie,k,q,d1,d2) firstprivate(w,numRowsElements,nln,NumNodes,Id,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        for (k = 0; k < nln; k = k + 1 )
+        long long localRrows[nln*dim];
+
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
-            for (q = 0; q < NumQuadPoints; q = q + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
         }
         
         for (q = 0; q < NumQuadPoints; q = q + 1 )
@@ -99,17 +87,16 @@ void SEMMTMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[d1][d2][q] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[d1][d2][q] = GradUh[d1][d2][q] + U_h[e_k] * gradphi[d2][k][q];
                     }
                 }
             }
         }
         
-        int iii = 0;
         int ii = 0;
-        int a, b, i_c, j_c;
+        int a, i_c;
         
         /* loop over test functions --> a */
         for (a = 0; a < nln; a = a + 1 )
@@ -162,18 +149,20 @@ void SEMMTMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
                     rloc  = rloc + Mdot( dim, GradV, P_Uh) * w[q];
                 }
                                             
-                myRrows[ie*nln*dim+ii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                myRcoef[ie*nln*dim+ii] = rloc * detjac[ie] * pow( detjac[0] / detjac[ie], Stiffening_power );
+                localRrows[ii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                myRcoef[(mwSize) ie*nln*dim+ii] = rloc * detjac[ie] * pow( detjac[0] / detjac[ie], Stiffening_power );
                 ii = ii + 1;
             }
         }
+        SetIndexBlock(myRrows, (mwSize) ie*nln*dim, localRrows, nln*dim);
     }
-        
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 
 
 /*************************************************************************/
-void SEMMTMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[])
+void SEMMTMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -181,32 +170,25 @@ void SEMMTMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
-    double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
-    int d1,d2;
     
     double* material_param = mxGetPr(prhs[2]);
     double Young = material_param[0];
@@ -221,26 +203,18 @@ void SEMMTMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,mu,lambda,detjac_ref,Stiffening_power)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef) private(ie,q) firstprivate(w,numRowsElements,nln2,nln,NumNodes,mu,lambda,detjac_ref,Stiffening_power)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localArows[nln2*9], localAcols[nln2*9];
+
         double gradphi[NumQuadPoints][dim][nln];
         
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[q][d1][k] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[q][d1][k] = gradphi[q][d1][k] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[q][0][0], nln, 1);
         }
         
         int iii = 0;
@@ -307,19 +281,22 @@ void SEMMTMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[])
                     /* loop over trial components --> j_c */
                     for (j_c = 0; j_c < 3; j_c = j_c + 1 )
                     {
-                        myArows[ie*nln2*9+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*9+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*9+iii] = aloc[a][i_c][b][j_c]*modified_detJ;
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*9+iii, aloc[a][i_c][b][j_c]*modified_detJ);
                         iii = iii + 1;
                     }
                 }
             }
         }
+        SetIndexBlock(myArows, ie*nln2*9, localArows, nln2*9);
+        SetIndexBlock(myAcols, ie*nln2*9, localAcols, nln2*9);
     }
     
+    ReleaseIndexData(elements, prhs[4]);
 }
 /*************************************************************************/
-void SEMMTMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[])
+void SEMMTMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -327,32 +304,25 @@ void SEMMTMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
-    double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
-    int d1,d2;
     
     double* material_param = mxGetPr(prhs[2]);
     double Young = material_param[0];
@@ -366,26 +336,18 @@ void SEMMTMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,mu,lambda,detjac_ref,Stiffening_power)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef) private(ie,q) firstprivate(w,numRowsElements,nln2,nln,NumNodes,mu,lambda,detjac_ref,Stiffening_power)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
+        long long localArows[nln2*4], localAcols[nln2*4];
+
         double gradphi[NumQuadPoints][dim][nln];
         
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[q][d1][k] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[q][d1][k] = gradphi[q][d1][k] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[q][0][0], nln, 1);
         }
         
         int iii = 0;
@@ -441,20 +403,23 @@ void SEMMTMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[])
                     /* loop over trial components --> j_c */
                     for (j_c = 0; j_c < 2; j_c = j_c + 1 )
                     {
-                        myArows[ie*nln2*4+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*4+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*4+iii] = aloc[a][i_c][b][j_c]*modified_detJ;
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*4+iii, aloc[a][i_c][b][j_c]*modified_detJ);
                         iii = iii + 1;
                     }
                 }
             }
         }
+        SetIndexBlock(myArows, ie*nln2*4, localArows, nln2*4);
+        SetIndexBlock(myAcols, ie*nln2*4, localAcols, nln2*4);
     }
     
+    ReleaseIndexData(elements, prhs[4]);
 }
 
 /*************************************************************************/
-void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
+void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -462,31 +427,27 @@ void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
     double gradphi[dim][nln][NumQuadPoints];
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double GradV[dim][dim];
     double GradU[dim][dim];
@@ -509,7 +470,6 @@ void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     double F[dim][dim];
     double EPS[dim][dim];
     double dP[dim][dim];
-    double P_Uh[dim][dim];
     
     double* material_param = mxGetPr(prhs[2]);
     double Young = material_param[0];
@@ -521,23 +481,15 @@ void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(gradphi,F,EPS,dP,P_Uh,GradV,GradU,GradUh,ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,U_h) private(gradphi,F,EPS,dP,GradV,GradU,GradUh,ie,k,q,d1,d2) firstprivate(w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        for (k = 0; k < nln; k = k + 1 )
+        long long localArows[nln2*dim*dim], localAcols[nln2*dim*dim];
+
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
-            for (q = 0; q < NumQuadPoints; q = q + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
         }
         
         for (q = 0; q < NumQuadPoints; q = q + 1 )
@@ -549,8 +501,8 @@ void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[d1][d2][q] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[d1][d2][q] = GradUh[d1][d2][q] + U_h[e_k] * gradphi[d2][k][q];
                     }
                 }
@@ -558,7 +510,6 @@ void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
         }
         
         int iii = 0;
-        int ii = 0;
         int a, b, i_c, j_c;
         
         /* loop over test functions --> a */
@@ -628,9 +579,9 @@ void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                             }
                             aloc  = aloc + Mdot( dim, GradV, dP) * w[q];
                         }
-                        myArows[ie*nln2*dim*dim+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*dim*dim+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*dim*dim+iii] = aloc * detjac[ie] * pow( detjac[0] / detjac[ie], Stiffening_power );
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*dim*dim+iii, aloc * detjac[ie] * pow( detjac[0] / detjac[ie], Stiffening_power ));
                         
                         iii = iii + 1;
                     }
@@ -638,7 +589,44 @@ void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                 
             }
         }
+        SetIndexBlock(myArows, ie*nln2*dim*dim, localArows, nln2*dim*dim);
+        SetIndexBlock(myAcols, ie*nln2*dim*dim, localAcols, nln2*dim*dim);
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Internal forces and jacobian assembled in a single pass over the
+ * elements; the SEMMT law is linear in the displacement, see
+ * LinearElasticMaterial_forcesFromJacobian */
+void SEMMTMaterial_residual_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    
+    if (dim == 2)
+    {
+        SEMMTMaterial_jacobianFast2D(plhs, prhs, coefFormat);
+    }
+    else
+    {
+        SEMMTMaterial_jacobianFast3D(plhs, prhs, coefFormat);
+    }
+    
+    if (mxIsSingle(plhs[2]) || coefFormat.map)
+    {
+        /* the residual is not computed from the rounded or already
+         * scattered jacobian */
+        mxArray* plhsF[2];
+        SEMMTMaterial_forces(plhsF, prhs);
+        plhs[3] = plhsF[0];
+        plhs[4] = plhsF[1];
+    }
+    else
+    {
+        LinearElasticMaterial_forcesFromJacobian(plhs, prhs);
     }
-        
 }
 /*************************************************************************/
\ No newline at end of file
@@ -10,20 +10,19 @@
 #include <string.h>
 #include "../../../Core/Tools.h"
 
-#define INVJAC(i,j,k) invjac[i+(j+k*dim)*noe]
-#define GRADREFPHI(i,j,k) gradrefphi[i+(j+k*NumQuadPoints)*nln]
-
 #ifndef SEMMTMATERIAL_H_INCLUDED
 #define SEMMTMATERIAL_H_INCLUDED
 
 /*************************************************************************/
 void SEMMTMaterial_forces(mxArray* plhs[], const mxArray* prhs[]);
 
-void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[]);
+void SEMMTMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void SEMMTMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
-void SEMMTMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[]);
+void SEMMTMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
-void SEMMTMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[]);
+void SEMMTMaterial_residual_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
 
 #endif
\ No newline at end of file
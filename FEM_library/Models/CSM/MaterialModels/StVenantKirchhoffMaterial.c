@@ -14,28 +14,25 @@ void StVenantKirchhoffMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
     
-    plhs[0] = mxCreateDoubleMatrix(nln*noe*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln*noe*dim,1, mxREAL);
+    plhs[0] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+    plhs[1] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
     
-    double* myRrows    = mxGetPr(plhs[0]);
+    IndexArray myRrows    = GetIndexArray(plhs[0]);
     double* myRcoef    = mxGetPr(plhs[1]);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
         
     double Id[dim][dim];
     int d1,d2;
@@ -61,11 +58,12 @@ void StVenantKirchhoffMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myRrows,myRcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h) private(ie,k,q,d1,d2) firstprivate(w,numRowsElements,nln,NumNodes,Id,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        
+        long long localRrows[nln*dim];
+
         double gradphi[NumQuadPoints][dim][nln];
 
         double GradV[dim][dim];
@@ -81,17 +79,7 @@ void StVenantKirchhoffMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[q][d1][k] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[q][d1][k] = gradphi[q][d1][k] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[q][0][0], nln, 1);
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
@@ -100,8 +88,8 @@ void StVenantKirchhoffMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[q][d1][d2] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphi[q][d2][k];
                     }
                     F[q][d1][d2]  = Id[d1][d2] + GradUh[q][d1][d2];
@@ -123,7 +111,7 @@ void StVenantKirchhoffMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
         }
 
         int ii = 0;
-        int a, i_c, j_c;
+        int a, i_c;
         
         /* loop over test functions --> a */
         for (a = 0; a < nln; a = a + 1 )
@@ -160,16 +148,19 @@ void StVenantKirchhoffMaterial_forces(mxArray* plhs[], const mxArray* prhs[])
                     rloc  = rloc + Mdot( dim, GradV, P_Uh) * w[q];
                 }
                                             
-                myRrows[ie*nln*dim+ii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                myRcoef[ie*nln*dim+ii] = rloc*detjac[ie];
+                localRrows[ii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                myRcoef[(mwSize) ie*nln*dim+ii] = rloc*detjac[ie];
                 ii = ii + 1;
             }
         }
+        SetIndexBlock(myRrows, (mwSize) ie*nln*dim, localRrows, nln*dim);
     }
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 
 /*************************************************************************/
-void StVenantKirchhoffMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
+void StVenantKirchhoffMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -177,31 +168,27 @@ void StVenantKirchhoffMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
     double gradphi[dim][nln][NumQuadPoints];
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double GradV[dim][dim];
     double GradU[dim][dim];
@@ -224,7 +211,6 @@ void StVenantKirchhoffMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     double F[dim][dim][NumQuadPoints];
     double E[dim][dim][NumQuadPoints];
     double dP[dim][dim];
-    double P_Uh[dim][dim];
     
     double dF[dim][dim];
     double dE[dim][dim];
@@ -238,25 +224,17 @@ void StVenantKirchhoffMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(gradphi,F,E,dP,P_Uh,dF,dE,GradV,GradU,GradUh,ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,U_h) private(gradphi,F,E,dP,dF,dE,GradV,GradU,GradUh,ie,k,q,d1,d2) firstprivate(w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {             
+        long long localArows[nln2*dim*dim], localAcols[nln2*dim*dim];
+
         double traceE[NumQuadPoints];
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[d1][k][q] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
@@ -265,8 +243,8 @@ void StVenantKirchhoffMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                     GradUh[d1][d2][q] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[d1][d2][q] = GradUh[d1][d2][q] + U_h[e_k] * gradphi[d2][k][q];
                     }
                     F[d1][d2][q]  = Id[d1][d2] + GradUh[d1][d2][q];
@@ -277,7 +255,6 @@ void StVenantKirchhoffMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
         }
 
         int iii = 0;
-        int ii = 0;
         int a, b, i_c, j_c;
         
         /* loop over test functions --> a */
@@ -349,22 +326,25 @@ void StVenantKirchhoffMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[])
                             MatrixSum(dim, dP, P_tmp);
                             aloc  = aloc + Mdot( dim, GradV, dP) * w[q];
                         }
-                        myArows[ie*nln2*dim*dim+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*dim*dim+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*dim*dim+iii] = aloc*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*dim*dim+iii, aloc*detjac[ie]);
                         
                         iii = iii + 1;
                     }
                 }
             }
         }
+        SetIndexBlock(myArows, ie*nln2*dim*dim, localArows, nln2*dim*dim);
+        SetIndexBlock(myAcols, ie*nln2*dim*dim, localAcols, nln2*dim*dim);
     }
-        
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 
 
 /*************************************************************************/
-void StVenantKirchhoffMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[])
+void StVenantKirchhoffMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -372,30 +352,26 @@ void StVenantKirchhoffMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* pr
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
         
     double Id[dim][dim];
     int d1,d2;
@@ -420,13 +396,12 @@ void StVenantKirchhoffMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* pr
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,q,d1,d2) firstprivate(w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        
-        double GradV[dim][dim];
-        double GradU[dim][dim];
+        long long localArows[nln2*9], localAcols[nln2*9];
+
         double GradUh[NumQuadPoints][dim][dim];
         double F[NumQuadPoints][dim][dim];
         double E[NumQuadPoints][dim][dim];
@@ -437,17 +412,7 @@ void StVenantKirchhoffMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* pr
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[q][d1][k] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[q][d1][k] = gradphi[q][d1][k] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[q][0][0], nln, 1);
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
@@ -456,8 +421,8 @@ void StVenantKirchhoffMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* pr
                     GradUh[q][d1][d2] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphi[q][d2][k];
                     }
                     F[q][d1][d2]  = Id[d1][d2] + GradUh[q][d1][d2];
@@ -476,7 +441,6 @@ void StVenantKirchhoffMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* pr
         }
 
         int iii = 0;
-        int ii = 0;
         int a, b, i_c, j_c;
         
         double aloc[nln][dim][nln][dim];
@@ -540,21 +504,24 @@ void StVenantKirchhoffMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* pr
                     /* loop over trial components --> j_c */
                     for (j_c = 0; j_c < 3; j_c = j_c + 1 )
                     {
-                        myArows[ie*nln2*9+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*9+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*9+iii] = aloc[a][i_c][b][j_c]*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*9+iii, aloc[a][i_c][b][j_c]*detjac[ie]);
                         iii = iii + 1;
                     }
                 }
             }
         }
+        SetIndexBlock(myArows, ie*nln2*9, localArows, nln2*9);
+        SetIndexBlock(myAcols, ie*nln2*9, localAcols, nln2*9);
     }
-        
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 
 
 /*************************************************************************/
-void StVenantKirchhoffMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[])
+void StVenantKirchhoffMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
 {
     
     double* dim_ptr = mxGetPr(prhs[0]);
@@ -562,30 +529,26 @@ void StVenantKirchhoffMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* pr
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
     
-    plhs[0] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[1] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
-    plhs[2] = mxCreateDoubleMatrix(nln2*noe*dim*dim,1, mxREAL);
+    CreateMatrixOutputs(plhs, nln2*noe*dim*dim, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
     
-    double* myArows    = mxGetPr(plhs[0]);
-    double* myAcols    = mxGetPr(plhs[1]);
-    double* myAcoef    = mxGetPr(plhs[2]);
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
     double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
     double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
         
     double Id[dim][dim];
     int d1,d2;
@@ -610,13 +573,12 @@ void StVenantKirchhoffMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* pr
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,l,q,d1,d2) firstprivate(phi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,U_h) private(ie,k,q,d1,d2) firstprivate(w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
-        
-        double GradV[dim][dim];
-        double GradU[dim][dim];
+        long long localArows[nln2*4], localAcols[nln2*4];
+
         double GradUh[NumQuadPoints][dim][dim];
         double F[NumQuadPoints][dim][dim];
         double E[NumQuadPoints][dim][dim];
@@ -627,17 +589,7 @@ void StVenantKirchhoffMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* pr
         for (q = 0; q < NumQuadPoints; q = q + 1 )
         {
             /* Compute Gradient of Basis functions*/
-            for (k = 0; k < nln; k = k + 1 )
-            {
-                for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-                {
-                    gradphi[q][d1][k] = 0;
-                    for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                    {
-                        gradphi[q][d1][k] = gradphi[q][d1][k] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                    }
-                }
-            }
+            GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[q][0][0], nln, 1);
             
             for (d1 = 0; d1 < dim; d1 = d1 + 1 )
             {
@@ -646,8 +598,8 @@ void StVenantKirchhoffMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* pr
                     GradUh[q][d1][d2] = 0;
                     for (k = 0; k < nln; k = k + 1 )
                     {
-                        int e_k;
-                        e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                        long long e_k;
+                        e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                         GradUh[q][d1][d2] = GradUh[q][d1][d2] + U_h[e_k] * gradphi[q][d2][k];
                     }
                     F[q][d1][d2]  = Id[d1][d2] + GradUh[q][d1][d2];
@@ -666,7 +618,6 @@ void StVenantKirchhoffMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* pr
         }
 
         int iii = 0;
-        int ii = 0;
         int a, b, i_c, j_c;
         
         double aloc[nln][dim][nln][dim];
@@ -720,16 +671,19 @@ void StVenantKirchhoffMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* pr
                     /* loop over trial components --> j_c */
                     for (j_c = 0; j_c < 2; j_c = j_c + 1 )
                     {
-                        myArows[ie*nln2*4+iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
-                        myAcols[ie*nln2*4+iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
-                        myAcoef[ie*nln2*4+iii] = aloc[a][i_c][b][j_c]*detjac[ie];
+                        localArows[iii] = elements[a+ie*numRowsElements] + i_c * NumNodes;
+                        localAcols[iii] = elements[b+ie*numRowsElements] + j_c * NumNodes;
+                        SetCoef(myAcoef, ie*nln2*4+iii, aloc[a][i_c][b][j_c]*detjac[ie]);
                         iii = iii + 1;
                     }
                 }
             }
         }
+        SetIndexBlock(myArows, ie*nln2*4, localArows, nln2*4);
+        SetIndexBlock(myAcols, ie*nln2*4, localAcols, nln2*4);
     }
-        
+    
+    ReleaseIndexData(elements, prhs[4]);
 }
 
 /*************************************************************************/
@@ -742,8 +696,7 @@ void StVenantKirchhoffMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
     int noe     = mxGetN(prhs[4]);
     double* nln_ptr = mxGetPr(prhs[5]);
     int nln     = (int)(nln_ptr[0]);
-    int numRowsElements  = mxGetM(prhs[4]);
-    int nln2    = nln*nln;
+    mwSize numRowsElements  = mxGetM(prhs[4]);
     
     plhs[0] = mxCreateDoubleMatrix(noe,dim*dim, mxREAL);
     plhs[1] = mxCreateDoubleMatrix(noe,dim*dim, mxREAL);
@@ -751,20 +704,16 @@ void StVenantKirchhoffMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
     double* P        = mxGetPr(plhs[0]);
     double* Sigma    = mxGetPr(plhs[1]);
     
-    int k,l;
+    int k;
     int q;
     int NumQuadPoints     = mxGetN(prhs[6]);
-    int NumNodes          = (int)(mxGetM(prhs[3]) / dim);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
     
     double* U_h   = mxGetPr(prhs[3]);
-    double* w   = mxGetPr(prhs[6]);
-    double* invjac = mxGetPr(prhs[7]);
-    double* detjac = mxGetPr(prhs[8]);
-    double* phi = mxGetPr(prhs[9]);
-    double* gradrefphi = mxGetPr(prhs[10]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
     
     double gradphi[dim][nln][NumQuadPoints];
-    double* elements  = mxGetPr(prhs[4]);
+    long long* elements  = GetIndexData(prhs[4]);
     
     double GradUh[dim][dim][NumQuadPoints];
     
@@ -795,7 +744,7 @@ void StVenantKirchhoffMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
     /* Assembly: loop over the elements */
     int ie;
     
-#pragma omp parallel for shared(invjac,detjac,elements,Sigma,U_h) private(gradphi,F,E,P_Uh,GradUh,ie,k,l,q,d1,d2) firstprivate(phi,gradrefphi,w,numRowsElements,nln2,nln,NumNodes,Id,mu,lambda)
+#pragma omp parallel for schedule(runtime) shared(elements,Sigma,U_h) private(gradphi,F,E,P_Uh,GradUh,ie,k,q,d1,d2) firstprivate(numRowsElements,nln,NumNodes,Id,mu,lambda)
     
     for (ie = 0; ie < noe; ie = ie + 1 )
     {
@@ -804,17 +753,7 @@ void StVenantKirchhoffMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
         q = 0;
         
         /* Compute Gradient of Basis functions*/
-        for (k = 0; k < nln; k = k + 1 )
-        {
-            for (d1 = 0; d1 < dim; d1 = d1 + 1 )
-            {
-                gradphi[d1][k][q] = 0;
-                for (d2 = 0; d2 < dim; d2 = d2 + 1 )
-                {
-                    gradphi[d1][k][q] = gradphi[d1][k][q] + INVJAC(ie,d1,d2)*GRADREFPHI(k,q,d2);
-                }
-            }
-        }
+        GeoCache.PhysicalGradients(&GeoCache, ie, q, &gradphi[0][0][q], nln*NumQuadPoints, NumQuadPoints);
         
         for (d1 = 0; d1 < dim; d1 = d1 + 1 )
         {
@@ -823,8 +762,8 @@ void StVenantKirchhoffMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
                 GradUh[d1][d2][q] = 0;
                 for (k = 0; k < nln; k = k + 1 )
                 {
-                    int e_k;
-                    e_k = (int)(elements[ie*numRowsElements + k] + d1*NumNodes - 1);
+                    long long e_k;
+                    e_k = elements[ie*numRowsElements + k] + d1*NumNodes - 1;
                     GradUh[d1][d2][q] = GradUh[d1][d2][q] + U_h[e_k] * gradphi[d2][k][q];
                 }
                 F[d1][d2][q]  = Id[d1][d2] + GradUh[d1][d2][q];
@@ -866,5 +805,547 @@ void StVenantKirchhoffMaterial_stress(mxArray* plhs[], const mxArray* prhs[])
         }
     }
     
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Element-batched internal forces (3D), see ELEMENT_BATCH in Tools.h */
+void StVenantKirchhoffMaterial_forcesBatch3D(mxArray* plhs[], const mxArray* prhs[])
+{
+    
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[4]);
+    double* nln_ptr = mxGetPr(prhs[5]);
+    int nln     = (int)(nln_ptr[0]);
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    
+    plhs[0] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+    plhs[1] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
+    
+    IndexArray myRrows    = GetIndexArray(plhs[0]);
+    double* myRcoef    = mxGetPr(plhs[1]);
+    
+    int NumQuadPoints     = mxGetN(prhs[6]);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
+    
+    double* U_h   = mxGetPr(prhs[3]);
+    double* w   = mxGetPr(prhs[6]);
+    double* detjac = mxGetPr(prhs[8]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
+    
+    long long* elements  = GetIndexData(prhs[4]);
+    
+    double* material_param = mxGetPr(prhs[2]);
+    double Young = material_param[0];
+    double Poisson = material_param[1];
+    double mu = Young / (2 + 2 * Poisson);
+    double lambda =  Young * Poisson /( (1+Poisson) * (1-2*Poisson) );
+    
+    /* Assembly: loop over batches of ELEMENT_BATCH elements */
+    int numBatches = (noe + ELEMENT_BATCH - 1) / ELEMENT_BATCH;
+    int ib;
+    
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,mu,lambda)
+    
+    for (ib = 0; ib < numBatches; ib = ib + 1 )
+    {
+        int ie0 = ib * ELEMENT_BATCH;
+        int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+        int q, d1, d2, l, a, i_c;
+        
+        double Uloc[3][nln][ELEMENT_BATCH];
+        double gradphi[3][nln][ELEMENT_BATCH];
+        double F[3][3][ELEMENT_BATCH];
+        double E[3][3][ELEMENT_BATCH];
+        double traceE[ELEMENT_BATCH];
+        double P_Uh[3][3][ELEMENT_BATCH];
+        double rloc[nln][3][ELEMENT_BATCH];
+        
+        memset(rloc, 0, sizeof(rloc));
+        
+        BatchLocalDisplacement(3, ie0, nb, nln, numRowsElements, NumNodes, elements, U_h, Uloc);
+        
+        for (q = 0; q < NumQuadPoints; q = q + 1 )
+        {
+            BatchGradients(3, ie0, nb, q, nln, &GeoCache, gradphi);
+            BatchDeformationGradient(3, nln, gradphi, Uloc, F);
+            BatchRightCauchyGreen(3, F, E);
+            for (d1 = 0; d1 < 3; d1 = d1 + 1 )
+            {
+                #pragma omp simd
+                for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                {
+                    E[d1][d1][l] = E[d1][d1][l] - 1.0;
+                }
+                for (d2 = 0; d2 < 3; d2 = d2 + 1 )
+                {
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        E[d1][d2][l] = 0.5 * E[d1][d2][l];
+                    }
+                }
+            }
+            BatchTrace(3, E, traceE);
+            
+            /* First Piola-Kirchhoff stress tensor */
+            for (d1 = 0; d1 < 3; d1 = d1 + 1 )
+            {
+                for (d2 = 0; d2 < 3; d2 = d2 + 1 )
+                {
+                    double FE[ELEMENT_BATCH];
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        FE[l] = F[d1][0][l]*E[0][d2][l] + F[d1][1][l]*E[1][d2][l] + F[d1][2][l]*E[2][d2][l];
+                    }
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        P_Uh[d1][d2][l] = 2 * mu * FE[l] + lambda * traceE[l] * F[d1][d2][l];
+                    }
+                }
+            }
+            
+            for (a = 0; a < nln; a = a + 1 )
+            {
+                for (i_c = 0; i_c < 3; i_c = i_c + 1 )
+                {
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        rloc[a][i_c][l] = rloc[a][i_c][l] + ( gradphi[0][a][l] * P_Uh[i_c][0][l]
+                                                            + gradphi[1][a][l] * P_Uh[i_c][1][l]
+                                                            + gradphi[2][a][l] * P_Uh[i_c][2][l] ) * w[q];
+                    }
+                }
+            }
+        }
+        
+        BatchScatterVector(3, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, rloc, myRrows, myRcoef);
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* First Piola-Kirchhoff stress P[i][J] and material tangent
+ * A[i][J][k][L] = dP_iJ / dF_kL, with P = F S and
+ * S = 2 mu E + lambda tr(E) I */
+FORCE_INLINE void StVenantKirchhoffMaterial_tangent(const int dim, const double mu, const double lambda, double F[dim][dim][ELEMENT_BATCH],
+        double E[dim][dim][ELEMENT_BATCH], double traceE[ELEMENT_BATCH], double P[dim][dim][ELEMENT_BATCH], double A[dim][dim][dim][dim][ELEMENT_BATCH])
+{
+    int i, J, k, L, M, l;
+    double FFT[dim][dim][ELEMENT_BATCH];
+    
+    for (i = 0; i < dim; i = i + 1 )
+    {
+        for (k = 0; k < dim; k = k + 1 )
+        {
+            #pragma omp simd
+            for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+            {
+                double tmp = 0;
+                for (M = 0; M < dim; M = M + 1 )
+                {
+                    tmp = tmp + F[i][M][l] * F[k][M][l];
+                }
+                FFT[i][k][l] = tmp;
+            }
+        }
+    }
+    
+    /* First Piola-Kirchhoff stress tensor */
+    for (i = 0; i < dim; i = i + 1 )
+    {
+        for (J = 0; J < dim; J = J + 1 )
+        {
+            #pragma omp simd
+            for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+            {
+                double tmp = 0;
+                for (M = 0; M < dim; M = M + 1 )
+                {
+                    tmp = tmp + F[i][M][l] * ( 2.0 * mu * E[M][J][l] );
+                }
+                P[i][J][l] = tmp + lambda * traceE[l] * F[i][J][l];
+            }
+        }
+    }
+    
+    for (i = 0; i < dim; i = i + 1 )
+    {
+        for (J = 0; J < dim; J = J + 1 )
+        {
+            for (k = 0; k < dim; k = k + 1 )
+            {
+                for (L = 0; L < dim; L = L + 1 )
+                {
+                    double delta_ik = (i == k) ? 1.0 : 0.0;
+                    double delta_JL = (J == L) ? 1.0 : 0.0;
+                    #pragma omp simd
+                    for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                    {
+                        double S_LJ = 2.0 * mu * E[L][J][l] + lambda * traceE[l] * delta_JL;
+                        
+                        A[i][J][k][L][l] = delta_ik * S_LJ
+                                           + mu * ( F[i][L][l] * F[k][J][l] + FFT[i][k][l] * delta_JL )
+                                           + lambda * F[i][J][l] * F[k][L][l];
+                    }
+                }
+            }
+        }
+    }
+}
+/*************************************************************************/
+/* Jacobian of a batch of elements: the material tangent is evaluated once
+ * per quadrature point and contracted with the gradients of the basis
+ * functions. If computeResidual is set, the internal forces are assembled
+ * in the same pass from the stress evaluated alongside the tangent. If
+ * symmetric is set, only the upper triangle of the local matrices is
+ * computed and scattered (the tangent of hyperelastic materials has major
+ * symmetry) */
+FORCE_INLINE void StVenantKirchhoffMaterial_jacobian_batch(const int dim, const int ie0, const int nb, const int nln, const int NumQuadPoints, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* U_h, const double* w,
+        const double* detjac, const GeometryCache GeoCache, const double mu, const double lambda, IndexArray myArows, IndexArray myAcols, CoefArray myAcoef,
+        const int computeResidual, IndexArray myRrows, double* myRcoef, const int symmetric)
+{
+    int q, d1, d2, l;
+    
+    double Uloc[dim][nln][ELEMENT_BATCH];
+    double gradphi[dim][nln][ELEMENT_BATCH];
+    double F[dim][dim][ELEMENT_BATCH];
+    double E[dim][dim][ELEMENT_BATCH];
+    double traceE[ELEMENT_BATCH];
+    double P[dim][dim][ELEMENT_BATCH];
+    double A[dim][dim][dim][dim][ELEMENT_BATCH];
+    double aloc[nln][dim][nln][dim][ELEMENT_BATCH];
+    double rloc[nln][dim][ELEMENT_BATCH];
+    
+    memset(aloc, 0, sizeof(aloc));
+    memset(rloc, 0, sizeof(rloc));
+    
+    BatchLocalDisplacement(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, U_h, Uloc);
+    
+    for (q = 0; q < NumQuadPoints; q = q + 1 )
+    {
+        BatchGradients(dim, ie0, nb, q, nln, &GeoCache, gradphi);
+        BatchDeformationGradient(dim, nln, gradphi, Uloc, F);
+        BatchRightCauchyGreen(dim, F, E);
+        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+        {
+            for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+            {
+                double delta = (d1 == d2) ? 1.0 : 0.0;
+                #pragma omp simd
+                for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                {
+                    E[d1][d2][l] = 0.5 * ( E[d1][d2][l] - delta );
+                }
+            }
+        }
+        BatchTrace(dim, E, traceE);
+        
+        StVenantKirchhoffMaterial_tangent(dim, mu, lambda, F, E, traceE, P, A);
+        if (symmetric)
+        {
+            BatchTangentContractionSymmetric(dim, nln, w[q], gradphi, A, aloc);
+        }
+        else
+        {
+            BatchTangentContraction(dim, nln, w[q], gradphi, A, aloc);
+        }
+        if (computeResidual)
+        {
+            BatchStressContraction(dim, nln, w[q], gradphi, P, rloc);
+        }
+    }
+    
+    if (symmetric)
+    {
+        BatchScatterMatrixSymmetric(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, aloc, myArows, myAcols, myAcoef);
+    }
+    else
+    {
+        BatchScatterMatrix(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, aloc, myArows, myAcols, myAcoef);
+    }
+    if (computeResidual)
+    {
+        BatchScatterVector(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, rloc, myRrows, myRcoef);
+    }
+}
+
+/*************************************************************************/
+/* Jacobian based on the material tangent, see StVenantKirchhoffMaterial_tangent;
+ * if computeResidual is set, the internal forces are returned in plhs[3],
+ * plhs[4] as well; if symmetric is set, only the upper triangle of the
+ * jacobian is returned (see SetSymmetricIndex) */
+static void StVenantKirchhoffMaterial_tangentAssembly(mxArray* plhs[], const mxArray* prhs[], const int computeResidual, const int symmetric, const CoefFormat coefFormat)
+{
+    
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[4]);
+    double* nln_ptr = mxGetPr(prhs[5]);
+    int nln     = (int)(nln_ptr[0]);
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    mwSize nln2    = nln*nln;
+    mwSize localSize = symmetric ? nln*dim*(nln*dim+1)/2 : nln2*dim*dim;
+    
+    CreateMatrixOutputs(plhs, localSize*noe, prhs[4], mxGetM(prhs[3]), noe, coefFormat);
+    
+    IndexArray myArows    = GetIndexArray(plhs[0]);
+    IndexArray myAcols    = GetIndexArray(plhs[1]);
+    CoefArray myAcoef  = GetMatrixCoefArray(plhs[2], coefFormat);
+    
+    IndexArray myRrows = {NULL, NULL, NULL};
+    double* myRcoef    = NULL;
+    if (computeResidual)
+    {
+        plhs[3] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+        plhs[4] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
+        myRrows = GetIndexArray(plhs[3]);
+        myRcoef = mxGetPr(plhs[4]);
+    }
+    
+    int NumQuadPoints     = mxGetN(prhs[6]);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
+    
+    double* U_h   = mxGetPr(prhs[3]);
+    double* w   = mxGetPr(prhs[6]);
+    double* detjac = mxGetPr(prhs[8]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
+    
+    long long* elements  = GetIndexData(prhs[4]);
+    
+    double* material_param = mxGetPr(prhs[2]);
+    double Young = material_param[0];
+    double Poisson = material_param[1];
+    double mu = Young / (2 + 2 * Poisson);
+    double lambda =  Young * Poisson /( (1+Poisson) * (1-2*Poisson) );
+    
+    /* Assembly: loop over batches of ELEMENT_BATCH elements */
+    int numBatches = (noe + ELEMENT_BATCH - 1) / ELEMENT_BATCH;
+    int ib;
+    
+    if (dim == 2)
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,computeResidual,symmetric,mu,lambda)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            StVenantKirchhoffMaterial_jacobian_batch(2, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, U_h, w,
+                    detjac, GeoCache, mu, lambda, myArows, myAcols, myAcoef, computeResidual, myRrows, myRcoef, symmetric);
+        }
+    }
+    else
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myAcols,myArows,myAcoef,myRrows,myRcoef,U_h) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,computeResidual,symmetric,mu,lambda)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            StVenantKirchhoffMaterial_jacobian_batch(3, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, U_h, w,
+                    detjac, GeoCache, mu, lambda, myArows, myAcols, myAcoef, computeResidual, myRrows, myRcoef, symmetric);
+        }
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+void StVenantKirchhoffMaterial_jacobianTangent(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    StVenantKirchhoffMaterial_tangentAssembly(plhs, prhs, 0, 0, coefFormat);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Internal forces and jacobian assembled in a single pass over the elements */
+void StVenantKirchhoffMaterial_residual_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    StVenantKirchhoffMaterial_tangentAssembly(plhs, prhs, 1, 0, coefFormat);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Upper triangle of the jacobian, see SetSymmetricIndex */
+void StVenantKirchhoffMaterial_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    StVenantKirchhoffMaterial_tangentAssembly(plhs, prhs, 0, 1, coefFormat);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+void StVenantKirchhoffMaterial_residual_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat)
+{
+    StVenantKirchhoffMaterial_tangentAssembly(plhs, prhs, 1, 1, coefFormat);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+/* Action of the jacobian on V_h for a batch of elements, without forming
+ * the local matrices: r_a += w (A : grad(V)) gradphi_a. If TangentCache is
+ * not NULL the material tangent is stored as well; V_h may be NULL if only
+ * the tangent is needed */
+FORCE_INLINE void StVenantKirchhoffMaterial_tangentOperator_batch(const int dim, const int ie0, const int nb, const int nln, const int NumQuadPoints, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* U_h, const double* V_h, const double* w,
+        const double* detjac, const GeometryCache GeoCache, const double mu, const double lambda, IndexArray myRrows, double* myRcoef, double* TangentCache)
+{
+    int q, d1, d2, l;
+    
+    double Uloc[dim][nln][ELEMENT_BATCH];
+    double Vloc[dim][nln][ELEMENT_BATCH];
+    double gradphi[dim][nln][ELEMENT_BATCH];
+    double F[dim][dim][ELEMENT_BATCH];
+    double E[dim][dim][ELEMENT_BATCH];
+    double traceE[ELEMENT_BATCH];
+    double P[dim][dim][ELEMENT_BATCH];
+    double A[dim][dim][dim][dim][ELEMENT_BATCH];
+    double G[dim][dim][ELEMENT_BATCH];
+    double dP[dim][dim][ELEMENT_BATCH];
+    double rloc[nln][dim][ELEMENT_BATCH];
+    
+    memset(rloc, 0, sizeof(rloc));
+    
+    BatchLocalDisplacement(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, U_h, Uloc);
+    if (V_h != NULL)
+    {
+        BatchLocalDisplacement(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, V_h, Vloc);
+    }
+    
+    for (q = 0; q < NumQuadPoints; q = q + 1 )
+    {
+        BatchGradients(dim, ie0, nb, q, nln, &GeoCache, gradphi);
+        BatchDeformationGradient(dim, nln, gradphi, Uloc, F);
+        BatchRightCauchyGreen(dim, F, E);
+        for (d1 = 0; d1 < dim; d1 = d1 + 1 )
+        {
+            for (d2 = 0; d2 < dim; d2 = d2 + 1 )
+            {
+                double delta = (d1 == d2) ? 1.0 : 0.0;
+                #pragma omp simd
+                for (l = 0; l < ELEMENT_BATCH; l = l + 1 )
+                {
+                    E[d1][d2][l] = 0.5 * ( E[d1][d2][l] - delta );
+                }
+            }
+        }
+        BatchTrace(dim, E, traceE);
+        
+        StVenantKirchhoffMaterial_tangent(dim, mu, lambda, F, E, traceE, P, A);
+        if (TangentCache != NULL)
+        {
+            BatchStoreTangent(dim, ie0, nb, q, NumQuadPoints, A, TangentCache);
+        }
+        if (V_h != NULL)
+        {
+            BatchDisplacementGradient(dim, nln, gradphi, Vloc, G);
+            BatchTangentApply(dim, A, G, dP);
+            BatchStressContraction(dim, nln, w[q], gradphi, dP, rloc);
+        }
+    }
+    
+    if (V_h != NULL)
+    {
+        BatchScatterVector(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, rloc, myRrows, myRcoef);
+    }
 }
-/*************************************************************************/
\ No newline at end of file
+
+/*************************************************************************/
+/* Matrix-free jacobian: if computeProduct is set, returns the vector
+ * J(U_h)*V_h, with V_h = prhs[11], in sparse vector format; otherwise
+ * returns the material tangent at each quadrature point */
+static void StVenantKirchhoffMaterial_tangentOperator(mxArray* plhs[], const mxArray* prhs[], const int computeProduct)
+{
+    
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[4]);
+    double* nln_ptr = mxGetPr(prhs[5]);
+    int nln     = (int)(nln_ptr[0]);
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    
+    int NumQuadPoints     = mxGetN(prhs[6]);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
+    
+    IndexArray myRrows = {NULL, NULL, NULL};
+    double* myRcoef      = NULL;
+    double* V_h          = NULL;
+    double* TangentCache = NULL;
+    if (computeProduct)
+    {
+        plhs[0] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+        plhs[1] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
+        myRrows = GetIndexArray(plhs[0]);
+        myRcoef = mxGetPr(plhs[1]);
+        V_h     = mxGetPr(prhs[11]);
+    }
+    else
+    {
+        plhs[0] = CreateElementMatrix(TangentCacheSize(dim)*NumQuadPoints*noe,1, noe);
+        TangentCache = mxGetPr(plhs[0]);
+    }
+    
+    double* U_h   = mxGetPr(prhs[3]);
+    double* w   = mxGetPr(prhs[6]);
+    double* detjac = mxGetPr(prhs[8]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
+    
+    long long* elements  = GetIndexData(prhs[4]);
+    
+    double* material_param = mxGetPr(prhs[2]);
+    double Young = material_param[0];
+    double Poisson = material_param[1];
+    double mu = Young / (2 + 2 * Poisson);
+    double lambda =  Young * Poisson /( (1+Poisson) * (1-2*Poisson) );
+    
+    /* Assembly: loop over batches of ELEMENT_BATCH elements */
+    int numBatches = (noe + ELEMENT_BATCH - 1) / ELEMENT_BATCH;
+    int ib;
+    
+    if (dim == 2)
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h,V_h,TangentCache) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,mu,lambda)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            StVenantKirchhoffMaterial_tangentOperator_batch(2, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, U_h, V_h, w,
+                    detjac, GeoCache, mu, lambda, myRrows, myRcoef, TangentCache);
+        }
+    }
+    else
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,U_h,V_h,TangentCache) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes,mu,lambda)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            StVenantKirchhoffMaterial_tangentOperator_batch(3, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, U_h, V_h, w,
+                    detjac, GeoCache, mu, lambda, myRrows, myRcoef, TangentCache);
+        }
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+void StVenantKirchhoffMaterial_jacobianVector(mxArray* plhs[], const mxArray* prhs[])
+{
+    StVenantKirchhoffMaterial_tangentOperator(plhs, prhs, 1);
+}
+/*************************************************************************/
+
+/*************************************************************************/
+void StVenantKirchhoffMaterial_tangentCache(mxArray* plhs[], const mxArray* prhs[])
+{
+    StVenantKirchhoffMaterial_tangentOperator(plhs, prhs, 0);
+}
+/*************************************************************************/
@@ -10,20 +10,31 @@
 #include <string.h>
 #include "../../../Core/Tools.h"
 
-#define INVJAC(i,j,k) invjac[i+(j+k*dim)*noe]
-#define GRADREFPHI(i,j,k) gradrefphi[i+(j+k*NumQuadPoints)*nln]
-
 #ifndef SVTMATERIAL_H_INCLUDED
 #define SVTMATERIAL_H_INCLUDED
 
 void StVenantKirchhoffMaterial_forces(mxArray* plhs[], const mxArray* prhs[]);
 
-void StVenantKirchhoffMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[]);
+void StVenantKirchhoffMaterial_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
-void StVenantKirchhoffMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[]);
+void StVenantKirchhoffMaterial_jacobianFast3D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
-void StVenantKirchhoffMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[]);
+void StVenantKirchhoffMaterial_jacobianFast2D(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
 
 void StVenantKirchhoffMaterial_stress(mxArray* plhs[], const mxArray* prhs[]);
 
+void StVenantKirchhoffMaterial_forcesBatch3D(mxArray* plhs[], const mxArray* prhs[]);
+
+void StVenantKirchhoffMaterial_jacobianTangent(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void StVenantKirchhoffMaterial_residual_jacobian(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void StVenantKirchhoffMaterial_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void StVenantKirchhoffMaterial_residual_jacobianSymmetric(mxArray* plhs[], const mxArray* prhs[], const CoefFormat coefFormat);
+
+void StVenantKirchhoffMaterial_jacobianVector(mxArray* plhs[], const mxArray* prhs[]);
+
+void StVenantKirchhoffMaterial_tangentCache(mxArray* plhs[], const mxArray* prhs[]);
+
 #endif
\ No newline at end of file
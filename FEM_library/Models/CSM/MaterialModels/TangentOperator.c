@@ -0,0 +1,105 @@
+/*   This file is part of redbKIT.
+ *   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+ *   Author: Federico Negri <federico.negri@epfl.ch>
+ */
+
+#include "TangentOperator.h"
+
+/*************************************************************************/
+/* Matrix-free jacobian based on a cached material tangent (see
+ * <Material>_tangentCache): the action on V_h does not depend on the
+ * material model, nor on the displacement */
+FORCE_INLINE void TangentOperator_jacobianVector_batch(const int dim, const int ie0, const int nb, const int nln, const int NumQuadPoints, const mwSize numRowsElements, const long long NumNodes,
+        const long long* elements, const double* V_h, const double* w,
+        const double* detjac, const GeometryCache GeoCache, const double* TangentCache, IndexArray myRrows, double* myRcoef)
+{
+    int q;
+    
+    double Vloc[dim][nln][ELEMENT_BATCH];
+    double gradphi[dim][nln][ELEMENT_BATCH];
+    double A[dim][dim][dim][dim][ELEMENT_BATCH];
+    double G[dim][dim][ELEMENT_BATCH];
+    double dP[dim][dim][ELEMENT_BATCH];
+    double rloc[nln][dim][ELEMENT_BATCH];
+    
+    memset(rloc, 0, sizeof(rloc));
+    
+    BatchLocalDisplacement(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, V_h, Vloc);
+    
+    for (q = 0; q < NumQuadPoints; q = q + 1 )
+    {
+        BatchGradients(dim, ie0, nb, q, nln, &GeoCache, gradphi);
+        BatchLoadTangent(dim, ie0, nb, q, NumQuadPoints, TangentCache, A);
+        BatchDisplacementGradient(dim, nln, gradphi, Vloc, G);
+        BatchTangentApply(dim, A, G, dP);
+        BatchStressContraction(dim, nln, w[q], gradphi, dP, rloc);
+    }
+    
+    BatchScatterVector(dim, ie0, nb, nln, numRowsElements, NumNodes, elements, detjac, rloc, myRrows, myRcoef);
+}
+
+/*************************************************************************/
+/* Returns J*V_h in sparse vector format, with V_h = prhs[11] and the
+ * tangent cache in prhs[12] */
+void TangentOperator_jacobianVector(mxArray* plhs[], const mxArray* prhs[])
+{
+    
+    double* dim_ptr = mxGetPr(prhs[0]);
+    int dim     = (int)(dim_ptr[0]);
+    int noe     = mxGetN(prhs[4]);
+    double* nln_ptr = mxGetPr(prhs[5]);
+    int nln     = (int)(nln_ptr[0]);
+    mwSize numRowsElements  = mxGetM(prhs[4]);
+    
+    int NumQuadPoints     = mxGetN(prhs[6]);
+    long long NumNodes    = (long long)(mxGetM(prhs[3]) / dim);
+    
+    if ( mxGetNumberOfElements(prhs[12]) != TangentCacheSize(dim)*NumQuadPoints*noe )
+    {
+        mexErrMsgTxt("TangentOperator_jacobianVector: the tangent cache does not match the mesh and quadrature rule.");
+    }
+    
+    plhs[0] = CreateIndexMatrix((mwSize) nln*noe*dim, 1, prhs[4], mxGetM(prhs[3]));
+    plhs[1] = CreateElementMatrix((mwSize) nln*noe*dim,1, noe);
+    
+    IndexArray myRrows    = GetIndexArray(plhs[0]);
+    double* myRcoef    = mxGetPr(plhs[1]);
+    
+    double* V_h   = mxGetPr(prhs[11]);
+    double* TangentCache = mxGetPr(prhs[12]);
+    double* w   = mxGetPr(prhs[6]);
+    double* detjac = mxGetPr(prhs[8]);
+    GeometryCache GeoCache = GetGeometryCache(prhs[10], prhs[7], dim, nln, NumQuadPoints, noe);
+    
+    long long* elements  = GetIndexData(prhs[4]);
+    
+    /* Assembly: loop over batches of ELEMENT_BATCH elements */
+    int numBatches = (noe + ELEMENT_BATCH - 1) / ELEMENT_BATCH;
+    int ib;
+    
+    if (dim == 2)
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,V_h,TangentCache) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            TangentOperator_jacobianVector_batch(2, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, V_h, w,
+                    detjac, GeoCache, TangentCache, myRrows, myRcoef);
+        }
+    }
+    else
+    {
+#pragma omp parallel for schedule(runtime) shared(detjac,elements,myRrows,myRcoef,V_h,TangentCache) private(ib) firstprivate(GeoCache,w,NumQuadPoints,numRowsElements,nln,NumNodes)
+        for (ib = 0; ib < numBatches; ib = ib + 1 )
+        {
+            int ie0 = ib * ELEMENT_BATCH;
+            int nb  = ( noe - ie0 < ELEMENT_BATCH ) ? noe - ie0 : ELEMENT_BATCH;
+            TangentOperator_jacobianVector_batch(3, ie0, nb, nln, NumQuadPoints, numRowsElements, NumNodes, elements, V_h, w,
+                    detjac, GeoCache, TangentCache, myRrows, myRcoef);
+        }
+    }
+    
+    ReleaseIndexData(elements, prhs[4]);
+}
+/*************************************************************************/
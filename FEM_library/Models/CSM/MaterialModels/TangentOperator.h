@@ -0,0 +1,19 @@
+/*   This file is part of redbKIT.
+ *   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+ *   Author: Federico Negri <federico.negri@epfl.ch>
+ */
+
+#include "mex.h"
+#include <stdio.h>
+#include <math.h>
+#include "blas.h"
+#include <string.h>
+#include "../../../Core/Tools.h"
+
+#ifndef TANGENTOPERATOR_H_INCLUDED
+#define TANGENTOPERATOR_H_INCLUDED
+
+/*************************************************************************/
+void TangentOperator_jacobianVector(mxArray* plhs[], const mxArray* prhs[]);
+
+#endif
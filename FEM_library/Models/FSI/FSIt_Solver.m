@@ -375,6 +375,16 @@ LinSolver  = LinearSolver( DATA.Fluid.LinearSolver );
 tol        = DATA.Solid.NonLinearSolver.tol;
 maxIter    = DATA.Solid.NonLinearSolver.maxit;
 
+% with DATA.Solid.NonLinearSolver.type = 'ModifiedNewton' the monolithic
+% jacobian of the implicit scheme and its preconditioner (or its matlab_lu /
+% MUMPS factorization) are kept until the residual norm is reduced by less
+% than DATA.Solid.NonLinearSolver.stallFactor
+modified_newton = strcmp(DATA.Solid.NonLinearSolver.type, 'ModifiedNewton') && ...
+                  strcmp(DATA.Fluid.time.nonlinearity, 'implicit');
+if modified_newton
+    LinSolver.SetReusePreconditioner( true );
+end
+
 %% PreProcessing for Drag and Lift Computation
 compute_AerodynamicForces = 0 ;
 if isfield(DATA.Fluid, 'Output') && isfield(DATA.Fluid.Output, 'DragLift')
@@ -450,6 +460,9 @@ end
 
 X_nk = X_n;
 
+% Fluid assembler, updated in place when the fluid mesh moves
+FluidModel = CFD_Assembler( MESH.Fluid, DATA.Fluid, FE_SPACE_v, FE_SPACE_p );
+
 %% Time Loop
 fprintf('\n **** Starting temporal loop ****\n');
 while ( t < tf )
@@ -471,7 +484,7 @@ while ( t < tf )
         case 'semi-implicit'
             
             %% Update Fluid Linear Matrices
-            FluidModel = CFD_Assembler( MESH.Fluid, DATA.Fluid, FE_SPACE_v, FE_SPACE_p );
+            FluidModel.SetMesh( MESH.Fluid );
 
             fprintf('\n   -- Fluid_Assembling Stokes terms... ');
             t_assembly = tic;
@@ -688,93 +701,147 @@ while ( t < tf )
             % Start Newton's method
             while( k <= maxIter && (norm_k > tol || isnan(norm_k) ) )
                 
-                % Assemble Solid Tangent matrix and internal forces vector
-                fprintf('\n   -- Solid_Assembling Residual and Jacobian ... ');
-                t_assembly = tic;
-                dA = SolidModel.compute_jacobian(  d_nk  );
-                GS = SolidModel.compute_internal_forces( d_nk );
-                t_assembly = toc(t_assembly);
-                fprintf('done in %3.3f s\n', t_assembly);
-                
-                dG_STR    = Coef_MassS * M_s + dA + A_robin + J_P;
-                G_S       = Coef_MassS * M_s * d_nk + GS + A_robin * d_nk + R_P + J_P * d_nk - F_S;
-
-                % Apply Solid boundary conditions
-                [dG_STR, G_S] = CSM_ApplyBC(dG_STR, -G_S, FE_SPACE_s, MESH.Solid, DATA.Solid, t, 1);
-                
-                % Update Fluid Matrices
-                FluidModel = CFD_Assembler( MESH.Fluid, DATA.Fluid, FE_SPACE_v, FE_SPACE_p );
-                
-                fprintf('\n   -- Fluid_Assembling volumetric forces... ');
-                t_assembly = tic;
-                F_gravity = FluidModel.compute_external_forces(t);
-                t_assembly = toc(t_assembly);
-                fprintf('done in %3.3f s\n', t_assembly);
-                
-                fprintf('\n   -- Fluid_Assembling Stokes terms... ');
-                t_assembly = tic;
-                [A_Stokes] = FluidModel.compute_Stokes_matrix();
-                t_assembly = toc(t_assembly);
-                fprintf('done in %3.3f s\n', t_assembly);
-                
-                fprintf('\n   -- Fluid_Assembling Mass matrix... ');
-                t_assembly = tic;
-                Mv = FluidModel.compute_mass_velocity();
-                Mp = FluidModel.compute_mass_pressure();
-                M  = blkdiag(DATA.Fluid.density * Mv, 0*Mp);
-                t_assembly = toc(t_assembly);
-                fprintf('done in %3.3f s\n', t_assembly);
-                                
-                fprintf('\n   -- Fluid_Assembling Convective Term... ');
-                t_assembly = tic;
-                [C1, C2]    = FluidModel.compute_convective_matrix_ALE( u_nk(1:FE_SPACE_v.numDof),  ALE_velocity);
-                t_assembly = toc(t_assembly);
-                fprintf('done in %3.3f s\n', t_assembly);
-                
-                F_NS = 1/dt * M * (alphaF*u_nk - u_BDF) + A_Stokes * u_nk + C1 * u_nk - F_gravity;
-                C_NS = alphaF/dt * M + A_Stokes + C1 + C2;
+                assemble_jacobian  = true;
+                residual_assembled = false;
                 
-                % Assemble SUPG contributes
-                if use_SUPG
-                    fprintf('\n   -- Fluid_Assembling SUPG Terms ... ');
+                if modified_newton && k > 1
+                    
+                    % Assemble residuals only, keep the current jacobian
+                    fprintf('\n   -- Solid_Assembling Residual ... ');
+                    t_assembly = tic;
+                    GS = SolidModel.compute_internal_forces( d_nk );
+                    t_assembly = toc(t_assembly);
+                    fprintf('done in %3.3f s\n', t_assembly);
+                    
+                    G_S       = Coef_MassS * M_s * d_nk + GS + A_robin * d_nk + R_P + J_P * d_nk - F_S;
+                    [~, G_S]  = CSM_ApplyBC([], -G_S, FE_SPACE_s, MESH.Solid, DATA.Solid, t, 1);
+                    
+                    FluidModel.SetMesh( MESH.Fluid );
+                    
+                    fprintf('\n   -- Fluid_Assembling Residual ... ');
                     t_assembly = tic;
-                    [A_SUPG, F_SUPG] = FluidModel.compute_SUPG_implicit_ALE( u_nk, ALE_velocity, v_BDF, dt, alphaF);
+                    F_NS = FluidModel.compute_NewtonStep_ALE_residual( u_nk, ALE_velocity, v_BDF, dt, alphaF, use_SUPG) ...
+                        - FluidModel.compute_external_forces(t);
                     t_assembly = toc(t_assembly);
                     fprintf('done in %3.3f s\n', t_assembly);
                     
-                    C_NS             = C_NS + A_SUPG;
-                    F_NS             = F_NS + F_SUPG;
+                    [~, G_NS] =  CFD_ApplyBC([], -F_NS, FE_SPACE_v, FE_SPACE_p, MESH.Fluid, DATA.Fluid, t, 1, u);
+                    
+                    F_L2     = F_L - IdGamma_FS*X_nk(MESH.Fluid.Gamma) + alpha*d_nk(MESH.Solid.internal_dof(MESH.Solid.Gamma));
+                    
+                    % interface terms dG_STR(:,Gamma)*F_L2 evaluated with the
+                    % solid jacobian at d_nk, without assembling it
+                    V_S      = zeros(FE_SPACE_s.numDof, 1);
+                    V_S(MESH.Solid.internal_dof(MESH.Solid.Gamma)) = F_L2;
+                    W_S      = Coef_MassS * (M_s * V_S) + SolidModel.compute_jacobian_vector( d_nk, V_S ) + A_robin * V_S + J_P * V_S;
+                    W_S      = W_S(MESH.Solid.internal_dof);
+                    
+                    G_FSI    = [G_NS(MESH.Fluid.II); ...
+                        G_NS(MESH.Fluid.Gamma)+IdGamma_SF*G_S(MESH.Solid.Gamma)+1/alpha*(IdGamma_SF*W_S(MESH.Solid.Gamma)); ...
+                        G_S(MESH.Solid.II)+1/alpha*W_S(MESH.Solid.II)];
+                    
+                    % rebuild the jacobian only if convergence stalls
+                    assemble_jacobian  = norm(G_FSI) > DATA.Solid.NonLinearSolver.stallFactor * normRES;
+                    residual_assembled = true;
+                    
                 end
                 
-                % Apply Fluid boundary conditions
-                [dG_NS, G_NS]   =  CFD_ApplyBC(C_NS, -F_NS, FE_SPACE_v, FE_SPACE_p, MESH.Fluid, DATA.Fluid, t, 1, u);
+                if assemble_jacobian
+                    
+                    % Assemble Solid Tangent matrix and internal forces vector,
+                    % unless the residuals are already available
+                    t_assembly = tic;
+                    if residual_assembled
+                        fprintf('\n   -- Solid_Assembling Jacobian ... ');
+                        dA = SolidModel.compute_jacobian(  d_nk  );
+                    else
+                        fprintf('\n   -- Solid_Assembling Residual and Jacobian ... ');
+                        [GS, dA] = SolidModel.compute_internal_forces_jacobian(  d_nk  );
+                    end
+                    t_assembly = toc(t_assembly);
+                    fprintf('done in %3.3f s\n', t_assembly);
+                
+                    dG_STR    = Coef_MassS * M_s + dA + A_robin + J_P;
+                    
+                    % Apply Solid boundary conditions
+                    if residual_assembled
+                        dG_STR        = CSM_ApplyBC(dG_STR, [], FE_SPACE_s, MESH.Solid, DATA.Solid, t, 1);
+                    else
+                        G_S           = Coef_MassS * M_s * d_nk + GS + A_robin * d_nk + R_P + J_P * d_nk - F_S;
+                        [dG_STR, G_S] = CSM_ApplyBC(dG_STR, -G_S, FE_SPACE_s, MESH.Solid, DATA.Solid, t, 1);
+                    end
+                    
+                    if residual_assembled
+                        
+                        % the fluid residual G_NS is kept, only the jacobian
+                        % of the fused sweep is used
+                        fprintf('\n   -- Fluid_Assembling Newton system... ');
+                        t_assembly = tic;
+                        C_NS = FluidModel.compute_NewtonStep_ALE( u_nk, ALE_velocity, v_BDF, dt, alphaF, use_SUPG);
+                        t_assembly = toc(t_assembly);
+                        fprintf('done in %3.3f s\n', t_assembly);
+                        
+                        dG_NS = CFD_ApplyBC(C_NS, [], FE_SPACE_v, FE_SPACE_p, MESH.Fluid, DATA.Fluid, t, 1, u);
+                        
+                    else
+                        
+                        % Update Fluid Matrices
+                        FluidModel.SetMesh( MESH.Fluid );
+                        
+                        fprintf('\n   -- Fluid_Assembling volumetric forces... ');
+                        t_assembly = tic;
+                        F_gravity = FluidModel.compute_external_forces(t);
+                        t_assembly = toc(t_assembly);
+                        fprintf('done in %3.3f s\n', t_assembly);
+                        
+                        % mass, Stokes, convective and SUPG terms in a single sweep
+                        fprintf('\n   -- Fluid_Assembling Newton system... ');
+                        t_assembly = tic;
+                        [C_NS, F_NS] = FluidModel.compute_NewtonStep_ALE( u_nk, ALE_velocity, v_BDF, dt, alphaF, use_SUPG);
+                        t_assembly = toc(t_assembly);
+                        fprintf('done in %3.3f s\n', t_assembly);
+                        
+                        F_NS = F_NS - F_gravity;
+                        
+                        % Apply Fluid boundary conditions
+                        [dG_NS, G_NS]   =  CFD_ApplyBC(C_NS, -F_NS, FE_SPACE_v, FE_SPACE_p, MESH.Fluid, DATA.Fluid, t, 1, u);
+                        
+                    end
+                
+                    fprintf('\n   -- Form monolithic system ... ');
+                    t_assembly = tic;
+                    % Interface Solid Stiffness expressed in the fluid numbering
+                    S_GG     = IdGamma_SF * (dG_STR(MESH.Solid.Gamma,MESH.Solid.Gamma) * IdGamma_FS);
                 
-                fprintf('\n   -- Form monolithic system ... ');
-                t_assembly = tic;
-                % Interface Solid Stiffness expressed in the fluid numbering
-                S_GG     = IdGamma_SF * (dG_STR(MESH.Solid.Gamma,MESH.Solid.Gamma) * IdGamma_FS);
+                    % Interface/Internal Solid Stiffness expressed in fluid/solid numbering
+                    S_GI     = IdGamma_SF *  dG_STR(MESH.Solid.Gamma,MESH.Solid.II);
+                    F_L2     = F_L - IdGamma_FS*X_nk(MESH.Fluid.Gamma) + alpha*d_nk(MESH.Solid.internal_dof(MESH.Solid.Gamma));
                 
-                % Interface/Internal Solid Stiffness expressed in fluid/solid numbering
-                S_GI     = IdGamma_SF *  dG_STR(MESH.Solid.Gamma,MESH.Solid.II);
-                F_L2     = F_L - IdGamma_FS*X_nk(MESH.Fluid.Gamma) + alpha*d_nk(MESH.Solid.internal_dof(MESH.Solid.Gamma));
+                    % Form Monolothic System
+                    dG_FSI    = [dG_NS(MESH.Fluid.II,MESH.Fluid.II)                      dG_NS(MESH.Fluid.II,MESH.Fluid.Gamma)                    Z_FS ;...
+                        dG_NS(MESH.Fluid.Gamma,MESH.Fluid.II)      dG_NS(MESH.Fluid.Gamma,MESH.Fluid.Gamma)+1/alpha*S_GG               S_GI  ;...
+                        Z_SF                                                    1/alpha*dG_STR(MESH.Solid.II,MESH.Solid.Gamma)*IdGamma_FS   dG_STR(MESH.Solid.II,MESH.Solid.II)   ];
                 
-                % Form Monolothic System
-                dG_FSI    = [dG_NS(MESH.Fluid.II,MESH.Fluid.II)                      dG_NS(MESH.Fluid.II,MESH.Fluid.Gamma)                    Z_FS ;...
-                    dG_NS(MESH.Fluid.Gamma,MESH.Fluid.II)      dG_NS(MESH.Fluid.Gamma,MESH.Fluid.Gamma)+1/alpha*S_GG               S_GI  ;...
-                    Z_SF                                                    1/alpha*dG_STR(MESH.Solid.II,MESH.Solid.Gamma)*IdGamma_FS   dG_STR(MESH.Solid.II,MESH.Solid.II)   ];
+                    G_FSI    = [G_NS(MESH.Fluid.II); ...
+                        G_NS(MESH.Fluid.Gamma)+IdGamma_SF*G_S(MESH.Solid.Gamma)+1/alpha*(IdGamma_SF*(dG_STR(MESH.Solid.Gamma,MESH.Solid.Gamma)*F_L2)); ...
+                        G_S(MESH.Solid.II)+1/alpha*dG_STR(MESH.Solid.II,MESH.Solid.Gamma)*F_L2];
                 
-                G_FSI    = [G_NS(MESH.Fluid.II); ...
-                    G_NS(MESH.Fluid.Gamma)+IdGamma_SF*G_S(MESH.Solid.Gamma)+1/alpha*(IdGamma_SF*(dG_STR(MESH.Solid.Gamma,MESH.Solid.Gamma)*F_L2)); ...
-                    G_S(MESH.Solid.II)+1/alpha*dG_STR(MESH.Solid.II,MESH.Solid.Gamma)*F_L2];
+                    t_assembly = toc(t_assembly);
+                    fprintf('done in %3.3f s\n', t_assembly);
                 
-                t_assembly = toc(t_assembly);
-                fprintf('done in %3.3f s\n', t_assembly);
+                end
+                normRES  = norm(G_FSI);
                     
                 % Solve Monolothic System
                 fprintf('\n -- Solve J x = -R ... ');
-                Precon.Build( dG_FSI );
-                fprintf('\n      time to build the preconditioner %3.3f s \n', Precon.GetBuildTime());
-                LinSolver.SetPreconditioner( Precon );
+                if assemble_jacobian
+                    if modified_newton
+                        LinSolver.Reset( );
+                    end
+                    Precon.Build( dG_FSI );
+                    fprintf('\n      time to build the preconditioner %3.3f s \n', Precon.GetBuildTime());
+                    LinSolver.SetPreconditioner( Precon );
+                end
                 dX(MESH.internal_dof) = LinSolver.Solve( dG_FSI, G_FSI );
                 fprintf('\n      time to solve the linear system in %3.3f s \n', LinSolver.GetSolveTime());
                 
@@ -9,6 +9,8 @@ function [ DATA ] = dataParser( DATA )
 DATA = parserLinearSolverOptions( DATA );
 DATA = parserPreconditionerOptions( DATA );
 DATA = parserNonLinearSolverOptions( DATA );
+DATA = parserAssemblyOptions( DATA );
+DATA = parserMeshOptions( DATA );
 
 end
 
@@ -42,6 +44,12 @@ if ~isfield(DATA.LinearSolver,'mumps_reordering')
     DATA.LinearSolver.mumps_reordering    =  0;
 end
 
+% MUMPS SYM parameter: 0 unsymmetric, 1 symmetric positive definite,
+% 2 general symmetric
+if ~isfield(DATA.LinearSolver,'symmetric')
+    DATA.LinearSolver.symmetric           =  0;
+end
+
 end
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
@@ -113,5 +121,102 @@ if ~isfield(DATA.NonLinearSolver,'backtrackFactor')
     DATA.NonLinearSolver.backtrackFactor       =  1.0;
 end
 
+% with type = 'ModifiedNewton' the jacobian (and its preconditioner) is
+% rebuilt only when the residual norm is reduced by less than stallFactor
+if ~isfield(DATA.NonLinearSolver,'stallFactor')
+    DATA.NonLinearSolver.stallFactor           =  0.5;
+end
+
+end
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+function [ DATA ] = parserAssemblyOptions( DATA )
+
+if ~isfield(DATA, 'Assembly')
+    DATA.Assembly = [];
+end
+
+% reuse the sparsity pattern of matrices reassembled at each Newton
+% iteration or time step (see SparseScatterMap)
+if ~isfield(DATA.Assembly,'cache_pattern')
+    DATA.Assembly.cache_pattern         =  false;
+end
+
+% class of the connectivity passed to the C assemblers ('double', 'int32'
+% or 'int64'); with integer connectivity row/column indices are returned
+% as int32 (int64 for very large problems)
+if ~isfield(DATA.Assembly,'index_type')
+    DATA.Assembly.index_type            =  'double';
+end
+
+% precompute the physical gradients of the basis functions ('none',
+% 'double' or 'single'), using at most geometry_cache_budget MB
+if ~isfield(DATA.Assembly,'geometry_cache')
+    DATA.Assembly.geometry_cache        =  'none';
+end
+
+if ~isfield(DATA.Assembly,'geometry_cache_budget')
+    DATA.Assembly.geometry_cache_budget =  Inf;
+end
+
+% solve the Newton linear systems by gmres with jacobian-vector products
+% computed element by element, without assembling the jacobian (CSM);
+% with tangent_cache the material tangent is stored at the quadrature
+% nodes once per Newton iteration: 45 doubles (10 in 2D) per quadrature
+% node of each element, hence off by default
+if ~isfield(DATA.Assembly,'matrix_free')
+    DATA.Assembly.matrix_free           =  false;
+end
+
+if ~isfield(DATA.Assembly,'tangent_cache')
+    DATA.Assembly.tangent_cache         =  false;
+end
+
+% compute only the upper triangle of the local matrices of symmetric
+% operators (mass, diffusion-reaction, Stokes viscous block, CSM jacobian)
+if ~isfield(DATA.Assembly,'symmetric')
+    DATA.Assembly.symmetric             =  false;
+end
+
+% mass matrix of the time dependent solvers: 'consistent', or lumped by
+% row sums ('rowsum') or by diagonal scaling ('HRZ'), see MassOperator
+if ~isfield(DATA.Assembly,'mass_type')
+    DATA.Assembly.mass_type             =  'consistent';
+end
+
+% color the elements (see ElementColoring) and scatter the elemental
+% contributions color by color, without atomics, into the residual
+% vectors and, with cache_pattern, into the cached sparse matrices
+if ~isfield(DATA.Assembly,'coloring')
+    DATA.Assembly.coloring              =  false;
+end
+
+% precision of the matrix coefficients returned by the C assemblers: the
+% local matrices are computed in double and rounded to single precision
+% when stored, halving the triplets ('single': all the matrices, 'mixed':
+% only the matrices assembled to build a preconditioner); the residuals
+% and rhs vectors are always assembled in double precision
+if ~isfield(DATA.Assembly,'precision')
+    DATA.Assembly.precision             =  'double';
+end
+
+end
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+function [ DATA ] = parserMeshOptions( DATA )
+
+if ~isfield(DATA, 'Mesh')
+    DATA.Mesh = [];
+end
+
+% renumber the elements along a Hilbert curve and the vertices by 'rcm'
+% or nested dissection ('nd') before building the FE spaces; the solution
+% is computed and exported on the renumbered mesh
+if ~isfield(DATA.Mesh,'reorder')
+    DATA.Mesh.reorder                   =  false;
+end
+
+if ~isfield(DATA.Mesh,'node_ordering')
+    DATA.Mesh.node_ordering             =  'rcm';
+end
+
 end
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
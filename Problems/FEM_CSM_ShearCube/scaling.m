@@ -0,0 +1,105 @@
+%SCALING OpenMP strong scaling of the C assemblers on the ShearCube mesh
+%
+%   Times the assembly of the CSM jacobian and internal forces, of the
+%   ADR stiffness and of the mass matrix for an increasing number of
+%   threads and for the static, dynamic and guided schedules (see
+%   SetOmpSettings). Run it on a dual-socket node to check the NUMA first
+%   touch of the outputs: with the static schedule the speedup should keep
+%   growing past the cores of one socket.
+
+clc
+clear all
+
+dim         =  3;
+fem         =  'P2';
+num_threads =  [1 2 4 8 16 32];
+schedules   =  {'static', 'dynamic', 'guided'};
+chunk       =  [];
+num_repeat  =  3;
+
+%% load P1 mesh and build FE space
+[vertices, boundaries, elements] = msh_to_Mmesh('Cube', dim);
+
+DATA   = CSM_read_DataFile('datafile', dim);
+DATA.Material_Model = 'NeoHookean';
+
+quad_order = 4;
+[ MESH ]     = buildMESH( dim, elements, vertices, boundaries, fem, quad_order, DATA, 'CSM' );
+[ FE_SPACE ] = buildFESpace( MESH, fem, dim, quad_order );
+
+SolidModel = CSM_Assembler( MESH, DATA, FE_SPACE );
+
+U_h = 1e-3 * rand(FE_SPACE.numDof, 1);
+
+FE_SPACE_s = buildFESpace( MESH, fem, 1, quad_order );
+
+DATA_ADR.diffusion = 1;
+DATA_ADR.reaction  = 0;
+DATA_ADR.force     = 0;
+DATA_ADR.transport = {0, 0, 0};
+DATA_ADR.param     = [];
+DATA_ADR           = dataParser( DATA_ADR );
+
+fprintf('\n%d elements, %d dofs, %d cores\n', MESH.numElem, FE_SPACE.numDof, feature('numcores'));
+
+%% Time the assemblers
+num_threads = num_threads(num_threads <= feature('numcores'));
+kernels     = {'CSM jacobian', 'CSM forces', 'ADR stiffness', 'Mass'};
+timings     = zeros(length(num_threads), length(kernels), length(schedules));
+
+for s = 1 : length(schedules)
+    for i = 1 : length(num_threads)
+        
+        SetOmpSettings(num_threads(i), schedules{s}, chunk);
+        
+        for k = 1 : length(kernels)
+            t = Inf;
+            for r = 1 : num_repeat
+                time_k = tic;
+                switch k
+                    case 1
+                        SolidModel.compute_jacobian(U_h);
+                    case 2
+                        SolidModel.compute_internal_forces(U_h);
+                    case 3
+                        ADR_Assembler(MESH, DATA_ADR, FE_SPACE_s, 'diffusion');
+                    case 4
+                        Mass_assembler_C_omp(dim, MESH.elements, FE_SPACE_s.numElemDof, ...
+                            FE_SPACE_s.quad_weights, MESH.jac, FE_SPACE_s.phi);
+                end
+                t = min(t, toc(time_k));
+            end
+            timings(i, k, s) = t;
+        end
+    end
+end
+
+SetOmpSettings();
+
+%% Print speedups
+for s = 1 : length(schedules)
+    fprintf('\nSchedule %s\n', schedules{s});
+    fprintf('%8s', 'threads');
+    fprintf('%18s', kernels{:});
+    fprintf('\n');
+    for i = 1 : length(num_threads)
+        fprintf('%8d', num_threads(i));
+        for k = 1 : length(kernels)
+            fprintf('%10.3f s (x%4.1f)', timings(i,k,s), timings(1,k,s) / timings(i,k,s));
+        end
+        fprintf('\n');
+    end
+end
+
+figure
+for k = 1 : length(kernels)
+    subplot(1, length(kernels), k)
+    loglog(num_threads, squeeze(timings(1,k,:))' ./ squeeze(timings(:,k,:)), '-o', 'LineWidth', 2)
+    hold on
+    loglog(num_threads, num_threads, 'k--')
+    legend([schedules, {'ideal'}], 'Location', 'NorthWest')
+    xlabel('threads')
+    ylabel('speedup')
+    title(kernels{k})
+    grid on
+end
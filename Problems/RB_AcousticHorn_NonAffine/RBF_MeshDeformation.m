@@ -67,13 +67,12 @@ for k_mu = 1 : size(mu_points,1)
     
 end
 
-const = [0.09 0.09];
-displacement = 0 * vertices;
+const = 0.09;
+
+% all the displacement components are interpolated at once
+RBF_data     = RBF_setup(P_fixed', P_displacement', 'gaussian', const);
+displacement = RBF_evaluate(vertices, RBF_data)';
 
-for i = 1 : dim
-    RBF_data{i} = RBF_setup(P_fixed', P_displacement(:,i)', 'gaussian', const(i));
-    displacement(i,:) = RBF_evaluate(vertices, RBF_data{i})';
-end
 deformed_vertices = vertices + displacement;
 
 end
\ No newline at end of file
@@ -101,13 +101,19 @@ for i = 1 : FOM.Qf
     FOM.Fq{i} = sparse(FOM.FE_SPACE.numDof, 1);
 end
 
-% A_1: diffusion
-A_1       =  ADR_Assembler(MESH, DATA, FE_SPACE, 'diffusion', [], [], [1 2 3 4 5]);
-FOM.Aq{1} =  A_1(FOM.MESH.internal_dof,FOM.MESH.internal_dof);
+% all the affine terms are assembled in a single loop over the elements
+TERMS = {'diffusion', [], [], [1 2 3 4 5]; ... % A_1: diffusion
+         'diffusion', [], [], [1 2 3 4];   ... % A_2: diffusion
+         'source',    [], [], 5;           ... % F_3: distr source
+         'source',    [], [], 1;           ... % F_4 - F_7: distr sources
+         'source',    [], [], 2;           ...
+         'source',    [], [], 3;           ...
+         'source',    [], [], 4};
 
-% A_2: diffusion
-A_2       =  ADR_Assembler(MESH, DATA, FE_SPACE, 'diffusion', [], [], [1 2 3 4]);
-FOM.Aq{2} =  A_2(FOM.MESH.internal_dof,FOM.MESH.internal_dof);
+[Aq, Fq]  =  ADR_Assembler(MESH, DATA, FE_SPACE, TERMS);
+
+FOM.Aq{1} =  Aq{1}(FOM.MESH.internal_dof,FOM.MESH.internal_dof);
+FOM.Aq{2} =  Aq{2}(FOM.MESH.internal_dof,FOM.MESH.internal_dof);
 
 % F_1: Neumann 1
 DATA.bcNeu     =  @(x, y, t, param)(1.*(y==1) + 0.*x.*y);
@@ -119,16 +125,9 @@ DATA.bcNeu     =  @(x, y, t, param)(1.*(y==-1) + 0.*x.*y);
 [~, F_2]       =  ADR_ApplyBC([], [], FE_SPACE, MESH, DATA);
 FOM.Fq{2}      =  F_2;
 
-% F_3: distr source
-[~, F_3]       =  ADR_Assembler(MESH, DATA, FE_SPACE, 'source', [], [], [5]);
-FOM.Fq{3}      =  F_3(FOM.MESH.internal_dof);
-
-for q = 1 : 4
-
-    % F_q: distr source
-    [~, F_q]       =  ADR_Assembler(MESH, DATA, FE_SPACE, 'source', [], [], [q]);
-    FOM.Fq{3+q}    =  F_q(FOM.MESH.internal_dof);
-
+% F_3 - F_7: distr sources
+for q = 3 : 7
+    FOM.Fq{q}      =  Fq{q}(FOM.MESH.internal_dof);
 end
 
 FOM.u_D        =  @(x,mu)(FOM.DATA.bcDir(x(1,:),x(2,:),[],mu));
@@ -0,0 +1,127 @@
+/*   This file is part of redbKIT.
+ *   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+ *   Author: Federico Negri <federico.negri@epfl.ch>
+ */
+
+/* Interpolation matrix of a compactly supported RBF
+ *
+ *  [rows, cols, coef] = RBF_SparseMatrix_Fast(RBF_function_name, x, rho)
+ *
+ *  x being dimX x nI, returns the triplets of the nonzero entries
+ *  A(i,j) = RBF(|x_i - x_j|), i.e. of the pairs of points closer than the
+ *  support radius rho, found by a spatial hash (see RBF_Tools.h)
+ */
+
+#include "mex.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include "RBF_Tools.h"
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#warning "OpenMP not enabled. Compile with mex RBF_SparseMatrix_Fast.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp""
+#endif
+
+/*************************************************************************/
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
+{
+
+    /* Check for proper number of arguments */
+    if(nrhs!=3) {
+        mexErrMsgTxt("3 inputs are required.");
+    } else if(nlhs>3) {
+        mexErrMsgTxt("Too many output arguments.");
+    }
+
+    char *RBF_function_name = mxArrayToString(prhs[0]);
+    int order = GetWendlandOrder(RBF_function_name);
+    mxFree(RBF_function_name);
+
+    if (order < 0)
+    {
+        mexErrMsgTxt("Only compactly supported RBF functions are allowed.");
+    }
+
+    double* interp_points = mxGetPr(prhs[1]);
+    int dimX  = mxGetM(prhs[1]);
+    int nI    = mxGetN(prhs[1]);
+    double rho = mxGetScalar(prhs[2]);
+
+    /* centers stored by coordinate (nI x dimX) */
+    double* centers = mxMalloc(sizeof(double) * nI * dimX);
+    int k, l;
+    for (k = 0; k < nI; k++)
+    {
+        for (l = 0; l < dimX; l++)
+        {
+            centers[k+nI*l] = interp_points[l+dimX*k];
+        }
+    }
+
+    RBF_Hash hash;
+    BuildHash(&hash, centers, nI, dimX, rho);
+
+    /* first pass: number of neighbors of each point */
+    mwSize* offset = mxMalloc(sizeof(mwSize) * (nI + 1));
+    int i;
+    #pragma omp parallel for schedule(dynamic, 64) shared(offset,centers,hash) private(i) firstprivate(nI,dimX)
+    for (i = 0; i < nI; i++)
+    {
+        double xi[dimX];
+        int l;
+        for (l = 0; l < dimX; l++)
+        {
+            xi[l] = centers[i+nI*l];
+        }
+        offset[i+1] = QueryHash(&hash, xi, NULL, NULL, 0);
+    }
+
+    offset[0] = 0;
+    for (i = 0; i < nI; i++)
+    {
+        offset[i+1] += offset[i];
+    }
+    mwSize nnz = offset[nI];
+
+    plhs[0] = mxCreateDoubleMatrix(nnz, 1, mxREAL);
+    plhs[1] = mxCreateDoubleMatrix(nnz, 1, mxREAL);
+    plhs[2] = mxCreateDoubleMatrix(nnz, 1, mxREAL);
+
+    double* rows = mxGetPr(plhs[0]);
+    double* cols = mxGetPr(plhs[1]);
+    double* coef = mxGetPr(plhs[2]);
+
+    int* neighbors = mxMalloc(sizeof(int) * nnz);
+
+    /* second pass: the squared distances are stored in coef and then
+     * replaced by the kernel values */
+    #pragma omp parallel for schedule(dynamic, 64) shared(offset,centers,hash,rows,cols,coef,neighbors) private(i) firstprivate(nI,dimX,order,rho)
+    for (i = 0; i < nI; i++)
+    {
+        double xi[dimX];
+        int l;
+        mwSize p;
+        for (l = 0; l < dimX; l++)
+        {
+            xi[l] = centers[i+nI*l];
+        }
+
+        int n = offset[i+1] - offset[i];
+        QueryHash(&hash, xi, neighbors + offset[i], coef + offset[i], n);
+        WendlandKernel(order, n, rho, coef + offset[i], coef + offset[i]);
+
+        for (p = offset[i]; p < offset[i+1]; p++)
+        {
+            rows[p] = i + 1;
+            cols[p] = neighbors[p] + 1;
+        }
+    }
+
+    mxFree(neighbors);
+    mxFree(offset);
+    FreeHash(&hash);
+    mxFree(centers);
+}
+/*************************************************************************/
+
@@ -0,0 +1,220 @@
+/*   This file is part of redbKIT.
+ *   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+ *   Author: Federico Negri <federico.negri@epfl.ch>
+ */
+
+#include "RBF_Tools.h"
+
+/*************************************************************************/
+void WendlandKernel(const int order, const int n, const double rho, const double* r2, double* phi)
+{
+    double s = 1.0/rho;
+    int k;
+
+    switch (order)
+    {
+        case 0:
+            #pragma omp simd
+            for (k = 0; k < n; k++)
+            {
+                double t = 1 - sqrt(r2[k])*s;
+                t = (t > 0) ? t : 0.0;
+                phi[k] = t*t;
+            }
+            break;
+
+        case 2:
+            #pragma omp simd
+            for (k = 0; k < n; k++)
+            {
+                double r = sqrt(r2[k])*s;
+                double t = (r < 1) ? 1 - r : 0.0;
+                double t2 = t*t;
+                phi[k] = t2*t2*(4*r+1);
+            }
+            break;
+
+        default:
+            #pragma omp simd
+            for (k = 0; k < n; k++)
+            {
+                double r = sqrt(r2[k])*s;
+                double t = (r < 1) ? 1 - r : 0.0;
+                double t3 = t*t*t;
+                phi[k] = t3*t3*(35*r*r+18*r+3)/3.0;
+            }
+            break;
+    }
+}
+/*************************************************************************/
+int GetWendlandOrder(const char* RBF_function_name)
+{
+    if (strcmp(RBF_function_name, "wendlandC0")==0)
+    {
+        return 0;
+    }
+
+    if (strcmp(RBF_function_name, "wendlandC2")==0)
+    {
+        return 2;
+    }
+
+    if (strcmp(RBF_function_name, "wendlandC4")==0)
+    {
+        return 4;
+    }
+
+    return -1;
+}
+/*************************************************************************/
+static unsigned int HashCell(const int dimX, const int* cell, const unsigned int mask)
+{
+    static const unsigned int primes[3] = {73856093u, 19349663u, 83492791u};
+    unsigned int key = 0;
+    int l;
+    for (l = 0; l < dimX; l++)
+    {
+        key ^= (unsigned int) cell[l] * primes[l%3] + (unsigned int) l;
+    }
+    return key & mask;
+}
+/*************************************************************************/
+void BuildHash(RBF_Hash* hash, const double* centers, const int nI, const int dimX, const double h)
+{
+    int k, l;
+
+    hash->dimX    = dimX;
+    hash->nI      = nI;
+    hash->h       = h;
+    hash->centers = centers;
+
+    /* number of buckets: power of two >= 2 nI */
+    unsigned int numBuckets = 1;
+    while (numBuckets < 2*(unsigned int)nI)
+    {
+        numBuckets *= 2;
+    }
+    hash->mask = numBuckets - 1;
+
+    hash->origin = mxMalloc(sizeof(double) * dimX);
+    hash->cells  = mxMalloc(sizeof(int) * dimX * nI);
+    hash->head   = mxCalloc(numBuckets + 1, sizeof(int));
+    hash->items  = mxMalloc(sizeof(int) * nI);
+
+    for (l = 0; l < dimX; l++)
+    {
+        hash->origin[l] = centers[nI*l];
+        for (k = 1; k < nI; k++)
+        {
+            hash->origin[l] = (centers[k+nI*l] < hash->origin[l]) ? centers[k+nI*l] : hash->origin[l];
+        }
+    }
+
+    unsigned int* bucket = mxMalloc(sizeof(unsigned int) * nI);
+    for (k = 0; k < nI; k++)
+    {
+        int* cell = hash->cells + dimX*k;
+        for (l = 0; l < dimX; l++)
+        {
+            cell[l] = (int) floor((centers[k+nI*l] - hash->origin[l]) / h);
+        }
+        bucket[k] = HashCell(dimX, cell, hash->mask);
+        hash->head[bucket[k]+1]++;
+    }
+
+    /* counting sort of the centers by bucket */
+    unsigned int b;
+    for (b = 0; b < numBuckets; b++)
+    {
+        hash->head[b+1] += hash->head[b];
+    }
+    int* next = mxMalloc(sizeof(int) * numBuckets);
+    memcpy(next, hash->head, sizeof(int) * numBuckets);
+    for (k = 0; k < nI; k++)
+    {
+        hash->items[next[bucket[k]]++] = k;
+    }
+
+    mxFree(next);
+    mxFree(bucket);
+}
+/*************************************************************************/
+int QueryHash(const RBF_Hash* hash, const double* xi, int* idx, double* r2, const int capacity)
+{
+    int dimX = hash->dimX;
+    int nI   = hash->nI;
+    double h2 = hash->h * hash->h;
+    int center[dimX], cell[dimX], offset[dimX];
+    int count = 0;
+    int l, p;
+
+    for (l = 0; l < dimX; l++)
+    {
+        center[l] = (int) floor((xi[l] - hash->origin[l]) / hash->h);
+        offset[l] = -1;
+    }
+
+    /* loop over the 3^dimX cells around xi, offset being the counter */
+    while (1)
+    {
+        for (l = 0; l < dimX; l++)
+        {
+            cell[l] = center[l] + offset[l];
+        }
+
+        unsigned int b = HashCell(dimX, cell, hash->mask);
+        for (p = hash->head[b]; p < hash->head[b+1]; p++)
+        {
+            int k = hash->items[p];
+            const int* cellk = hash->cells + dimX*k;
+
+            /* other cells can fall into the same bucket */
+            int same = 1;
+            for (l = 0; l < dimX; l++)
+            {
+                same = same && (cellk[l] == cell[l]);
+            }
+            if (!same)
+            {
+                continue;
+            }
+
+            double d2 = 0.0;
+            for (l = 0; l < dimX; l++)
+            {
+                double tmp = xi[l] - hash->centers[k+nI*l];
+                d2 += tmp*tmp;
+            }
+            if (d2 < h2)
+            {
+                if (count < capacity)
+                {
+                    idx[count] = k;
+                    r2[count]  = d2;
+                }
+                count++;
+            }
+        }
+
+        for (l = 0; l < dimX && offset[l] == 1; l++)
+        {
+            offset[l] = -1;
+        }
+        if (l == dimX)
+        {
+            break;
+        }
+        offset[l]++;
+    }
+
+    return count;
+}
+/*************************************************************************/
+void FreeHash(RBF_Hash* hash)
+{
+    mxFree(hash->origin);
+    mxFree(hash->cells);
+    mxFree(hash->head);
+    mxFree(hash->items);
+}
+/*************************************************************************/
@@ -0,0 +1,65 @@
+/*   This file is part of redbKIT.
+ *   Copyright (c) 2016, Ecole Polytechnique Federale de Lausanne (EPFL)
+ *   Author: Federico Negri <federico.negri@epfl.ch>
+ */
+
+#include "mex.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#ifndef RBF_TOOLS_H_INCLUDED
+#define RBF_TOOLS_H_INCLUDED
+
+/*************************************************************************/
+/* Compactly supported Wendland functions, scaled so that phi(0) = 1 and
+ * positive definite up to dimension 3:
+ *
+ *   order 0:  (1-t)^2_+
+ *   order 2:  (1-t)^4_+ (4t+1)
+ *   order 4:  (1-t)^6_+ (35t^2+18t+3)/3,     t = r/rho
+ *
+ * phi[k] = psi(sqrt(r2[k])/rho) for the n squared distances r2 */
+
+void WendlandKernel(const int order, const int n, const double rho, const double* r2, double* phi);
+
+
+/* order of the Wendland function wendlandC0, wendlandC2 or wendlandC4,
+ * -1 for any other name */
+int GetWendlandOrder(const char* RBF_function_name);
+
+/*************************************************************************/
+/* Spatial hash of a set of centers: the space is divided into cubic cells
+ * of size h, and the centers are sorted by the hash of the integer
+ * coordinates of their cell. All the centers closer than h to a point are
+ * found in the 3^dimX cells around it, which makes the neighbor lists of
+ * compactly supported kernels (h = support radius) linear in the number of
+ * points. The centers are stored by coordinate (nI x dimX). */
+
+typedef struct
+{
+    int             dimX;
+    int             nI;
+    double          h;
+    const double*   centers;
+    double*         origin;     /* dimX */
+    int*            cells;      /* cell coordinates of the centers, dimX x nI */
+    unsigned int    mask;       /* number of buckets - 1 */
+    int*            head;       /* bucket b holds items[head[b]:head[b+1]-1] */
+    int*            items;
+} RBF_Hash;
+
+
+void BuildHash(RBF_Hash* hash, const double* centers, const int nI, const int dimX, const double h);
+
+
+/* Indices and squared distances of the centers closer than h to xi. At
+ * most capacity neighbors are stored, the return value is their total
+ * number: the caller can count with capacity = 0 or enlarge its buffers
+ * and query again. */
+int QueryHash(const RBF_Hash* hash, const double* xi, int* idx, double* r2, const int capacity);
+
+
+void FreeHash(RBF_Hash* hash);
+
+#endif
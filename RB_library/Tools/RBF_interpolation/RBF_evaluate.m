@@ -1,10 +1,20 @@
-function [I_f] = RBF_evaluate(x, RBF_data)
+function [I_f] = RBF_evaluate(x, RBF_data, tol)
 %RBF_EVALUATE evaluates RBF interpolant in a given set of points
 %
 %   [I_F] = RBF_EVALUATE(X, RBF_data) given a matrix X of size dimX
-%   x nPoints and the struct RBF_data generated by RBF_SETUP, returns a row
-%   vector I_F of size 1 x nPoints containing the values of the RBF
+%   x nPoints and the struct RBF_data generated by RBF_SETUP, returns a column
+%   vector I_F of size nPoints x 1 containing the values of the RBF
 %   interpolant in the points X.
+%
+%   If RBF_data contains k interpolants (see RBF_SETUP), I_F is a matrix of
+%   size nPoints x k: the kernel values are computed once and applied to
+%   all the coefficient vectors.
+%
+%   [I_F] = RBF_EVALUATE(X, RBF_data, TOL) with TOL > 0 evaluates the
+%   interpolant on a k-d tree of the interpolation points: far clusters of
+%   points are replaced by a second order expansion, with a relative error
+%   of order TOL, and for the gaussian the points farther than
+%   c*sqrt(-2*log(TOL)) are neglected. Default is TOL = 0 (exact).
 
 %   This file is part of redbKIT.
 %   Copyright (c) 2015, Ecole Polytechnique Federale de Lausanne (EPFL)
@@ -19,7 +29,11 @@ if (dimI~=dimX)
   error('x should have the same number of rows as RBF_data.x');
 end
 
-I_f = RBF_evaluate_Fast(RBF_data.RBF_function_type, interp_points, x,  RBF_data.constant, RBF_data.coeff);
+if nargin < 3 || isempty(tol)
+    tol = 0;
+end
+
+I_f = RBF_evaluate_Fast(RBF_data.RBF_function_type, interp_points, x,  RBF_data.constant, RBF_data.coeff, tol);
 
 % I_f = zeros(1, nPoints);
 % 
@@ -5,103 +5,761 @@
 
 #include "mex.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include "blas.h"
 #include <string.h>
+#include "RBF_Tools.h"
 #ifdef _OPENMP
 #include <omp.h>
 #else
 #warning "OpenMP not enabled. Compile with mex RBF_evaluate_Fast.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp""
 #endif
 
+/* number of centers processed at once: the squared distances and the
+ * kernel values of a block are computed in separate vectorized loops */
+#define RBF_BLOCK 256
+
+/* number of points per tile when several coefficient vectors are given:
+ * a RBF_BLOCK x RBF_TILE block of kernel values (64 KB) is computed once
+ * and multiplied against all the coefficient columns by dgemm */
+#define RBF_TILE 32
+
+/* maximum number of centers in a leaf of the k-d tree */
+#define RBF_LEAF 64
+
+typedef enum
+{
+    RBF_GAUSSIAN,
+    RBF_THINPLATE,
+    RBF_CUBIC,
+    RBF_MULTIQUADRIC,
+    RBF_WENDLAND0,
+    RBF_WENDLAND2,
+    RBF_WENDLAND4
+} RBF_Type;
+
 /*************************************************************************/
-double RBF_function(double d, double c, char *RBF_function_name)
+RBF_Type GetRBFType(const char* RBF_function_name)
 {
+    if (strcmp(RBF_function_name, "thinplate")==0)
+    {
+        return RBF_THINPLATE;
+    }
+
+    if (strcmp(RBF_function_name, "cubic")==0)
+    {
+        return RBF_CUBIC;
+    }
 
-	double val = -1;
-
-    if (strcmp(RBF_function_name, "gaussian")==0)
-	{
-		val = exp(-0.5*d*d/(c*c));
-        return val;
-	}
-
-	if (strcmp(RBF_function_name, "thinplate")==0)
-	{
-		val = d*d*log(d+1);
-        return val;
-	}
-
-	if (strcmp(RBF_function_name, "cubic")==0)
-	{
-		val = (d*d*d);
-        return val;
-	}
-    
     if (strcmp(RBF_function_name, "multiquadric")==0)
-	{
-		val = sqrt(1+d*d/(c*c));
-        return val;
-	}
+    {
+        return RBF_MULTIQUADRIC;
+    }
+
+    switch (GetWendlandOrder(RBF_function_name))
+    {
+        case 0:
+            return RBF_WENDLAND0;
+        case 2:
+            return RBF_WENDLAND2;
+        case 4:
+            return RBF_WENDLAND4;
+    }
+
+    /* as in RBF_setup, unknown functions are replaced by the gaussian */
+    return RBF_GAUSSIAN;
+}
+/*************************************************************************/
+/* Kernel values phi[k] = RBF(d_k) of a block of n centers, given the
+ * squared distances r2[k] = d_k^2; the kernel is selected once per block */
+static void RBF_kernel(const RBF_Type type, const int n, const double c, const double* r2, double* phi)
+{
+    int k;
+
+    switch (type)
+    {
+        case RBF_GAUSSIAN:
+        {
+            double s = -0.5/(c*c);
+            #pragma omp simd
+            for (k = 0; k < n; k++)
+            {
+                phi[k] = exp(s*r2[k]);
+            }
+            break;
+        }
+
+        case RBF_THINPLATE:
+            #pragma omp simd
+            for (k = 0; k < n; k++)
+            {
+                phi[k] = r2[k]*log(sqrt(r2[k])+1);
+            }
+            break;
+
+        case RBF_CUBIC:
+            #pragma omp simd
+            for (k = 0; k < n; k++)
+            {
+                phi[k] = r2[k]*sqrt(r2[k]);
+            }
+            break;
+
+        case RBF_MULTIQUADRIC:
+        {
+            double s = 1.0/(c*c);
+            #pragma omp simd
+            for (k = 0; k < n; k++)
+            {
+                phi[k] = sqrt(1+s*r2[k]);
+            }
+            break;
+        }
+
+        /* c is the support radius */
+        case RBF_WENDLAND0:
+            WendlandKernel(0, n, c, r2, phi);
+            break;
+
+        case RBF_WENDLAND2:
+            WendlandKernel(2, n, c, r2, phi);
+            break;
+
+        case RBF_WENDLAND4:
+            WendlandKernel(4, n, c, r2, phi);
+            break;
+    }
+}
+/*************************************************************************/
+/* phi[k] = RBF(|x_i - interp_point_{k0+k}|) for the nb centers of a block */
+static void RBF_block(const RBF_Type type, const double c, const double* xi, const double* centers,
+                      const int nI, const int dimX, const int k0, const int nb, double* phi)
+{
+    int k, l;
+
+    for (k = 0; k < nb; k++)
+    {
+        phi[k] = 0.0;
+    }
+    for (l = 0; l < dimX; l++)
+    {
+        double xl = xi[l];
+        const double* cl = centers + k0 + nI*l;
+        #pragma omp simd
+        for (k = 0; k < nb; k++)
+        {
+            double tmp = xl - cl[k];
+            phi[k] += tmp*tmp;
+        }
+    }
+
+    RBF_kernel(type, nb, c, phi, phi);
+}
+/*************************************************************************/
+/* f(s) = RBF(sqrt(s)) and its first two derivatives with respect to the
+ * squared distance s, used by the far-field expansion of the tree */
+static void RBF_kernel_derivatives(const RBF_Type type, const double c, const double s,
+                                   double* f, double* df, double* d2f)
+{
+    switch (type)
+    {
+        case RBF_GAUSSIAN:
+        {
+            double a = -0.5/(c*c);
+            *f   = exp(a*s);
+            *df  = a * (*f);
+            *d2f = a * (*df);
+            break;
+        }
+
+        case RBF_THINPLATE:
+        {
+            double r = sqrt(s);
+            *f   = s*log(r+1);
+            *df  = log(r+1) + 0.5*r/(r+1);
+            *d2f = (1.0/(r+1) + 0.5/((r+1)*(r+1))) / (2*r);
+            break;
+        }
+
+        case RBF_CUBIC:
+        {
+            double r = sqrt(s);
+            *f   = s*r;
+            *df  = 1.5*r;
+            *d2f = 0.75/r;
+            break;
+        }
+
+        case RBF_MULTIQUADRIC:
+        {
+            double b = 1.0/(c*c);
+            *f   = sqrt(1+b*s);
+            *df  = 0.5*b/(*f);
+            *d2f = -0.5*b*(*df)/((*f)*(*f));
+            break;
+        }
+
+        default:
+            /* compactly supported kernels are evaluated on neighbor lists */
+            break;
+    }
+}
+/*************************************************************************/
+/* k-d tree on the interpolation points: each node stores the bounding box
+ * of its centers, the radius of the ball around the box midpoint z, and,
+ * for each coefficient vector a, the moments
+ *
+ *   W = sum a_k,  T = sum a_k |d_k|^2,  D = sum a_k d_k,  Q = sum a_k d_k d_k',
+ *
+ * with d_k = y_k - z, of the second order Taylor expansion in y_k of
+ * sum_k a_k f(|x-y_k|^2) around z */
+typedef struct
+{
+    int     begin, end;
+    int     left, right;
+    double  radius;
+} RBF_Node;
+
+typedef struct
+{
+    int         dimX;
+    int         nI;
+    int         numCoef;
+    int         numMoments;
+    int         numNodes;
+    RBF_Node*   nodes;
+    double*     midpoint;   /* dimX x numNodes */
+    double*     bmin;       /* dimX x numNodes */
+    double*     bmax;       /* dimX x numNodes */
+    double*     moments;    /* numMoments x numCoef x numNodes */
+    int*        perm;       /* tree position -> interpolation point */
+    double*     centers;    /* centers in tree order, nI x dimX */
+    double*     coeff;      /* RBF coefficients in tree order, nI x numCoef */
+} RBF_Tree;
+
+/*************************************************************************/
+static int CountNodes(const int n)
+{
+    if (n <= RBF_LEAF)
+    {
+        return 1;
+    }
+    return 1 + CountNodes(n/2) + CountNodes(n - n/2);
+}
+/*************************************************************************/
+/* reorder perm[begin:end-1] so that perm[nth] has the nth smallest key */
+static void SelectNth(int* perm, int begin, int end, const int nth, const double* key)
+{
+    end = end - 1;
+    while (begin < end)
+    {
+        double pivot = key[perm[(begin+end)/2]];
+        int i = begin, j = end;
+        while (i <= j)
+        {
+            while (key[perm[i]] < pivot) i++;
+            while (key[perm[j]] > pivot) j--;
+            if (i <= j)
+            {
+                int tmp = perm[i];
+                perm[i] = perm[j];
+                perm[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+        if (nth <= j)
+        {
+            end = j;
+        }
+        else if (nth >= i)
+        {
+            begin = i;
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+/*************************************************************************/
+static int BuildNode(RBF_Tree* tree, const double* centers, const double* coeff,
+                     const int begin, const int end)
+{
+    int dimX    = tree->dimX;
+    int nI      = tree->nI;
+    int node    = tree->numNodes++;
+    int* perm   = tree->perm;
+    double* z    = tree->midpoint + dimX*node;
+    double* bmin = tree->bmin + dimX*node;
+    double* bmax = tree->bmax + dimX*node;
+    int k, l, m, j;
+
+    tree->nodes[node].begin = begin;
+    tree->nodes[node].end   = end;
+
+    int split = 0;
+    for (l = 0; l < dimX; l++)
+    {
+        bmin[l] = centers[perm[begin]+nI*l];
+        bmax[l] = bmin[l];
+        for (k = begin+1; k < end; k++)
+        {
+            double y = centers[perm[k]+nI*l];
+            bmin[l] = (y < bmin[l]) ? y : bmin[l];
+            bmax[l] = (y > bmax[l]) ? y : bmax[l];
+        }
+        z[l] = 0.5*(bmin[l]+bmax[l]);
+        if (bmax[l]-bmin[l] > bmax[split]-bmin[split])
+        {
+            split = l;
+        }
+    }
+
+    double radius2 = 0.0;
+    for (j = 0; j < tree->numCoef; j++)
+    {
+        double* W = tree->moments + tree->numMoments*(j + tree->numCoef*node);
+        double* T = W + 1;
+        double* D = W + 2;
+        double* Q = W + 2 + dimX;
+
+        for (m = 0; m < tree->numMoments; m++)
+        {
+            W[m] = 0.0;
+        }
+
+        for (k = begin; k < end; k++)
+        {
+            double a = coeff[perm[k] + (nI+1+dimX)*j];
+            double d[dimX];
+            double d2 = 0.0;
+            for (l = 0; l < dimX; l++)
+            {
+                d[l] = centers[perm[k]+nI*l] - z[l];
+                d2  += d[l]*d[l];
+            }
+            radius2 = (d2 > radius2) ? d2 : radius2;
+
+            *W += a;
+            *T += a*d2;
+            for (l = 0; l < dimX; l++)
+            {
+                D[l] += a*d[l];
+                for (m = 0; m < dimX; m++)
+                {
+                    Q[l+dimX*m] += a*d[l]*d[m];
+                }
+            }
+        }
+    }
+    tree->nodes[node].radius = sqrt(radius2);
+
+    if (end - begin > RBF_LEAF)
+    {
+        int mid = (begin + end)/2;
+        SelectNth(perm, begin, end, mid, centers + nI*split);
+        tree->nodes[node].left  = BuildNode(tree, centers, coeff, begin, mid);
+        tree->nodes[node].right = BuildNode(tree, centers, coeff, mid, end);
+    }
+    else
+    {
+        tree->nodes[node].left  = -1;
+        tree->nodes[node].right = -1;
+    }
+
+    return node;
+}
+/*************************************************************************/
+static void BuildTree(RBF_Tree* tree, const double* centers, const double* coeff,
+                      const int nI, const int dimX, const int numCoef)
+{
+    int k, l, j;
+
+    tree->dimX       = dimX;
+    tree->nI         = nI;
+    tree->numCoef    = numCoef;
+    tree->numMoments = 2 + dimX + dimX*dimX;
+    tree->numNodes   = 0;
+
+    int maxNodes   = CountNodes(nI);
+    tree->nodes    = mxMalloc(sizeof(RBF_Node) * maxNodes);
+    tree->midpoint = mxMalloc(sizeof(double) * dimX * maxNodes);
+    tree->bmin     = mxMalloc(sizeof(double) * dimX * maxNodes);
+    tree->bmax     = mxMalloc(sizeof(double) * dimX * maxNodes);
+    tree->moments  = mxMalloc(sizeof(double) * tree->numMoments * numCoef * maxNodes);
+    tree->perm     = mxMalloc(sizeof(int) * nI);
+    tree->centers  = mxMalloc(sizeof(double) * nI * dimX);
+    tree->coeff    = mxMalloc(sizeof(double) * nI * numCoef);
+
+    for (k = 0; k < nI; k++)
+    {
+        tree->perm[k] = k;
+    }
+
+    BuildNode(tree, centers, coeff, 0, nI);
+
+    /* the leaves are evaluated directly on contiguous centers */
+    for (k = 0; k < nI; k++)
+    {
+        for (l = 0; l < dimX; l++)
+        {
+            tree->centers[k+nI*l] = centers[tree->perm[k]+nI*l];
+        }
+        for (j = 0; j < numCoef; j++)
+        {
+            tree->coeff[k+nI*j] = coeff[tree->perm[k]+(nI+1+dimX)*j];
+        }
+    }
+}
+/*************************************************************************/
+static void FreeTree(RBF_Tree* tree)
+{
+    mxFree(tree->nodes);
+    mxFree(tree->midpoint);
+    mxFree(tree->bmin);
+    mxFree(tree->bmax);
+    mxFree(tree->moments);
+    mxFree(tree->perm);
+    mxFree(tree->centers);
+    mxFree(tree->coeff);
+}
+/*************************************************************************/
+/* sum[j] = sum_k coeff_j[k] RBF(|xi - interp_point_k|), j = 1,...,numCoef.
+ *
+ * A node is replaced by its far-field expansion when
+ *    radius <= theta * |xi - z|               (thinplate, cubic, multiquadric)
+ *    radius * (|xi - z| + radius) <= theta c^2 (gaussian)
+ * and, for the gaussian, skipped when the distance of xi from its bounding
+ * box exceeds the cutoff radius rcut */
+static void EvaluateTree(const RBF_Tree* tree, const RBF_Type type, const double c,
+                         const double theta, const double rcut2, const double* xi, double* sum)
+{
+    int dimX    = tree->dimX;
+    int nI      = tree->nI;
+    int numCoef = tree->numCoef;
+    int stack[128];
+    int top = 0;
+    int j, k, l, m;
+
+    for (j = 0; j < numCoef; j++)
+    {
+        sum[j] = 0.0;
+    }
+
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        int node = stack[--top];
+        const RBF_Node* N = tree->nodes + node;
+        const double* z = tree->midpoint + dimX*node;
+
+        if (type == RBF_GAUSSIAN)
+        {
+            const double* bmin = tree->bmin + dimX*node;
+            const double* bmax = tree->bmax + dimX*node;
+            double dist2 = 0.0;
+            for (l = 0; l < dimX; l++)
+            {
+                double tmp = (xi[l] < bmin[l]) ? bmin[l]-xi[l] : ((xi[l] > bmax[l]) ? xi[l]-bmax[l] : 0.0);
+                dist2 += tmp*tmp;
+            }
+            if (dist2 > rcut2)
+            {
+                continue;
+            }
+        }
+
+        double u[dimX];
+        double s = 0.0;
+        for (l = 0; l < dimX; l++)
+        {
+            u[l] = xi[l] - z[l];
+            s   += u[l]*u[l];
+        }
+
+        int farField;
+        if (type == RBF_GAUSSIAN)
+        {
+            farField = N->radius * (sqrt(s) + N->radius) <= theta * c * c;
+        }
+        else
+        {
+            farField = N->radius <= theta * sqrt(s);
+        }
 
-	return val;
-     
+        if (farField && s > 0)
+        {
+            double f = 0.0, df = 0.0, d2f = 0.0;
+            RBF_kernel_derivatives(type, c, s, &f, &df, &d2f);
+
+            for (j = 0; j < numCoef; j++)
+            {
+                const double* W = tree->moments + tree->numMoments*(j + numCoef*node);
+                const double* D = W + 2;
+                const double* Q = W + 2 + dimX;
+                double uD = 0.0, uQu = 0.0;
+                for (l = 0; l < dimX; l++)
+                {
+                    uD += u[l]*D[l];
+                    for (m = 0; m < dimX; m++)
+                    {
+                        uQu += u[l]*Q[l+dimX*m]*u[m];
+                    }
+                }
+                sum[j] += W[0]*f + df*(W[1] - 2*uD) + 2*d2f*uQu;
+            }
+        }
+        else if (N->left < 0)
+        {
+            double phi[RBF_LEAF];
+            int nb = N->end - N->begin;
+
+            RBF_block(type, c, xi, tree->centers, nI, dimX, N->begin, nb, phi);
+
+            for (j = 0; j < numCoef; j++)
+            {
+                const double* a = tree->coeff + N->begin + nI*j;
+                double tmp = 0.0;
+                #pragma omp simd reduction(+:tmp)
+                for (k = 0; k < nb; k++)
+                {
+                    tmp += a[k] * phi[k];
+                }
+                sum[j] += tmp;
+            }
+        }
+        else
+        {
+            stack[top++] = N->right;
+            stack[top++] = N->left;
+        }
+    }
 }
 /*************************************************************************/
 void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 {
-    
-    char *RBF_function_name = mxArrayToString(prhs[0]);
-    
+
     /* Check for proper number of arguments */
-    if(nrhs!=5) {
-        mexErrMsgTxt("5 inputs are required.");
+    if(nrhs!=5 && nrhs!=6) {
+        mexErrMsgTxt("5 or 6 inputs are required.");
     } else if(nlhs>1) {
         mexErrMsgTxt("Too many output arguments.");
     }
 
+    char *RBF_function_name = mxArrayToString(prhs[0]);
+    RBF_Type type = GetRBFType(RBF_function_name);
+    mxFree(RBF_function_name);
+
     double* interp_points = mxGetPr(prhs[1]);
     int nI  = mxGetN(prhs[1]);
-    
+
     double* x = mxGetPr(prhs[2]);
     int dimX  = mxGetM(prhs[2]);
     int nPoints  = mxGetN(prhs[2]);
-    
+
     double* tmpPtr = mxGetPr(prhs[3]);
     double constant = tmpPtr[0];
-    
+
+    /* coeff is (nI+1+dimX) x numCoef: one interpolant per column */
     double* coeff = mxGetPr(prhs[4]);
-    
-    plhs[0] = mxCreateDoubleMatrix(nPoints,1, mxREAL);
+    int numCoef   = mxGetN(prhs[4]);
+    int ldCoef    = mxGetM(prhs[4]);
+
+    if (ldCoef != nI+1+dimX)
+    {
+        mexErrMsgTxt("coeff must have nI+1+dimX rows.");
+    }
+
+    plhs[0] = mxCreateDoubleMatrix(nPoints, numCoef, mxREAL);
     double* I_f    = mxGetPr(plhs[0]);
-    
+
+    /* centers stored by coordinate (nI x dimX), so that the distances to
+     * a block of centers are computed with unit stride */
+    double* centers = mxMalloc(sizeof(double) * nI * dimX);
+    int k, l;
+    for (k = 0; k < nI; k++)
+    {
+        for (l = 0; l < dimX; l++)
+        {
+            centers[k+nI*l] = interp_points[l+dimX*k];
+        }
+    }
+
+    /* optional 6th input: tolerance of the tree evaluation; 0 means exact */
+    double tol = (nrhs > 5) ? mxGetScalar(prhs[5]) : 0.0;
+
     int i;
-    #pragma omp parallel for shared(I_f,x) private(i) firstprivate(coeff,interp_points,nI,dimX,constant,RBF_function_name)
-    for (i = 0; i < nPoints; i++)
+    if (type == RBF_WENDLAND0 || type == RBF_WENDLAND2 || type == RBF_WENDLAND4)
     {
-        int l, k;
-        I_f[i] = 0.0;
-        for (k = 0; k < nI; k++)
+        /* compactly supported kernels: only the centers closer than the
+         * support radius, found by a spatial hash, contribute to each point */
+        RBF_Hash hash;
+        BuildHash(&hash, centers, nI, dimX, constant);
+
+        #pragma omp parallel shared(I_f,x,coeff,hash) firstprivate(nI,dimX,nPoints,numCoef,ldCoef,constant,type)
         {
-            /*d = distance(x[:,i], interp_points(:,k));*/
-            double tmp = 0;
+            int capacity = RBF_BLOCK;
+            int* idx    = malloc(sizeof(int) * capacity);
+            double* r2  = malloc(sizeof(double) * capacity);
+            double* phi = malloc(sizeof(double) * capacity);
+            int i;
+
+            #pragma omp for schedule(dynamic, RBF_TILE)
+            for (i = 0; i < nPoints; i++)
+            {
+                const double* xi = x+dimX*i;
+                int n = QueryHash(&hash, xi, idx, r2, capacity);
+                int j, k, l;
+
+                if (n > capacity)
+                {
+                    capacity = n;
+                    idx = realloc(idx, sizeof(int) * capacity);
+                    r2  = realloc(r2,  sizeof(double) * capacity);
+                    phi = realloc(phi, sizeof(double) * capacity);
+                    QueryHash(&hash, xi, idx, r2, capacity);
+                }
+
+                RBF_kernel(type, n, constant, r2, phi);
+
+                for (j = 0; j < numCoef; j++)
+                {
+                    const double* cj = coeff + ldCoef*j;
+                    double sum = cj[nI];
+                    for (k = 0; k < n; k++)
+                    {
+                        sum += cj[idx[k]] * phi[k];
+                    }
+                    /* linear polynomial term */
+                    for (l = 0; l < dimX; l++)
+                    {
+                        sum += cj[l+nI+1]*xi[l];
+                    }
+                    I_f[i+nPoints*j] = sum;
+                }
+            }
+
+            free(idx);
+            free(r2);
+            free(phi);
+        }
+
+        FreeHash(&hash);
+    }
+    else if (tol > 0)
+    {
+        RBF_Tree tree;
+        BuildTree(&tree, centers, coeff, nI, dimX, numCoef);
+
+        /* the far-field truncation error is of order theta^3 */
+        double theta = cbrt(tol);
+        double rcut2 = (tol < 1) ? -2*constant*constant*log(tol) : 0.0;
+
+        #pragma omp parallel for schedule(dynamic, RBF_TILE) shared(I_f,x,coeff,tree) private(i) firstprivate(nI,dimX,nPoints,numCoef,ldCoef,constant,type,theta,rcut2)
+        for (i = 0; i < nPoints; i++)
+        {
+            double sum[numCoef];
+            int j, l;
+
+            EvaluateTree(&tree, type, constant, theta, rcut2, x+dimX*i, sum);
+
+            /* linear polynomial term */
+            for (j = 0; j < numCoef; j++)
+            {
+                const double* cj = coeff + ldCoef*j;
+                sum[j] += cj[nI];
+                for (l = 0; l < dimX; l++)
+                {
+                    sum[j] += cj[l+nI+1]*x[l+dimX*i];
+                }
+                I_f[i+nPoints*j] = sum[j];
+            }
+        }
+
+        FreeTree(&tree);
+    }
+    else if (numCoef == 1)
+    {
+        #pragma omp parallel for shared(I_f,x,centers,coeff) private(i) firstprivate(nI,dimX,constant,type)
+        for (i = 0; i < nPoints; i++)
+        {
+            double phi[RBF_BLOCK];
+            double sum = 0.0;
+            int k0, k, l;
+
+            for (k0 = 0; k0 < nI; k0 += RBF_BLOCK)
+            {
+                int nb = (nI - k0 < RBF_BLOCK) ? nI - k0 : RBF_BLOCK;
+
+                RBF_block(type, constant, x+dimX*i, centers, nI, dimX, k0, nb, phi);
+
+                #pragma omp simd reduction(+:sum)
+                for (k = 0; k < nb; k++)
+                {
+                    sum += coeff[k0+k] * phi[k];
+                }
+            }
+
+            /* linear polynomial term */
+            sum += coeff[nI];
             for (l = 0; l < dimX; l++)
             {
-                double tmp2 = (x[l+dimX*i] - interp_points[l+dimX*k]);
-                tmp += (tmp2*tmp2);
+                sum += coeff[l+nI+1]*x[l+dimX*i];
             }
-            double d = sqrt(tmp);
-            I_f[i] +=  coeff[k] * RBF_function(d, constant, RBF_function_name);
+
+            I_f[i] = sum;
         }
-        
-        I_f[i] += coeff[nI];
-        
-        for (k = 0; k < dimX; k++)
+    }
+    else
+    {
+        /* I_f(i0:i0+np-1,:) += Phi' * coeff(k0:k0+nb-1,:), Phi being the
+         * nb x np tile of kernel values stored column by column (point) */
+        int i0;
+        #pragma omp parallel for shared(I_f,x,centers,coeff) private(i0) firstprivate(nI,dimX,nPoints,numCoef,ldCoef,constant,type)
+        for (i0 = 0; i0 < nPoints; i0 += RBF_TILE)
         {
-            I_f[i] += coeff[k+nI+1]*x[k+dimX*i];;
+            double Phi[RBF_BLOCK*RBF_TILE];
+            int np = (nPoints - i0 < RBF_TILE) ? nPoints - i0 : RBF_TILE;
+            int k0, p, j, l;
+
+            char* chn = "N";
+            char* cht = "T";
+            double one = 1.0;
+            ptrdiff_t M = np, N = numCoef, ldA = RBF_BLOCK, ldB = ldCoef, ldC = nPoints;
+
+            for (k0 = 0; k0 < nI; k0 += RBF_BLOCK)
+            {
+                int nb = (nI - k0 < RBF_BLOCK) ? nI - k0 : RBF_BLOCK;
+                ptrdiff_t K = nb;
+
+                for (p = 0; p < np; p++)
+                {
+                    RBF_block(type, constant, x+dimX*(i0+p), centers, nI, dimX, k0, nb, Phi+RBF_BLOCK*p);
+                }
+
+                dgemm(cht, chn, &M, &N, &K, &one, Phi, &ldA, coeff+k0, &ldB, &one, I_f+i0, &ldC);
+            }
+
+            /* linear polynomial term */
+            for (j = 0; j < numCoef; j++)
+            {
+                const double* cj = coeff + ldCoef*j;
+                for (p = 0; p < np; p++)
+                {
+                    double sum = cj[nI];
+                    for (l = 0; l < dimX; l++)
+                    {
+                        sum += cj[l+nI+1]*x[l+dimX*(i0+p)];
+                    }
+                    I_f[i0+p+nPoints*j] += sum;
+                }
+            }
         }
     }
-    mxFree(RBF_function_name);
+
+    mxFree(centers);
 }
 /*************************************************************************/
 
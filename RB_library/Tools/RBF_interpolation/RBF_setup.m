@@ -6,6 +6,17 @@ function RBF_data = RBF_setup(x, y, RBF_function_name, constant)
 %   num_interpolation_points, and a string RBF_FUNCTION specifying the
 %   type of RBF to be used, returns a struct containing the RBF
 %   interpolation coefficients
+%
+%   Y can also be a matrix of size k x num_interpolation_points: the k
+%   interpolants share the interpolation matrix, which is factorized once,
+%   and RBF_DATA.COEFF has one column per row of Y.
+%
+%   RBF_DATA = RBF_SETUP(X, Y, RBF_FUNCTION, CONSTANT) sets the shape
+%   parameter CONSTANT of the RBF. For the compactly supported Wendland
+%   functions 'wendlandC0', 'wendlandC2' and 'wendlandC4', CONSTANT is the
+%   support radius: the interpolation matrix is then sparse, it is built
+%   from the neighbor lists of the points and factorized by sparse
+%   Cholesky.
 
 %   This file is part of redbKIT.
 %   Copyright (c) 2015, Ecole Polytechnique Federale de Lausanne (EPFL)
@@ -19,21 +30,22 @@ end
 
 [dimX, num_int_p] = size(x);
 
-if (length(y)~=num_int_p)
+if (size(y,2)~=num_int_p)
   error('x and y should have the same number of columns');
 end
 
-if (size(y,1)~=1)
-  error('y should be a row vector');
-end
-
 RBF_data.x    = x;
 RBF_data.y    = y;
 
 RBF_data.RBF_function_type  = RBF_function_name;
 
+compact = any(strcmp(RBF_function_name, {'wendlandC0', 'wendlandC2', 'wendlandC4'}));
+
 if nargin < 4 || isempty(constant)
     RBF_data.constant      = (prod(max(x,[],2)-min(x,[],2))/num_int_p)^(1/dimX); %approx. average distance between the nodes
+    if compact
+        RBF_data.constant  = 4 * RBF_data.constant; % support radius
+    end
 else
     RBF_data.constant = constant;
 end
@@ -52,11 +64,40 @@ switch RBF_function_name
       case 'gaussian'
         RBF_data.RBF_function   = @(r,c)exp(-0.5*r.*r/(c*c));
         
+      case 'wendlandC0'
+        RBF_data.RBF_function   = @(r,c)max(1-r/c,0).^2;
+        
+      case 'wendlandC2'
+        RBF_data.RBF_function   = @(r,c)max(1-r/c,0).^4.*(4*r/c+1);
+        
+      case 'wendlandC4'
+        RBF_data.RBF_function   = @(r,c)max(1-r/c,0).^6.*(35*(r/c).^2+18*r/c+3)/3;
+        
     otherwise
         warning('RBF_function set to gaussian')
         RBF_data.RBF_function   = @(r,c)exp(-0.5*r.*r/(c*c));
 end
 
+if compact
+    % sparse, symmetric positive definite A: the polynomial part is
+    % eliminated by the Schur complement P'*inv(A)*P of size dimX+1
+    [rows, cols, coef] = RBF_SparseMatrix_Fast(RBF_function_name, x, RBF_data.constant);
+    A         = sparse(rows, cols, coef, num_int_p, num_int_p);
+    [R, p, S] = chol(A);
+    if p > 0
+        error('RBF_setup: the interpolation matrix is not positive definite');
+    end
+    solveA    = @(B) S * (R \ (R' \ (S' * B)));
+    
+    P         = [ones(num_int_p,1) x'];
+    invA_P    = solveA(P);
+    invA_y    = solveA(y');
+    beta      = (P' * invA_P) \ (P' * invA_y);
+    
+    RBF_data.coeff = [invA_y - invA_P * beta; beta];
+    return;
+end
+
 A       = zeros(num_int_p,num_int_p);
 for i = 1 : num_int_p
     for j = 1 : i
@@ -71,7 +112,7 @@ P   = [ones(num_int_p,1) x'];
 A   = [ A                P
         P' zeros(dimX+1,dimX+1)];
   
-b   = [y'; zeros(dimX+1, 1)];                       
+b   = [y'; zeros(dimX+1, size(y,1))];                       
 
 RBF_data.coeff = A \ b;
 
@@ -33,24 +33,39 @@ end
 
 
 source_files{1} = {'FEM_library/Models/ADR/','ADR_assembler_C_omp.c'};
-dependencies{1} = {};
+dependencies{1} = {'../../Core/Tools.c'};
 source_files{2} = {'FEM_library/Models/ADR/','Mass_assembler_C_omp.c'};
-dependencies{2} = {};
+dependencies{2} = {'../../Core/Tools.c'};
 source_files{3} = {'FEM_library/Models/CSM/','CSM_assembler_ExtForces.c'};
-dependencies{3} = {};
+dependencies{3} = {'../../Core/Tools.c'};
 source_files{4} = {'FEM_library/Models/CFD/','CFD_assembler_C_omp.c'};
 dependencies{4} = {'../../Core/Tools.c'};
 source_files{5} = {'FEM_library/Models/CFD/','CFD_assembler_ExtForces.c'};
-dependencies{5} = {};
+dependencies{5} = {'../../Core/Tools.c'};
 source_files{6} = {'FEM_library/Models/CSM/','CSM_assembler_C_omp.c'};
 dependencies{6} = {'../../Core/Tools.c', 'MaterialModels/NeoHookeanMaterial.c',...
                    'MaterialModels/LinearElasticMaterial.c', 'MaterialModels/SEMMTMaterial.c', ...
                    'MaterialModels/StVenantKirchhoffMaterial.c',...
-                   'MaterialModels/RaghavanVorpMaterial.c'};
+                   'MaterialModels/RaghavanVorpMaterial.c', ...
+                   'MaterialModels/TangentOperator.c'};
 source_files{7} = {'RB_library/Tools/RBF_interpolation/','RBF_evaluate_Fast.c'};
-dependencies{7} = {};
+dependencies{7} = {'RBF_Tools.c'};
 source_files{8} = {'FEM_library/Models/ADR/','ADR_SUPGassembler_C_omp.c'};
 dependencies{8} = {'../../Core/Tools.c'};
+source_files{9} = {'FEM_library/Core/','SparseScatter_C.c'};
+dependencies{9} = {'Tools.c'};
+source_files{10} = {'FEM_library/Core/','geotrasf_C_omp.c'};
+dependencies{10} = {'Tools.c'};
+source_files{11} = {'FEM_library/Models/ADR/','MassOperator_C_omp.c'};
+dependencies{11} = {'../../Core/Tools.c'};
+source_files{12} = {'RB_library/Tools/RBF_interpolation/','RBF_SparseMatrix_Fast.c'};
+dependencies{12} = {'RBF_Tools.c'};
+source_files{13} = {'FEM_library/Mesh/','read_msh_C.c'};
+dependencies{13} = {};
+
+% libraries to be linked, if any
+libraries       = cell(size(source_files));
+libraries{7}    = '-lmwblas';
 
 %Mexify = 0;               
 if nargin < 2 || isempty( sources )
@@ -80,7 +95,7 @@ for i = sources
         
     end
     
-    mex_command = sprintf( 'mex %s%s %s %s -outdir %s', file_path, file_name, all_dep, Flags, file_path);
+    mex_command = sprintf( 'mex %s%s %s %s %s -outdir %s', file_path, file_name, all_dep, libraries{i}, Flags, file_path);
     eval( mex_command );
 end
 